@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+constexpr size_t cache_line_size = 64;
+constexpr size_t page_size = 4096;
+
+// std::aligned_alloc is not provided by MSVC, and requires the size to be a
+// multiple of the alignment, so route through these instead.
+inline void* aligned_malloc(size_t size, size_t alignment) {
+  alignment = alignment < alignof(std::max_align_t) ? alignof(std::max_align_t)
+                                                    : alignment;
+  size_t roundedSize = (size + alignment - 1) & ~(alignment - 1);
+#ifdef _WIN32
+  return _aligned_malloc(roundedSize, alignment);
+#else
+  return std::aligned_alloc(alignment, roundedSize);
+#endif
+}
+
+inline void aligned_free(void* memory) {
+#ifdef _WIN32
+  _aligned_free(memory);
+#else
+  std::free(memory);
+#endif
+}
+
+struct aligned_free_deleter {
+  void operator()(void* memory) const { aligned_free(memory); }
+};
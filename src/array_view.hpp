@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <stdexcept>
+
+// Non-owning view of a contiguous, read-only array.
+template <typename T>
+struct array_view {
+  array_view() = default;
+  constexpr array_view(const T* data, size_t size)
+      : m_data(data), m_size(size) {}
+
+  constexpr const T* data() const { return m_data; }
+  constexpr size_t size() const { return m_size; }
+  constexpr size_t size_bytes() const { return m_size * sizeof(T); }
+  constexpr bool empty() const { return m_size == 0; }
+
+  constexpr const T* begin() const { return m_data; }
+  constexpr const T* end() const { return m_data + m_size; }
+
+  constexpr const T& operator[](size_t index) const { return m_data[index]; }
+
+  array_view subview(size_t offset, size_t count) const {
+    if (offset > m_size || count > m_size - offset) {
+      throw std::out_of_range{"array_view::subview out of range"};
+    }
+    return {m_data + offset, count};
+  }
+
+private:
+  const T* m_data{};
+  size_t m_size{};
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <limits>
+
+// Minimal timing harness for the *.bench.cpp executables. Runs fn
+// `repetitions` times, keeps the fastest run and prints it as nanoseconds
+// per operation.
+template <typename Fn>
+double run_benchmark(
+    const char* name,
+    size_t operations,
+    Fn&& fn,
+    size_t repetitions = 5) {
+  using clock = std::chrono::steady_clock;
+  double best = std::numeric_limits<double>::max();
+  for (size_t rep{}; rep < repetitions; ++rep) {
+    auto start = clock::now();
+    fn();
+    auto end = clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    best = std::min(best, ns);
+  }
+  double perOperation = best / static_cast<double>(operations);
+  std::printf("%-48s %12.2f ns/op\n", name, perOperation);
+  return perOperation;
+}
+
+// Keeps the optimizer from discarding a result the benchmark never reads.
+// The empty asm claims to read value and clobber memory, so the work that
+// produced it can't be dropped or moved out of the timed region.
+template <typename T>
+void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile const void* sink{};
+  sink = &value;
+#endif
+}
@@ -0,0 +1,82 @@
+#include "bench.hpp"
+#include "bvh.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <vector>
+
+// Instances spread over a 4 km square world, 200 m tall, seen by a camera
+// with a 500 m far plane: the typical case where most of the scene is far
+// away and a flat cull wastes its time.
+int main() {
+  auto projection =
+      glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 500.f);
+  auto view = glm::lookAt(
+      glm::vec3(0.f, 50.f, 0.f),
+      glm::vec3(100.f, 40.f, -100.f),
+      glm::vec3(0.f, 1.f, 0.f));
+  auto frustum = extract_frustum(projection * view);
+
+  for (size_t count : {size_t{10000}, size_t{100000}, size_t{1000000}}) {
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<float> ground{-2000.f, 2000.f};
+    std::uniform_real_distribution<float> height{0.f, 200.f};
+    std::uniform_real_distribution<float> size{0.5f, 8.f};
+    instance_bounds bounds{};
+    bounds.reserve(count);
+    for (size_t i{}; i < count; ++i) {
+      std::array<float, 3> low{ground(rng), height(rng), ground(rng)};
+      bounds.add_box(
+          low, {low[0] + size(rng), low[1] + size(rng), low[2] + size(rng)});
+    }
+    char name[64];
+
+    bvh tree{};
+    std::snprintf(name, sizeof(name), "build %zu (per instance)", count);
+    run_benchmark(name, count, [&] { tree.build(bounds); }, 3);
+
+    std::snprintf(name, sizeof(name), "full refit %zu (per instance)", count);
+    run_benchmark(name, count, [&] { tree.refit(); });
+
+    // one percent of the instances move each frame
+    std::vector<uint32_t> moved;
+    std::uniform_int_distribution<uint32_t> pick{
+        0, static_cast<uint32_t>(count - 1)};
+    for (size_t i{}; i < count / 100; ++i) {
+      auto instance = pick(rng);
+      bounds.centerX[instance] += 1.f;
+      moved.push_back(instance);
+    }
+    std::snprintf(
+        name, sizeof(name), "partial refit %zu (per moved)", count);
+    run_benchmark(name, moved.size(), [&] { tree.refit(moved); });
+
+    std::vector<uint32_t> visible;
+    visible.reserve(count + 1);
+    std::snprintf(name, sizeof(name), "bvh frustum query %zu", count);
+    run_benchmark(name, 1, [&] {
+      visible.clear();
+      tree.query(frustum, visible);
+      do_not_optimize(visible);
+    });
+    auto bvhVisible = visible.size();
+    std::snprintf(name, sizeof(name), "flat cull %zu", count);
+    run_benchmark(name, 1, [&] {
+      cull_instances(frustum, bounds, visible);
+      do_not_optimize(visible);
+    });
+    std::printf("  %zu of %zu visible\n", bvhVisible, count);
+
+    std::snprintf(name, sizeof(name), "bvh ray query %zu", count);
+    run_benchmark(name, 1, [&] {
+      visible.clear();
+      tree.query_ray({0.f, 50.f, 0.f}, {1.f, -0.1f, -1.f}, 2000.f, visible);
+      do_not_optimize(visible);
+    });
+    std::snprintf(name, sizeof(name), "bvh sphere query %zu", count);
+    run_benchmark(name, 1, [&] {
+      visible.clear();
+      tree.query_sphere({0.f, 50.f, 0.f}, 100.f, visible);
+      do_not_optimize(visible);
+    });
+  }
+}
@@ -0,0 +1,543 @@
+#pragma once
+#include "frustum_culling.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Bounding volume hierarchy over the boxes of an instance_bounds store, which
+// must outlive it and keep its size between builds. Built top-down with a
+// binned surface area heuristic; when instances move, refit() updates node
+// boxes in place without changing the topology, which stays efficient until
+// the motion is large relative to the scene and a rebuild pays off again.
+struct bvh {
+  struct node {
+    std::array<float, 3> boundsMin;
+    // inner nodes: index of the left child, the right child follows it
+    // leaves: first entry in the instance permutation
+    uint32_t leftFirst;
+    std::array<float, 3> boundsMax;
+    // 0 for inner nodes
+    uint32_t count;
+  };
+
+  static constexpr uint32_t max_leaf_size = 4;
+  static constexpr size_t bin_count = 12;
+
+  bvh() = default;
+  explicit bvh(const instance_bounds& bounds) { build(bounds); }
+
+  void build(const instance_bounds& bounds) {
+    m_bounds = &bounds;
+    auto count = static_cast<uint32_t>(bounds.size());
+    // the build partitions a contiguous copy of the boxes rather than
+    // gathering from the SoA streams through the permutation
+    m_items.resize(count);
+    for (uint32_t i{}; i < count; ++i) {
+      auto [low, high] = instance_box(i);
+      m_items[i] = {low, high, centroid(i), i};
+    }
+    m_instances.resize(count);
+    m_nodes.clear();
+    m_parents.clear();
+    m_leafOf.assign(count, 0);
+    m_depth = 0;
+    if (count == 0) {
+      return;
+    }
+    m_nodes.reserve(size_t{count} * 2);
+    m_parents.reserve(size_t{count} * 2);
+    m_nodes.push_back({});
+    m_parents.push_back(0);
+    m_nodes[0].leftFirst = 0;
+    m_nodes[0].count = count;
+
+    std::vector<uint32_t> stack{0};
+    while (!stack.empty()) {
+      auto index = stack.back();
+      stack.pop_back();
+      auto& built = m_nodes[index];
+      built.boundsMin = {empty_low, empty_low, empty_low};
+      built.boundsMax = {empty_high, empty_high, empty_high};
+      for (uint32_t i{}; i < built.count; ++i) {
+        auto& item = m_items[built.leftFirst + i];
+        grow(built.boundsMin, built.boundsMax, item.low, item.high);
+      }
+      uint32_t splitAt{};
+      if (!split(index, splitAt)) {
+        for (uint32_t i{}; i < m_nodes[index].count; ++i) {
+          auto position = m_nodes[index].leftFirst + i;
+          m_instances[position] = m_items[position].instance;
+          m_leafOf[m_items[position].instance] = index;
+        }
+        continue;
+      }
+      auto first = m_nodes[index].leftFirst;
+      auto total = m_nodes[index].count;
+      auto left = static_cast<uint32_t>(m_nodes.size());
+      node leftNode{};
+      leftNode.leftFirst = first;
+      leftNode.count = splitAt - first;
+      node rightNode{};
+      rightNode.leftFirst = splitAt;
+      rightNode.count = total - leftNode.count;
+      m_nodes.push_back(leftNode);
+      m_nodes.push_back(rightNode);
+      m_parents.push_back(index);
+      m_parents.push_back(index);
+      m_nodes[index].leftFirst = left;
+      m_nodes[index].count = 0;
+      stack.push_back(left);
+      stack.push_back(left + 1);
+    }
+    m_items.clear();
+    m_items.shrink_to_fit();
+
+    // children are stored after their parent, so one pass finds the depth
+    std::vector<uint32_t> depths(m_nodes.size());
+    for (size_t i{1}; i < m_nodes.size(); ++i) {
+      depths[i] = depths[m_parents[i]] + 1;
+      m_depth = std::max(m_depth, depths[i]);
+    }
+  }
+
+  // Recomputes every node box from the current instance bounds.
+  void refit() {
+    // children are always stored after their parent
+    for (size_t i = m_nodes.size(); i-- > 0;) {
+      refit_node(static_cast<uint32_t>(i));
+    }
+  }
+
+  // Recomputes only the boxes on the paths from the changed instances' leaves
+  // to the root.
+  void refit(const std::vector<uint32_t>& changedInstances) {
+    m_dirty.clear();
+    m_dirtyFlags.resize(m_nodes.size());
+    for (auto instance : changedInstances) {
+      auto index = m_leafOf[instance];
+      while (!m_dirtyFlags[index]) {
+        m_dirtyFlags[index] = true;
+        m_dirty.push_back(index);
+        if (index == 0) {
+          break;
+        }
+        index = m_parents[index];
+      }
+    }
+    std::sort(m_dirty.begin(), m_dirty.end(), std::greater<>{});
+    for (auto index : m_dirty) {
+      refit_node(index);
+      m_dirtyFlags[index] = false;
+    }
+  }
+
+  // Appends the instances whose boxes intersect the frustum. Subtrees
+  // entirely inside skip the remaining plane tests. Queries keep no state in
+  // the tree, so any number may run concurrently between builds and refits.
+  void query(const frustum& frustum, std::vector<uint32_t>& result) const {
+    if (m_nodes.empty()) {
+      return;
+    }
+    constexpr uint32_t allPlanes = (1u << 6) - 1;
+    traversal_stack stack{m_depth};
+    stack.push({0, allPlanes});
+    while (!stack.empty()) {
+      auto [index, planeMask] = stack.pop();
+      auto& current = m_nodes[index];
+      bool outside = false;
+      for (uint32_t p{}; p < 6 && !outside; ++p) {
+        if (!(planeMask & (1u << p))) {
+          continue;
+        }
+        auto& plane = frustum.planes[p];
+        // the box corners farthest along and against the plane normal
+        float farthest = plane[3];
+        float nearest = plane[3];
+        for (int axis{}; axis < 3; ++axis) {
+          float low = plane[axis] * current.boundsMin[axis];
+          float high = plane[axis] * current.boundsMax[axis];
+          farthest += std::max(low, high);
+          nearest += std::min(low, high);
+        }
+        if (farthest < 0.f) {
+          outside = true;
+        } else if (nearest >= 0.f) {
+          planeMask &= ~(1u << p);
+        }
+      }
+      if (outside) {
+        continue;
+      }
+      if (planeMask == 0 || current.count > 0) {
+        if (planeMask == 0) {
+          append_subtree(index, result);
+        } else {
+          append_leaf_if(current, result, [&](uint32_t instance) {
+            return box_in_frustum(frustum, instance);
+          });
+        }
+        continue;
+      }
+      stack.push({current.leftFirst, planeMask});
+      stack.push({current.leftFirst + 1, planeMask});
+    }
+  }
+
+  // Appends the instances whose boxes the ray origin + t * direction hits
+  // for t in [0, maxDistance].
+  void query_ray(
+      const std::array<float, 3>& origin,
+      const std::array<float, 3>& direction,
+      float maxDistance,
+      std::vector<uint32_t>& result) const {
+    if (m_nodes.empty()) {
+      return;
+    }
+    std::array<float, 3> inverse{};
+    for (int axis{}; axis < 3; ++axis) {
+      inverse[axis] = 1.f / direction[axis];
+    }
+    auto hits = [&](const std::array<float, 3>& low,
+                    const std::array<float, 3>& high) {
+      float enter = 0.f;
+      float exit = maxDistance;
+      for (int axis{}; axis < 3; ++axis) {
+        float t0 = (low[axis] - origin[axis]) * inverse[axis];
+        float t1 = (high[axis] - origin[axis]) * inverse[axis];
+        // NaN from 0 * inf (origin on a slab of a parallel ray) is ignored
+        // by min/max argument order, keeping the test conservative
+        enter = std::max(enter, std::min(t0, t1));
+        exit = std::min(exit, std::max(t0, t1));
+      }
+      return enter <= exit;
+    };
+    traverse(
+        [&](const node& current) {
+          return hits(current.boundsMin, current.boundsMax);
+        },
+        [&](uint32_t instance) {
+          auto [low, high] = instance_box(instance);
+          return hits(low, high);
+        },
+        result);
+  }
+
+  // Appends the instances whose boxes overlap the sphere.
+  void query_sphere(
+      const std::array<float, 3>& center,
+      float radius,
+      std::vector<uint32_t>& result) const {
+    if (m_nodes.empty()) {
+      return;
+    }
+    auto overlaps = [&](const std::array<float, 3>& low,
+                        const std::array<float, 3>& high) {
+      float squared{};
+      for (int axis{}; axis < 3; ++axis) {
+        float outside = std::max(
+            {low[axis] - center[axis], 0.f, center[axis] - high[axis]});
+        squared += outside * outside;
+      }
+      return squared <= radius * radius;
+    };
+    traverse(
+        [&](const node& current) {
+          return overlaps(current.boundsMin, current.boundsMax);
+        },
+        [&](uint32_t instance) {
+          auto [low, high] = instance_box(instance);
+          return overlaps(low, high);
+        },
+        result);
+  }
+
+  const std::vector<node>& nodes() const { return m_nodes; }
+  // edges from the root to the deepest leaf
+  uint32_t depth() const { return m_depth; }
+
+private:
+  struct traversal_entry {
+    uint32_t node;
+    uint32_t planeMask;
+  };
+
+  static constexpr size_t inline_stack_size = 64;
+
+  // Depth-first stack owned by one query. Popping a node at depth d leaves
+  // at most d pending siblings plus its two children, so depth + 1 entries
+  // always suffice; trees that shallow keep them on the caller's stack.
+  struct traversal_stack {
+    explicit traversal_stack(uint32_t depth) {
+      if (size_t{depth} + 1 > m_inline.size()) {
+        m_heap.resize(size_t{depth} + 1);
+        m_entries = m_heap.data();
+      }
+    }
+
+    traversal_stack(const traversal_stack&) = delete;
+    traversal_stack& operator=(const traversal_stack&) = delete;
+
+    void push(traversal_entry entry) { m_entries[m_size++] = entry; }
+    traversal_entry pop() { return m_entries[--m_size]; }
+    bool empty() const { return m_size == 0; }
+
+  private:
+    std::array<traversal_entry, inline_stack_size> m_inline;
+    std::vector<traversal_entry> m_heap;
+    traversal_entry* m_entries{m_inline.data()};
+    size_t m_size{};
+  };
+
+  const instance_bounds* m_bounds{};
+  std::vector<node> m_nodes;
+  std::vector<uint32_t> m_parents;
+  std::vector<uint32_t> m_instances;
+  struct build_item {
+    std::array<float, 3> low;
+    std::array<float, 3> high;
+    std::array<float, 3> centroid;
+    uint32_t instance;
+  };
+  std::vector<build_item> m_items;
+  std::vector<uint32_t> m_leafOf;
+  std::vector<uint32_t> m_dirty;
+  std::vector<bool> m_dirtyFlags;
+  uint32_t m_depth{};
+
+  std::pair<std::array<float, 3>, std::array<float, 3>> instance_box(
+      uint32_t instance) const {
+    auto& b = *m_bounds;
+    return {{b.centerX[instance] - b.extentX[instance],
+             b.centerY[instance] - b.extentY[instance],
+             b.centerZ[instance] - b.extentZ[instance]},
+            {b.centerX[instance] + b.extentX[instance],
+             b.centerY[instance] + b.extentY[instance],
+             b.centerZ[instance] + b.extentZ[instance]}};
+  }
+
+  std::array<float, 3> centroid(uint32_t instance) const {
+    auto& b = *m_bounds;
+    return {b.centerX[instance], b.centerY[instance], b.centerZ[instance]};
+  }
+
+  // the same test as cull_instances, so both agree exactly
+  bool box_in_frustum(const frustum& frustum, uint32_t instance) const {
+    auto& b = *m_bounds;
+    for (auto& plane : frustum.planes) {
+      float distance =
+          (plane[0] * b.centerX[instance] + plane[1] * b.centerY[instance]) +
+          (plane[2] * b.centerZ[instance] + plane[3]);
+      float radius = std::abs(plane[0]) * b.extentX[instance] +
+                     std::abs(plane[1]) * b.extentY[instance] +
+                     std::abs(plane[2]) * b.extentZ[instance];
+      if (distance + radius < 0.f) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static float half_area(
+      const std::array<float, 3>& low,
+      const std::array<float, 3>& high) {
+    std::array<float, 3> size{
+        high[0] - low[0], high[1] - low[1], high[2] - low[2]};
+    return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+  }
+
+  static void grow(
+      std::array<float, 3>& low,
+      std::array<float, 3>& high,
+      const std::array<float, 3>& otherLow,
+      const std::array<float, 3>& otherHigh) {
+    for (int axis{}; axis < 3; ++axis) {
+      low[axis] = std::min(low[axis], otherLow[axis]);
+      high[axis] = std::max(high[axis], otherHigh[axis]);
+    }
+  }
+
+  static constexpr float empty_low = std::numeric_limits<float>::max();
+  static constexpr float empty_high = std::numeric_limits<float>::lowest();
+
+  void update_node_bounds(uint32_t index) {
+    auto& current = m_nodes[index];
+    current.boundsMin = {empty_low, empty_low, empty_low};
+    current.boundsMax = {empty_high, empty_high, empty_high};
+    for (uint32_t i{}; i < current.count; ++i) {
+      auto [low, high] = instance_box(m_instances[current.leftFirst + i]);
+      grow(current.boundsMin, current.boundsMax, low, high);
+    }
+  }
+
+  void refit_node(uint32_t index) {
+    auto& current = m_nodes[index];
+    if (current.count > 0) {
+      update_node_bounds(index);
+      return;
+    }
+    auto& left = m_nodes[current.leftFirst];
+    auto& right = m_nodes[current.leftFirst + 1];
+    current.boundsMin = left.boundsMin;
+    current.boundsMax = left.boundsMax;
+    grow(
+        current.boundsMin, current.boundsMax, right.boundsMin, right.boundsMax);
+  }
+
+  // Finds the cheapest binned SAH split of a node and partitions its
+  // instances. Returns false when the node should stay a leaf.
+  bool split(uint32_t index, uint32_t& splitAt) {
+    auto first = m_nodes[index].leftFirst;
+    auto count = m_nodes[index].count;
+    if (count <= 1) {
+      return false;
+    }
+    std::array<float, 3> centroidMin{empty_low, empty_low, empty_low};
+    std::array<float, 3> centroidMax{empty_high, empty_high, empty_high};
+    for (uint32_t i{}; i < count; ++i) {
+      auto& c = m_items[first + i].centroid;
+      grow(centroidMin, centroidMax, c, c);
+    }
+
+    struct bin {
+      std::array<float, 3> low{empty_low, empty_low, empty_low};
+      std::array<float, 3> high{empty_high, empty_high, empty_high};
+      uint32_t count{};
+    };
+    // bin all three axes in one pass over the instances
+    std::array<float, 3> scale{};
+    for (int axis{}; axis < 3; ++axis) {
+      float extent = centroidMax[axis] - centroidMin[axis];
+      scale[axis] = extent > 0.f ? bin_count / extent : 0.f;
+    }
+    std::array<std::array<bin, bin_count>, 3> axisBins{};
+    for (uint32_t i{}; i < count; ++i) {
+      auto& item = m_items[first + i];
+      for (int axis{}; axis < 3; ++axis) {
+        auto b = std::min(
+            bin_count - 1,
+            size_t((item.centroid[axis] - centroidMin[axis]) * scale[axis]));
+        auto& target = axisBins[axis][b];
+        grow(target.low, target.high, item.low, item.high);
+        ++target.count;
+      }
+    }
+
+    float bestCost = std::numeric_limits<float>::max();
+    int bestAxis = -1;
+    size_t bestBin{};
+    for (int axis{}; axis < 3; ++axis) {
+      if (scale[axis] == 0.f) {
+        continue;
+      }
+      auto& bins = axisBins[axis];
+      // sweep from both ends to get the area and count left and right of
+      // each of the bin_count - 1 split planes
+      std::array<float, bin_count - 1> leftArea{};
+      std::array<uint32_t, bin_count - 1> leftCount{};
+      bin running{};
+      for (size_t b{}; b + 1 < bin_count; ++b) {
+        grow(running.low, running.high, bins[b].low, bins[b].high);
+        running.count += bins[b].count;
+        leftArea[b] = running.count ? half_area(running.low, running.high) : 0;
+        leftCount[b] = running.count;
+      }
+      running = {};
+      for (size_t b = bin_count - 1; b > 0; --b) {
+        grow(running.low, running.high, bins[b].low, bins[b].high);
+        running.count += bins[b].count;
+        float rightArea =
+            running.count ? half_area(running.low, running.high) : 0;
+        float cost = leftCount[b - 1] * leftArea[b - 1] +
+                     running.count * rightArea;
+        if (leftCount[b - 1] > 0 && running.count > 0 && cost < bestCost) {
+          bestCost = cost;
+          bestAxis = axis;
+          bestBin = b;
+        }
+      }
+    }
+
+    auto& current = m_nodes[index];
+    float leafCost = count * half_area(current.boundsMin, current.boundsMax);
+    if (bestAxis < 0) {
+      // all centroids coincide; halve large nodes anyway to bound leaf size
+      if (count <= max_leaf_size) {
+        return false;
+      }
+      splitAt = first + count / 2;
+      return true;
+    }
+    if (count <= max_leaf_size && bestCost >= leafCost) {
+      return false;
+    }
+
+    auto middle = std::partition(
+        m_items.begin() + first,
+        m_items.begin() + first + count,
+        [&](const build_item& item) {
+          auto b = std::min(
+              bin_count - 1,
+              size_t(
+                  (item.centroid[bestAxis] - centroidMin[bestAxis]) *
+                  scale[bestAxis]));
+          return b < bestBin;
+        });
+    splitAt = static_cast<uint32_t>(middle - m_items.begin());
+    return splitAt != first && splitAt != first + count;
+  }
+
+  template <typename Predicate>
+  void append_leaf_if(
+      const node& leaf,
+      std::vector<uint32_t>& result,
+      Predicate&& predicate) const {
+    for (uint32_t i{}; i < leaf.count; ++i) {
+      auto instance = m_instances[leaf.leftFirst + i];
+      if (predicate(instance)) {
+        result.push_back(instance);
+      }
+    }
+  }
+
+  void append_subtree(uint32_t index, std::vector<uint32_t>& result) const {
+    // a subtree's instances are one contiguous range of the permutation
+    auto first = index;
+    while (m_nodes[first].count == 0) {
+      first = m_nodes[first].leftFirst;
+    }
+    auto last = index;
+    while (m_nodes[last].count == 0) {
+      last = m_nodes[last].leftFirst + 1;
+    }
+    result.insert(
+        result.end(),
+        m_instances.begin() + m_nodes[first].leftFirst,
+        m_instances.begin() + m_nodes[last].leftFirst + m_nodes[last].count);
+  }
+
+  template <typename NodeTest, typename InstanceTest>
+  void traverse(
+      NodeTest&& nodeTest,
+      InstanceTest&& instanceTest,
+      std::vector<uint32_t>& result) const {
+    traversal_stack stack{m_depth};
+    stack.push({0, 0});
+    while (!stack.empty()) {
+      auto index = stack.pop().node;
+      auto& current = m_nodes[index];
+      if (!nodeTest(current)) {
+        continue;
+      }
+      if (current.count > 0) {
+        append_leaf_if(current, result, instanceTest);
+        continue;
+      }
+      stack.push({current.leftFirst, 0});
+      stack.push({current.leftFirst + 1, 0});
+    }
+  }
+};
@@ -0,0 +1,185 @@
+#include "bvh.hpp"
+#include <catch2/catch.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <thread>
+
+namespace {
+instance_bounds make_scene(size_t count, unsigned seed = 5) {
+  std::mt19937 rng{seed};
+  std::uniform_real_distribution<float> position{-200.f, 200.f};
+  std::uniform_real_distribution<float> size{0.1f, 5.f};
+  instance_bounds bounds{};
+  for (size_t i{}; i < count; ++i) {
+    std::array<float, 3> low{position(rng), position(rng), position(rng)};
+    bounds.add_box(
+        low, {low[0] + size(rng), low[1] + size(rng), low[2] + size(rng)});
+  }
+  return bounds;
+}
+
+frustum make_camera_frustum(const glm::vec3& eye, const glm::vec3& target) {
+  auto projection =
+      glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 150.f);
+  auto view = glm::lookAt(eye, target, glm::vec3(0.f, 1.f, 0.f));
+  return extract_frustum(projection * view);
+}
+
+std::vector<uint32_t> sorted(std::vector<uint32_t> values) {
+  std::sort(values.begin(), values.end());
+  return values;
+}
+
+// Every instance box is inside its leaf and every node inside its parent.
+bool bounds_nest(const bvh& tree, const instance_bounds& bounds) {
+  auto& nodes = tree.nodes();
+  auto contains = [](const bvh::node& outer,
+                     const std::array<float, 3>& low,
+                     const std::array<float, 3>& high) {
+    for (int axis{}; axis < 3; ++axis) {
+      if (low[axis] < outer.boundsMin[axis] ||
+          high[axis] > outer.boundsMax[axis]) {
+        return false;
+      }
+    }
+    return true;
+  };
+  for (auto& current : nodes) {
+    if (current.count == 0) {
+      for (auto child : {current.leftFirst, current.leftFirst + 1}) {
+        if (!contains(
+                current, nodes[child].boundsMin, nodes[child].boundsMax)) {
+          return false;
+        }
+      }
+    }
+  }
+  std::vector<uint32_t> all;
+  tree.query_sphere({0.f, 0.f, 0.f}, 1e6f, all);
+  return sorted(all).size() == bounds.size();
+}
+}  // namespace
+
+TEST_CASE("A BVH frustum query matches brute-force culling") {
+  auto count = GENERATE(size_t{0}, size_t{1}, size_t{7}, size_t{20000});
+  auto bounds = make_scene(count);
+  bvh tree{bounds};
+  REQUIRE(bounds_nest(tree, bounds));
+  for (auto target : {glm::vec3(0.f, 0.f, -1.f), glm::vec3(1.f, 0.3f, 0.f)}) {
+    auto frustum = make_camera_frustum(glm::vec3(0.f), target);
+    std::vector<uint32_t> expected;
+    cull_instances(frustum, bounds, expected, cull_path::scalar);
+    std::vector<uint32_t> visible;
+    tree.query(frustum, visible);
+    REQUIRE(sorted(visible) == expected);
+  }
+}
+
+TEST_CASE("BVH ray and sphere queries match brute force") {
+  auto bounds = make_scene(5000, 11);
+  bvh tree{bounds};
+  std::mt19937 rng{3};
+  std::uniform_real_distribution<float> unit{-1.f, 1.f};
+  for (int trial{}; trial < 20; ++trial) {
+    std::array<float, 3> origin{unit(rng) * 200, unit(rng) * 200, 0.f};
+    std::array<float, 3> direction{unit(rng), unit(rng), unit(rng)};
+    std::array<float, 3> center{unit(rng) * 150, unit(rng) * 150, 0.f};
+    float radius = 30.f;
+
+    std::vector<uint32_t> rayExpected;
+    std::vector<uint32_t> sphereExpected;
+    for (uint32_t i{}; i < bounds.size(); ++i) {
+      std::array<float, 3> low{
+          bounds.centerX[i] - bounds.extentX[i],
+          bounds.centerY[i] - bounds.extentY[i],
+          bounds.centerZ[i] - bounds.extentZ[i]};
+      std::array<float, 3> high{
+          bounds.centerX[i] + bounds.extentX[i],
+          bounds.centerY[i] + bounds.extentY[i],
+          bounds.centerZ[i] + bounds.extentZ[i]};
+      float enter = 0.f;
+      float exit = 300.f;
+      float squared{};
+      for (int axis{}; axis < 3; ++axis) {
+        float t0 = (low[axis] - origin[axis]) / direction[axis];
+        float t1 = (high[axis] - origin[axis]) / direction[axis];
+        enter = std::max(enter, std::min(t0, t1));
+        exit = std::min(exit, std::max(t0, t1));
+        float outside = std::max(
+            {low[axis] - center[axis], 0.f, center[axis] - high[axis]});
+        squared += outside * outside;
+      }
+      if (enter <= exit) {
+        rayExpected.push_back(i);
+      }
+      if (squared <= radius * radius) {
+        sphereExpected.push_back(i);
+      }
+    }
+
+    std::vector<uint32_t> hits;
+    tree.query_ray(origin, direction, 300.f, hits);
+    REQUIRE(sorted(hits) == rayExpected);
+    std::vector<uint32_t> overlaps;
+    tree.query_sphere(center, radius, overlaps);
+    REQUIRE(sorted(overlaps) == sphereExpected);
+  }
+}
+
+TEST_CASE("Refitting after instances move keeps queries exact") {
+  auto bounds = make_scene(10000, 21);
+  bvh tree{bounds};
+  std::mt19937 rng{8};
+  std::uniform_real_distribution<float> offset{-20.f, 20.f};
+  std::uniform_int_distribution<uint32_t> pick{0, 9999};
+
+  std::vector<uint32_t> moved;
+  for (int i{}; i < 500; ++i) {
+    auto instance = pick(rng);
+    bounds.centerX[instance] += offset(rng);
+    bounds.centerY[instance] += offset(rng);
+    moved.push_back(instance);
+  }
+  auto refitPartial = GENERATE(true, false);
+  if (refitPartial) {
+    tree.refit(moved);
+  } else {
+    tree.refit();
+  }
+  REQUIRE(bounds_nest(tree, bounds));
+
+  auto frustum =
+      make_camera_frustum(glm::vec3(0.f, 0.f, 50.f), glm::vec3(0.f));
+  std::vector<uint32_t> expected;
+  cull_instances(frustum, bounds, expected, cull_path::scalar);
+  std::vector<uint32_t> visible;
+  tree.query(frustum, visible);
+  REQUIRE(sorted(visible) == expected);
+}
+
+TEST_CASE("Concurrent BVH queries agree with a single-threaded one") {
+  auto bounds = make_scene(20000, 13);
+  bvh tree{bounds};
+  auto frustum = make_camera_frustum(glm::vec3(0.f), glm::vec3(1.f, 0.f, 0.f));
+  std::vector<uint32_t> expected;
+  tree.query(frustum, expected);
+
+  std::vector<std::vector<uint32_t>> results(4);
+  std::vector<std::thread> threads;
+  for (auto& result : results) {
+    threads.emplace_back([&] {
+      for (int repeat{}; repeat < 20; ++repeat) {
+        result.clear();
+        tree.query(frustum, result);
+        std::vector<uint32_t> all;
+        tree.query_sphere({0.f, 0.f, 0.f}, 1e6f, all);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (auto& result : results) {
+    REQUIRE(result == expected);
+  }
+}
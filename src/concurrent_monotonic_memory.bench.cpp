@@ -0,0 +1,68 @@
+#include "bench.hpp"
+#include "concurrent_monotonic_memory.hpp"
+#include "monotonic_allocator.hpp"
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr size_t allocationsPerThread = 200000;
+constexpr size_t allocationSize = 48;
+
+template <typename Work>
+void run_threads(size_t threadCount, Work&& work) {
+  std::vector<std::thread> threads;
+  for (size_t t{}; t < threadCount; ++t) {
+    threads.emplace_back(work);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+int main() {
+  size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  size_t arenaSize = (allocationSize + 64) * allocationsPerThread * maxThreads;
+
+  for (size_t threadCount{1}; threadCount <= maxThreads;
+       threadCount = threadCount == maxThreads
+                         ? maxThreads + 1
+                         : std::min(threadCount * 2, maxThreads)) {
+    size_t operations = allocationsPerThread * threadCount;
+    auto label = [&](const char* name) {
+      return std::string{name} + " x" + std::to_string(threadCount);
+    };
+
+    monotonic_memory locked{arenaSize};
+    std::mutex lock;
+    run_benchmark(label("mutex + monotonic_memory").c_str(), operations, [&] {
+      locked.reset();
+      run_threads(threadCount, [&] {
+        for (size_t i{}; i < allocationsPerThread; ++i) {
+          std::lock_guard<std::mutex> guard{lock};
+          do_not_optimize(locked.allocate_bytes(allocationSize, 8));
+        }
+      });
+    });
+
+    concurrent_monotonic_memory shared{arenaSize};
+    run_benchmark(label("concurrent fetch_add").c_str(), operations, [&] {
+      shared.reset();
+      run_threads(threadCount, [&] {
+        for (size_t i{}; i < allocationsPerThread; ++i) {
+          do_not_optimize(shared.allocate_bytes(allocationSize, 8));
+        }
+      });
+    });
+
+    run_benchmark(label("concurrent thread_cache").c_str(), operations, [&] {
+      shared.reset();
+      run_threads(threadCount, [&] {
+        concurrent_monotonic_memory::thread_cache cache{&shared, 64 * 1024};
+        for (size_t i{}; i < allocationsPerThread; ++i) {
+          do_not_optimize(cache.allocate_bytes(allocationSize, 8));
+        }
+      });
+    });
+  }
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <memory>
+#include <new>
+
+// A fixed-size bump arena that any number of threads may allocate from at
+// once. Each allocation is a single fetch_add on the shared offset; requests
+// aligned no more strictly than max_align_t never need padding because every
+// reservation is rounded up to that granularity. reset() is not thread safe
+// and must only be called once all allocating threads are done (e.g. after
+// the frame's fence has been waited on).
+struct concurrent_monotonic_memory {
+  static constexpr size_t granularity = alignof(std::max_align_t);
+
+  concurrent_monotonic_memory(size_t size) : m_size(size) {
+    m_memory.reset(malloc(size));
+    if (!m_memory && size > 0) {
+      throw std::bad_alloc{};
+    }
+  }
+
+  concurrent_monotonic_memory(const concurrent_monotonic_memory&) = delete;
+  concurrent_monotonic_memory& operator=(const concurrent_monotonic_memory&) =
+      delete;
+
+  template <typename T>
+  T* allocate(size_t n) {
+    return reinterpret_cast<T*>(allocate_bytes(sizeof(T) * n, alignof(T)));
+  }
+
+  void* allocate_bytes(size_t size, size_t alignment) {
+    // over-aligned requests reserve enough slack to align inside the range
+    size_t slack = alignment > granularity ? alignment - granularity : 0;
+    size_t reserved = round_up(size + slack, granularity);
+    size_t offset = m_offset.fetch_add(reserved, std::memory_order_relaxed);
+    if (offset + reserved > m_size) {
+      throw std::bad_alloc{};
+    }
+    auto address = reinterpret_cast<uintptr_t>(m_memory.get()) + offset;
+    return reinterpret_cast<void*>(round_up(address, alignment));
+  }
+
+  void reset() {
+    m_offset.store(0, std::memory_order_relaxed);
+    m_generation.fetch_add(1, std::memory_order_release);
+  }
+
+  size_t used() const {
+    return std::min(m_offset.load(std::memory_order_relaxed), m_size);
+  }
+
+  size_t size() const { return m_size; }
+
+  // Per-thread front end that claims chunkSize bytes from the shared arena
+  // at a time and bump-allocates out of them without touching the shared
+  // counter. A thread_cache notices reset() and drops its chunk.
+  struct thread_cache {
+    thread_cache(concurrent_monotonic_memory* memory, size_t chunkSize)
+        : m_memory(memory), m_chunkSize(chunkSize) {}
+
+    template <typename T>
+    T* allocate(size_t n) {
+      return reinterpret_cast<T*>(allocate_bytes(sizeof(T) * n, alignof(T)));
+    }
+
+    void* allocate_bytes(size_t size, size_t alignment) {
+      auto generation = m_memory->m_generation.load(std::memory_order_acquire);
+      if (generation != m_generation) {
+        m_generation = generation;
+        m_free = m_end = 0;
+      }
+      auto aligned = round_up(m_free, alignment);
+      if (m_free == 0 || aligned + size > m_end) {
+        size_t chunk = std::max(m_chunkSize, size + alignment);
+        m_free = reinterpret_cast<uintptr_t>(
+            m_memory->allocate_bytes(chunk, granularity));
+        m_end = m_free + chunk;
+        aligned = round_up(m_free, alignment);
+      }
+      m_free = aligned + size;
+      return reinterpret_cast<void*>(aligned);
+    }
+
+  private:
+    concurrent_monotonic_memory* m_memory{};
+    size_t m_chunkSize{};
+    uint64_t m_generation{};
+    uintptr_t m_free{};
+    uintptr_t m_end{};
+  };
+
+private:
+  struct free_deleter {
+    void operator()(void* memory) const { free(memory); }
+  };
+
+  size_t m_size{};
+  std::unique_ptr<void, free_deleter> m_memory{};
+  std::atomic<size_t> m_offset{};
+  std::atomic<uint64_t> m_generation{};
+
+  static uintptr_t round_up(uintptr_t value, size_t alignment) {
+    return (value + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+  }
+};
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "concurrent_monotonic_memory.hpp"
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+struct allocation_record {
+  uint8_t* ptr;
+  size_t size;
+  size_t alignment;
+  uint8_t pattern;
+};
+
+template <typename Allocate>
+std::vector<allocation_record> allocate_mixed(
+    Allocate&& allocate,
+    unsigned seed,
+    size_t count) {
+  std::mt19937 rng{seed};
+  std::uniform_int_distribution<size_t> sizeDist{1, 200};
+  std::uniform_int_distribution<int> alignShift{0, 8};
+  std::vector<allocation_record> records;
+  records.reserve(count);
+  for (size_t i{}; i < count; ++i) {
+    allocation_record record{};
+    record.size = sizeDist(rng);
+    record.alignment = size_t{1} << alignShift(rng);
+    record.pattern = static_cast<uint8_t>(seed * 31 + i);
+    record.ptr = static_cast<uint8_t*>(allocate(record.size, record.alignment));
+    std::memset(record.ptr, record.pattern, record.size);
+    records.push_back(record);
+  }
+  return records;
+}
+
+bool intact(const allocation_record& record) {
+  return std::all_of(record.ptr, record.ptr + record.size, [&](uint8_t b) {
+    return b == record.pattern;
+  });
+}
+
+bool aligned(const allocation_record& record) {
+  return reinterpret_cast<uintptr_t>(record.ptr) % record.alignment == 0;
+}
+
+template <typename MakeAllocate>
+void stress(MakeAllocate&& makeAllocate) {
+  constexpr size_t threadCount = 8;
+  constexpr size_t perThread = 2000;
+  std::vector<std::vector<allocation_record>> results(threadCount);
+  std::vector<std::thread> threads;
+  for (unsigned t{}; t < threadCount; ++t) {
+    threads.emplace_back([&, t] {
+      results[t] = allocate_mixed(makeAllocate(), t + 1, perThread);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<allocation_record> all;
+  for (auto& threadResults : results) {
+    all.insert(all.end(), threadResults.begin(), threadResults.end());
+  }
+  REQUIRE(std::all_of(all.begin(), all.end(), aligned));
+  REQUIRE(std::all_of(all.begin(), all.end(), intact));
+  std::sort(all.begin(), all.end(), [](auto& lhs, auto& rhs) {
+    return lhs.ptr < rhs.ptr;
+  });
+  size_t overlaps{};
+  for (size_t i{1}; i < all.size(); ++i) {
+    if (all[i - 1].ptr + all[i - 1].size > all[i].ptr) {
+      ++overlaps;
+    }
+  }
+  REQUIRE(overlaps == 0);
+}
+}  // namespace
+
+TEST_CASE("Concurrent allocations honor alignment and never overlap") {
+  concurrent_monotonic_memory memory{16 * 1024 * 1024};
+  stress([&] {
+    return [&](size_t size, size_t alignment) {
+      return memory.allocate_bytes(size, alignment);
+    };
+  });
+}
+
+TEST_CASE("Thread caches honor alignment and never overlap") {
+  concurrent_monotonic_memory memory{16 * 1024 * 1024};
+  stress([&] {
+    auto cache = std::make_shared<concurrent_monotonic_memory::thread_cache>(
+        &memory, 4096);
+    return [cache](size_t size, size_t alignment) {
+      return cache->allocate_bytes(size, alignment);
+    };
+  });
+}
+
+TEST_CASE("Exhausting a concurrent arena throws bad_alloc") {
+  concurrent_monotonic_memory memory{64};
+  REQUIRE_NOTHROW(memory.allocate<uint8_t>(64));
+  REQUIRE_THROWS_AS(memory.allocate<uint8_t>(1), std::bad_alloc);
+}
+
+TEST_CASE("Typed concurrent allocation is sized by sizeof(T)") {
+  struct alignas(4) big {
+    char data[64];
+  };
+  concurrent_monotonic_memory memory{1024};
+  auto first = memory.allocate<big>(2);
+  auto second = memory.allocate<big>(1);
+  REQUIRE(reinterpret_cast<char*>(second) >=
+          reinterpret_cast<char*>(first + 2));
+}
+
+TEST_CASE("A thread cache starts over after reset") {
+  concurrent_monotonic_memory memory{256};
+  concurrent_monotonic_memory::thread_cache cache{&memory, 128};
+  auto first = cache.allocate_bytes(8, 8);
+  cache.allocate_bytes(8, 8);
+  memory.reset();
+  REQUIRE(cache.allocate_bytes(8, 8) == first);
+  REQUIRE(memory.used() == 128);
+}
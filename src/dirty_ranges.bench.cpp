@@ -0,0 +1,71 @@
+#include "bench.hpp"
+#include "dirty_ranges.hpp"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+constexpr uint64_t allocationSize = 64 * 1024 * 1024;
+constexpr uint64_t atomSize = 256;
+
+int main() {
+  std::mt19937_64 rng{4};
+  for (size_t writeCount : {1000, 10000, 100000}) {
+    // small writes (one uniform block or a few instances each) scattered
+    // over the whole allocation, and clustered in a few hot pages
+    std::vector<memory_range> scattered(writeCount);
+    std::vector<memory_range> clustered(writeCount);
+    std::uniform_int_distribution<uint64_t> anywhere{0, allocationSize - 256};
+    std::uniform_int_distribution<uint64_t> hot{0, 15};
+    std::uniform_int_distribution<uint64_t> within{0, 64 * 1024 - 256};
+    std::uniform_int_distribution<uint64_t> size{16, 256};
+    for (size_t i{}; i < writeCount; ++i) {
+      scattered[i] = {anywhere(rng), size(rng)};
+      clustered[i] = {
+          hot(rng) * (allocationSize / 16) + within(rng), size(rng)};
+    }
+
+    dirty_ranges ranges{};
+    std::vector<memory_range> merged{};
+    for (auto [name, writes] : {std::pair{"scattered", &scattered},
+                                std::pair{"clustered", &clustered}}) {
+      auto label = std::string{name} + " " + std::to_string(writeCount) +
+                   " writes, record + coalesce";
+      run_benchmark(label.c_str(), writeCount, [&] {
+        ranges.clear();
+        merged.clear();
+        for (auto& write : *writes) {
+          ranges.add(write.offset, write.size);
+        }
+        ranges.coalesce(atomSize, 0, allocationSize, merged);
+        do_not_optimize(merged);
+      });
+      uint64_t flushedBytes{};
+      for (auto& range : merged) {
+        flushedBytes += range.size;
+      }
+      std::printf(
+          "  %zu flush ranges, %.2f MiB flushed of %.0f MiB\n",
+          merged.size(),
+          flushedBytes / (1024.0 * 1024.0),
+          allocationSize / (1024.0 * 1024.0));
+    }
+
+    std::vector<memory_range> sequential(writeCount);
+    for (size_t i{}; i < writeCount; ++i) {
+      sequential[i] = {i * 64, 64};
+    }
+    run_benchmark(
+        ("sequential " + std::to_string(writeCount) + " writes").c_str(),
+        writeCount,
+        [&] {
+          ranges.clear();
+          merged.clear();
+          for (auto& write : sequential) {
+            ranges.add(write.offset, write.size);
+          }
+          ranges.coalesce(atomSize, 0, allocationSize, merged);
+          do_not_optimize(merged);
+        });
+  }
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// round n down to nearest multiple of m
+inline uint64_t round_down(uint64_t n, uint64_t m) {
+  return (m == 0) ? n : (n / m) * m;
+}
+
+// round n up to nearest multiple of m
+inline uint64_t round_up(uint64_t n, uint64_t m) {
+  return (m == 0) ? n : ((n + m - 1) / m) * m;
+}
+
+struct memory_range {
+  uint64_t offset{};
+  uint64_t size{};
+};
+
+// Byte ranges written to one mapped allocation during a frame. Writes are
+// recorded as they happen; coalesce() turns them into the fewest ranges
+// that cover every write on nonCoherentAtomSize boundaries, ready for one
+// vkFlushMappedMemoryRanges call.
+struct dirty_ranges {
+  void add(uint64_t offset, uint64_t size) {
+    if (size == 0) {
+      return;
+    }
+    if (!m_ranges.empty()) {
+      // sequential writes extend the last range instead of piling up
+      auto& last = m_ranges.back();
+      if (offset >= last.offset && offset <= last.offset + last.size) {
+        last.size = std::max(last.size, offset + size - last.offset);
+        return;
+      }
+      m_sorted &= offset > last.offset;
+    }
+    m_ranges.push_back({offset, size});
+  }
+
+  bool empty() const { return m_ranges.empty(); }
+  // ranges as recorded, before coalescing
+  size_t size() const { return m_ranges.size(); }
+
+  void clear() {
+    m_ranges.clear();
+    m_sorted = true;
+  }
+
+  // Appends the merged ranges to out, rounded out to atomSize. Offsets are
+  // shifted by base, the allocation's offset in its VkDeviceMemory, since
+  // atoms are aligned to the memory object rather than the allocation; ends
+  // are clamped to limit, also relative to the memory object.
+  void coalesce(
+      uint64_t atomSize,
+      uint64_t base,
+      uint64_t limit,
+      std::vector<memory_range>& out) {
+    if (!m_sorted) {
+      std::sort(
+          m_ranges.begin(),
+          m_ranges.end(),
+          [](const memory_range& a, const memory_range& b) {
+            return a.offset < b.offset;
+          });
+      m_sorted = true;
+    }
+    auto first = out.size();
+    for (auto& range : m_ranges) {
+      auto begin = round_down(base + range.offset, atomSize);
+      auto end = std::min(
+          round_up(base + range.offset + range.size, atomSize), limit);
+      if (out.size() > first) {
+        auto& last = out.back();
+        if (begin <= last.offset + last.size) {
+          last.size = std::max(last.size, end - last.offset);
+          continue;
+        }
+      }
+      out.push_back({begin, end - begin});
+    }
+  }
+
+private:
+  std::vector<memory_range> m_ranges{};
+  bool m_sorted{true};
+};
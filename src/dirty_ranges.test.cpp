@@ -0,0 +1,123 @@
+#include "dirty_ranges.hpp"
+#include <catch2/catch.hpp>
+#include <random>
+
+namespace {
+std::vector<memory_range> coalesced(
+    dirty_ranges& ranges,
+    uint64_t atomSize,
+    uint64_t base = 0,
+    uint64_t limit = ~uint64_t{}) {
+  std::vector<memory_range> out{};
+  ranges.coalesce(atomSize, base, limit, out);
+  return out;
+}
+}  // namespace
+
+static bool operator==(const memory_range& a, const memory_range& b) {
+  return a.offset == b.offset && a.size == b.size;
+}
+
+TEST_CASE("Rounding helpers") {
+  REQUIRE(round_down(130, 64) == 128);
+  REQUIRE(round_up(130, 64) == 192);
+  REQUIRE(round_up(128, 64) == 128);
+  REQUIRE(round_down(130, 0) == 130);
+  REQUIRE(round_up(130, 0) == 130);
+}
+
+TEST_CASE("Sequential writes extend one range") {
+  dirty_ranges ranges{};
+  for (uint64_t offset{}; offset < 1024; offset += 16) {
+    ranges.add(offset, 16);
+  }
+  REQUIRE(ranges.size() == 1);
+  REQUIRE(coalesced(ranges, 64) == std::vector<memory_range>{{0, 1024}});
+}
+
+TEST_CASE("Overlapping and adjacent ranges merge") {
+  dirty_ranges ranges{};
+  ranges.add(500, 20);
+  ranges.add(100, 50);
+  ranges.add(140, 30);
+  ranges.add(170, 10);
+  ranges.add(0, 0);
+  // the writes at 140 and 170 extend the range at 100 as they arrive
+  REQUIRE(ranges.size() == 2);
+  ranges.add(120, 200);
+  ranges.add(600, 8);
+  ranges.add(330, 10);
+  REQUIRE(
+      coalesced(ranges, 1) ==
+      std::vector<memory_range>{{100, 220}, {330, 10}, {500, 20}, {600, 8}});
+}
+
+TEST_CASE("Ranges sharing an atom merge after rounding") {
+  dirty_ranges ranges{};
+  ranges.add(10, 4);
+  ranges.add(70, 4);
+  ranges.add(200, 4);
+  REQUIRE(
+      coalesced(ranges, 64) ==
+      std::vector<memory_range>{{0, 128}, {192, 64}});
+}
+
+TEST_CASE("Atoms are aligned to the memory object") {
+  dirty_ranges ranges{};
+  ranges.add(0, 8);
+  ranges.add(1000, 8);
+  // the allocation starts 32 bytes into an atom and ends at 1056
+  REQUIRE(
+      coalesced(ranges, 64, 32, 1088) ==
+      std::vector<memory_range>{{0, 64}, {1024, 64}});
+
+  SECTION("Ends are clamped to the limit") {
+    REQUIRE(
+        coalesced(ranges, 64, 32, 1044) ==
+        std::vector<memory_range>{{0, 64}, {1024, 20}});
+  }
+}
+
+TEST_CASE("Coalesced ranges cover every write and nothing extra") {
+  std::mt19937 rng{9};
+  constexpr uint64_t memorySize = 1 << 16;
+  constexpr uint64_t atomSize = 256;
+  std::uniform_int_distribution<uint64_t> offset{0, memorySize - 64};
+  std::uniform_int_distribution<uint64_t> size{1, 64};
+  dirty_ranges ranges{};
+  std::vector<bool> written(memorySize / atomSize);
+  for (int i{}; i < 300; ++i) {
+    auto o = offset(rng);
+    auto s = size(rng);
+    ranges.add(o, s);
+    for (auto atom = o / atomSize; atom <= (o + s - 1) / atomSize; ++atom) {
+      written[atom] = true;
+    }
+  }
+  auto result = coalesced(ranges, atomSize, 0, memorySize);
+  std::vector<bool> flushed(written.size());
+  for (size_t i{}; i < result.size(); ++i) {
+    REQUIRE(result[i].offset % atomSize == 0);
+    REQUIRE(result[i].size % atomSize == 0);
+    if (i > 0) {
+      // disjoint and not even touching, or they would have merged
+      REQUIRE(result[i - 1].offset + result[i - 1].size < result[i].offset);
+    }
+    for (auto atom = result[i].offset / atomSize;
+         atom < (result[i].offset + result[i].size) / atomSize;
+         ++atom) {
+      flushed[atom] = true;
+    }
+  }
+  REQUIRE(flushed == written);
+}
+
+TEST_CASE("clear starts a new frame") {
+  dirty_ranges ranges{};
+  ranges.add(300, 4);
+  ranges.add(0, 4);
+  ranges.clear();
+  REQUIRE(ranges.empty());
+  ranges.add(64, 4);
+  REQUIRE(coalesced(ranges, 64) == std::vector<memory_range>{{64, 64}});
+}
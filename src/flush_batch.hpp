@@ -0,0 +1,100 @@
+#pragma once
+#include "dirty_ranges.hpp"
+#include <memory_allocator.hpp>
+#include <unordered_map>
+#include <vector>
+
+// Collects the writes made to mapped VMA allocations during a frame and
+// flushes them with a single vkFlushMappedMemoryRanges call. Writes to
+// HOST_COHERENT memory need no flush and are dropped when recorded.
+struct flush_batch {
+  flush_batch(
+      VkDevice device,
+      VmaAllocator allocator,
+      VkPhysicalDevice physicalDevice)
+      : m_device(device), m_allocator(allocator) {
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_atomSize = properties.limits.nonCoherentAtomSize;
+  }
+
+  // Records a CPU write of size bytes at offset within allocation.
+  void write(VmaAllocation allocation, VkDeviceSize offset, VkDeviceSize size) {
+    auto found = m_allocations.find(allocation);
+    if (found == m_allocations.end()) {
+      found = m_allocations.emplace(allocation, describe(allocation)).first;
+    }
+    if (!found->second.coherent) {
+      found->second.ranges.add(offset, size);
+    }
+  }
+
+  // Flushes everything recorded since the last flush. Call before the
+  // submit that reads the data.
+  VkResult flush() {
+    m_ranges.clear();
+    for (auto& [allocation, tracked] : m_allocations) {
+      if (tracked.ranges.empty()) {
+        continue;
+      }
+      tracked.ranges.coalesce(
+          m_atomSize, tracked.offset, tracked.limit, m_mergedRanges);
+      for (auto& range : m_mergedRanges) {
+        VkMappedMemoryRange mapped{VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE};
+        mapped.memory = tracked.memory;
+        mapped.offset = range.offset;
+        // past a partial last atom may lie the end of the memory object,
+        // whose size VMA doesn't report; WHOLE_SIZE stops there by itself
+        mapped.size = range.offset + range.size > tracked.end
+                          ? VK_WHOLE_SIZE
+                          : range.size;
+        m_ranges.push_back(mapped);
+      }
+      m_mergedRanges.clear();
+      tracked.ranges.clear();
+    }
+    if (m_ranges.empty()) {
+      return VK_SUCCESS;
+    }
+    return vkFlushMappedMemoryRanges(
+        m_device, static_cast<uint32_t>(m_ranges.size()), m_ranges.data());
+  }
+
+  // Drops an allocation about to be destroyed, along with unflushed writes.
+  void forget(VmaAllocation allocation) { m_allocations.erase(allocation); }
+
+private:
+  struct tracked_allocation {
+    VkDeviceMemory memory{};
+    VkDeviceSize offset{};
+    // end of the allocation within memory
+    VkDeviceSize end{};
+    // end rounded up to an atom, which may pass the end of memory
+    VkDeviceSize limit{};
+    bool coherent{};
+    dirty_ranges ranges{};
+  };
+
+  VkDevice m_device{};
+  VmaAllocator m_allocator{};
+  VkDeviceSize m_atomSize{};
+  std::unordered_map<VmaAllocation, tracked_allocation> m_allocations{};
+  std::vector<memory_range> m_mergedRanges{};
+  std::vector<VkMappedMemoryRange> m_ranges{};
+
+  tracked_allocation describe(VmaAllocation allocation) const {
+    VmaAllocationInfo info{};
+    vmaGetAllocationInfo(m_allocator, allocation, &info);
+    VkMemoryPropertyFlags flags{};
+    vmaGetMemoryTypeProperties(m_allocator, info.memoryType, &flags);
+    tracked_allocation tracked{};
+    tracked.memory = info.deviceMemory;
+    tracked.offset = info.offset;
+    tracked.end = info.offset + info.size;
+    // VMA aligns allocations in non-coherent memory to whole atoms, so
+    // rounding the end up never reaches into a neighbour
+    tracked.limit = round_up(tracked.end, m_atomSize);
+    tracked.coherent = (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+    return tracked;
+  }
+};
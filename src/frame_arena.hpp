@@ -0,0 +1,68 @@
+#pragma once
+#include "monotonic_allocator.hpp"
+#include <cstddef>
+#include <vector>
+
+// Scratch memory for building frames. Holds one monotonic_memory per
+// in-flight frame per worker thread; a frame's arenas are only reset when
+// that frame index comes around again, which the caller must do after
+// waiting on the fence guarding the frame (e.g. commandBufferExecuted).
+struct frame_arenas {
+  frame_arenas(
+      size_t frameCount,
+      size_t workerCount,
+      size_t arenaSize,
+      monotonic_growth growth = {})
+      : m_frameCount(frameCount), m_workerCount(workerCount) {
+    m_arenas.reserve(frameCount * workerCount);
+    for (size_t i{}; i < frameCount * workerCount; ++i) {
+      m_arenas.emplace_back(arenaSize, growth);
+    }
+  }
+
+  // Resets every worker's arena for frameIndex and makes it current.
+  // Only call once the GPU is done with the previous use of this frame.
+  void begin_frame(size_t frameIndex) {
+    m_currentFrame = frameIndex % m_frameCount;
+    for (size_t worker{}; worker < m_workerCount; ++worker) {
+      arena(worker).reset();
+    }
+  }
+
+  size_t current_frame() const { return m_currentFrame; }
+  size_t frame_count() const { return m_frameCount; }
+  size_t worker_count() const { return m_workerCount; }
+
+  monotonic_memory& arena(size_t workerIndex) {
+    return m_arenas[m_currentFrame * m_workerCount + workerIndex];
+  }
+
+  template <typename T>
+  monotonic_allocator<T> allocator(size_t workerIndex) {
+    return monotonic_allocator<T>{&arena(workerIndex)};
+  }
+
+  // Worker threads call bind_this_thread once with their pool index; after
+  // that they can fetch their arena without threading the index through.
+  static void bind_this_thread(size_t workerIndex) {
+    this_thread_index() = workerIndex;
+  }
+
+  monotonic_memory& this_thread_arena() { return arena(this_thread_index()); }
+
+  template <typename T>
+  monotonic_allocator<T> this_thread_allocator() {
+    return monotonic_allocator<T>{&this_thread_arena()};
+  }
+
+private:
+  size_t m_frameCount{};
+  size_t m_workerCount{};
+  size_t m_currentFrame{};
+  std::vector<monotonic_memory> m_arenas{};
+
+  static size_t& this_thread_index() {
+    thread_local size_t workerIndex{};
+    return workerIndex;
+  }
+};
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "frame_arena.hpp"
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Counts every global operator new in the test binary so steady-state frame
+// building can be checked for heap traffic.
+static std::atomic<size_t> globalNewCount{};
+
+void* operator new(size_t size) {
+  ++globalNewCount;
+  if (auto ptr = malloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc{};
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  ++globalNewCount;
+  return malloc(size);
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+template <typename T>
+using frame_vector = std::vector<T, monotonic_allocator<T>>;
+
+static void build_frame(frame_arenas& arenas, size_t workerIndex) {
+  frame_vector<int> draws{arenas.allocator<int>(workerIndex)};
+  for (int i{}; i < 1000; ++i) {
+    draws.push_back(i);
+  }
+  frame_vector<double> transforms{arenas.allocator<double>(workerIndex)};
+  transforms.resize(256);
+}
+
+TEST_CASE("Each frame index owns a separate arena") {
+  frame_arenas arenas{3, 1, 64};
+  arenas.begin_frame(0);
+  auto frame0 = &arenas.arena(0);
+  arenas.begin_frame(1);
+  auto frame1 = &arenas.arena(0);
+  arenas.begin_frame(3);
+  REQUIRE(arenas.current_frame() == 0);
+  REQUIRE(&arenas.arena(0) == frame0);
+  REQUIRE(frame0 != frame1);
+}
+
+TEST_CASE("Beginning a frame only resets that frame's arenas") {
+  frame_arenas arenas{3, 2, 64};
+  arenas.begin_frame(0);
+  auto& frame0 = arenas.arena(1);
+  arenas.allocator<int>(1).allocate(4);
+  arenas.begin_frame(1);
+  arenas.allocator<int>(1).allocate(2);
+  REQUIRE(frame0.stats().used == sizeof(int) * 4);
+  arenas.begin_frame(0);
+  REQUIRE(frame0.stats().used == 0);
+}
+
+TEST_CASE("Worker threads draw from their own arena") {
+  frame_arenas arenas{3, 4, 1024};
+  arenas.begin_frame(0);
+  std::vector<std::thread> workers;
+  for (size_t worker{}; worker < 4; ++worker) {
+    workers.emplace_back([&arenas, worker] {
+      frame_arenas::bind_this_thread(worker);
+      arenas.this_thread_allocator<int>().allocate(worker + 1);
+    });
+  }
+  for (auto& thread : workers) {
+    thread.join();
+  }
+  for (size_t worker{}; worker < 4; ++worker) {
+    REQUIRE(arenas.arena(worker).stats().used == sizeof(int) * (worker + 1));
+  }
+}
+
+TEST_CASE("Steady-state frame building makes no heap allocations") {
+  frame_arenas arenas{3, 2, 256, monotonic_growth{}};
+  auto buildAndCheck = [&](size_t frame) {
+    arenas.begin_frame(frame);
+    build_frame(arenas, 0);
+    build_frame(arenas, 1);
+    // checked before the next reset trims the arenas back to one block
+    REQUIRE(arenas.arena(0).stats().blockCount == 1);
+    REQUIRE(arenas.arena(1).stats().blockCount == 1);
+  };
+  // warm up: let every arena grow to its working size
+  for (size_t frame{}; frame < 6; ++frame) {
+    arenas.begin_frame(frame);
+    build_frame(arenas, 0);
+    build_frame(arenas, 1);
+  }
+
+  // arena blocks come from aligned_malloc, which operator new never sees
+  auto blockAllocations = [&] {
+    std::vector<size_t> counts{};
+    for (size_t frame{}; frame < 3; ++frame) {
+      arenas.begin_frame(frame);
+      counts.push_back(arenas.arena(0).stats().blockAllocations);
+      counts.push_back(arenas.arena(1).stats().blockAllocations);
+    }
+    return counts;
+  };
+  auto blocksBefore = blockAllocations();
+  auto newCountBefore = globalNewCount.load();
+  for (size_t frame{6}; frame < 60; ++frame) {
+    buildAndCheck(frame);
+  }
+  auto newCountAfter = globalNewCount.load();
+  REQUIRE(newCountAfter == newCountBefore);
+  REQUIRE(blockAllocations() == blocksBefore);
+}
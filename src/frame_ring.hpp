@@ -0,0 +1,199 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <new>
+#include <optional>
+#include <stdexcept>
+
+// Completion state of the frames in flight. The Vulkan implementation wraps
+// the per-frame command buffer fences; tests substitute a fake.
+struct frame_fences {
+  virtual ~frame_fences() = default;
+  virtual bool signaled(size_t frame) = 0;
+  virtual void wait(size_t frame) = 0;
+};
+
+struct ring_allocation {
+  std::byte* data{};
+  // offset from the start of the buffer, usable as a dynamic offset
+  uint32_t offset{};
+  uint32_t size{};
+};
+
+// Ring suballocator over one persistently mapped buffer for data written
+// once per frame (dynamic uniforms, instance data). Each frame's allocations
+// form one contiguous region that is released once that frame's fence has
+// signaled. Frames must be submitted to a single queue, so a frame finishing
+// implies every frame submitted before it has finished too.
+struct frame_ring {
+  // alignment is the default for allocate(), normally the device's
+  // minUniformBufferOffsetAlignment, and must be a power of two
+  frame_ring(
+      std::byte* data,
+      size_t capacity,
+      size_t alignment,
+      frame_fences& fences)
+      : m_data(data),
+        m_capacity(capacity),
+        m_alignment(alignment),
+        m_fences(fences) {
+    check_alignment(alignment);
+    if (capacity > UINT32_MAX) {
+      throw std::invalid_argument{
+          "Ring capacity exceeds the dynamic offset range"};
+    }
+  }
+
+  // Starts recording frame, whose fence the caller has just waited on. The
+  // previous frame's allocations go in flight, and everything submitted up
+  // to this frame's last use is released.
+  void begin_frame(size_t frame) {
+    // a frame that took no bytes holds nothing back, so it isn't tracked
+    if (m_frameOpen && m_frameBytes > 0) {
+      m_inFlight.push_back({m_currentFrame, m_head});
+    }
+    m_currentFrame = frame;
+    m_frameOpen = true;
+    m_frameBytes = 0;
+    auto last = m_inFlight.begin();
+    for (auto it = m_inFlight.begin(); it != m_inFlight.end(); ++it) {
+      if (it->frame == frame) {
+        last = it + 1;
+      }
+    }
+    release_through(last);
+    retire_signaled();
+  }
+
+  // Allocates size bytes for the current frame. When the ring is full, waits
+  // for the oldest frame in flight; throws std::bad_alloc if the current
+  // frame alone would not fit.
+  ring_allocation allocate(size_t size) { return allocate(size, m_alignment); }
+
+  ring_allocation allocate(size_t size, size_t alignment) {
+    if (auto allocation = try_allocate(size, alignment)) {
+      return *allocation;
+    }
+    throw std::bad_alloc{};
+  }
+
+  // As allocate(), but returns nothing instead of throwing when the current
+  // frame has filled the ring, so the caller can close the frame and retry.
+  std::optional<ring_allocation> try_allocate(size_t size, size_t alignment) {
+    check_alignment(alignment);
+    if (!m_frameOpen) {
+      throw std::logic_error{"frame_ring::allocate outside a frame"};
+    }
+    size_t offset{};
+    while (!try_place(size, alignment, offset)) {
+      if (!retire_signaled()) {
+        if (m_inFlight.empty()) {
+          return {};
+        }
+        m_fences.wait(m_inFlight.front().frame);
+        release_through(m_inFlight.begin() + 1);
+      }
+    }
+    // padding skipped before offset, including a wrap, belongs to the frame
+    m_frameBytes += offset >= m_head ? offset + size - m_head
+                                     : m_capacity - m_head + offset + size;
+    m_head = offset + size;
+    return ring_allocation{m_data + offset,
+                           static_cast<uint32_t>(offset),
+                           static_cast<uint32_t>(size)};
+  }
+
+  template <typename T>
+  ring_allocation push(const T& value) {
+    auto allocation = allocate(sizeof(T));
+    std::memcpy(allocation.data, &value, sizeof(T));
+    return allocation;
+  }
+
+  size_t capacity() const { return m_capacity; }
+  size_t frames_in_flight() const { return m_inFlight.size(); }
+
+  // bytes between the oldest live allocation and the next free byte,
+  // including alignment and wrap-around padding
+  size_t used_bytes() const {
+    if (empty()) {
+      return 0;
+    }
+    return m_head > m_tail ? m_head - m_tail : m_capacity - m_tail + m_head;
+  }
+
+private:
+  struct region {
+    size_t frame;
+    // one past the region's last byte; it starts where the previous ended
+    size_t end;
+  };
+
+  std::byte* m_data{};
+  size_t m_capacity{};
+  size_t m_alignment{};
+  frame_fences& m_fences;
+  std::deque<region> m_inFlight{};
+  size_t m_head{};
+  size_t m_tail{};
+  size_t m_currentFrame{};
+  bool m_frameOpen{};
+  // bytes the current frame has taken, padding included
+  size_t m_frameBytes{};
+
+  static void check_alignment(size_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+      throw std::invalid_argument{"alignment must be a power of two"};
+    }
+  }
+
+  // Every tracked region holds at least one byte, so head == tail with
+  // anything live means the ring is full.
+  bool empty() const { return m_inFlight.empty() && m_frameBytes == 0; }
+
+  void release_through(std::deque<region>::iterator last) {
+    if (last == m_inFlight.begin()) {
+      return;
+    }
+    m_tail = (last - 1)->end;
+    m_inFlight.erase(m_inFlight.begin(), last);
+  }
+
+  // Releases finished frames from the front; returns whether any were.
+  bool retire_signaled() {
+    auto last = m_inFlight.begin();
+    while (last != m_inFlight.end() && m_fences.signaled(last->frame)) {
+      ++last;
+    }
+    bool retired = last != m_inFlight.begin();
+    release_through(last);
+    return retired;
+  }
+
+  bool try_place(size_t size, size_t alignment, size_t& offset) {
+    if (empty()) {
+      // nothing live, so start again at the front
+      m_head = m_tail = 0;
+    }
+    auto start = (m_head + alignment - 1) & ~(alignment - 1);
+    if (m_head > m_tail || empty()) {
+      // free space is [head, capacity) followed by [0, tail)
+      if (start + size <= m_capacity) {
+        offset = start;
+        return true;
+      }
+      if (size <= m_tail) {
+        offset = 0;
+        return true;
+      }
+      return false;
+    }
+    if (m_head < m_tail && start + size <= m_tail) {
+      offset = start;
+      return true;
+    }
+    return false;
+  }
+};
@@ -0,0 +1,178 @@
+#include "frame_ring.hpp"
+#include <catch2/catch.hpp>
+#include <vector>
+
+namespace {
+// Stands in for the device: a frame's fence signals when the test says the
+// GPU finished it, and wait() finishes it on the spot.
+struct fake_fences : frame_fences {
+  std::vector<bool> done;
+  std::vector<size_t> waited;
+
+  explicit fake_fences(size_t frameCount) : done(frameCount, false) {}
+
+  bool signaled(size_t frame) override { return done[frame]; }
+  void wait(size_t frame) override {
+    waited.push_back(frame);
+    done[frame] = true;
+  }
+  // what the render loop does before reusing a frame
+  void reuse(size_t frame) { done[frame] = false; }
+};
+}  // namespace
+
+TEST_CASE("Allocations respect the offset alignment") {
+  std::vector<std::byte> memory(4096);
+  fake_fences fences{3};
+  frame_ring ring{memory.data(), memory.size(), 256, fences};
+  ring.begin_frame(0);
+  auto first = ring.allocate(64);
+  auto second = ring.allocate(100);
+  auto third = ring.allocate(8, 16);
+  REQUIRE(first.offset == 0);
+  REQUIRE(second.offset == 256);
+  REQUIRE(third.offset == 368);
+  REQUIRE(second.data == memory.data() + 256);
+
+  SECTION("Alignments must be powers of two") {
+    REQUIRE_THROWS_AS(ring.allocate(8, 48), std::invalid_argument);
+    REQUIRE_THROWS_AS(
+        (frame_ring{memory.data(), memory.size(), 0, fences}),
+        std::invalid_argument);
+  }
+}
+
+TEST_CASE("push copies the value into the ring") {
+  std::vector<std::byte> memory(1024);
+  fake_fences fences{1};
+  frame_ring ring{memory.data(), memory.size(), 64, fences};
+  ring.begin_frame(0);
+  ring.allocate(4);
+  auto allocation = ring.push(uint64_t{0x1122334455667788});
+  REQUIRE(allocation.offset == 64);
+  REQUIRE(allocation.size == 8);
+  uint64_t value{};
+  std::memcpy(&value, memory.data() + 64, sizeof(value));
+  REQUIRE(value == 0x1122334455667788);
+}
+
+TEST_CASE("Frames are released when their fence is reused") {
+  std::vector<std::byte> memory(1024);
+  fake_fences fences{3};
+  frame_ring ring{memory.data(), memory.size(), 256, fences};
+
+  for (size_t frame{}; frame < 3; ++frame) {
+    ring.begin_frame(frame);
+    ring.allocate(256);
+  }
+  REQUIRE(ring.frames_in_flight() == 2);
+  REQUIRE(ring.used_bytes() == 768);
+
+  // the loop waits on and resets frame 0's fence before reusing it
+  fences.reuse(0);
+  ring.begin_frame(0);
+  REQUIRE(ring.frames_in_flight() == 2);
+  REQUIRE(ring.used_bytes() == 512);
+  auto wrapped = ring.allocate(256);
+  REQUIRE(wrapped.offset == 768);
+  REQUIRE(fences.waited.empty());
+
+  // frame 0's old region at the front is free again
+  REQUIRE(ring.allocate(256).offset == 0);
+
+  SECTION("Signaled frames are retired without waiting") {
+    fences.done[1] = true;
+    fences.done[2] = true;
+    auto allocation = ring.allocate(256);
+    REQUIRE(allocation.offset == 256);
+    REQUIRE(fences.waited.empty());
+    REQUIRE(ring.frames_in_flight() == 0);
+  }
+
+  SECTION("A full ring waits for the oldest frame") {
+    auto allocation = ring.allocate(256);
+    REQUIRE(allocation.offset == 256);
+    REQUIRE(fences.waited == std::vector<size_t>{1});
+    REQUIRE(ring.frames_in_flight() == 1);
+  }
+
+  SECTION("Finishing a frame releases the frames submitted before it") {
+    fences.reuse(2);
+    ring.begin_frame(2);
+    REQUIRE(ring.frames_in_flight() == 1);
+    REQUIRE(ring.used_bytes() == 512);
+  }
+}
+
+TEST_CASE("Frames without allocations never make the ring wait") {
+  std::vector<std::byte> memory(1024);
+  fake_fences fences{3};
+  frame_ring ring{memory.data(), memory.size(), 256, fences};
+  ring.begin_frame(0);
+  ring.allocate(256);
+  ring.begin_frame(1);
+  ring.begin_frame(2);
+  fences.reuse(0);
+  ring.begin_frame(0);
+  REQUIRE(ring.frames_in_flight() == 0);
+  REQUIRE(ring.used_bytes() == 0);
+  REQUIRE(ring.allocate(256).offset == 0);
+  REQUIRE(fences.waited.empty());
+}
+
+TEST_CASE("A frame larger than the ring throws") {
+  std::vector<std::byte> memory(1024);
+  fake_fences fences{2};
+  frame_ring ring{memory.data(), memory.size(), 256, fences};
+  ring.begin_frame(0);
+  ring.allocate(512);
+  ring.begin_frame(1);
+  ring.allocate(512);
+  REQUIRE(ring.allocate(256).offset == 0);
+  REQUIRE(fences.waited == std::vector<size_t>{0});
+  REQUIRE_THROWS_AS(ring.allocate(512), std::bad_alloc);
+  REQUIRE_THROWS_AS(ring.allocate(2048), std::bad_alloc);
+}
+
+TEST_CASE("Allocations outside a frame are rejected") {
+  std::vector<std::byte> memory(256);
+  fake_fences fences{1};
+  frame_ring ring{memory.data(), memory.size(), 16, fences};
+  REQUIRE_THROWS_AS(ring.allocate(16), std::logic_error);
+}
+
+TEST_CASE("Live allocations are never overwritten") {
+  std::vector<std::byte> memory(4096);
+  fake_fences fences{3};
+  frame_ring ring{memory.data(), memory.size(), 64, fences};
+  // frame -> allocations that must stay intact until its fence is reused
+  std::vector<std::vector<ring_allocation>> live(3);
+  uint32_t seed = 1;
+  for (size_t step{}; step < 300; ++step) {
+    size_t frame = step % 3;
+    fences.reuse(frame);
+    ring.begin_frame(frame);
+    live[frame].clear();
+    for (size_t i{}; i < step % 13; ++i) {
+      for (size_t other{}; other < 3; ++other) {
+        // frames the ring waited for are done and may be overwritten; the
+        // fake GPU finishes nothing else
+        if (other != frame && fences.done[other]) {
+          live[other].clear();
+        }
+        for (auto& allocation : live[other]) {
+          for (uint32_t b{}; b < allocation.size; ++b) {
+            REQUIRE(allocation.data[b] == std::byte(allocation.offset));
+          }
+        }
+      }
+      seed = seed * 1103515245 + 12345;
+      auto allocation = ring.allocate(16 + (seed >> 16) % 300);
+      REQUIRE(allocation.offset % 64 == 0);
+      REQUIRE(allocation.offset + allocation.size <= memory.size());
+      std::memset(
+          allocation.data, int(allocation.offset & 0xff), allocation.size);
+      live[frame].push_back(allocation);
+    }
+  }
+}
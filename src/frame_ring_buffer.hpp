@@ -0,0 +1,69 @@
+#pragma once
+#include "frame_ring.hpp"
+#include <buffer.hpp>
+#include <logger.hpp>
+#include <memory_allocator.hpp>
+#include <move_into.hpp>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// frame_fences over the per-frame command buffer fences.
+struct vulkan_frame_fences : frame_fences {
+  vulkan_frame_fences(VkDevice device, std::vector<VkFence> fences)
+      : m_device(device), m_fences(std::move(fences)) {}
+
+  bool signaled(size_t frame) override {
+    return vkGetFenceStatus(m_device, m_fences[frame]) == VK_SUCCESS;
+  }
+
+  void wait(size_t frame) override {
+    vkWaitForFences(m_device, 1, &m_fences[frame], true, ~uint64_t{});
+  }
+
+private:
+  VkDevice m_device{};
+  std::vector<VkFence> m_fences;
+};
+
+// One persistently mapped cpu_to_gpu buffer, usable as a dynamic uniform,
+// storage or vertex buffer, suballocated by a frame_ring.
+struct frame_ring_buffer {
+  frame_ring_buffer(
+      vka::allocator& allocator,
+      VkPhysicalDevice physicalDevice,
+      uint32_t queueFamilyIndex,
+      size_t capacity,
+      frame_fences& fences) {
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    auto alignment = std::max<size_t>(
+        {properties.limits.minUniformBufferOffsetAlignment,
+         properties.limits.minStorageBufferOffsetAlignment,
+         1});
+    vka::buffer_builder{}
+        .cpu_to_gpu()
+        .uniform_buffer()
+        .storage_buffer()
+        .vertex_buffer()
+        .queue_family_index(queueFamilyIndex)
+        .size(capacity)
+        .build(allocator)
+        .map(vka::move_into{m_buffer})
+        .map_error([](auto error) {
+          vka::multi_logger::get()->critical("Error creating frame ring!");
+          exit(error);
+        });
+    void* mapped{};
+    m_buffer->map().map(vka::move_into{mapped});
+    m_ring = std::make_unique<frame_ring>(
+        static_cast<std::byte*>(mapped), capacity, alignment, fences);
+  }
+
+  vka::buffer& buffer() { return *m_buffer; }
+  frame_ring& ring() { return *m_ring; }
+
+private:
+  std::unique_ptr<vka::buffer> m_buffer{};
+  std::unique_ptr<frame_ring> m_ring{};
+};
@@ -0,0 +1,110 @@
+#include "frame_scheduler.hpp"
+#include "headless_vulkan.hpp"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+// Frame pacing with 1..3 frames in flight on a headless device, e.g.
+// lavapipe. Each frame spends a fixed time on the CPU and submits a large
+// buffer copy as its GPU work; with more frames in flight the two overlap
+// and the frame time drops towards the larger of them.
+
+constexpr VkDeviceSize copySize = 64 * 1024 * 1024;
+constexpr size_t frameCount = 200;
+constexpr auto cpuWork = std::chrono::milliseconds{4};
+
+struct gpu_buffer {
+  VmaAllocator allocator{};
+  VkBuffer buffer{};
+  VmaAllocation allocation{};
+
+  gpu_buffer(VmaAllocator allocator, VkBufferUsageFlags usage)
+      : allocator(allocator) {
+    VkBufferCreateInfo bufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    bufferInfo.size = copySize;
+    bufferInfo.usage = usage;
+    VmaAllocationCreateInfo allocationInfo{};
+    allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    vmaCreateBuffer(
+        allocator, &bufferInfo, &allocationInfo, &buffer, &allocation, nullptr);
+  }
+
+  gpu_buffer(const gpu_buffer&) = delete;
+  gpu_buffer& operator=(const gpu_buffer&) = delete;
+  ~gpu_buffer() { vmaDestroyBuffer(allocator, buffer, allocation); }
+};
+
+void spin(std::chrono::steady_clock::duration duration) {
+  auto end = std::chrono::steady_clock::now() + duration;
+  while (std::chrono::steady_clock::now() < end) {
+  }
+}
+
+int main() {
+  auto vk = headless_vulkan::create();
+  if (!vk) {
+    std::printf(
+        "No Vulkan device; set VK_ICD_FILENAMES to lavapipe to run this\n");
+    return 0;
+  }
+  gpu_buffer source{vk->allocator, VK_BUFFER_USAGE_TRANSFER_SRC_BIT};
+  std::printf(
+      "%-16s %10s %12s %12s %12s\n",
+      "frames in flight",
+      "fps",
+      "cpu ms",
+      "gpu wait ms",
+      "latency ms");
+
+  for (size_t framesInFlight{1}; framesInFlight <= 3; ++framesInFlight) {
+    VkCommandPoolCreateInfo poolInfo{
+        VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    poolInfo.queueFamilyIndex = vk->graphicsFamily;
+    std::vector<VkCommandPool> pools(framesInFlight);
+    std::vector<VkCommandBuffer> commandBuffers(framesInFlight);
+    std::vector<std::unique_ptr<gpu_buffer>> targets{};
+    for (size_t frame{}; frame < framesInFlight; ++frame) {
+      vkCreateCommandPool(vk->device, &poolInfo, nullptr, &pools[frame]);
+      VkCommandBufferAllocateInfo allocateInfo{
+          VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+      allocateInfo.commandPool = pools[frame];
+      allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+      allocateInfo.commandBufferCount = 1;
+      vkAllocateCommandBuffers(
+          vk->device, &allocateInfo, &commandBuffers[frame]);
+      targets.push_back(std::make_unique<gpu_buffer>(
+          vk->allocator, VK_BUFFER_USAGE_TRANSFER_DST_BIT));
+    }
+
+    {
+      frame_scheduler scheduler{vk->device, framesInFlight};
+      for (size_t i{}; i < frameCount; ++i) {
+        auto frame = scheduler.begin_frame();
+        spin(cpuWork);
+        auto cmd = commandBuffers[frame];
+        vkResetCommandPool(vk->device, pools[frame], 0);
+        VkCommandBufferBeginInfo beginInfo{
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(cmd, &beginInfo);
+        VkBufferCopy region{0, 0, copySize};
+        vkCmdCopyBuffer(cmd, source.buffer, targets[frame]->buffer, 1, &region);
+        vkEndCommandBuffer(cmd);
+        scheduler.submit(vk->graphicsQueue, {cmd});
+      }
+      scheduler.wait_idle();
+      auto& stats = scheduler.stats();
+      std::printf(
+          "%-16zu %10.1f %12.2f %12.2f %12.2f\n",
+          framesInFlight,
+          stats.frames_per_second(),
+          stats.cpu_frame_ms(),
+          stats.gpu_wait_ms(),
+          stats.latency_ms());
+    }
+    for (auto pool : pools) {
+      vkDestroyCommandPool(vk->device, pool, nullptr);
+    }
+  }
+}
@@ -0,0 +1,321 @@
+#pragma once
+#include <memory_allocator.hpp>
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Lowest-latency present mode: MAILBOX, which never tears, else IMMEDIATE,
+// which trades tearing for latency, else FIFO, which every device supports.
+// vsync asks for FIFO outright.
+inline VkPresentModeKHR pick_present_mode(
+    const std::vector<VkPresentModeKHR>& available,
+    bool vsync = false) {
+  if (!vsync) {
+    for (auto preferred :
+         {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR}) {
+      if (std::find(available.begin(), available.end(), preferred) !=
+          available.end()) {
+        return preferred;
+      }
+    }
+  }
+  return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+inline VkPresentModeKHR choose_present_mode(
+    VkPhysicalDevice physicalDevice,
+    VkSurfaceKHR surface,
+    bool vsync = false) {
+  uint32_t modeCount{};
+  vkGetPhysicalDeviceSurfacePresentModesKHR(
+      physicalDevice, surface, &modeCount, nullptr);
+  std::vector<VkPresentModeKHR> modes(modeCount);
+  vkGetPhysicalDeviceSurfacePresentModesKHR(
+      physicalDevice, surface, &modeCount, modes.data());
+  return pick_present_mode(modes, vsync);
+}
+
+// Averages of the last `window` samples of each frame pacing measurement,
+// in milliseconds.
+struct frame_pacing_stats {
+  explicit frame_pacing_stats(size_t window = 120) : m_window(window) {
+    if (window == 0) {
+      throw std::invalid_argument{"Frame pacing window must not be empty"};
+    }
+  }
+
+  // cpuFrame is the time from one frame's start to the next, gpuWait the
+  // part of it spent blocked on the GPU
+  void add_frame(double cpuFrame, double gpuWait) {
+    m_cpuFrame.add(cpuFrame, m_window);
+    m_gpuWait.add(gpuWait, m_window);
+  }
+
+  // time from a frame's start on the CPU to its work finishing on the GPU
+  void add_latency(double latency) { m_latency.add(latency, m_window); }
+
+  double cpu_frame_ms() const { return m_cpuFrame.average(); }
+  double gpu_wait_ms() const { return m_gpuWait.average(); }
+  double latency_ms() const { return m_latency.average(); }
+  double frames_per_second() const {
+    auto frame = cpu_frame_ms();
+    return frame > 0 ? 1000.0 / frame : 0;
+  }
+  size_t frame_count() const { return m_cpuFrame.count; }
+
+private:
+  struct rolling_average {
+    std::vector<double> samples{};
+    double sum{};
+    size_t count{};
+
+    void add(double sample, size_t window) {
+      if (samples.size() < window) {
+        samples.push_back(sample);
+      } else {
+        auto& oldest = samples[count % window];
+        sum -= oldest;
+        oldest = sample;
+      }
+      sum += sample;
+      ++count;
+    }
+
+    double average() const {
+      return samples.empty() ? 0 : sum / static_cast<double>(samples.size());
+    }
+  };
+
+  size_t m_window{};
+  rolling_average m_cpuFrame{};
+  rolling_average m_gpuWait{};
+  rolling_average m_latency{};
+};
+
+// Paces rendering with a fixed number of frames in flight. Each frame slot
+// has a fence and an acquire semaphore; render-finished semaphores are kept
+// per swapchain image, since an image's present is the only thing known to
+// have consumed one before it is signaled again. The CPU only blocks in
+// begin_frame, when the slot's previous frame is still on the GPU, so
+// recording frame N + 1 overlaps the GPU executing frame N.
+struct frame_scheduler {
+  using clock = std::chrono::steady_clock;
+
+  frame_scheduler(
+      VkDevice device,
+      size_t framesInFlight,
+      uint32_t swapImageCount = 0)
+      : m_device(device), m_frames(framesInFlight) {
+    if (framesInFlight == 0) {
+      throw std::invalid_argument{"At least one frame must be in flight"};
+    }
+    for (auto& frame : m_frames) {
+      VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+      fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+      check(vkCreateFence(m_device, &fenceInfo, nullptr, &frame.fence));
+      frame.acquired = create_semaphore();
+    }
+    set_swap_image_count(swapImageCount);
+  }
+
+  frame_scheduler(const frame_scheduler&) = delete;
+  frame_scheduler& operator=(const frame_scheduler&) = delete;
+
+  ~frame_scheduler() {
+    wait_idle();
+    for (auto& frame : m_frames) {
+      vkDestroyFence(m_device, frame.fence, nullptr);
+      vkDestroySemaphore(m_device, frame.acquired, nullptr);
+    }
+    for (auto semaphore : m_renderFinished) {
+      vkDestroySemaphore(m_device, semaphore, nullptr);
+    }
+  }
+
+  // Resizes the per-image semaphores, e.g. after the swapchain was
+  // recreated. Waits for the frames in flight first.
+  void set_swap_image_count(uint32_t count) {
+    wait_idle();
+    for (auto semaphore : m_renderFinished) {
+      vkDestroySemaphore(m_device, semaphore, nullptr);
+    }
+    m_renderFinished.clear();
+    for (uint32_t i{}; i < count; ++i) {
+      m_renderFinished.push_back(create_semaphore());
+    }
+  }
+
+  // Starts the next frame: waits until its slot's previous frame finished
+  // and returns the slot index, which selects the frame's command buffers,
+  // ring regions and arenas.
+  size_t begin_frame() {
+    auto now = clock::now();
+    if (m_started) {
+      m_slot = (m_slot + 1) % m_frames.size();
+    }
+    poll_completed(now);
+    auto& frame = m_frames[m_slot];
+    vkWaitForFences(m_device, 1, &frame.fence, true, ~uint64_t{});
+    auto waited = clock::now();
+    complete(frame, waited);
+    if (m_started) {
+      m_stats.add_frame(ms(now - m_frameStart), ms(waited - now));
+    }
+    m_started = true;
+    m_frameStart = now;
+    frame.start = now;
+    frame.imageIndex.reset();
+    return m_slot;
+  }
+
+  // Acquires the next swapchain image, signaling the frame's acquire
+  // semaphore. Returns nothing when the swapchain has to be recreated or
+  // no image was available; the frame can still submit work without
+  // presenting.
+  std::optional<uint32_t> acquire(VkSwapchainKHR swapchain) {
+    auto& frame = m_frames[m_slot];
+    uint32_t imageIndex{};
+    m_lastResult = vkAcquireNextImageKHR(
+        m_device,
+        swapchain,
+        ~uint64_t{},
+        frame.acquired,
+        VK_NULL_HANDLE,
+        &imageIndex);
+    if (m_lastResult != VK_SUCCESS && m_lastResult != VK_SUBOPTIMAL_KHR) {
+      return {};
+    }
+    if (imageIndex >= m_renderFinished.size()) {
+      throw std::logic_error{"Swap image count not set on frame_scheduler"};
+    }
+    frame.imageIndex = imageIndex;
+    return imageIndex;
+  }
+
+  // Submits the frame's command buffers with its fence. With an acquired
+  // image, the submission waits for it at waitStage and signals the
+  // image's render-finished semaphore for present().
+  void submit(
+      VkQueue queue,
+      const std::vector<VkCommandBuffer>& commandBuffers,
+      VkPipelineStageFlags waitStage =
+          VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT) {
+    auto& frame = m_frames[m_slot];
+    VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submitInfo.commandBufferCount =
+        static_cast<uint32_t>(commandBuffers.size());
+    submitInfo.pCommandBuffers = commandBuffers.data();
+    if (frame.imageIndex) {
+      submitInfo.waitSemaphoreCount = 1;
+      submitInfo.pWaitSemaphores = &frame.acquired;
+      submitInfo.pWaitDstStageMask = &waitStage;
+      submitInfo.signalSemaphoreCount = 1;
+      submitInfo.pSignalSemaphores = &m_renderFinished[*frame.imageIndex];
+    }
+    check(vkResetFences(m_device, 1, &frame.fence));
+    check(vkQueueSubmit(queue, 1, &submitInfo, frame.fence));
+    frame.pending = true;
+  }
+
+  // Presents the image acquired this frame once its rendering finished.
+  // Returns the present result; VK_ERROR_OUT_OF_DATE_KHR and
+  // VK_SUBOPTIMAL_KHR mean the swapchain should be recreated.
+  VkResult present(VkQueue queue, VkSwapchainKHR swapchain) {
+    auto& frame = m_frames[m_slot];
+    if (!frame.imageIndex) {
+      throw std::logic_error{"frame_scheduler::present without an image"};
+    }
+    VkPresentInfoKHR presentInfo{VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &m_renderFinished[*frame.imageIndex];
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &swapchain;
+    presentInfo.pImageIndices = &*frame.imageIndex;
+    m_lastResult = vkQueuePresentKHR(queue, &presentInfo);
+    return m_lastResult;
+  }
+
+  // Blocks until every submitted frame finished.
+  void wait_idle() {
+    for (auto& frame : m_frames) {
+      if (frame.pending) {
+        vkWaitForFences(m_device, 1, &frame.fence, true, ~uint64_t{});
+        complete(frame, clock::now());
+      }
+    }
+  }
+
+  size_t frames_in_flight() const { return m_frames.size(); }
+  size_t current_frame() const { return m_slot; }
+  // fence signaled when a frame slot's last submission finished
+  VkFence fence(size_t frame) const { return m_frames[frame].fence; }
+  std::vector<VkFence> fences() const {
+    std::vector<VkFence> result{};
+    for (auto& frame : m_frames) {
+      result.push_back(frame.fence);
+    }
+    return result;
+  }
+  // result of the last acquire or present
+  VkResult last_result() const { return m_lastResult; }
+  const frame_pacing_stats& stats() const { return m_stats; }
+
+private:
+  struct frame_slot {
+    VkFence fence{};
+    VkSemaphore acquired{};
+    std::optional<uint32_t> imageIndex{};
+    clock::time_point start{};
+    bool pending{};
+  };
+
+  VkDevice m_device{};
+  std::vector<frame_slot> m_frames;
+  std::vector<VkSemaphore> m_renderFinished{};
+  size_t m_slot{};
+  bool m_started{};
+  clock::time_point m_frameStart{};
+  VkResult m_lastResult{VK_SUCCESS};
+  frame_pacing_stats m_stats{};
+
+  static double ms(clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  }
+
+  static void check(VkResult result) {
+    if (result != VK_SUCCESS) {
+      throw std::runtime_error{
+          "Frame scheduler Vulkan call failed: " +
+          std::to_string(static_cast<int>(result))};
+    }
+  }
+
+  VkSemaphore create_semaphore() {
+    VkSemaphoreCreateInfo semaphoreInfo{
+        VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    VkSemaphore semaphore{};
+    check(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &semaphore));
+    return semaphore;
+  }
+
+  void complete(frame_slot& frame, clock::time_point now) {
+    if (frame.pending) {
+      frame.pending = false;
+      m_stats.add_latency(ms(now - frame.start));
+    }
+  }
+
+  // Latency is observed when a frame start finds the fence signaled, so
+  // it is rounded up to the CPU frame time.
+  void poll_completed(clock::time_point now) {
+    for (auto& frame : m_frames) {
+      if (frame.pending &&
+          vkGetFenceStatus(m_device, frame.fence) == VK_SUCCESS) {
+        complete(frame, now);
+      }
+    }
+  }
+};
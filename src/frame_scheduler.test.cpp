@@ -0,0 +1,77 @@
+#include "frame_scheduler.hpp"
+#include "headless_vulkan.hpp"
+#include <catch2/catch.hpp>
+
+TEST_CASE("Present mode prefers MAILBOX, then IMMEDIATE, then FIFO") {
+  std::vector<VkPresentModeKHR> all{VK_PRESENT_MODE_FIFO_KHR,
+                                    VK_PRESENT_MODE_IMMEDIATE_KHR,
+                                    VK_PRESENT_MODE_MAILBOX_KHR};
+  REQUIRE(pick_present_mode(all) == VK_PRESENT_MODE_MAILBOX_KHR);
+  REQUIRE(pick_present_mode(all, true) == VK_PRESENT_MODE_FIFO_KHR);
+  // without MAILBOX, latency wins over tearing unless vsync is asked for
+  REQUIRE(
+      pick_present_mode({VK_PRESENT_MODE_IMMEDIATE_KHR,
+                         VK_PRESENT_MODE_FIFO_KHR}) ==
+      VK_PRESENT_MODE_IMMEDIATE_KHR);
+  REQUIRE(
+      pick_present_mode({VK_PRESENT_MODE_FIFO_KHR}) ==
+      VK_PRESENT_MODE_FIFO_KHR);
+  REQUIRE(pick_present_mode({}) == VK_PRESENT_MODE_FIFO_KHR);
+}
+
+TEST_CASE("Frame pacing stats average over a window") {
+  frame_pacing_stats stats{4};
+  REQUIRE(stats.cpu_frame_ms() == 0);
+  REQUIRE(stats.frames_per_second() == 0);
+
+  stats.add_frame(10, 2);
+  stats.add_frame(20, 4);
+  REQUIRE(stats.cpu_frame_ms() == Approx(15));
+  REQUIRE(stats.gpu_wait_ms() == Approx(3));
+  REQUIRE(stats.frames_per_second() == Approx(1000.0 / 15));
+
+  // the first two samples fall out of the window
+  for (int i{}; i < 4; ++i) {
+    stats.add_frame(5, 0);
+  }
+  REQUIRE(stats.cpu_frame_ms() == Approx(5));
+  REQUIRE(stats.gpu_wait_ms() == Approx(0));
+  REQUIRE(stats.frame_count() == 6);
+
+  stats.add_latency(30);
+  stats.add_latency(50);
+  REQUIRE(stats.latency_ms() == Approx(40));
+
+  REQUIRE_THROWS_AS(frame_pacing_stats{0}, std::invalid_argument);
+}
+
+TEST_CASE("Frame scheduler cycles frame slots") {
+  auto vk = headless_vulkan::create();
+  if (!vk) {
+    WARN("No Vulkan device; set VK_ICD_FILENAMES to lavapipe to run this");
+    return;
+  }
+  frame_scheduler scheduler{vk->device, 3};
+  REQUIRE(scheduler.frames_in_flight() == 3);
+
+  // offscreen frames: no image is acquired, so submit only signals the
+  // slot's fence
+  std::vector<size_t> slots{};
+  for (int i{}; i < 7; ++i) {
+    slots.push_back(scheduler.begin_frame());
+    scheduler.submit(vk->graphicsQueue, {});
+  }
+  REQUIRE(slots == std::vector<size_t>{0, 1, 2, 0, 1, 2, 0});
+  REQUIRE(scheduler.current_frame() == 0);
+  REQUIRE_THROWS_AS(
+      scheduler.present(vk->graphicsQueue, VK_NULL_HANDLE), std::logic_error);
+
+  scheduler.wait_idle();
+  for (auto fence : scheduler.fences()) {
+    REQUIRE(vkGetFenceStatus(vk->device, fence) == VK_SUCCESS);
+  }
+  auto& stats = scheduler.stats();
+  REQUIRE(stats.frame_count() == 6);
+  REQUIRE(stats.cpu_frame_ms() >= stats.gpu_wait_ms());
+  REQUIRE(stats.latency_ms() >= 0);
+}
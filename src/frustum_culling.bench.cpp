@@ -0,0 +1,51 @@
+#include "bench.hpp"
+#include "frustum_culling.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <vector>
+
+// Culls instances scattered through a 2 km cube around a camera with a
+// 60 degree field of view, so about a tenth of them are visible.
+int main() {
+  auto projection =
+      glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 1000.f);
+  auto view = glm::lookAt(
+      glm::vec3(0.f, 0.f, 0.f),
+      glm::vec3(0.f, 0.f, -1.f),
+      glm::vec3(0.f, 1.f, 0.f));
+  auto frustum = extract_frustum(projection * view);
+
+  for (size_t count : {size_t{100000}, size_t{1000000}}) {
+    std::mt19937 rng{7};
+    std::uniform_real_distribution<float> position{-1000.f, 1000.f};
+    std::uniform_real_distribution<float> size{0.5f, 10.f};
+    instance_bounds bounds{};
+    bounds.reserve(count);
+    for (size_t i{}; i < count; ++i) {
+      std::array<float, 3> low{position(rng), position(rng), position(rng)};
+      bounds.add_box(
+          low, {low[0] + size(rng), low[1] + size(rng), low[2] + size(rng)});
+    }
+
+    std::vector<uint32_t> visible;
+    visible.reserve(count + 1);
+    const std::pair<cull_path, const char*> paths[]{
+        {cull_path::scalar, "scalar"},
+        {cull_path::sse, "sse"},
+        {cull_path::avx, "avx"}};
+    for (auto& [path, pathName] : paths) {
+      if (!cull_path_supported(path)) {
+        std::printf("%s path not supported on this CPU\n", pathName);
+        continue;
+      }
+      char name[64];
+      std::snprintf(
+          name, sizeof(name), "cull %zu instances (%s)", count, pathName);
+      run_benchmark(name, count, [&] {
+        cull_instances(frustum, bounds, visible, path);
+        do_not_optimize(visible);
+      });
+    }
+    std::printf("  %zu of %zu visible\n", visible.size(), count);
+  }
+}
@@ -0,0 +1,325 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+    defined(_M_IX86)
+#define VKA_CULL_X86
+#include <immintrin.h>
+#endif
+
+// GCC and Clang compile the AVX kernel with a target attribute and pick it at
+// run time; other compilers only get it when the whole build targets AVX.
+#if defined(VKA_CULL_X86) && (defined(__GNUC__) || defined(__clang__))
+#define VKA_CULL_AVX
+#define VKA_CULL_TARGET_AVX __attribute__((target("avx")))
+#elif defined(VKA_CULL_X86) && defined(__AVX__)
+#define VKA_CULL_AVX
+#define VKA_CULL_TARGET_AVX
+#endif
+
+// Six planes (a, b, c, d) with normals pointing into the frustum, normalized
+// so a x + b y + c z + d is the signed distance of a point.
+struct frustum {
+  std::array<std::array<float, 4>, 6> planes{};
+};
+
+// Extracts the world-space frustum of a projection * view matrix (Gribb &
+// Hartmann). The near plane uses the -w <= z clip convention, which is exact
+// for OpenGL-style projections and slightly conservative for Vulkan's
+// 0 <= z, so nothing visible is ever culled.
+inline frustum extract_frustum(const glm::mat4& viewProjection) {
+  auto row = [&](int r) {
+    return std::array<float, 4>{viewProjection[0][r],
+                                viewProjection[1][r],
+                                viewProjection[2][r],
+                                viewProjection[3][r]};
+  };
+  auto w = row(3);
+  frustum result{};
+  for (int axis{}; axis < 3; ++axis) {
+    auto r = row(axis);
+    for (int i{}; i < 4; ++i) {
+      result.planes[axis * 2][i] = w[i] + r[i];
+      result.planes[axis * 2 + 1][i] = w[i] - r[i];
+    }
+  }
+  for (auto& plane : result.planes) {
+    float length = std::sqrt(
+        plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+    if (length > 0.f) {
+      for (auto& value : plane) {
+        value /= length;
+      }
+    }
+  }
+  return result;
+}
+
+// Instance bounds in structure-of-arrays form, as box centres and half
+// extents. Spheres are stored as their bounding boxes, which keeps one test
+// for both and is only slightly conservative.
+struct instance_bounds {
+  std::vector<float> centerX;
+  std::vector<float> centerY;
+  std::vector<float> centerZ;
+  std::vector<float> extentX;
+  std::vector<float> extentY;
+  std::vector<float> extentZ;
+
+  size_t size() const { return centerX.size(); }
+
+  void reserve(size_t count) {
+    for (auto stream : streams()) {
+      stream->reserve(count);
+    }
+  }
+
+  void clear() {
+    for (auto stream : streams()) {
+      stream->clear();
+    }
+  }
+
+  uint32_t add_box(
+      const std::array<float, 3>& boundsMin,
+      const std::array<float, 3>& boundsMax) {
+    auto index = static_cast<uint32_t>(size());
+    for (auto stream : streams()) {
+      stream->push_back(0.f);
+    }
+    set_box(index, boundsMin, boundsMax);
+    return index;
+  }
+
+  uint32_t add_sphere(const std::array<float, 3>& center, float radius) {
+    return add_box(
+        {center[0] - radius, center[1] - radius, center[2] - radius},
+        {center[0] + radius, center[1] + radius, center[2] + radius});
+  }
+
+  void set_box(
+      size_t index,
+      const std::array<float, 3>& boundsMin,
+      const std::array<float, 3>& boundsMax) {
+    centerX[index] = (boundsMin[0] + boundsMax[0]) * 0.5f;
+    centerY[index] = (boundsMin[1] + boundsMax[1]) * 0.5f;
+    centerZ[index] = (boundsMin[2] + boundsMax[2]) * 0.5f;
+    extentX[index] = (boundsMax[0] - boundsMin[0]) * 0.5f;
+    extentY[index] = (boundsMax[1] - boundsMin[1]) * 0.5f;
+    extentZ[index] = (boundsMax[2] - boundsMin[2]) * 0.5f;
+  }
+
+private:
+  std::array<std::vector<float>*, 6> streams() {
+    return {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ};
+  }
+};
+
+enum class cull_path { scalar, sse, avx, best };
+
+namespace detail {
+// A box is outside when it lies entirely behind any plane: the plane
+// distance of its centre plus its projected radius |n| . extent is negative.
+inline size_t cull_scalar(
+    const frustum& frustum,
+    const instance_bounds& bounds,
+    size_t begin,
+    uint32_t* visible) {
+  size_t count{};
+  for (size_t i = begin; i < bounds.size(); ++i) {
+    bool inside = true;
+    for (auto& plane : frustum.planes) {
+      // summed as the SIMD paths do, so every path rounds the same way
+      float distance =
+          (plane[0] * bounds.centerX[i] + plane[1] * bounds.centerY[i]) +
+          (plane[2] * bounds.centerZ[i] + plane[3]);
+      float radius = std::abs(plane[0]) * bounds.extentX[i] +
+                     std::abs(plane[1]) * bounds.extentY[i] +
+                     std::abs(plane[2]) * bounds.extentZ[i];
+      inside &= distance + radius >= 0.f;
+    }
+    visible[count] = static_cast<uint32_t>(i);
+    count += inside;
+  }
+  return count;
+}
+
+#ifdef VKA_CULL_X86
+inline size_t write_visible(
+    uint32_t mask,
+    size_t first,
+    uint32_t* visible) {
+  size_t count{};
+  while (mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    auto bit = static_cast<uint32_t>(__builtin_ctz(mask));
+#else
+    unsigned long bit;
+    _BitScanForward(&bit, mask);
+#endif
+    visible[count++] = static_cast<uint32_t>(first + bit);
+    mask &= mask - 1;
+  }
+  return count;
+}
+
+inline size_t cull_sse(
+    const frustum& frustum,
+    const instance_bounds& bounds,
+    uint32_t* visible) {
+  // per plane: a, b, c, d, |a|, |b|, |c| broadcast across lanes
+  __m128 planes[6][7];
+  for (size_t p{}; p < 6; ++p) {
+    auto& plane = frustum.planes[p];
+    const float values[7]{plane[0],
+                          plane[1],
+                          plane[2],
+                          plane[3],
+                          std::abs(plane[0]),
+                          std::abs(plane[1]),
+                          std::abs(plane[2])};
+    for (size_t k{}; k < 7; ++k) {
+      planes[p][k] = _mm_set1_ps(values[k]);
+    }
+  }
+  const __m128 zero = _mm_setzero_ps();
+  size_t count{};
+  size_t i{};
+  for (; i + 4 <= bounds.size(); i += 4) {
+    __m128 cx = _mm_loadu_ps(&bounds.centerX[i]);
+    __m128 cy = _mm_loadu_ps(&bounds.centerY[i]);
+    __m128 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+    __m128 ex = _mm_loadu_ps(&bounds.extentX[i]);
+    __m128 ey = _mm_loadu_ps(&bounds.extentY[i]);
+    __m128 ez = _mm_loadu_ps(&bounds.extentZ[i]);
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (auto& plane : planes) {
+      __m128 distance = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(plane[0], cx), _mm_mul_ps(plane[1], cy)),
+          _mm_add_ps(_mm_mul_ps(plane[2], cz), plane[3]));
+      __m128 radius = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(plane[4], ex), _mm_mul_ps(plane[5], ey)),
+          _mm_mul_ps(plane[6], ez));
+      inside = _mm_and_ps(
+          inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+    }
+    count += write_visible(
+        static_cast<uint32_t>(_mm_movemask_ps(inside)), i, visible + count);
+  }
+  return count + cull_scalar(frustum, bounds, i, visible + count);
+}
+#endif
+
+#ifdef VKA_CULL_AVX
+VKA_CULL_TARGET_AVX inline size_t cull_avx(
+    const frustum& frustum,
+    const instance_bounds& bounds,
+    uint32_t* visible) {
+  // per plane: a, b, c, d, |a|, |b|, |c| broadcast across lanes
+  __m256 planes[6][7];
+  for (size_t p{}; p < 6; ++p) {
+    auto& plane = frustum.planes[p];
+    const float values[7]{plane[0],
+                          plane[1],
+                          plane[2],
+                          plane[3],
+                          std::abs(plane[0]),
+                          std::abs(plane[1]),
+                          std::abs(plane[2])};
+    for (size_t k{}; k < 7; ++k) {
+      planes[p][k] = _mm256_set1_ps(values[k]);
+    }
+  }
+  const __m256 zero = _mm256_setzero_ps();
+  size_t count{};
+  size_t i{};
+  for (; i + 8 <= bounds.size(); i += 8) {
+    __m256 cx = _mm256_loadu_ps(&bounds.centerX[i]);
+    __m256 cy = _mm256_loadu_ps(&bounds.centerY[i]);
+    __m256 cz = _mm256_loadu_ps(&bounds.centerZ[i]);
+    __m256 ex = _mm256_loadu_ps(&bounds.extentX[i]);
+    __m256 ey = _mm256_loadu_ps(&bounds.extentY[i]);
+    __m256 ez = _mm256_loadu_ps(&bounds.extentZ[i]);
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (auto& plane : planes) {
+      __m256 distance = _mm256_add_ps(
+          _mm256_add_ps(
+              _mm256_mul_ps(plane[0], cx), _mm256_mul_ps(plane[1], cy)),
+          _mm256_add_ps(_mm256_mul_ps(plane[2], cz), plane[3]));
+      __m256 radius = _mm256_add_ps(
+          _mm256_add_ps(
+              _mm256_mul_ps(plane[4], ex), _mm256_mul_ps(plane[5], ey)),
+          _mm256_mul_ps(plane[6], ez));
+      inside = _mm256_and_ps(
+          inside,
+          _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+    }
+    count += write_visible(
+        static_cast<uint32_t>(_mm256_movemask_ps(inside)), i, visible + count);
+  }
+  return count + cull_scalar(frustum, bounds, i, visible + count);
+}
+#endif
+}  // namespace detail
+
+inline bool cull_path_supported(cull_path path) {
+  switch (path) {
+    case cull_path::scalar:
+    case cull_path::best:
+      return true;
+    case cull_path::sse:
+#ifdef VKA_CULL_X86
+      return true;
+#else
+      return false;
+#endif
+    case cull_path::avx:
+#if defined(VKA_CULL_AVX) && (defined(__GNUC__) || defined(__clang__))
+      return __builtin_cpu_supports("avx");
+#elif defined(VKA_CULL_AVX)
+      return true;
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+// Tests every instance against the frustum and writes the indices of the
+// visible ones, in ascending order, to visible. Every path produces the same
+// list; best picks the widest one the CPU supports.
+inline void cull_instances(
+    const frustum& frustum,
+    const instance_bounds& bounds,
+    std::vector<uint32_t>& visible,
+    cull_path path = cull_path::best) {
+  if (path == cull_path::best) {
+    path = cull_path_supported(cull_path::avx)   ? cull_path::avx
+           : cull_path_supported(cull_path::sse) ? cull_path::sse
+                                                 : cull_path::scalar;
+  }
+  // kernels write unconditionally and advance only past visible entries
+  visible.resize(bounds.size() + 1);
+  size_t count{};
+  switch (path) {
+#ifdef VKA_CULL_AVX
+    case cull_path::avx:
+      count = detail::cull_avx(frustum, bounds, visible.data());
+      break;
+#endif
+#ifdef VKA_CULL_X86
+    case cull_path::sse:
+      count = detail::cull_sse(frustum, bounds, visible.data());
+      break;
+#endif
+    default:
+      count = detail::cull_scalar(frustum, bounds, 0, visible.data());
+      break;
+  }
+  visible.resize(count);
+}
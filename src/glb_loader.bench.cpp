@@ -0,0 +1,171 @@
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include "bench.hpp"
+#include "glb_loader.hpp"
+#include <tiny_gltf.h>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Writes an n x n vertex grid with positions, normals and 32-bit indices.
+static void write_grid_glb(const std::string& path, uint32_t n) {
+  size_t vertexCount = size_t{n} * n;
+  size_t indexCount = size_t{n - 1} * (n - 1) * 6;
+  std::vector<float> positions;
+  std::vector<float> normals;
+  positions.reserve(vertexCount * 3);
+  normals.reserve(vertexCount * 3);
+  for (uint32_t z{}; z < n; ++z) {
+    for (uint32_t x{}; x < n; ++x) {
+      positions.insert(
+          positions.end(),
+          {float(x), float((x * 7 + z * 13) % 5) * 0.1f, float(z)});
+      normals.insert(normals.end(), {0.f, 1.f, 0.f});
+    }
+  }
+  std::vector<uint32_t> indices;
+  indices.reserve(indexCount);
+  for (uint32_t z{}; z + 1 < n; ++z) {
+    for (uint32_t x{}; x + 1 < n; ++x) {
+      uint32_t i = z * n + x;
+      indices.insert(indices.end(), {i, i + n, i + 1, i + 1, i + n, i + n + 1});
+    }
+  }
+
+  size_t positionBytes = positions.size() * sizeof(float);
+  size_t normalBytes = normals.size() * sizeof(float);
+  size_t indexBytes = indices.size() * sizeof(uint32_t);
+  std::vector<std::byte> bin(positionBytes + normalBytes + indexBytes);
+  std::memcpy(bin.data(), positions.data(), positionBytes);
+  std::memcpy(bin.data() + positionBytes, normals.data(), normalBytes);
+  std::memcpy(
+      bin.data() + positionBytes + normalBytes, indices.data(), indexBytes);
+
+  nlohmann::json json;
+  json["asset"]["version"] = "2.0";
+  json["buffers"] = {{{"byteLength", bin.size()}}};
+  json["bufferViews"] = {
+      {{"buffer", 0}, {"byteOffset", 0}, {"byteLength", positionBytes}},
+      {{"buffer", 0},
+       {"byteOffset", positionBytes},
+       {"byteLength", normalBytes}},
+      {{"buffer", 0},
+       {"byteOffset", positionBytes + normalBytes},
+       {"byteLength", indexBytes}}};
+  json["accessors"] = {
+      {{"bufferView", 0},
+       {"componentType", gltf_float},
+       {"count", vertexCount},
+       {"type", "VEC3"},
+       {"min", {0, 0, 0}},
+       {"max", {n - 1, 1, n - 1}}},
+      {{"bufferView", 1},
+       {"componentType", gltf_float},
+       {"count", vertexCount},
+       {"type", "VEC3"}},
+      {{"bufferView", 2},
+       {"componentType", gltf_unsigned_int},
+       {"count", indexCount},
+       {"type", "SCALAR"}}};
+  json["meshes"] = {
+      {{"primitives",
+        {{{"attributes", {{"POSITION", 0}, {"NORMAL", 1}}},
+          {"indices", 2}}}}}};
+  json["nodes"] = {{{"mesh", 0}}};
+  json["scenes"] = {{{"nodes", {0}}}};
+  write_glb(path, json, {bin.data(), bin.size()});
+}
+
+// Both paths finish with the vertex and index data packed in a staging
+// allocation, as an upload would need.
+static size_t load_with_tinygltf(const std::string& path) {
+  tinygltf::TinyGLTF loader{};
+  tinygltf::Model model{};
+  std::string err{};
+  std::string warn{};
+  loader.LoadBinaryFromFile(&model, &err, &warn, path);
+  size_t total{};
+  for (auto& accessor : model.accessors) {
+    auto& view = model.bufferViews[accessor.bufferView];
+    total += view.byteLength;
+  }
+  std::vector<std::byte> staging(total);
+  size_t offset{};
+  for (auto& accessor : model.accessors) {
+    auto& view = model.bufferViews[accessor.bufferView];
+    auto& buffer = model.buffers[view.buffer];
+    std::memcpy(
+        staging.data() + offset,
+        buffer.data.data() + view.byteOffset + accessor.byteOffset,
+        view.byteLength);
+    offset += view.byteLength;
+  }
+  return staging.size();
+}
+
+static size_t load_with_glb_file(const std::string& path) {
+  glb_file glb{path};
+  std::vector<glb_accessor> accessors;
+  size_t total{};
+  for (size_t i{}; i < glb.json()["accessors"].size(); ++i) {
+    accessors.push_back(glb.accessor(i));
+    total += accessors.back().elementSize * accessors.back().count;
+  }
+  std::vector<std::byte> staging(total);
+  size_t offset{};
+  for (auto& accessor : accessors) {
+    accessor.copy_to(staging.data() + offset);
+    offset += accessor.elementSize * accessor.count;
+  }
+  return staging.size();
+}
+
+// Runs load in a child process so each path's peak RSS is measured alone.
+// Times are reported per vertex.
+template <typename Load>
+void measure(
+    const char* name,
+    const std::string& path,
+    size_t vertexCount,
+    Load&& load) {
+#ifndef _WIN32
+  std::fflush(stdout);
+  auto child = fork();
+  if (child == 0) {
+    run_benchmark(name, vertexCount, [&] { do_not_optimize(load(path)); }, 3);
+    std::fflush(stdout);
+    _exit(0);
+  }
+  int status{};
+  rusage usage{};
+  wait4(child, &status, 0, &usage);
+  std::printf("%-48s %12ld KiB peak RSS\n", name, usage.ru_maxrss);
+#else
+  run_benchmark(name, vertexCount, [&] { do_not_optimize(load(path)); }, 3);
+#endif
+}
+
+int main(int argc, char** argv) {
+  std::vector<uint32_t> gridSizes{256, 1024, 2048};
+  if (argc > 1) {
+    gridSizes = {static_cast<uint32_t>(std::stoul(argv[1]))};
+  }
+  for (auto n : gridSizes) {
+    std::string path = "glb_loader_bench_" + std::to_string(n) + ".glb";
+    write_grid_glb(path, n);
+    std::printf("%u x %u grid\n", n, n);
+    size_t vertexCount = size_t{n} * n;
+    measure(
+        "tinygltf LoadBinaryFromFile", path, vertexCount, load_with_tinygltf);
+    measure("glb_file (mmap)", path, vertexCount, load_with_glb_file);
+    std::remove(path.c_str());
+  }
+}
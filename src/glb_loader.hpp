@@ -0,0 +1,238 @@
+#pragma once
+#include "array_view.hpp"
+#include "mapped_file.hpp"
+#include <json.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+constexpr uint32_t glb_magic = 0x46546C67;       // "glTF"
+constexpr uint32_t glb_chunk_json = 0x4E4F534A;  // "JSON"
+constexpr uint32_t glb_chunk_bin = 0x004E4942;   // "BIN\0"
+
+// glTF componentType values
+constexpr uint32_t gltf_unsigned_short = 5123;
+constexpr uint32_t gltf_unsigned_int = 5125;
+constexpr uint32_t gltf_float = 5126;
+
+// An accessor resolved to a location inside the mapped BIN chunk.
+struct glb_accessor {
+  const std::byte* data{};
+  size_t count{};
+  // bytes in one element, e.g. 12 for a float VEC3
+  size_t elementSize{};
+  // bytes between the starts of consecutive elements
+  size_t byteStride{};
+  uint32_t componentType{};
+  uint32_t componentCount{};
+
+  bool tightly_packed() const { return byteStride == elementSize; }
+
+  // Views the accessor as an array of T without copying. Throws if the data
+  // is interleaved or not suitably aligned for T.
+  template <typename T>
+  array_view<T> as() const {
+    if (sizeof(T) != elementSize || !tightly_packed()) {
+      throw std::runtime_error{"glb accessor is not a packed array of T"};
+    }
+    if (reinterpret_cast<uintptr_t>(data) % alignof(T) != 0) {
+      throw std::runtime_error{"glb accessor is misaligned for T"};
+    }
+    return {reinterpret_cast<const T*>(data), count};
+  }
+
+  // Copies the elements into a tightly packed destination, which is the one
+  // copy on the way from the page cache to a staging buffer.
+  void copy_to(void* destination) const {
+    if (tightly_packed()) {
+      std::memcpy(destination, data, elementSize * count);
+      return;
+    }
+    auto out = static_cast<std::byte*>(destination);
+    for (size_t i{}; i < count; ++i) {
+      std::memcpy(out + i * elementSize, data + i * byteStride, elementSize);
+    }
+  }
+};
+
+// Accessor indices of the attributes the 3D pipeline consumes.
+struct glb_primitive {
+  std::optional<size_t> positions;
+  std::optional<size_t> normals;
+  std::optional<size_t> indices;
+};
+
+// Binary glTF loaded by memory-mapping the file. Only the JSON chunk is
+// parsed; buffer views and accessors are exposed as views straight into the
+// mapped BIN chunk.
+struct glb_file {
+  glb_file(const std::string& path) : m_file(path) { parse(); }
+
+  const nlohmann::json& json() const { return m_json; }
+
+  array_view<std::byte> bin() const { return m_bin; }
+
+  array_view<std::byte> buffer_view(size_t index) const {
+    auto& view = m_json.at("bufferViews").at(index);
+    if (view.value("buffer", 0) != 0) {
+      throw std::runtime_error{"glb buffer view does not use the BIN chunk"};
+    }
+    return m_bin.subview(
+        view.value("byteOffset", size_t{}),
+        view.at("byteLength").get<size_t>());
+  }
+
+  glb_accessor accessor(size_t index) const {
+    auto& accessorJson = m_json.at("accessors").at(index);
+    if (!accessorJson.count("bufferView") || accessorJson.count("sparse")) {
+      throw std::runtime_error{"glb accessor without a buffer view"};
+    }
+    size_t viewIndex = accessorJson.at("bufferView");
+    auto view = buffer_view(viewIndex);
+
+    glb_accessor result{};
+    result.count = accessorJson.at("count");
+    result.componentType = accessorJson.at("componentType");
+    result.componentCount = component_count(accessorJson.at("type"));
+    result.elementSize =
+        component_size(result.componentType) * result.componentCount;
+    result.byteStride = m_json["bufferViews"][viewIndex].value(
+        "byteStride", result.elementSize);
+
+    size_t offset = accessorJson.value("byteOffset", size_t{});
+    size_t extent = result.count == 0 ? 0
+                                      : result.byteStride * (result.count - 1) +
+                                            result.elementSize;
+    result.data = view.subview(offset, extent).data();
+    return result;
+  }
+
+  size_t mesh_count() const {
+    return m_json.count("meshes") ? m_json["meshes"].size() : 0;
+  }
+
+  size_t primitive_count(size_t mesh) const {
+    return m_json.at("meshes").at(mesh).at("primitives").size();
+  }
+
+  glb_primitive primitive(size_t mesh, size_t primitive) const {
+    auto& primitiveJson =
+        m_json.at("meshes").at(mesh).at("primitives").at(primitive);
+    auto& attributes = primitiveJson.at("attributes");
+    glb_primitive result{};
+    if (attributes.count("POSITION")) {
+      result.positions = attributes["POSITION"].get<size_t>();
+    }
+    if (attributes.count("NORMAL")) {
+      result.normals = attributes["NORMAL"].get<size_t>();
+    }
+    if (primitiveJson.count("indices")) {
+      result.indices = primitiveJson["indices"].get<size_t>();
+    }
+    return result;
+  }
+
+private:
+  mapped_file m_file;
+  nlohmann::json m_json{};
+  array_view<std::byte> m_bin{};
+
+  static uint32_t read_u32(array_view<std::byte> bytes, size_t offset) {
+    uint32_t value{};
+    std::memcpy(&value, bytes.subview(offset, 4).data(), 4);
+    return value;
+  }
+
+  void parse() {
+    auto bytes = m_file.bytes();
+    if (bytes.size() < 20 || read_u32(bytes, 0) != glb_magic ||
+        read_u32(bytes, 4) != 2) {
+      throw std::runtime_error{"Not a glTF 2.0 binary file"};
+    }
+    size_t totalLength = std::min<size_t>(read_u32(bytes, 8), bytes.size());
+
+    size_t offset = 12;
+    while (offset + 8 <= totalLength) {
+      uint32_t chunkLength = read_u32(bytes, offset);
+      uint32_t chunkType = read_u32(bytes, offset + 4);
+      auto chunk = bytes.subview(offset + 8, chunkLength);
+      if (chunkType == glb_chunk_json) {
+        auto text = reinterpret_cast<const char*>(chunk.data());
+        m_json = nlohmann::json::parse(text, text + chunk.size());
+      } else if (chunkType == glb_chunk_bin && m_bin.empty()) {
+        m_bin = chunk;
+      }
+      // chunks are 4-byte aligned
+      offset += 8 + ((chunkLength + 3) & ~uint32_t{3});
+    }
+    if (m_json.is_null()) {
+      throw std::runtime_error{"glb file has no JSON chunk"};
+    }
+  }
+
+  static size_t component_size(uint32_t componentType) {
+    switch (componentType) {
+      case 5120:  // BYTE
+      case 5121:  // UNSIGNED_BYTE
+        return 1;
+      case 5122:  // SHORT
+      case gltf_unsigned_short:
+        return 2;
+      case gltf_unsigned_int:
+      case gltf_float:
+        return 4;
+      default:
+        throw std::runtime_error{"Unknown glTF componentType"};
+    }
+  }
+
+  static uint32_t component_count(const std::string& type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    if (type == "MAT2") return 4;
+    if (type == "MAT3") return 9;
+    if (type == "MAT4") return 16;
+    throw std::runtime_error{"Unknown glTF accessor type " + type};
+  }
+};
+
+// Writes a binary glTF with a JSON chunk and an optional BIN chunk.
+inline void write_glb(
+    const std::string& path,
+    const nlohmann::json& json,
+    array_view<std::byte> bin) {
+  auto text = json.dump();
+  // JSON is padded with spaces and BIN with zeros to 4 byte boundaries
+  text.resize((text.size() + 3) & ~size_t{3}, ' ');
+  size_t binLength = (bin.size() + 3) & ~size_t{3};
+  uint32_t totalLength = static_cast<uint32_t>(
+      12 + 8 + text.size() + (bin.empty() ? 0 : 8 + binLength));
+
+  std::ofstream out{path, std::ios::binary};
+  auto write_u32 = [&](uint32_t value) {
+    out.write(reinterpret_cast<const char*>(&value), 4);
+  };
+  write_u32(glb_magic);
+  write_u32(2);
+  write_u32(totalLength);
+  write_u32(static_cast<uint32_t>(text.size()));
+  write_u32(glb_chunk_json);
+  out.write(text.data(), text.size());
+  if (!bin.empty()) {
+    write_u32(static_cast<uint32_t>(binLength));
+    write_u32(glb_chunk_bin);
+    out.write(reinterpret_cast<const char*>(bin.data()), bin.size());
+    const char padding[4]{};
+    out.write(padding, binLength - bin.size());
+  }
+  if (!out) {
+    throw std::runtime_error{"Unable to write " + path};
+  }
+}
\ No newline at end of file
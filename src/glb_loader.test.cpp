@@ -0,0 +1,120 @@
+#include "glb_loader.hpp"
+#include <catch2/catch.hpp>
+#include <array>
+#include <cstdio>
+#include <vector>
+
+namespace {
+struct vec3 {
+  float x, y, z;
+};
+
+// Three packed position/normal/index streams, followed by an interleaved
+// position+normal stream for the strided path.
+struct test_glb {
+  std::string path = "glb_loader_test.glb";
+  std::array<vec3, 3> positions{{{0, 0, 0}, {1, 0, 0}, {0, 1, 0}}};
+  std::array<vec3, 3> normals{{{0, 0, 1}, {0, 0, 1}, {0, 0, 1}}};
+  std::array<uint16_t, 3> indices{0, 1, 2};
+
+  test_glb() {
+    std::vector<std::byte> bin;
+    auto append = [&](const void* data, size_t size) {
+      auto offset = bin.size();
+      bin.resize(offset + size);
+      std::memcpy(bin.data() + offset, data, size);
+      return offset;
+    };
+    auto positionOffset = append(positions.data(), sizeof(positions));
+    auto normalOffset = append(normals.data(), sizeof(normals));
+    auto indexOffset = append(indices.data(), sizeof(indices));
+    bin.resize((bin.size() + 3) & ~size_t{3});
+    std::vector<vec3> interleaved;
+    for (size_t i{}; i < 3; ++i) {
+      interleaved.push_back(positions[i]);
+      interleaved.push_back(normals[i]);
+    }
+    auto interleavedOffset =
+        append(interleaved.data(), interleaved.size() * sizeof(vec3));
+
+    nlohmann::json json;
+    json["asset"]["version"] = "2.0";
+    json["buffers"] = {{{"byteLength", bin.size()}}};
+    json["bufferViews"] = {
+        {{"buffer", 0}, {"byteOffset", positionOffset}, {"byteLength", 36}},
+        {{"buffer", 0}, {"byteOffset", normalOffset}, {"byteLength", 36}},
+        {{"buffer", 0}, {"byteOffset", indexOffset}, {"byteLength", 6}},
+        {{"buffer", 0},
+         {"byteOffset", interleavedOffset},
+         {"byteLength", 72},
+         {"byteStride", 24}}};
+    json["accessors"] = {
+        {{"bufferView", 0},
+         {"componentType", gltf_float},
+         {"count", 3},
+         {"type", "VEC3"}},
+        {{"bufferView", 1},
+         {"componentType", gltf_float},
+         {"count", 3},
+         {"type", "VEC3"}},
+        {{"bufferView", 2},
+         {"componentType", gltf_unsigned_short},
+         {"count", 3},
+         {"type", "SCALAR"}},
+        {{"bufferView", 3},
+         {"byteOffset", 12},
+         {"componentType", gltf_float},
+         {"count", 3},
+         {"type", "VEC3"}}};
+    json["meshes"] = {
+        {{"primitives",
+          {{{"attributes", {{"POSITION", 0}, {"NORMAL", 1}}},
+            {"indices", 2}}}}}};
+    write_glb(path, json, {bin.data(), bin.size()});
+  }
+
+  ~test_glb() { std::remove(path.c_str()); }
+};
+}  // namespace
+
+TEST_CASE("A glb file exposes its meshes and primitives") {
+  test_glb source;
+  glb_file glb{source.path};
+  REQUIRE(glb.mesh_count() == 1);
+  REQUIRE(glb.primitive_count(0) == 1);
+  auto primitive = glb.primitive(0, 0);
+  REQUIRE(primitive.positions == 0u);
+  REQUIRE(primitive.normals == 1u);
+  REQUIRE(primitive.indices == 2u);
+}
+
+TEST_CASE("Packed glb accessors are views into the BIN chunk") {
+  test_glb source;
+  glb_file glb{source.path};
+  auto positions = glb.accessor(0).as<vec3>();
+  REQUIRE(positions.size() == 3);
+  REQUIRE(positions.data() >= reinterpret_cast<const vec3*>(glb.bin().begin()));
+  REQUIRE(positions[1].x == 1.f);
+  auto indices = glb.accessor(2).as<uint16_t>();
+  REQUIRE(indices[2] == 2);
+}
+
+TEST_CASE("Interleaved glb accessors copy out with their stride") {
+  test_glb source;
+  glb_file glb{source.path};
+  auto normalAccessor = glb.accessor(3);
+  REQUIRE_FALSE(normalAccessor.tightly_packed());
+  REQUIRE_THROWS(normalAccessor.as<vec3>());
+  std::array<vec3, 3> normals{};
+  normalAccessor.copy_to(normals.data());
+  REQUIRE(normals[2].z == 1.f);
+}
+
+TEST_CASE("Files that are not glb are rejected") {
+  {
+    std::ofstream out{"not_a_glb.glb", std::ios::binary};
+    out << "{\"asset\": {\"version\": \"2.0\"}}";
+  }
+  REQUIRE_THROWS([] { glb_file glb{"not_a_glb.glb"}; }());
+  std::remove("not_a_glb.glb");
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include <memory_allocator.hpp>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Windowless instance, device and VMA allocator for tests and benchmarks,
+// e.g. on lavapipe (VK_ICD_FILENAMES=.../lvp_icd.x86_64.json). Uses the
+// first physical device; create() returns null when there is none.
+// presentable additionally enables VK_EXT_headless_surface and
+// VK_KHR_swapchain and creates `surface`, for swapchain tests.
+struct headless_vulkan {
+  VkInstance instance{};
+  VkSurfaceKHR surface{};
+  VkPhysicalDevice physicalDevice{};
+  VkDevice device{};
+  uint32_t graphicsFamily{};
+  VkQueue graphicsQueue{};
+  // a transfer-only family, when the device has one
+  std::optional<uint32_t> transferFamily{};
+  VkQueue transferQueue{};
+  VmaAllocator allocator{};
+
+  static std::unique_ptr<headless_vulkan> create(bool presentable = false) {
+    auto result = std::make_unique<headless_vulkan>();
+    std::vector<const char*> instanceExtensions{};
+    std::vector<const char*> deviceExtensions{};
+    if (presentable) {
+      instanceExtensions = {VK_KHR_SURFACE_EXTENSION_NAME,
+                            VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME};
+      deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    }
+    VkApplicationInfo appInfo{VK_STRUCTURE_TYPE_APPLICATION_INFO};
+    appInfo.pApplicationName = "vkaTest1 headless";
+    appInfo.apiVersion = VK_API_VERSION_1_0;
+    VkInstanceCreateInfo instanceInfo{VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
+    instanceInfo.pApplicationInfo = &appInfo;
+    instanceInfo.enabledExtensionCount =
+        static_cast<uint32_t>(instanceExtensions.size());
+    instanceInfo.ppEnabledExtensionNames = instanceExtensions.data();
+    if (vkCreateInstance(&instanceInfo, nullptr, &result->instance) !=
+        VK_SUCCESS) {
+      return {};
+    }
+    uint32_t deviceCount{1};
+    vkEnumeratePhysicalDevices(
+        result->instance, &deviceCount, &result->physicalDevice);
+    if (deviceCount == 0) {
+      return {};
+    }
+    if (presentable) {
+      auto createSurface = reinterpret_cast<PFN_vkCreateHeadlessSurfaceEXT>(
+          vkGetInstanceProcAddr(
+              result->instance, "vkCreateHeadlessSurfaceEXT"));
+      VkHeadlessSurfaceCreateInfoEXT surfaceInfo{
+          VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT};
+      if (!createSurface ||
+          createSurface(
+              result->instance, &surfaceInfo, nullptr, &result->surface) !=
+              VK_SUCCESS) {
+        return {};
+      }
+    }
+
+    uint32_t familyCount{};
+    vkGetPhysicalDeviceQueueFamilyProperties(
+        result->physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(
+        result->physicalDevice, &familyCount, families.data());
+    std::optional<uint32_t> graphicsFamily{};
+    for (uint32_t i{}; i < familyCount; ++i) {
+      auto flags = families[i].queueFlags;
+      VkBool32 canPresent{true};
+      if (presentable) {
+        vkGetPhysicalDeviceSurfaceSupportKHR(
+            result->physicalDevice, i, result->surface, &canPresent);
+      }
+      if (!graphicsFamily && (flags & VK_QUEUE_GRAPHICS_BIT) && canPresent) {
+        graphicsFamily = i;
+      }
+      if (!result->transferFamily && (flags & VK_QUEUE_TRANSFER_BIT) &&
+          !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+        result->transferFamily = i;
+      }
+    }
+    if (!graphicsFamily) {
+      return {};
+    }
+    result->graphicsFamily = *graphicsFamily;
+
+    float priority{1.f};
+    std::vector<VkDeviceQueueCreateInfo> queueInfos{};
+    for (auto family : {graphicsFamily, result->transferFamily}) {
+      if (family) {
+        VkDeviceQueueCreateInfo queueInfo{
+            VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
+        queueInfo.queueFamilyIndex = *family;
+        queueInfo.queueCount = 1;
+        queueInfo.pQueuePriorities = &priority;
+        queueInfos.push_back(queueInfo);
+      }
+    }
+    VkDeviceCreateInfo deviceInfo{VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
+    deviceInfo.queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size());
+    deviceInfo.pQueueCreateInfos = queueInfos.data();
+    deviceInfo.enabledExtensionCount =
+        static_cast<uint32_t>(deviceExtensions.size());
+    deviceInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    if (vkCreateDevice(
+            result->physicalDevice, &deviceInfo, nullptr, &result->device) !=
+        VK_SUCCESS) {
+      return {};
+    }
+    vkGetDeviceQueue(
+        result->device, result->graphicsFamily, 0, &result->graphicsQueue);
+    if (result->transferFamily) {
+      vkGetDeviceQueue(
+          result->device, *result->transferFamily, 0, &result->transferQueue);
+    }
+
+    VmaAllocatorCreateInfo allocatorInfo{};
+    allocatorInfo.physicalDevice = result->physicalDevice;
+    allocatorInfo.device = result->device;
+    if (vmaCreateAllocator(&allocatorInfo, &result->allocator) != VK_SUCCESS) {
+      return {};
+    }
+    return result;
+  }
+
+  headless_vulkan() = default;
+  headless_vulkan(const headless_vulkan&) = delete;
+  headless_vulkan& operator=(const headless_vulkan&) = delete;
+
+  ~headless_vulkan() {
+    if (allocator) {
+      vmaDestroyAllocator(allocator);
+    }
+    if (device) {
+      vkDestroyDevice(device, nullptr);
+    }
+    if (surface) {
+      vkDestroySurfaceKHR(instance, surface, nullptr);
+    }
+    if (instance) {
+      vkDestroyInstance(instance, nullptr);
+    }
+  }
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include "array_view.hpp"
+#include "packed_mesh.hpp"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+// The matrices bound to the Camera uniform block in 3d.vert.
+struct camera_matrices {
+  glm::mat4 view;
+  glm::mat4 projection;
+};
+
+// Projects an object-space error to pixels at the point of the bounding
+// sphere nearest the camera. projection must be a glm-style perspective or
+// orthographic matrix; viewportHeight is in pixels.
+inline float projected_lod_error(
+    float error,
+    const std::array<float, 3>& center,
+    float radius,
+    const glm::mat4& model,
+    const camera_matrices& camera,
+    float viewportHeight) {
+  // the largest axis scale keeps the estimate conservative under
+  // non-uniform scaling
+  float scale = std::max(
+      {glm::length(glm::vec3(model[0])),
+       glm::length(glm::vec3(model[1])),
+       glm::length(glm::vec3(model[2]))});
+  // Vulkan projections often negate [1][1] to flip Y
+  float pixelsPerUnit =
+      std::abs(camera.projection[1][1]) * viewportHeight * 0.5f;
+  // orthographic projections have no perspective divide
+  if (camera.projection[2][3] == 0.f) {
+    return error * scale * pixelsPerUnit;
+  }
+  auto viewCenter =
+      camera.view * model * glm::vec4(center[0], center[1], center[2], 1.f);
+  float distance = std::max(-viewCenter.z - radius * scale, 1e-3f);
+  return error * scale * pixelsPerUnit / distance;
+}
+
+// Picks the coarsest LOD whose projected error stays within maxPixelError.
+// lods must be ordered finest first, as generate_lod_chain produces them.
+inline size_t select_lod(
+    array_view<mesh_lod> lods,
+    const std::array<float, 3>& boundsMin,
+    const std::array<float, 3>& boundsMax,
+    const glm::mat4& model,
+    const camera_matrices& camera,
+    float viewportHeight,
+    float maxPixelError = 1.f) {
+  std::array<float, 3> center{};
+  float radiusSquared{};
+  for (int axis{}; axis < 3; ++axis) {
+    center[axis] = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+    float half = (boundsMax[axis] - boundsMin[axis]) * 0.5f;
+    radiusSquared += half * half;
+  }
+  float radius = std::sqrt(radiusSquared);
+
+  size_t selected{};
+  for (size_t i{}; i < lods.size(); ++i) {
+    if (projected_lod_error(
+            lods[i].error, center, radius, model, camera, viewportHeight) >
+        maxPixelError) {
+      break;
+    }
+    selected = i;
+  }
+  return selected;
+}
+
+inline size_t select_lod(
+    const packed_mesh_view& mesh,
+    const glm::mat4& model,
+    const camera_matrices& camera,
+    float viewportHeight,
+    float maxPixelError = 1.f) {
+  return select_lod(
+      mesh.lods,
+      mesh.boundsMin,
+      mesh.boundsMax,
+      model,
+      camera,
+      viewportHeight,
+      maxPixelError);
+}
@@ -11,9 +11,6 @@
 #include <buffer.hpp>
 #include <image.hpp>
 #include <image_view.hpp>
-#include <descriptor_set_layout.hpp>
-#include <descriptor_pool.hpp>
-#include <descriptor_set.hpp>
 #include <swapchain.hpp>
 #include <framebuffer.hpp>
 #include <fence.hpp>
@@ -22,17 +19,27 @@
 #include <command_pool.hpp>
 #include <command_buffer.hpp>
 #include <render_pass.hpp>
-#include <pipeline_layout.hpp>
-#include <pipeline.hpp>
 #include <memory>
 #include <array>
 #include <vector>
 #include <move_into.hpp>
 #include <logger.hpp>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <string>
 #include <tiny_gltf.h>
 #include <memory_allocator.hpp>
+#include <fstream>
+#include "mesh_cooker.hpp"
+#include "terrain_buffers.hpp"
+#include "bvh.hpp"
+#include "flush_batch.hpp"
+#include "frame_ring_buffer.hpp"
+#include "frame_scheduler.hpp"
+#include "scene_store.hpp"
+#include "pipeline_registry.hpp"
+#include "shader_layout.hpp"
+#include "3d.layout.hpp"
 
 using namespace vka;
 int main() {
@@ -105,129 +112,15 @@ int main() {
         exit(error);
       });
 
-  std::unique_ptr<descriptor_set_layout> set0LayoutPtr{};
-  descriptor_set_layout_builder{}
-      .storage_buffer(0, 1, VK_SHADER_STAGE_FRAGMENT_BIT)
-      .build(*devicePtr)
-      .map(move_into{set0LayoutPtr})
-      .map_error([](auto error) {
-        multi_logger::get()->critical("Error creating set layout 0!");
-        exit(error);
-      });
-
-  std::unique_ptr<descriptor_set_layout> set1LayoutPtr{};
-  descriptor_set_layout_builder{}
-      .storage_buffer(1, 1, VK_SHADER_STAGE_FRAGMENT_BIT)
-      .build(*devicePtr)
-      .map(move_into{set1LayoutPtr})
-      .map_error([](auto error) {
-        multi_logger::get()->critical("Error creating set layout 1!");
-        exit(error);
-      });
-
-  std::unique_ptr<descriptor_set_layout> set2LayoutPtr{};
-  descriptor_set_layout_builder{}
-      .uniform_buffer(2, 1, VK_SHADER_STAGE_FRAGMENT_BIT)
-      .build(*devicePtr)
-      .map(move_into{set2LayoutPtr})
-      .map_error([](auto error) {
-        multi_logger::get()->critical("Error creating set layout 2!");
-        exit(error);
-      });
-
-  std::unique_ptr<descriptor_set_layout> set3LayoutPtr{};
-  descriptor_set_layout_builder{}
-      .uniform_buffer(3, 1, VK_SHADER_STAGE_VERTEX_BIT)
-      .build(*devicePtr)
-      .map(move_into{set3LayoutPtr})
-      .map_error([](auto error) {
-        multi_logger::get()->critical("Error creating set layout 3!");
-        exit(error);
-      });
-
-  std::unique_ptr<descriptor_set_layout> set4LayoutPtr{};
-  descriptor_set_layout_builder{}
-      .uniform_buffer_dynamic(4, 1, VK_SHADER_STAGE_VERTEX_BIT)
-      .build(*devicePtr)
-      .map(move_into{set4LayoutPtr})
-      .map_error([](auto error) {
-        multi_logger::get()->critical("Error creating set layout 4!");
-        exit(error);
-      });
-
-  std::unique_ptr<descriptor_pool> descriptorPoolPtr{};
-  descriptor_pool_builder{}
-      .add_layout(set0LayoutPtr.get(), 3)
-      .add_layout(set1LayoutPtr.get(), 3)
-      .add_layout(set2LayoutPtr.get(), 3)
-      .add_layout(set3LayoutPtr.get(), 3)
-      .add_layout(set4LayoutPtr.get(), 3)
-      .build(*devicePtr)
-      .map(move_into{descriptorPoolPtr})
-      .map_error([](auto error) {
-        multi_logger::get()->critical("Error creating descriptor pool!");
-        exit(error);
-      });
-
-  std::array<std::unique_ptr<descriptor_set>, 3> set0Array;
-  descriptor_set_allocator set0Allocator{};
-  set0Allocator.set_layout(set0LayoutPtr.get());
-  for (auto& set : set0Array) {
-    set0Allocator.allocate(*devicePtr, *descriptorPoolPtr)
-        .map(move_into{set})
-        .map_error([](auto error) {
-          multi_logger::get()->critical("Error allocating descriptor set 0!");
-          exit(error);
-        });
-  }
-  std::array<std::unique_ptr<descriptor_set>, 3> set1Array;
-  descriptor_set_allocator set1Allocator{};
-  set1Allocator.set_layout(set1LayoutPtr.get());
-  for (auto& set : set1Array) {
-    set1Allocator.allocate(*devicePtr, *descriptorPoolPtr)
-        .map(move_into{set})
-        .map_error([](auto error) {
-          multi_logger::get()->critical("Error allocating descriptor set 1!");
-          exit(error);
-        });
-  }
-  std::array<std::unique_ptr<descriptor_set>, 3> set2Array;
-  descriptor_set_allocator set2Allocator{};
-  set2Allocator.set_layout(set2LayoutPtr.get());
-  for (auto& set : set2Array) {
-    set2Allocator.allocate(*devicePtr, *descriptorPoolPtr)
-        .map(move_into{set})
-        .map_error([](auto error) {
-          multi_logger::get()->critical("Error allocating descriptor set 2!");
-          exit(error);
-        });
-  }
-  std::array<std::unique_ptr<descriptor_set>, 3> set3Array;
-  descriptor_set_allocator set3Allocator{};
-  set3Allocator.set_layout(set3LayoutPtr.get());
-  for (auto& set : set3Array) {
-    set3Allocator.allocate(*devicePtr, *descriptorPoolPtr)
-        .map(move_into{set})
-        .map_error([](auto error) {
-          multi_logger::get()->critical("Error allocating descriptor set 3!");
-          exit(error);
-        });
-  }
-  std::array<std::unique_ptr<descriptor_set>, 3> set4Array;
-  descriptor_set_allocator set4Allocator{};
-  set4Allocator.set_layout(set4LayoutPtr.get());
-  for (auto& set : set4Array) {
-    set4Allocator.allocate(*devicePtr, *descriptorPoolPtr)
-        .map(move_into{set})
-        .map_error([](auto error) {
-          multi_logger::get()->critical("Error allocating descriptor set 4!");
-          exit(error);
-        });
-  }
+  // Set layouts, pipeline layout and one copy of every set per swap image,
+  // all from 3d.layout.hpp, which the build reflects out of the shaders.
+  // Set 0 is per frame; set 1 holds the per-draw Instance uniform behind a
+  // dynamic offset, so each draw rebinds one set.
+  descriptor_layouts layouts3D{*devicePtr, layout_3d::layout, 3};
 
   std::unique_ptr<shader_module> shaderVertex3D{};
   shader_module_builder{}
-      .build(*devicePtr, "../3d.vert.spv")
+      .build(*devicePtr, "3d.vert.spv")
       .map(move_into{shaderVertex3D})
       .map_error([](auto error) {
         multi_logger::get()->critical("Error creating 3D vertex shader!");
@@ -236,28 +129,13 @@ int main() {
 
   std::unique_ptr<shader_module> shaderFragment3D{};
   shader_module_builder{}
-      .build(*devicePtr, "../3d.frag.spv")
+      .build(*devicePtr, "3d.frag.spv")
       .map(move_into{shaderFragment3D})
       .map_error([](auto error) {
         multi_logger::get()->critical("Error creating 3D fragment shader!");
         exit(1);
       });
 
-  std::unique_ptr<pipeline_layout> pipelineLayoutPtr{};
-  pipeline_layout_builder{}
-      .set_layout(*set0LayoutPtr)
-      .set_layout(*set1LayoutPtr)
-      .set_layout(*set2LayoutPtr)
-      .set_layout(*set3LayoutPtr)
-      .set_layout(*set4LayoutPtr)
-      .push_range(VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t))
-      .build(*devicePtr)
-      .map(move_into{pipelineLayoutPtr})
-      .map_error([](auto error) {
-        multi_logger::get()->critical("Error creating pipeline layout!");
-        exit(error);
-      });
-
   auto subpass3D =
       subpass_builder{}
           .color_attachment(0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
@@ -290,37 +168,26 @@ int main() {
         exit(error);
       });
 
-  std::unique_ptr<pipeline> pipeline3DPtr{};
-  graphics_pipeline_builder{}
-      .pipeline_layout(*pipelineLayoutPtr)
-      .render_pass(*renderPassPtr, 0)
-      .color_attachment(no_blend_attachment{})
-      .depth_test()
-      .depth_write()
-      .shader_stage(shader_stage_builder{}
-                        .vertex()
-                        .shader_module(*shaderVertex3D, "main")
-                        .build())
-      .shader_stage(shader_stage_builder{}
-                        .fragment()
-                        .shader_module(*shaderFragment3D, "main")
-                        .build())
-      .vertex_binding<glm::vec3>(0, VK_VERTEX_INPUT_RATE_VERTEX)
-      .vertex_binding<glm::vec3>(1, VK_VERTEX_INPUT_RATE_VERTEX)
-      .vertex_attribute(0, 0, 3, 0)
-      .vertex_attribute(1, 1, 3, sizeof(glm::vec3))
-      .viewport_scissor({}, {})
-      .polygon_mode(VK_POLYGON_MODE_FILL)
-      .cull_mode(VK_CULL_MODE_BACK_BIT)
-      .primitive_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
-      .dynamic_state(VK_DYNAMIC_STATE_VIEWPORT)
-      .dynamic_state(VK_DYNAMIC_STATE_SCISSOR)
-      .build(*devicePtr)
-      .map(move_into{pipeline3DPtr})
-      .map_error([](auto error) {
-        multi_logger::get()->critical("Error creating 3D pipeline!");
-        exit(error);
-      });
+  // Compiles on the registry's threads while the terrain below is cooked and
+  // loaded; the cache file makes every run after the first a warm start.
+  pipeline_cache pipelineCache{
+      physicalDevice, *devicePtr, "vkaEngine.pipeline_cache"};
+  pipeline_registry pipelines{*devicePtr, pipelineCache};
+  pipeline_description pipeline3D{};
+  pipeline3D.name = "3d";
+  pipeline3D.stages = {{VK_SHADER_STAGE_VERTEX_BIT, *shaderVertex3D},
+                       {VK_SHADER_STAGE_FRAGMENT_BIT, *shaderFragment3D}};
+  pipeline3D.bindings.assign(
+      layout_3d::layout.vertexBindings.begin(),
+      layout_3d::layout.vertexBindings.end());
+  pipeline3D.attributes.assign(
+      layout_3d::layout.vertexAttributes.begin(),
+      layout_3d::layout.vertexAttributes.end());
+  pipeline3D.depthTest = true;
+  pipeline3D.depthWrite = true;
+  pipeline3D.layout = layouts3D.pipeline_layout();
+  pipeline3D.renderPass = *renderPassPtr;
+  auto pipeline3DFuture = pipelines.request(pipeline3D);
 
   auto loadModelFromFile = [](auto filePath) -> tinygltf::Model {
     tinygltf::TinyGLTF loader{};
@@ -340,7 +207,27 @@ int main() {
       exit(1);
     }
   };
-  tinygltf::Model terrainModel{loadModelFromFile("models/terrain.gltf")};
+  // Terrain streams from cooked chunks; the glTF is only parsed to cook them
+  // on the first run (vkaCooker models/terrain.gltf models/terrain.vkmesh 64).
+  const std::string terrainTilesPath{"models/terrain.vkmesh"};
+  if (!std::ifstream{terrainTilesPath}) {
+    auto terrainModel = loadModelFromFile("models/terrain.gltf");
+    write_packed_meshes(
+        terrainTilesPath,
+        cook_meshes(extract_gltf_meshes(terrainModel), 64.f));
+  }
+  packed_mesh_file terrainTiles{terrainTilesPath};
+
+  try {
+    pipeline3DFuture.get();
+  } catch (const std::exception& error) {
+    multi_logger::get()->critical("{}", error.what());
+    exit(1);
+  }
+  multi_logger::get()->info(
+      "Pipelines built in {:.2f} ms from a {} cache",
+      pipelineCache.total_build_ms(),
+      pipelineCache.warm() ? "warm" : "cold");
 
   std::unique_ptr<allocator> allocatorPtr{};
   allocator_builder{}
@@ -358,7 +245,6 @@ int main() {
   std::unique_ptr<buffer> dynamicLightsBuffer{};
   std::unique_ptr<buffer> lightDataBuffer{};
   std::unique_ptr<buffer> cameraBuffer{};
-  std::unique_ptr<buffer> instanceBuffer{};
 
   auto hostStorageBuilder =
       buffer_builder{}.cpu_to_gpu().storage_buffer().queue_family_index(
@@ -393,7 +279,98 @@ int main() {
         exit(error);
       });
 
+  VkQueue queue{};
+  vkGetDeviceQueue(*devicePtr, queueFamily.familyIndex, 0, &queue);
+  upload_manager uploads{
+      *devicePtr, *allocatorPtr, queue, queueFamily.familyIndex};
+  vma_terrain_sink terrainSink{uploads};
+  terrain_streamer terrainStreamer{terrainTiles, terrainSink};
+  std::array<float, 3> cameraPosition{};
+
+  instance_bounds terrainBounds{};
+  for (auto& chunk : terrain_streamer::chunk_infos(terrainTiles)) {
+    terrainBounds.add_box(chunk.boundsMin, chunk.boundsMax);
+  }
+  bvh terrainBvh{terrainBounds};
+
+  // One scene node per terrain chunk; its world matrix is the Instance
+  // block of set 1, binding 0, copied into the frame ring for each draw.
+  scene_store scene{};
+  for (size_t chunk{}; chunk < terrainBounds.size(); ++chunk) {
+    scene.add_node();
+  }
+  scene.update();
+  worker_pool workers{};
+
+  // Frame slots are paced by the scheduler's fences. Matrices the GPU reads
+  // while later frames are recorded can't be overwritten in place, so each
+  // frame copies its draws' matrices into a ring region that is reclaimed
+  // once the frame's fence signals.
+  constexpr size_t framesInFlight = 2;
+  frame_scheduler scheduler{*devicePtr, framesInFlight};
+  vulkan_frame_fences frameFences{*devicePtr, scheduler.fences()};
+  VkPhysicalDeviceProperties physicalDeviceProperties{};
+  vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+  // the ring aligns allocations for uniform and storage use alike
+  auto instanceStride = scene_store::uniform_stride(std::max(
+      physicalDeviceProperties.limits.minUniformBufferOffsetAlignment,
+      physicalDeviceProperties.limits.minStorageBufferOffsetAlignment));
+  // every chunk drawn in each frame in flight and the one being recorded
+  frame_ring_buffer frameRing{
+      *allocatorPtr,
+      physicalDevice,
+      queueFamily.familyIndex,
+      std::max<size_t>(scene.size(), 1) * instanceStride *
+          (framesInFlight + 1),
+      frameFences};
+  // The ring need not be HOST_COHERENT, so CPU writes to it are recorded
+  // here and flushed before the submit that reads them.
+  flush_batch hostWrites{*devicePtr, *allocatorPtr, physicalDevice};
+
+  // The draw list is built from chunks that are in view and whose uploads
+  // have landed; drawOffsets holds each draw's dynamic offset for set 1.
+  std::vector<uint32_t> visibleChunks{};
+  std::vector<uint32_t> drawList{};
+  std::vector<uint32_t> drawOffsets{};
+  auto projection =
+      glm::perspective(glm::radians(60.f), 900.f / 900.f, 0.1f, 1000.f);
+
   platform::window_should_close shouldClose{};
   while (!(shouldClose = platform::glfw::poll_os(*surfacePtr))) {
+    auto frame = scheduler.begin_frame();
+    frameRing.ring().begin_frame(frame);
+    terrainStreamer.update(cameraPosition);
+    uploads.submit();
+    scene.update({}, &workers);
+
+    glm::vec3 eye{cameraPosition[0], cameraPosition[1], cameraPosition[2]};
+    auto view = glm::lookAt(
+        eye, eye + glm::vec3{0.f, 0.f, -1.f}, glm::vec3{0.f, 1.f, 0.f});
+    visibleChunks.clear();
+    terrainBvh.query(extract_frustum(projection * view), visibleChunks);
+    drawList.clear();
+    drawOffsets.clear();
+    for (auto chunk : visibleChunks) {
+      if (terrainSink.ready(chunk)) {
+        auto instance = frameRing.ring().push(scene.world(chunk));
+        hostWrites.write(frameRing.buffer(), instance.offset, instance.size);
+        drawList.push_back(chunk);
+        drawOffsets.push_back(instance.offset);
+      }
+    }
+    if (hostWrites.flush() != VK_SUCCESS) {
+      multi_logger::get()->critical("Error flushing frame data!");
+      exit(1);
+    }
+    // Nothing is recorded for the draw list yet; the submit still carries
+    // the frame's fence, so its ring region is reclaimed only once the
+    // queue has moved past it.
+    scheduler.submit(queue, {});
+  }
+  scheduler.wait_idle();
+  try {
+    pipelineCache.save();
+  } catch (const std::exception& error) {
+    multi_logger::get()->warn("{}", error.what());
   }
 }
\ No newline at end of file
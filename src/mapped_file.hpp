@@ -0,0 +1,109 @@
+#pragma once
+#include "array_view.hpp"
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file. Pages are served straight from
+// the OS page cache, so reading through bytes() costs no copy.
+struct mapped_file {
+  mapped_file(const std::string& path) {
+#ifdef _WIN32
+    m_file = CreateFileA(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+      throw std::runtime_error{"Unable to open " + path};
+    }
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(m_file, &fileSize)) {
+      close();
+      throw std::runtime_error{"Unable to read the size of " + path};
+    }
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+    if (m_size > 0) {
+      m_mapping =
+          CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (!m_mapping) {
+        close();
+        throw std::runtime_error{"Unable to map " + path};
+      }
+      m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+#else
+    m_file = open(path.c_str(), O_RDONLY);
+    if (m_file < 0) {
+      throw std::runtime_error{"Unable to open " + path};
+    }
+    struct stat fileStat {};
+    if (fstat(m_file, &fileStat) != 0) {
+      close();
+      throw std::runtime_error{"Unable to read the size of " + path};
+    }
+    m_size = static_cast<size_t>(fileStat.st_size);
+    if (m_size > 0) {
+      m_data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+      if (m_data == MAP_FAILED) {
+        m_data = nullptr;
+      }
+    }
+#endif
+    if (m_size > 0 && !m_data) {
+      close();
+      throw std::runtime_error{"Unable to map " + path};
+    }
+  }
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  ~mapped_file() { close(); }
+
+  array_view<std::byte> bytes() const {
+    return {static_cast<const std::byte*>(m_data), m_size};
+  }
+
+  size_t size() const { return m_size; }
+
+private:
+  void* m_data{};
+  size_t m_size{};
+#ifdef _WIN32
+  HANDLE m_file{INVALID_HANDLE_VALUE};
+  HANDLE m_mapping{};
+
+  void close() {
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+    m_data = nullptr;
+    m_mapping = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+  }
+#else
+  int m_file{-1};
+
+  void close() {
+    if (m_data) munmap(m_data, m_size);
+    if (m_file >= 0) ::close(m_file);
+    m_data = nullptr;
+    m_file = -1;
+  }
+#endif
+};
@@ -0,0 +1,86 @@
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include "mesh_cooker.hpp"
+#include <logger.hpp>
+#include <string>
+
+using namespace vka;
+
+// Usage: vkaCooker <input.gltf|input.glb> <output.vkmesh> [chunkSize]
+// With chunkSize, every mesh is split into terrain chunks of that many world
+// units for streaming.
+int main(int argc, char** argv) {
+  if (argc != 3 && argc != 4) {
+    multi_logger::get()->critical(
+        "Usage: vkaCooker <input.gltf|input.glb> <output.vkmesh> [chunkSize]");
+    return 1;
+  }
+  std::string inputPath{argv[1]};
+  std::string outputPath{argv[2]};
+
+  tinygltf::TinyGLTF loader{};
+  tinygltf::Model model{};
+  std::string err{};
+  std::string warn{};
+  bool binary = inputPath.size() >= 4 &&
+                inputPath.compare(inputPath.size() - 4, 4, ".glb") == 0;
+  auto result =
+      binary ? loader.LoadBinaryFromFile(&model, &err, &warn, inputPath)
+             : loader.LoadASCIIFromFile(&model, &err, &warn, inputPath);
+  if (!warn.empty()) {
+    multi_logger::get()->warn("tinygltf: {}", warn);
+  }
+  if (!err.empty()) {
+    multi_logger::get()->error("tinygltf: {}", err);
+  }
+  if (!result) {
+    return 1;
+  }
+
+  try {
+    float chunkSize = argc == 4 ? std::stof(argv[3]) : 0.f;
+    auto extracted = extract_gltf_meshes(model);
+    size_t sourceVertices{};
+    vertex_cache_stats before{};
+    for (auto& mesh : extracted) {
+      auto stats = simulate_vertex_cache(mesh.indices, mesh.positions.size());
+      before.acmr += stats.acmr / extracted.size();
+      before.atvr += stats.atvr / extracted.size();
+      sourceVertices += mesh.positions.size();
+    }
+    auto meshes = cook_meshes(std::move(extracted), chunkSize);
+    for (auto& mesh : meshes) {
+      auto& finest = mesh.lods.front();
+      std::vector<uint32_t> finestIndices(
+          mesh.indices.begin() + finest.indexOffset,
+          mesh.indices.begin() + finest.indexOffset + finest.indexCount);
+      auto after = simulate_vertex_cache(finestIndices, mesh.positions.size());
+      multi_logger::get()->info(
+          "Mesh: {} vertices, {} LODs, ACMR {:.3f}, ATVR {:.3f}, coarsest "
+          "error {}",
+          mesh.positions.size(),
+          mesh.lods.size(),
+          after.acmr,
+          after.atvr,
+          mesh.lods.back().error);
+    }
+    multi_logger::get()->info(
+        "Source: {} vertices, mean ACMR {:.3f}, mean ATVR {:.3f}",
+        sourceVertices,
+        before.acmr,
+        before.atvr);
+    write_packed_meshes(outputPath, meshes);
+    multi_logger::get()->info(
+        "Cooked {} mesh(es) from {} into {}",
+        meshes.size(),
+        inputPath,
+        outputPath);
+  } catch (const std::exception& error) {
+    multi_logger::get()->critical(
+        "Error cooking {}: {}", inputPath, error.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "packed_mesh.hpp"
+#include "terrain_tiles.hpp"
+#include <tiny_gltf.h>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Reads one accessor of a tinygltf model into packed elements of type T,
+// following the buffer view's stride when the data is interleaved.
+template <typename T>
+std::vector<T> read_gltf_accessor(
+    const tinygltf::Model& model,
+    int accessorIndex) {
+  auto& accessor = model.accessors.at(accessorIndex);
+  auto& view = model.bufferViews.at(accessor.bufferView);
+  auto& buffer = model.buffers.at(view.buffer);
+  size_t stride = view.byteStride != 0 ? view.byteStride : sizeof(T);
+  auto base = buffer.data.data() + view.byteOffset + accessor.byteOffset;
+  if (accessor.count > 0 &&
+      view.byteOffset + accessor.byteOffset + stride * (accessor.count - 1) +
+              sizeof(T) >
+          buffer.data.size()) {
+    throw std::runtime_error{"glTF accessor runs past its buffer"};
+  }
+  std::vector<T> result(accessor.count);
+  for (size_t i{}; i < accessor.count; ++i) {
+    std::memcpy(&result[i], base + i * stride, sizeof(T));
+  }
+  return result;
+}
+
+inline std::vector<uint32_t> read_gltf_indices(
+    const tinygltf::Model& model,
+    int accessorIndex) {
+  switch (model.accessors.at(accessorIndex).componentType) {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+      auto indices = read_gltf_accessor<uint8_t>(model, accessorIndex);
+      return {indices.begin(), indices.end()};
+    }
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+      auto indices = read_gltf_accessor<uint16_t>(model, accessorIndex);
+      return {indices.begin(), indices.end()};
+    }
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+      return read_gltf_accessor<uint32_t>(model, accessorIndex);
+    default:
+      throw std::runtime_error{"Unsupported glTF index component type"};
+  }
+}
+
+// Converts every triangle-list primitive of a glTF model into a source_mesh
+// with de-interleaved position and normal streams, one per primitive.
+inline std::vector<source_mesh> extract_gltf_meshes(
+    const tinygltf::Model& model) {
+  std::vector<source_mesh> meshes;
+  for (auto& mesh : model.meshes) {
+    for (auto& primitive : mesh.primitives) {
+      if (primitive.mode != TINYGLTF_MODE_TRIANGLES) {
+        continue;
+      }
+      auto position = primitive.attributes.find("POSITION");
+      auto normal = primitive.attributes.find("NORMAL");
+      if (position == primitive.attributes.end() ||
+          normal == primitive.attributes.end()) {
+        throw std::runtime_error{
+            "Mesh " + mesh.name + " is missing POSITION or NORMAL"};
+      }
+      for (auto attribute : {position->second, normal->second}) {
+        auto& accessor = model.accessors.at(attribute);
+        if (accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT ||
+            accessor.type != TINYGLTF_TYPE_VEC3) {
+          throw std::runtime_error{
+              "Mesh " + mesh.name + " attributes must be float VEC3"};
+        }
+      }
+
+      source_mesh cooked{};
+      cooked.positions =
+          read_gltf_accessor<std::array<float, 3>>(model, position->second);
+      cooked.normals =
+          read_gltf_accessor<std::array<float, 3>>(model, normal->second);
+      if (primitive.indices >= 0) {
+        cooked.indices = read_gltf_indices(model, primitive.indices);
+      } else {
+        cooked.indices.resize(cooked.positions.size());
+        for (uint32_t i{}; i < cooked.indices.size(); ++i) {
+          cooked.indices[i] = i;
+        }
+      }
+      meshes.push_back(std::move(cooked));
+    }
+  }
+  return meshes;
+}
+
+// Prepares extracted meshes for the runtime: optionally splits them into
+// terrain chunks (chunkSize > 0), then welds, builds the LOD chain and
+// reorders each mesh for the vertex cache and vertex fetch.
+inline std::vector<source_mesh> cook_meshes(
+    std::vector<source_mesh> meshes,
+    float chunkSize = 0.f) {
+  if (chunkSize > 0.f) {
+    std::vector<source_mesh> chunks;
+    for (auto& mesh : meshes) {
+      auto split = split_terrain(mesh, chunkSize);
+      std::move(split.begin(), split.end(), std::back_inserter(chunks));
+    }
+    meshes = std::move(chunks);
+  }
+  for (auto& mesh : meshes) {
+    weld_vertices(mesh);
+    generate_lod_chain(mesh);
+    optimize_mesh(mesh);
+  }
+  return meshes;
+}
@@ -0,0 +1,172 @@
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include "mesh_cooker.hpp"
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+// A tinygltf model holding an n x n vertex grid as a single primitive. The
+// position and normal streams are interleaved to exercise de-interleaving.
+tinygltf::Model make_grid_model(uint32_t n) {
+  tinygltf::Model model{};
+  tinygltf::Buffer buffer{};
+  size_t vertexCount = size_t{n} * n;
+  for (uint32_t z{}; z < n; ++z) {
+    for (uint32_t x{}; x < n; ++x) {
+      float vertex[6]{float(x), float((x + z) % 3), float(z), 0.f, 1.f, 0.f};
+      auto bytes = reinterpret_cast<unsigned char*>(vertex);
+      buffer.data.insert(buffer.data.end(), bytes, bytes + sizeof(vertex));
+    }
+  }
+  size_t indexOffset = buffer.data.size();
+  size_t indexCount{};
+  for (uint32_t z{}; z + 1 < n; ++z) {
+    for (uint32_t x{}; x + 1 < n; ++x) {
+      uint32_t i = z * n + x;
+      uint32_t quad[6]{i, i + n, i + 1, i + 1, i + n, i + n + 1};
+      auto bytes = reinterpret_cast<unsigned char*>(quad);
+      buffer.data.insert(buffer.data.end(), bytes, bytes + sizeof(quad));
+      indexCount += 6;
+    }
+  }
+  model.buffers.push_back(buffer);
+
+  tinygltf::BufferView vertexView{};
+  vertexView.buffer = 0;
+  vertexView.byteLength = indexOffset;
+  vertexView.byteStride = sizeof(float) * 6;
+  tinygltf::BufferView indexView{};
+  indexView.buffer = 0;
+  indexView.byteOffset = indexOffset;
+  indexView.byteLength = indexCount * sizeof(uint32_t);
+  model.bufferViews = {vertexView, indexView};
+
+  tinygltf::Accessor positions{};
+  positions.bufferView = 0;
+  positions.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
+  positions.type = TINYGLTF_TYPE_VEC3;
+  positions.count = vertexCount;
+  tinygltf::Accessor normals = positions;
+  normals.byteOffset = sizeof(float) * 3;
+  tinygltf::Accessor indices{};
+  indices.bufferView = 1;
+  indices.componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT;
+  indices.type = TINYGLTF_TYPE_SCALAR;
+  indices.count = indexCount;
+  model.accessors = {positions, normals, indices};
+
+  tinygltf::Primitive primitive{};
+  primitive.attributes["POSITION"] = 0;
+  primitive.attributes["NORMAL"] = 1;
+  primitive.indices = 2;
+  primitive.mode = TINYGLTF_MODE_TRIANGLES;
+  tinygltf::Mesh mesh{};
+  mesh.primitives.push_back(primitive);
+  model.meshes.push_back(mesh);
+  return model;
+}
+
+template <typename T>
+std::vector<T> to_vector(array_view<std::byte> bytes) {
+  std::vector<T> result(bytes.size() / sizeof(T));
+  std::memcpy(result.data(), bytes.data(), bytes.size());
+  return result;
+}
+}  // namespace
+
+TEST_CASE("Extracting a glTF mesh de-interleaves positions and normals") {
+  auto model = make_grid_model(4);
+  auto meshes = extract_gltf_meshes(model);
+  REQUIRE(meshes.size() == 1);
+  REQUIRE(meshes[0].positions.size() == 16);
+  REQUIRE(meshes[0].positions[5] == std::array<float, 3>{1.f, 2.f, 1.f});
+  REQUIRE(meshes[0].normals[5] == std::array<float, 3>{0.f, 1.f, 0.f});
+  REQUIRE(meshes[0].indices.size() == 9 * 6);
+}
+
+TEST_CASE("Cooked meshes round-trip through a packed mesh file") {
+  auto model = make_grid_model(GENERATE(4u, 300u));
+  auto source = extract_gltf_meshes(model);
+  std::string path = "mesh_cooker_test.vkmesh";
+  write_packed_meshes(path, source);
+
+  {
+    packed_mesh_file cooked{path};
+    REQUIRE(cooked.mesh_count() == 1);
+    auto mesh = cooked.mesh(0);
+    REQUIRE(mesh.vertexCount == source[0].positions.size());
+    REQUIRE(mesh.indexCount == source[0].indices.size());
+    REQUIRE(
+        reinterpret_cast<uintptr_t>(mesh.positions.data()) %
+            packed_mesh_stream_alignment ==
+        0);
+    REQUIRE(
+        to_vector<std::array<float, 3>>(mesh.positions) ==
+        source[0].positions);
+    REQUIRE(
+        to_vector<std::array<float, 3>>(mesh.normals) == source[0].normals);
+
+    std::vector<uint32_t> indices;
+    if (mesh.indexSize == 2) {
+      auto shortIndices = to_vector<uint16_t>(mesh.indices);
+      indices.assign(shortIndices.begin(), shortIndices.end());
+    } else {
+      indices = to_vector<uint32_t>(mesh.indices);
+    }
+    REQUIRE(indices == source[0].indices);
+    REQUIRE(mesh.lods.size() == 1);
+    REQUIRE(mesh.lods[0].indexCount == mesh.indexCount);
+    REQUIRE(mesh.indexSize == (mesh.vertexCount <= 65535 ? 2u : 4u));
+
+    uint32_t n = static_cast<uint32_t>(std::sqrt(mesh.vertexCount));
+    REQUIRE(mesh.boundsMin == std::array<float, 3>{0.f, 0.f, 0.f});
+    REQUIRE(
+        mesh.boundsMax ==
+        std::array<float, 3>{float(n - 1), 2.f, float(n - 1)});
+  }
+  std::remove(path.c_str());
+}
+
+TEST_CASE("LOD ranges round-trip through a packed mesh file") {
+  auto source = extract_gltf_meshes(make_grid_model(4));
+  auto fullCount = static_cast<uint32_t>(source[0].indices.size());
+  source[0].indices.insert(source[0].indices.end(), {0, 4, 5});
+  source[0].lods = {{0, fullCount, 0.f}, {fullCount, 3, 0.5f}};
+  std::string path = "mesh_cooker_lod_test.vkmesh";
+  write_packed_meshes(path, source);
+  {
+    packed_mesh_file cooked{path};
+    auto mesh = cooked.mesh(0);
+    REQUIRE(mesh.lods.size() == 2);
+    REQUIRE(mesh.lods[1].indexOffset == fullCount);
+    REQUIRE(mesh.lods[1].indexCount == 3);
+    REQUIRE(mesh.lods[1].error == 0.5f);
+  }
+  std::remove(path.c_str());
+}
+
+TEST_CASE("A packed mesh file from another version is rejected") {
+  std::string path = "mesh_cooker_version_test.vkmesh";
+  auto blob = cook_packed_meshes({});
+  packed_mesh_header header{};
+  header.version = packed_mesh_version + 1;
+  std::memcpy(blob.data(), &header, sizeof(header));
+  {
+    std::ofstream out{path, std::ios::binary};
+    out.write(reinterpret_cast<const char*>(blob.data()), blob.size());
+  }
+  REQUIRE_THROWS([&] { packed_mesh_file cooked{path}; }());
+  std::remove(path.c_str());
+}
+
+TEST_CASE("Cooking with a chunk size splits meshes and builds LODs") {
+  auto cooked = cook_meshes(extract_gltf_meshes(make_grid_model(33)), 16.f);
+  REQUIRE(cooked.size() == 4);
+  for (auto& mesh : cooked) {
+    REQUIRE(mesh.lods.size() > 1);
+    REQUIRE(mesh.lods[0].indexCount == 16 * 16 * 6);
+  }
+}
@@ -0,0 +1,331 @@
+#pragma once
+#include "packed_mesh.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+// Post-transform vertex cache size assumed by the optimizer and simulator.
+constexpr size_t default_vertex_cache_size = 16;
+
+struct vertex_cache_stats {
+  // average cache miss ratio: transformed vertices per triangle (0.5 is the
+  // ideal for large regular grids, 3 the worst case)
+  float acmr{};
+  // average transform to vertex ratio: transformed vertices per unique
+  // vertex (1 is ideal)
+  float atvr{};
+};
+
+// Simulates a FIFO post-transform cache over an index buffer.
+inline vertex_cache_stats simulate_vertex_cache(
+    const std::vector<uint32_t>& indices,
+    size_t vertexCount,
+    size_t cacheSize = default_vertex_cache_size) {
+  std::deque<uint32_t> cache;
+  size_t misses{};
+  for (auto index : indices) {
+    if (std::find(cache.begin(), cache.end(), index) == cache.end()) {
+      ++misses;
+      cache.push_back(index);
+      if (cache.size() > cacheSize) {
+        cache.pop_front();
+      }
+    }
+  }
+  vertex_cache_stats stats{};
+  if (!indices.empty()) {
+    stats.acmr = float(misses) / float(indices.size() / 3);
+  }
+  if (vertexCount > 0) {
+    stats.atvr = float(misses) / float(vertexCount);
+  }
+  return stats;
+}
+
+// Vertex fetch efficiency: the fraction of vertex data bytes fetched
+// relative to the vertex buffer size, assuming cacheLineSize-byte fetches
+// and a tiny fetch cache holding only the most recent line. 1 is ideal.
+inline float simulate_vertex_fetch(
+    const std::vector<uint32_t>& indices,
+    size_t vertexCount,
+    size_t vertexStride,
+    size_t cacheLineSize = 64) {
+  size_t fetchedLines{};
+  size_t lastLine = ~size_t{};
+  for (auto index : indices) {
+    size_t line = size_t{index} * vertexStride / cacheLineSize;
+    if (line != lastLine) {
+      ++fetchedLines;
+      lastLine = line;
+    }
+  }
+  size_t totalBytes = vertexCount * vertexStride;
+  return totalBytes == 0
+             ? 0.f
+             : float(fetchedLines * cacheLineSize) / float(totalBytes);
+}
+
+// Merges vertices whose position and normal are bitwise identical and
+// rewrites the index buffer to match.
+inline void weld_vertices(source_mesh& mesh) {
+  struct vertex_key {
+    std::array<float, 3> position;
+    std::array<float, 3> normal;
+    bool operator==(const vertex_key& other) const {
+      return std::memcmp(this, &other, sizeof(vertex_key)) == 0;
+    }
+  };
+  struct vertex_hash {
+    size_t operator()(const vertex_key& key) const {
+      uint32_t words[6];
+      std::memcpy(words, &key, sizeof(words));
+      size_t hash = 14695981039346656037ull;
+      for (auto word : words) {
+        hash = (hash ^ word) * 1099511628211ull;
+      }
+      return hash;
+    }
+  };
+
+  std::unordered_map<vertex_key, uint32_t, vertex_hash> unique;
+  unique.reserve(mesh.positions.size());
+  std::vector<uint32_t> remap(mesh.positions.size());
+  source_mesh welded{};
+  for (size_t i{}; i < mesh.positions.size(); ++i) {
+    vertex_key key{mesh.positions[i], mesh.normals[i]};
+    auto inserted = unique.emplace(key, uint32_t(welded.positions.size()));
+    if (inserted.second) {
+      welded.positions.push_back(key.position);
+      welded.normals.push_back(key.normal);
+    }
+    remap[i] = inserted.first->second;
+  }
+  for (auto& index : mesh.indices) {
+    index = remap[index];
+  }
+  mesh.positions = std::move(welded.positions);
+  mesh.normals = std::move(welded.normals);
+}
+
+// Reorders triangles for post-transform cache locality using Tipsify
+// (Sander, Nehab & Barczak 2007). Returns the index of the first triangle of
+// each cluster, where a cluster ends whenever the fan walk hit a dead end;
+// clusters can be reordered freely for overdraw.
+inline std::vector<size_t> optimize_vertex_cache(
+    std::vector<uint32_t>& indices,
+    size_t vertexCount,
+    size_t cacheSize = default_vertex_cache_size) {
+  size_t triangleCount = indices.size() / 3;
+  std::vector<uint32_t> liveTriangles(vertexCount);
+  for (auto index : indices) {
+    ++liveTriangles[index];
+  }
+  // vertex -> triangles adjacency in compressed rows
+  std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+  for (size_t v{}; v < vertexCount; ++v) {
+    adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+  }
+  std::vector<uint32_t> adjacency(indices.size());
+  {
+    auto cursor = adjacencyOffsets;
+    for (size_t i{}; i < indices.size(); ++i) {
+      adjacency[cursor[indices[i]]++] = uint32_t(i / 3);
+    }
+  }
+
+  std::vector<size_t> cacheTime(vertexCount);
+  std::vector<bool> emitted(triangleCount);
+  std::vector<uint32_t> deadEnds;
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> output;
+  std::vector<size_t> clusters;
+  output.reserve(indices.size());
+  size_t timestamp = cacheSize + 1;
+  size_t cursor{};
+
+  auto skip_dead_end = [&]() -> int64_t {
+    while (!deadEnds.empty()) {
+      auto vertex = deadEnds.back();
+      deadEnds.pop_back();
+      if (liveTriangles[vertex] > 0) {
+        return vertex;
+      }
+    }
+    for (; cursor < vertexCount; ++cursor) {
+      if (liveTriangles[cursor] > 0) {
+        return int64_t(cursor);
+      }
+    }
+    return -1;
+  };
+
+  int64_t fanVertex = skip_dead_end();
+  bool newCluster = true;
+  while (fanVertex >= 0) {
+    if (newCluster) {
+      clusters.push_back(output.size() / 3);
+    }
+    candidates.clear();
+    for (auto a = adjacencyOffsets[fanVertex];
+         a < adjacencyOffsets[fanVertex + 1];
+         ++a) {
+      auto triangle = adjacency[a];
+      if (emitted[triangle]) {
+        continue;
+      }
+      for (size_t corner{}; corner < 3; ++corner) {
+        auto vertex = indices[triangle * 3 + corner];
+        output.push_back(vertex);
+        deadEnds.push_back(vertex);
+        candidates.push_back(vertex);
+        --liveTriangles[vertex];
+        if (timestamp - cacheTime[vertex] > cacheSize) {
+          cacheTime[vertex] = timestamp++;
+        }
+      }
+      emitted[triangle] = true;
+    }
+
+    // prefer the candidate that will still be in cache after its
+    // remaining triangles are emitted, oldest first
+    int64_t best = -1;
+    int64_t bestPriority = -1;
+    for (auto vertex : candidates) {
+      if (liveTriangles[vertex] == 0) {
+        continue;
+      }
+      int64_t priority = 0;
+      auto age = int64_t(timestamp - cacheTime[vertex]);
+      if (age + 2 * int64_t(liveTriangles[vertex]) <= int64_t(cacheSize)) {
+        priority = age;
+      }
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        best = vertex;
+      }
+    }
+    newCluster = best < 0;
+    fanVertex = best >= 0 ? best : skip_dead_end();
+  }
+  indices = std::move(output);
+  return clusters;
+}
+
+// Sorts the clusters produced by optimize_vertex_cache so that clusters on
+// the outside of the mesh, facing away from its centre, draw first and
+// occlude the rest (the linear-speed overdraw pass from Tipsify).
+inline void optimize_overdraw(
+    std::vector<uint32_t>& indices,
+    const std::vector<std::array<float, 3>>& positions,
+    const std::vector<size_t>& clusters) {
+  size_t triangleCount = indices.size() / 3;
+  std::array<float, 3> meshCentroid{};
+  for (auto& position : positions) {
+    for (int axis{}; axis < 3; ++axis) {
+      meshCentroid[axis] += position[axis] / float(positions.size());
+    }
+  }
+
+  struct cluster_sort_key {
+    size_t begin;
+    size_t end;
+    float outwardness;
+  };
+  std::vector<cluster_sort_key> keys;
+  for (size_t c{}; c < clusters.size(); ++c) {
+    cluster_sort_key key{};
+    key.begin = clusters[c];
+    key.end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+    std::array<float, 3> centroid{};
+    std::array<float, 3> normal{};
+    float area{};
+    for (size_t t = key.begin; t < key.end; ++t) {
+      auto& a = positions[indices[t * 3]];
+      auto& b = positions[indices[t * 3 + 1]];
+      auto& d = positions[indices[t * 3 + 2]];
+      std::array<float, 3> ab{b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+      std::array<float, 3> ad{d[0] - a[0], d[1] - a[1], d[2] - a[2]};
+      std::array<float, 3> cross{ab[1] * ad[2] - ab[2] * ad[1],
+                                 ab[2] * ad[0] - ab[0] * ad[2],
+                                 ab[0] * ad[1] - ab[1] * ad[0]};
+      float triangleArea =
+          std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] +
+                    cross[2] * cross[2]);
+      for (int axis{}; axis < 3; ++axis) {
+        normal[axis] += cross[axis];
+        centroid[axis] +=
+            (a[axis] + b[axis] + d[axis]) / 3.f * triangleArea;
+      }
+      area += triangleArea;
+    }
+    if (area > 0.f) {
+      for (int axis{}; axis < 3; ++axis) {
+        centroid[axis] /= area;
+        key.outwardness +=
+            (centroid[axis] - meshCentroid[axis]) * normal[axis] / area;
+      }
+    }
+    keys.push_back(key);
+  }
+
+  std::stable_sort(keys.begin(), keys.end(), [](auto& lhs, auto& rhs) {
+    return lhs.outwardness > rhs.outwardness;
+  });
+  std::vector<uint32_t> sorted;
+  sorted.reserve(indices.size());
+  for (auto& key : keys) {
+    sorted.insert(
+        sorted.end(),
+        indices.begin() + key.begin * 3,
+        indices.begin() + key.end * 3);
+  }
+  indices = std::move(sorted);
+}
+
+// Renumbers vertices in order of first use so the vertex streams are read
+// front to back; unreferenced vertices are dropped.
+inline void optimize_vertex_fetch(source_mesh& mesh) {
+  constexpr auto unused = ~uint32_t{};
+  std::vector<uint32_t> remap(mesh.positions.size(), unused);
+  source_mesh reordered{};
+  for (auto& index : mesh.indices) {
+    if (remap[index] == unused) {
+      remap[index] = uint32_t(reordered.positions.size());
+      reordered.positions.push_back(mesh.positions[index]);
+      reordered.normals.push_back(mesh.normals[index]);
+    }
+    index = remap[index];
+  }
+  mesh.positions = std::move(reordered.positions);
+  mesh.normals = std::move(reordered.normals);
+}
+
+// Full pipeline: vertex cache, overdraw, then vertex fetch. Each LOD range
+// is reordered on its own; the vertex fetch order follows the finest LOD,
+// which the coarser ones index a subset of. The mesh should already be
+// welded, before its LOD chain was built; welding here would only repeat
+// that work.
+inline void optimize_mesh(
+    source_mesh& mesh,
+    size_t cacheSize = default_vertex_cache_size) {
+  auto lods = mesh.lods;
+  if (lods.empty()) {
+    lods.push_back({0, static_cast<uint32_t>(mesh.indices.size()), 0.f});
+  }
+  for (auto& lod : lods) {
+    auto first = mesh.indices.begin() + lod.indexOffset;
+    std::vector<uint32_t> range(first, first + lod.indexCount);
+    auto clusters =
+        optimize_vertex_cache(range, mesh.positions.size(), cacheSize);
+    optimize_overdraw(range, mesh.positions, clusters);
+    std::copy(range.begin(), range.end(), first);
+  }
+  optimize_vertex_fetch(mesh);
+}
@@ -0,0 +1,147 @@
+#include "mesh_optimizer.hpp"
+#include <catch2/catch.hpp>
+#include <random>
+#include <set>
+
+namespace {
+// n x n vertex grid with its triangles shuffled, the worst case for the
+// post-transform cache.
+source_mesh make_shuffled_grid(uint32_t n) {
+  source_mesh mesh{};
+  for (uint32_t z{}; z < n; ++z) {
+    for (uint32_t x{}; x < n; ++x) {
+      mesh.positions.push_back({float(x), 0.f, float(z)});
+      mesh.normals.push_back({0.f, 1.f, 0.f});
+    }
+  }
+  std::vector<std::array<uint32_t, 3>> triangles;
+  for (uint32_t z{}; z + 1 < n; ++z) {
+    for (uint32_t x{}; x + 1 < n; ++x) {
+      uint32_t i = z * n + x;
+      triangles.push_back({i, i + n, i + 1});
+      triangles.push_back({i + 1, i + n, i + n + 1});
+    }
+  }
+  std::shuffle(triangles.begin(), triangles.end(), std::mt19937{42});
+  for (auto& triangle : triangles) {
+    mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+  }
+  return mesh;
+}
+
+// Triangles as sets of positions, independent of vertex numbering,
+// triangle order and which corner comes first.
+std::multiset<std::array<std::array<float, 3>, 3>> triangle_set(
+    const source_mesh& mesh) {
+  std::multiset<std::array<std::array<float, 3>, 3>> result;
+  for (size_t t{}; t < mesh.indices.size(); t += 3) {
+    std::array<std::array<float, 3>, 3> triangle{
+        mesh.positions[mesh.indices[t]],
+        mesh.positions[mesh.indices[t + 1]],
+        mesh.positions[mesh.indices[t + 2]]};
+    auto smallest = std::min_element(triangle.begin(), triangle.end());
+    std::rotate(triangle.begin(), smallest, triangle.end());
+    result.insert(triangle);
+  }
+  return result;
+}
+}  // namespace
+
+TEST_CASE("The cache simulator counts FIFO misses") {
+  std::vector<uint32_t> indices{0, 1, 2, 2, 1, 3, 4, 5, 6};
+  auto stats = simulate_vertex_cache(indices, 7, 16);
+  REQUIRE(stats.acmr == Approx(7.f / 3.f));
+  REQUIRE(stats.atvr == Approx(1.f));
+  auto tinyCache = simulate_vertex_cache({0, 1, 2, 0, 1, 2}, 3, 2);
+  REQUIRE(tinyCache.atvr == Approx(2.f));
+}
+
+TEST_CASE("Welding merges identical vertices") {
+  source_mesh mesh{};
+  mesh.positions = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {1, 0, 0}, {0, 1, 0}};
+  mesh.normals = {{0, 0, 1}, {0, 0, 1}, {0, 0, 1}, {0, 0, 1}, {0, 0, 1}};
+  mesh.indices = {0, 1, 2, 3, 4, 0};
+  auto before = triangle_set(mesh);
+  weld_vertices(mesh);
+  REQUIRE(mesh.positions.size() == 3);
+  REQUIRE(mesh.normals.size() == 3);
+  REQUIRE(triangle_set(mesh) == before);
+}
+
+TEST_CASE("Welding keeps vertices with different normals apart") {
+  source_mesh mesh{};
+  mesh.positions = {{0, 0, 0}, {0, 0, 0}};
+  mesh.normals = {{0, 0, 1}, {0, 1, 0}};
+  mesh.indices = {0, 1, 1};
+  weld_vertices(mesh);
+  REQUIRE(mesh.positions.size() == 2);
+}
+
+TEST_CASE("Vertex cache optimization lowers ACMR on a shuffled grid") {
+  auto mesh = make_shuffled_grid(64);
+  auto triangles = triangle_set(mesh);
+  auto before = simulate_vertex_cache(mesh.indices, mesh.positions.size());
+  optimize_vertex_cache(mesh.indices, mesh.positions.size());
+  auto after = simulate_vertex_cache(mesh.indices, mesh.positions.size());
+  REQUIRE(after.acmr < before.acmr * 0.5f);
+  REQUIRE(after.acmr < 1.f);
+  REQUIRE(triangle_set(mesh) == triangles);
+}
+
+TEST_CASE("Vertex fetch optimization numbers vertices by first use") {
+  auto mesh = make_shuffled_grid(16);
+  mesh.positions.push_back({100.f, 0.f, 0.f});
+  mesh.normals.push_back({0.f, 1.f, 0.f});
+  auto triangles = triangle_set(mesh);
+  optimize_vertex_fetch(mesh);
+  REQUIRE(mesh.positions.size() == 16 * 16);
+  uint32_t nextNew{};
+  bool firstUseOrdered = true;
+  for (auto index : mesh.indices) {
+    if (index == nextNew) {
+      ++nextNew;
+    } else if (index > nextNew) {
+      firstUseOrdered = false;
+    }
+  }
+  REQUIRE(firstUseOrdered);
+  REQUIRE(triangle_set(mesh) == triangles);
+}
+
+TEST_CASE("The full pipeline improves cache and fetch locality") {
+  auto mesh = make_shuffled_grid(64);
+  auto triangles = triangle_set(mesh);
+  auto cacheBefore = simulate_vertex_cache(mesh.indices, mesh.positions.size());
+  auto fetchBefore = simulate_vertex_fetch(
+      mesh.indices, mesh.positions.size(), sizeof(float) * 3);
+  optimize_mesh(mesh);
+  auto cacheAfter = simulate_vertex_cache(mesh.indices, mesh.positions.size());
+  auto fetchAfter = simulate_vertex_fetch(
+      mesh.indices, mesh.positions.size(), sizeof(float) * 3);
+  REQUIRE(cacheAfter.acmr < cacheBefore.acmr);
+  REQUIRE(cacheAfter.atvr < cacheBefore.atvr);
+  REQUIRE(fetchAfter < fetchBefore);
+  REQUIRE(triangle_set(mesh) == triangles);
+}
+
+TEST_CASE("Each LOD range is optimized on its own") {
+  auto mesh = make_shuffled_grid(32);
+  auto fullCount = static_cast<uint32_t>(mesh.indices.size());
+  auto coarseCount = fullCount / 6 * 3;
+  source_mesh coarse = mesh;
+  coarse.indices.resize(coarseCount);
+  auto fullTriangles = triangle_set(mesh);
+  auto coarseTriangles = triangle_set(coarse);
+  mesh.indices.insert(
+      mesh.indices.end(), coarse.indices.begin(), coarse.indices.end());
+  mesh.lods = {{0, fullCount, 0.f}, {fullCount, coarseCount, 1.f}};
+
+  optimize_mesh(mesh);
+  source_mesh full = mesh;
+  full.indices.resize(fullCount);
+  coarse = mesh;
+  coarse.indices.erase(
+      coarse.indices.begin(), coarse.indices.begin() + fullCount);
+  REQUIRE(triangle_set(full) == fullTriangles);
+  REQUIRE(triangle_set(coarse) == coarseTriangles);
+}
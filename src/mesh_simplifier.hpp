@@ -0,0 +1,290 @@
+#pragma once
+#include "packed_mesh.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+// Symmetric 4x4 error quadric (Garland & Heckbert 1997). Built from
+// unweighted unit planes, so evaluate() is the sum of squared distances to
+// every plane merged into a vertex and its square root bounds the distance to
+// each of them.
+struct error_quadric {
+  // a2 ab ac ad b2 bc bd c2 cd d2
+  std::array<double, 10> m{};
+
+  static error_quadric from_plane(double a, double b, double c, double d) {
+    return {{a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d,
+             d * d}};
+  }
+
+  error_quadric& operator+=(const error_quadric& other) {
+    for (size_t i{}; i < m.size(); ++i) {
+      m[i] += other.m[i];
+    }
+    return *this;
+  }
+
+  double evaluate(const std::array<float, 3>& p) const {
+    double x = p[0], y = p[1], z = p[2];
+    double error = m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z +
+                   2 * m[3] * x + m[4] * y * y + 2 * m[5] * y * z +
+                   2 * m[6] * y + m[7] * z * z + 2 * m[8] * z + m[9];
+    return std::max(error, 0.0);
+  }
+};
+
+// Simplifies a triangle list by collapsing edges in order of quadric error
+// until at most targetIndexCount indices remain or the next collapse would
+// exceed maxError. Collapses move a vertex onto one of its neighbours, so
+// the result indexes the original vertex stream. Vertices on open edges
+// never move, which keeps the borders of adjacent terrain chunks matching at
+// every LOD. Returns the simplified indices and writes the largest error of
+// any collapse to resultError.
+inline std::vector<uint32_t> simplify_mesh(
+    const std::vector<std::array<float, 3>>& positions,
+    const std::vector<uint32_t>& indices,
+    size_t targetIndexCount,
+    float maxError = std::numeric_limits<float>::max(),
+    float* resultError = nullptr) {
+  using vec3 = std::array<float, 3>;
+  auto sub = [](const vec3& a, const vec3& b) {
+    return vec3{a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+  };
+  auto cross = [](const vec3& a, const vec3& b) {
+    return vec3{a[1] * b[2] - a[2] * b[1],
+                a[2] * b[0] - a[0] * b[2],
+                a[0] * b[1] - a[1] * b[0]};
+  };
+  auto dot = [](const vec3& a, const vec3& b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+  };
+
+  size_t vertexCount = positions.size();
+  size_t triangleCount = indices.size() / 3;
+  std::vector<uint32_t> triangles = indices;
+  std::vector<bool> triangleAlive(triangleCount, true);
+  size_t liveTriangles = triangleCount;
+  std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+  std::vector<error_quadric> quadrics(vertexCount);
+
+  for (uint32_t t{}; t < triangleCount; ++t) {
+    auto& a = positions[triangles[t * 3]];
+    auto& b = positions[triangles[t * 3 + 1]];
+    auto& c = positions[triangles[t * 3 + 2]];
+    auto normal = cross(sub(b, a), sub(c, a));
+    auto length = std::sqrt(dot(normal, normal));
+    for (size_t corner{}; corner < 3; ++corner) {
+      vertexTriangles[triangles[t * 3 + corner]].push_back(t);
+    }
+    if (length == 0.f) {
+      continue;
+    }
+    double nx = normal[0] / length, ny = normal[1] / length,
+           nz = normal[2] / length;
+    auto plane = error_quadric::from_plane(
+        nx, ny, nz, -(nx * a[0] + ny * a[1] + nz * a[2]));
+    for (size_t corner{}; corner < 3; ++corner) {
+      quadrics[triangles[t * 3 + corner]] += plane;
+    }
+  }
+
+  // an edge used by only one triangle is on the border
+  std::vector<bool> locked(vertexCount);
+  {
+    std::unordered_map<uint64_t, uint32_t> edgeUse;
+    edgeUse.reserve(indices.size());
+    auto edge_key = [](uint32_t a, uint32_t b) {
+      return uint64_t{std::min(a, b)} << 32 | std::max(a, b);
+    };
+    for (size_t t{}; t < triangleCount; ++t) {
+      for (size_t corner{}; corner < 3; ++corner) {
+        ++edgeUse[edge_key(
+            triangles[t * 3 + corner], triangles[t * 3 + (corner + 1) % 3])];
+      }
+    }
+    for (auto& use : edgeUse) {
+      if (use.second == 1) {
+        locked[use.first >> 32] = true;
+        locked[use.first & 0xFFFFFFFF] = true;
+      }
+    }
+  }
+
+  struct collapse {
+    double cost;
+    uint32_t from;
+    uint32_t to;
+    uint32_t fromVersion;
+    uint32_t toVersion;
+    bool operator>(const collapse& other) const { return cost > other.cost; }
+  };
+  std::priority_queue<collapse, std::vector<collapse>, std::greater<>> queue;
+  std::vector<uint32_t> version(vertexCount);
+  std::vector<bool> vertexAlive(vertexCount, true);
+
+  auto push_collapse = [&](uint32_t from, uint32_t to) {
+    if (locked[from]) {
+      return;
+    }
+    auto combined = quadrics[from];
+    combined += quadrics[to];
+    queue.push({combined.evaluate(positions[to]),
+                from,
+                to,
+                version[from],
+                version[to]});
+  };
+  for (size_t t{}; t < triangleCount; ++t) {
+    for (size_t corner{}; corner < 3; ++corner) {
+      auto a = triangles[t * 3 + corner];
+      auto b = triangles[t * 3 + (corner + 1) % 3];
+      push_collapse(a, b);
+      push_collapse(b, a);
+    }
+  }
+
+  // rejects collapses that would flip or squash a remaining triangle
+  auto collapse_is_valid = [&](uint32_t from, uint32_t to) {
+    for (auto t : vertexTriangles[from]) {
+      if (!triangleAlive[t]) {
+        continue;
+      }
+      auto corners = &triangles[t * 3];
+      if (corners[0] == to || corners[1] == to || corners[2] == to) {
+        continue;
+      }
+      std::array<vec3, 3> before{
+          positions[corners[0]], positions[corners[1]], positions[corners[2]]};
+      auto after = before;
+      for (size_t corner{}; corner < 3; ++corner) {
+        if (corners[corner] == from) {
+          after[corner] = positions[to];
+        }
+      }
+      auto oldNormal =
+          cross(sub(before[1], before[0]), sub(before[2], before[0]));
+      auto newNormal =
+          cross(sub(after[1], after[0]), sub(after[2], after[0]));
+      auto alignment = dot(oldNormal, newNormal);
+      if (alignment <= 0.25f * std::sqrt(dot(oldNormal, oldNormal) *
+                                         dot(newNormal, newNormal))) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  double maxErrorSquared = double{maxError} * maxError;
+  double worstCost{};
+  std::vector<uint32_t> neighbours;
+  while (liveTriangles * 3 > targetIndexCount && !queue.empty()) {
+    auto next = queue.top();
+    queue.pop();
+    if (!vertexAlive[next.from] || !vertexAlive[next.to] ||
+        version[next.from] != next.fromVersion ||
+        version[next.to] != next.toVersion) {
+      continue;
+    }
+    if (next.cost > maxErrorSquared) {
+      break;
+    }
+    if (!collapse_is_valid(next.from, next.to)) {
+      continue;
+    }
+
+    auto from = next.from;
+    auto to = next.to;
+    worstCost = std::max(worstCost, next.cost);
+    vertexAlive[from] = false;
+    quadrics[to] += quadrics[from];
+    ++version[to];
+    for (auto t : vertexTriangles[from]) {
+      if (!triangleAlive[t]) {
+        continue;
+      }
+      auto corners = &triangles[t * 3];
+      if (corners[0] == to || corners[1] == to || corners[2] == to) {
+        triangleAlive[t] = false;
+        --liveTriangles;
+        continue;
+      }
+      std::replace(corners, corners + 3, from, to);
+      vertexTriangles[to].push_back(t);
+    }
+    vertexTriangles[from].clear();
+
+    auto& adjacent = vertexTriangles[to];
+    adjacent.erase(
+        std::remove_if(
+            adjacent.begin(),
+            adjacent.end(),
+            [&](uint32_t t) { return !triangleAlive[t]; }),
+        adjacent.end());
+    neighbours.clear();
+    for (auto t : adjacent) {
+      for (size_t corner{}; corner < 3; ++corner) {
+        if (triangles[t * 3 + corner] != to) {
+          neighbours.push_back(triangles[t * 3 + corner]);
+        }
+      }
+    }
+    std::sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(
+        std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    for (auto neighbour : neighbours) {
+      push_collapse(neighbour, to);
+      push_collapse(to, neighbour);
+    }
+  }
+
+  std::vector<uint32_t> result;
+  result.reserve(liveTriangles * 3);
+  for (size_t t{}; t < triangleCount; ++t) {
+    if (triangleAlive[t]) {
+      result.insert(
+          result.end(), &triangles[t * 3], &triangles[t * 3] + 3);
+    }
+  }
+  if (resultError) {
+    *resultError = static_cast<float>(std::sqrt(worstCost));
+  }
+  return result;
+}
+
+// Replaces mesh.indices with a chain of LODs, each simplified from the full
+// mesh to about reduction times the previous level's triangle count, and
+// records their index ranges and error bounds in mesh.lods. The chain stops
+// early once simplification stalls or the next level would exceed maxError.
+inline void generate_lod_chain(
+    source_mesh& mesh,
+    size_t maxLevels = 4,
+    float reduction = 0.5f,
+    float maxError = std::numeric_limits<float>::max()) {
+  auto fullIndices = mesh.indices;
+  mesh.lods = {{0, static_cast<uint32_t>(fullIndices.size()), 0.f}};
+
+  size_t target = fullIndices.size();
+  for (size_t level = 1; level < maxLevels; ++level) {
+    target = static_cast<size_t>(target * reduction) / 3 * 3;
+    float error{};
+    auto simplified = simplify_mesh(
+        mesh.positions, fullIndices, target, maxError, &error);
+    // stop once a level no longer removes a meaningful number of triangles
+    if (simplified.empty() ||
+        simplified.size() > mesh.lods.back().indexCount * 9 / 10) {
+      break;
+    }
+    mesh.lods.push_back(
+        {static_cast<uint32_t>(mesh.indices.size()),
+         static_cast<uint32_t>(simplified.size()),
+         std::max(error, mesh.lods.back().error)});
+    mesh.indices.insert(
+        mesh.indices.end(), simplified.begin(), simplified.end());
+  }
+}
@@ -0,0 +1,176 @@
+#include "lod_selector.hpp"
+#include "mesh_simplifier.hpp"
+#include <catch2/catch.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+
+namespace {
+// n x n heightfield of rolling hills over [0, n-1] in x and z.
+source_mesh make_terrain(uint32_t n) {
+  source_mesh mesh{};
+  for (uint32_t z{}; z < n; ++z) {
+    for (uint32_t x{}; x < n; ++x) {
+      float height = 2.f * std::sin(x * 0.15f) * std::cos(z * 0.1f);
+      mesh.positions.push_back({float(x), height, float(z)});
+      mesh.normals.push_back({0.f, 1.f, 0.f});
+    }
+  }
+  for (uint32_t z{}; z + 1 < n; ++z) {
+    for (uint32_t x{}; x + 1 < n; ++x) {
+      uint32_t i = z * n + x;
+      mesh.indices.insert(
+          mesh.indices.end(), {i, i + n, i + 1, i + 1, i + n, i + n + 1});
+    }
+  }
+  return mesh;
+}
+
+using vec3 = std::array<float, 3>;
+
+// Vertical distance from p to the triangle list covering p in the xz plane,
+// which is the geometric error of a heightfield LOD at p.
+float height_error(
+    const source_mesh& mesh,
+    const uint32_t* indices,
+    size_t indexCount,
+    const vec3& p) {
+  for (size_t t{}; t < indexCount; t += 3) {
+    auto& a = mesh.positions[indices[t]];
+    auto& b = mesh.positions[indices[t + 1]];
+    auto& c = mesh.positions[indices[t + 2]];
+    // barycentrics in the xz plane
+    float det = (b[2] - c[2]) * (a[0] - c[0]) + (c[0] - b[0]) * (a[2] - c[2]);
+    if (det == 0.f) {
+      continue;
+    }
+    float u = ((b[2] - c[2]) * (p[0] - c[0]) + (c[0] - b[0]) * (p[2] - c[2])) /
+              det;
+    float v = ((c[2] - a[2]) * (p[0] - c[0]) + (a[0] - c[0]) * (p[2] - c[2])) /
+              det;
+    float w = 1.f - u - v;
+    constexpr float epsilon = -1e-5f;
+    if (u >= epsilon && v >= epsilon && w >= epsilon) {
+      return std::abs(u * a[1] + v * b[1] + w * c[1] - p[1]);
+    }
+  }
+  return std::numeric_limits<float>::max();
+}
+}  // namespace
+
+TEST_CASE("Simplifying a flat grid removes most triangles without error") {
+  auto mesh = make_terrain(32);
+  for (auto& position : mesh.positions) {
+    position[1] = 0.f;
+  }
+  float error{};
+  auto simplified =
+      simplify_mesh(mesh.positions, mesh.indices, 0, 1e-3f, &error);
+  REQUIRE(simplified.size() < mesh.indices.size() / 4);
+  REQUIRE(error < 1e-3f);
+}
+
+TEST_CASE("Simplification keeps border vertices in place") {
+  auto mesh = make_terrain(16);
+  auto simplified =
+      simplify_mesh(mesh.positions, mesh.indices, mesh.indices.size() / 4);
+  std::vector<bool> used(mesh.positions.size());
+  for (auto index : simplified) {
+    used[index] = true;
+  }
+  for (uint32_t i{}; i < 16; ++i) {
+    REQUIRE(used[i]);
+    REQUIRE(used[15 * 16 + i]);
+    REQUIRE(used[i * 16]);
+    REQUIRE(used[i * 16 + 15]);
+  }
+}
+
+TEST_CASE("An LOD chain reduces triangles with bounded geometric error") {
+  auto mesh = make_terrain(48);
+  auto original = mesh;
+  generate_lod_chain(mesh, 4, 0.5f);
+  REQUIRE(mesh.lods.size() == 4);
+  REQUIRE(mesh.lods[0].indexCount == original.indices.size());
+  REQUIRE(mesh.lods[0].error == 0.f);
+
+  for (size_t level = 1; level < mesh.lods.size(); ++level) {
+    auto& lod = mesh.lods[level];
+    auto& previous = mesh.lods[level - 1];
+    REQUIRE(lod.indexCount % 3 == 0);
+    REQUIRE(lod.indexCount <= previous.indexCount * 6 / 10);
+    REQUIRE(lod.error >= previous.error);
+
+    float worst{};
+    for (auto& position : original.positions) {
+      worst = std::max(
+          worst,
+          height_error(
+              mesh,
+              mesh.indices.data() + lod.indexOffset,
+              lod.indexCount,
+              position));
+    }
+    // the coarse surface still covers the whole terrain and stays within
+    // the recorded bound
+    REQUIRE(worst < std::numeric_limits<float>::max());
+    REQUIRE(worst <= lod.error + 1e-4f);
+  }
+}
+
+TEST_CASE("A max error stops the LOD chain early") {
+  auto mesh = make_terrain(32);
+  generate_lod_chain(mesh, 8, 0.5f, 0.05f);
+  REQUIRE(mesh.lods.size() < 8);
+  for (auto& lod : mesh.lods) {
+    REQUIRE(lod.error <= 0.05f);
+  }
+}
+
+TEST_CASE("LOD selection coarsens with distance") {
+  std::vector<mesh_lod> lods{
+      {0, 300, 0.f}, {300, 150, 0.05f}, {450, 75, 0.2f}, {525, 30, 1.f}};
+  array_view<mesh_lod> view{lods.data(), lods.size()};
+  std::array<float, 3> boundsMin{-1.f, -1.f, -1.f};
+  std::array<float, 3> boundsMax{1.f, 1.f, 1.f};
+  camera_matrices camera{};
+  camera.projection =
+      glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 5000.f);
+  glm::mat4 model{1.f};
+
+  auto at_distance = [&](float distance) {
+    camera.view = glm::lookAt(
+        glm::vec3(0.f, 0.f, distance),
+        glm::vec3(0.f, 0.f, 0.f),
+        glm::vec3(0.f, 1.f, 0.f));
+    return select_lod(view, boundsMin, boundsMax, model, camera, 1080.f);
+  };
+  REQUIRE(at_distance(2.f) == 0);
+  size_t previous{};
+  for (float distance : {5.f, 50.f, 200.f, 2000.f}) {
+    auto selected = at_distance(distance);
+    REQUIRE(selected >= previous);
+    previous = selected;
+  }
+  REQUIRE(previous == 3);
+
+  // scaling the model up makes its errors larger on screen
+  camera.view = glm::lookAt(
+      glm::vec3(0.f, 0.f, 200.f),
+      glm::vec3(0.f, 0.f, 0.f),
+      glm::vec3(0.f, 1.f, 0.f));
+  auto unscaled = select_lod(view, boundsMin, boundsMax, model, camera, 1080.f);
+  auto scaled = select_lod(
+      view,
+      boundsMin,
+      boundsMax,
+      glm::scale(model, glm::vec3(10.f, 10.f, 10.f)),
+      camera,
+      1080.f);
+  REQUIRE(scaled < unscaled);
+
+  // a Y-flipped projection sees the same sizes
+  camera.projection[1][1] *= -1.f;
+  REQUIRE(
+      select_lod(view, boundsMin, boundsMax, model, camera, 1080.f) ==
+      unscaled);
+}
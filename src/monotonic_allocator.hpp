@@ -1,15 +1,92 @@
 #pragma once
+#include "aligned_alloc.hpp"
 #include <cstdint>
 #include <cstddef>
 #include <cstdlib>
 #include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <stdexcept>
 #include <type_traits>
+#include <vector>
+
+// Controls how a monotonic_memory obtains more space once its current block
+// is exhausted. Each new block is the previous block's size times factor,
+// clamped to maxBlockSize (a single request larger than the cap still gets a
+// block big enough to hold it).
+struct monotonic_growth {
+  size_t factor = 2;
+  size_t maxBlockSize = std::numeric_limits<size_t>::max();
+};
+
+struct monotonic_stats {
+  // bytes handed out (including alignment padding) since the last reset
+  size_t used{};
+  // total bytes owned across all blocks
+  size_t capacity{};
+  size_t blockCount{};
+  // blocks allocated over the lifetime of the memory resource, including
+  // the first; unchanged across a cycle means the cycle never hit the heap
+  size_t blockAllocations{};
+  // largest value of used seen over the lifetime of the memory resource;
+  // a good starting size for the next run
+  size_t highWaterMark{};
+};
+
+#ifdef VKA_MONOTONIC_INSTRUMENTATION
+// Opt-in allocation counters, compiled in by defining
+// VKA_MONOTONIC_INSTRUMENTATION. One set covers a single reset cycle.
+struct monotonic_tag_counters {
+  const char* tag{};
+  size_t allocationCount{};
+  size_t bytesRequested{};
+};
+
+struct monotonic_counters {
+  size_t allocationCount{};
+  size_t bytesRequested{};
+  // requested bytes plus alignment padding
+  size_t bytesConsumed{};
+  size_t paddingWaste{};
+  // bytes left unused at the end of a block when a new one was chained in
+  size_t blockTailWaste{};
+  // largest used() reached during the cycle
+  size_t peakOffset{};
+  std::vector<monotonic_tag_counters> tags{};
+};
+#endif
+
+// Debug builds fill rewound memory with this byte to expose use-after-rewind.
+constexpr unsigned char monotonic_poison_byte = 0xCD;
 
 struct monotonic_memory {
-  monotonic_memory(size_t size) : m_size(size) {
-    m_memory = malloc(size);
-    m_freePtr = m_memory;
+  // A saved allocation position; see mark() and rewind().
+  struct marker {
+    size_t block{};
+    size_t offset{};
+    size_t usedInPriorBlocks{};
+  };
+
+  monotonic_memory(size_t size) : monotonic_memory(size, default_alignment) {}
+
+  monotonic_memory(size_t size, monotonic_growth growth)
+      : monotonic_memory(size, default_alignment, growth) {}
+
+  // blockAlignment is the alignment of every block's base address; raise it
+  // to cache_line_size or a page size when most allocations need it so they
+  // don't pay for padding.
+  monotonic_memory(
+      size_t size,
+      size_t blockAlignment,
+      std::optional<monotonic_growth> growth = {})
+      : m_growth(growth), m_blockAlignment(blockAlignment) {
+    if (!is_power_of_two(blockAlignment)) {
+      throw std::invalid_argument{"block alignment must be a power of two"};
+    }
+    push_block(size);
+    m_freePtr = current_block().memory.get();
   }
 
   monotonic_memory(const monotonic_memory&) = delete;
@@ -17,49 +94,277 @@ struct monotonic_memory {
   monotonic_memory& operator=(const monotonic_memory&) = delete;
   monotonic_memory& operator=(monotonic_memory&&) = default;
 
-  ~monotonic_memory() { free(m_memory); }
-
   template <typename T>
   T* allocate(size_t n) {
-    constexpr auto alignment = alignof(T);
-    size_t alignedSize = alignment * n;
-    m_freePtr = next_aligned(alignment);
-    if (!can_allocate(alignedSize)) {
-      throw std::bad_alloc{};
+    return reinterpret_cast<T*>(bump(sizeof(T) * n, alignof(T)));
+  }
+
+  // Over-aligned typed allocation, e.g. cache_line_size to keep per-thread
+  // data from sharing a line.
+  template <typename T>
+  T* allocate(size_t n, size_t alignment) {
+    return reinterpret_cast<T*>(
+        allocate_bytes(sizeof(T) * n, std::max(alignment, alignof(T))));
+  }
+
+  // Untyped allocation for callers that only know size and alignment at
+  // runtime, such as std::pmr::memory_resource or upload staging.
+  // alignment must be a power of two.
+  void* allocate_bytes(size_t size, size_t alignment) {
+    if (!is_power_of_two(alignment)) {
+      throw std::invalid_argument{"alignment must be a power of two"};
     }
-    auto result = m_freePtr;
-    auto newFree = reinterpret_cast<size_t>(m_freePtr) + alignedSize;
-    m_freePtr = reinterpret_cast<void*>(newFree);
-    return reinterpret_cast<T*>(result);
+    return bump(size, alignment);
+  }
+
+  // Keeps only the largest block, so a memory resource that grew during one
+  // cycle can satisfy the same load from a single block in the next.
+  void reset() {
+    if (m_blocks.size() > 1) {
+      auto largest = std::max_element(
+          m_blocks.begin(), m_blocks.end(), [](auto& lhs, auto& rhs) {
+            return lhs.size < rhs.size;
+          });
+      std::iter_swap(m_blocks.begin(), largest);
+      m_blocks.erase(m_blocks.begin() + 1, m_blocks.end());
+    }
+    m_current = 0;
+    m_usedInPriorBlocks = 0;
+    m_freePtr = m_blocks[0].memory.get();
+#ifdef VKA_MONOTONIC_INSTRUMENTATION
+    m_previousCycle = std::move(m_cycle);
+    m_cycle = {};
+#endif
+  }
+
+  marker mark() const {
+    marker result{};
+    result.block = m_current;
+    result.offset = used() - m_usedInPriorBlocks;
+    result.usedInPriorBlocks = m_usedInPriorBlocks;
+    return result;
+  }
+
+  // Releases everything allocated since savedPosition was taken. Blocks
+  // chained in after the marker are kept and reused by later allocations,
+  // so peak memory is bounded by the deepest nesting rather than the total.
+  void rewind(marker savedPosition) {
+#ifndef NDEBUG
+    for (size_t i = savedPosition.block; i <= m_current; ++i) {
+      auto start = i == savedPosition.block ? savedPosition.offset : 0;
+      std::memset(
+          static_cast<unsigned char*>(m_blocks[i].memory.get()) + start,
+          monotonic_poison_byte,
+          m_blocks[i].size - start);
+    }
+#endif
+    m_current = savedPosition.block;
+    m_usedInPriorBlocks = savedPosition.usedInPriorBlocks;
+    m_freePtr = static_cast<unsigned char*>(current_block().memory.get()) +
+                savedPosition.offset;
+  }
+
+  monotonic_stats stats() const {
+    monotonic_stats result{};
+    result.used = used();
+    result.blockCount = m_blocks.size();
+    for (auto& b : m_blocks) {
+      result.capacity += b.size;
+    }
+    result.blockAllocations = m_blockAllocations;
+    result.highWaterMark = m_highWaterMark;
+    return result;
   }
 
-  void reset() { m_freePtr = m_memory; }
+  static constexpr size_t default_alignment = alignof(std::max_align_t);
+
+#ifdef VKA_MONOTONIC_INSTRUMENTATION
+  // Attributes subsequent allocations to tag until it is changed; tag must
+  // outlive the memory resource (a string literal naming the callsite).
+  void set_tag(const char* tag) { m_tag = tag; }
+  const char* tag() const { return m_tag; }
+
+  const monotonic_counters& counters() const { return m_cycle; }
+  // Counters for the cycle that the last reset() closed.
+  const monotonic_counters& previous_counters() const {
+    return m_previousCycle;
+  }
+#endif
 
 private:
-  size_t m_size{};
-  void* m_memory{};
+  struct block {
+    std::unique_ptr<void, aligned_free_deleter> memory;
+    size_t size{};
+  };
+
+  std::optional<monotonic_growth> m_growth{};
+  size_t m_blockAlignment{default_alignment};
+  std::vector<block> m_blocks{};
+  size_t m_current{};
+  size_t m_usedInPriorBlocks{};
+  size_t m_highWaterMark{};
+  size_t m_blockAllocations{};
   void* m_freePtr{};
+#ifdef VKA_MONOTONIC_INSTRUMENTATION
+  const char* m_tag{};
+  monotonic_counters m_cycle{};
+  monotonic_counters m_previousCycle{};
+#endif
+
+  void* bump(size_t requiredSize, size_t alignment) {
+    for (;;) {
+      auto aligned = next_aligned(alignment);
+      if (can_allocate(aligned, requiredSize)) {
+#ifdef VKA_MONOTONIC_INSTRUMENTATION
+        record_allocation(
+            requiredSize, aligned - reinterpret_cast<uintptr_t>(m_freePtr));
+#endif
+        m_freePtr = reinterpret_cast<void*>(aligned);
+        break;
+      }
+      if (!m_growth) {
+        throw std::bad_alloc{};
+      }
+      // a fresh block is only guaranteed to be aligned to m_blockAlignment
+      auto slack = alignment > m_blockAlignment ? alignment : 0;
+      next_block(requiredSize + slack);
+    }
+    auto result = m_freePtr;
+    auto newFree = reinterpret_cast<size_t>(m_freePtr) + requiredSize;
+    m_freePtr = reinterpret_cast<void*>(newFree);
+    m_highWaterMark = std::max(m_highWaterMark, used());
+#ifdef VKA_MONOTONIC_INSTRUMENTATION
+    m_cycle.peakOffset = std::max(m_cycle.peakOffset, used());
+#endif
+    return result;
+  }
+
+#ifdef VKA_MONOTONIC_INSTRUMENTATION
+  void record_allocation(size_t requestedSize, size_t padding) {
+    ++m_cycle.allocationCount;
+    m_cycle.bytesRequested += requestedSize;
+    m_cycle.bytesConsumed += requestedSize + padding;
+    m_cycle.paddingWaste += padding;
+    if (!m_tag) {
+      return;
+    }
+    auto tagCounters = std::find_if(
+        m_cycle.tags.begin(), m_cycle.tags.end(), [&](auto& counters) {
+          return counters.tag == m_tag;
+        });
+    if (tagCounters == m_cycle.tags.end()) {
+      m_cycle.tags.push_back({m_tag});
+      tagCounters = m_cycle.tags.end() - 1;
+    }
+    ++tagCounters->allocationCount;
+    tagCounters->bytesRequested += requestedSize;
+  }
+#endif
+
+  void push_block(size_t size) {
+    block newBlock{};
+    newBlock.memory.reset(aligned_malloc(size, m_blockAlignment));
+    if (!newBlock.memory && size > 0) {
+      throw std::bad_alloc{};
+    }
+    newBlock.size = size;
+    ++m_blockAllocations;
+    m_blocks.insert(
+        m_blocks.begin() + std::min(m_current + 1, m_blocks.size()),
+        std::move(newBlock));
+  }
+
+  void next_block(size_t minimumSize) {
+#ifdef VKA_MONOTONIC_INSTRUMENTATION
+    m_cycle.blockTailWaste += current_block().size - distance_base_to_free();
+#endif
+    m_usedInPriorBlocks += distance_base_to_free();
+    auto nextIndex = m_current + 1;
+    if (nextIndex >= m_blocks.size() ||
+        m_blocks[nextIndex].size < minimumSize) {
+      size_t grownSize = std::min(
+          current_block().size * m_growth->factor, m_growth->maxBlockSize);
+      push_block(std::max(grownSize, minimumSize));
+    }
+    m_current = nextIndex;
+    m_freePtr = current_block().memory.get();
+  }
+
+  block& current_block() { return m_blocks[m_current]; }
+
+  size_t used() const {
+    auto base = reinterpret_cast<size_t>(m_blocks[m_current].memory.get());
+    return m_usedInPriorBlocks + (reinterpret_cast<size_t>(m_freePtr) - base);
+  }
 
   size_t distance_base_to_free() {
     return reinterpret_cast<size_t>(m_freePtr) -
-           reinterpret_cast<size_t>(m_memory);
+           reinterpret_cast<size_t>(current_block().memory.get());
   }
 
-  void* next_aligned(std::size_t requiredAlignment) {
-    size_t dist = distance_base_to_free();
-    size_t nextAligned =
-        reinterpret_cast<size_t>(m_freePtr) + (dist % requiredAlignment);
-    return reinterpret_cast<void*>(
-        std::min(nextAligned, reinterpret_cast<size_t>(end_pointer())));
+  static bool is_power_of_two(size_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
   }
 
-  bool can_allocate(size_t requiredSize) {
-    return (distance_base_to_free() + requiredSize) <= m_size;
+  // Aligns the absolute address, not the offset from the block base, so
+  // requests stricter than the block alignment are still honored. The
+  // result may lie past the end of the block.
+  uintptr_t next_aligned(std::size_t requiredAlignment) {
+    auto mask = static_cast<uintptr_t>(requiredAlignment - 1);
+    return (reinterpret_cast<uintptr_t>(m_freePtr) + mask) & ~mask;
+  }
+
+  // Even a zero-size allocation needs its aligned address inside the block.
+  bool can_allocate(uintptr_t aligned, size_t requiredSize) {
+    auto end = reinterpret_cast<uintptr_t>(end_pointer());
+    return aligned <= end && end - aligned >= requiredSize;
   }
 
   void* end_pointer() {
-    return reinterpret_cast<void*>(reinterpret_cast<size_t>(m_memory) + m_size);
+    return reinterpret_cast<void*>(
+        reinterpret_cast<size_t>(current_block().memory.get()) +
+        current_block().size);
+  }
+};
+
+// Rewinds a monotonic_memory to where it was when the scope was opened.
+struct monotonic_scope {
+  monotonic_scope(monotonic_memory& memory)
+      : m_memory(memory), m_marker(memory.mark()) {}
+
+  monotonic_scope(const monotonic_scope&) = delete;
+  monotonic_scope& operator=(const monotonic_scope&) = delete;
+
+  ~monotonic_scope() { m_memory.rewind(m_marker); }
+
+private:
+  monotonic_memory& m_memory;
+  monotonic_memory::marker m_marker{};
+};
+
+// Tags allocations made while the scope is open for the instrumentation
+// report, restoring the previous tag on exit. Does nothing unless
+// VKA_MONOTONIC_INSTRUMENTATION is defined.
+struct monotonic_tag_scope {
+#ifdef VKA_MONOTONIC_INSTRUMENTATION
+  monotonic_tag_scope(monotonic_memory& memory, const char* tag)
+      : m_memory(memory), m_previousTag(memory.tag()) {
+    memory.set_tag(tag);
   }
+
+  ~monotonic_tag_scope() { m_memory.set_tag(m_previousTag); }
+#else
+  monotonic_tag_scope(monotonic_memory&, const char*) {}
+#endif
+
+  monotonic_tag_scope(const monotonic_tag_scope&) = delete;
+  monotonic_tag_scope& operator=(const monotonic_tag_scope&) = delete;
+
+#ifdef VKA_MONOTONIC_INSTRUMENTATION
+private:
+  monotonic_memory& m_memory;
+  const char* m_previousTag{};
+#endif
 };
 
 template <typename T>
@@ -1,5 +1,7 @@
 #include "monotonic_allocator.hpp"
 #include <catch2/catch.hpp>
+#include <algorithm>
+#include <random>
 #include <vector>
 
 TEST_CASE("Create memory resource of size 1024") {
@@ -50,14 +52,14 @@ TEST_CASE("Allocate two ints from an allocator with size 8 + 3") {
 
 struct alignas(128) test_aligned_128 {};
 TEST_CASE("Allocate an empty alignas(128) struct from a pool sized 128") {
-  monotonic_memory memoryResource{128};
+  monotonic_memory memoryResource{128, 128};
   monotonic_allocator<test_aligned_128> monotonic{&memoryResource};
   REQUIRE_NOTHROW([&] { auto ptr = monotonic.allocate(1); }());
   REQUIRE_THROWS([&] { auto ptr = monotonic.allocate(1); }());
 }
 
 TEST_CASE("Exhaust the allocator memory, reset, allocate successfully") {
-  monotonic_memory memoryResource{128};
+  monotonic_memory memoryResource{128, 128};
   monotonic_allocator<test_aligned_128> monotonic{&memoryResource};
   auto ptr = monotonic.allocate(1);
   monotonic.reset();
@@ -104,4 +106,228 @@ TEST_CASE("Allocate a vector's data from a monotonic allocator") {
     REQUIRE_NOTHROW(intVector.push_back(i));
   }
   REQUIRE_THROWS(intVector.push_back(8));
-}
\ No newline at end of file
+}
+
+TEST_CASE("A growable memory resource chains a new block instead of throwing") {
+  monotonic_memory memoryResource{sizeof(int32_t) * 2, monotonic_growth{}};
+  monotonic_allocator<int32_t> alloc{&memoryResource};
+  auto ptr0 = alloc.allocate(2);
+  int32_t* ptr1{};
+  REQUIRE_NOTHROW([&] { ptr1 = alloc.allocate(1); }());
+  REQUIRE(ptr1 != nullptr);
+  REQUIRE(memoryResource.stats().blockCount == 2);
+}
+
+TEST_CASE("Growth is geometric and clamped to the maximum block size") {
+  monotonic_growth growth{};
+  growth.factor = 4;
+  growth.maxBlockSize = 32;
+  monotonic_memory memoryResource{8, growth};
+  monotonic_allocator<int32_t> alloc{&memoryResource};
+  alloc.allocate(2);
+  alloc.allocate(1);
+  REQUIRE(memoryResource.stats().capacity == 8 + 32);
+  alloc.allocate(8);
+  REQUIRE(memoryResource.stats().capacity == 8 + 32 + 32);
+}
+
+TEST_CASE("A request larger than the growth cap still succeeds") {
+  monotonic_growth growth{};
+  growth.maxBlockSize = 16;
+  monotonic_memory memoryResource{16, growth};
+  monotonic_allocator<int32_t> alloc{&memoryResource};
+  REQUIRE_NOTHROW([&] { alloc.allocate(64); }());
+}
+
+TEST_CASE("Reset keeps only the largest block") {
+  monotonic_memory memoryResource{16, monotonic_growth{}};
+  monotonic_allocator<int32_t> alloc{&memoryResource};
+  alloc.allocate(4);
+  alloc.allocate(4);
+  alloc.allocate(8);
+  REQUIRE(memoryResource.stats().blockCount == 3);
+  memoryResource.reset();
+  auto stats = memoryResource.stats();
+  REQUIRE(stats.blockCount == 1);
+  REQUIRE(stats.capacity == 64);
+  REQUIRE(stats.used == 0);
+}
+
+TEST_CASE("High water mark survives reset") {
+  monotonic_memory memoryResource{64, monotonic_growth{}};
+  monotonic_allocator<int32_t> alloc{&memoryResource};
+  alloc.allocate(8);
+  alloc.allocate(12);
+  memoryResource.reset();
+  alloc.allocate(1);
+  auto stats = memoryResource.stats();
+  REQUIRE(stats.used == sizeof(int32_t));
+  REQUIRE(stats.highWaterMark == sizeof(int32_t) * 20);
+}
+
+TEST_CASE("Rewinding to a marker releases later allocations") {
+  monotonic_memory memoryResource{64};
+  monotonic_allocator<int32_t> alloc{&memoryResource};
+  alloc.allocate(2);
+  auto marker = memoryResource.mark();
+  auto scratch = alloc.allocate(4);
+  memoryResource.rewind(marker);
+  REQUIRE(memoryResource.stats().used == sizeof(int32_t) * 2);
+  REQUIRE(alloc.allocate(4) == scratch);
+}
+
+TEST_CASE("A scope rewinds its memory resource on exit") {
+  monotonic_memory memoryResource{64};
+  monotonic_allocator<int32_t> alloc{&memoryResource};
+  auto model = alloc.allocate(1);
+  {
+    monotonic_scope meshScratch{memoryResource};
+    alloc.allocate(8);
+    {
+      monotonic_scope nested{memoryResource};
+      alloc.allocate(4);
+    }
+    REQUIRE(memoryResource.stats().used == sizeof(int32_t) * 9);
+  }
+  REQUIRE(memoryResource.stats().used == sizeof(int32_t));
+  REQUIRE(alloc.allocate(1) == model + 1);
+}
+
+TEST_CASE("Rewinding across chained blocks keeps them for reuse") {
+  monotonic_memory memoryResource{16, monotonic_growth{}};
+  monotonic_allocator<int32_t> alloc{&memoryResource};
+  alloc.allocate(2);
+  auto marker = memoryResource.mark();
+  alloc.allocate(16);
+  auto blocksAfterGrowth = memoryResource.stats().blockCount;
+  memoryResource.rewind(marker);
+  REQUIRE(memoryResource.stats().used == sizeof(int32_t) * 2);
+  for (int i{}; i < 3; ++i) {
+    monotonic_scope scope{memoryResource};
+    alloc.allocate(16);
+  }
+  REQUIRE(memoryResource.stats().blockCount == blocksAfterGrowth);
+}
+
+#ifndef NDEBUG
+TEST_CASE("Rewound memory is poisoned in debug builds") {
+  monotonic_memory memoryResource{64};
+  monotonic_allocator<uint8_t> alloc{&memoryResource};
+  auto marker = memoryResource.mark();
+  auto bytes = alloc.allocate(16);
+  std::fill(bytes, bytes + 16, uint8_t{0});
+  memoryResource.rewind(marker);
+  REQUIRE(std::all_of(bytes, bytes + 16, [](uint8_t b) {
+    return b == monotonic_poison_byte;
+  }));
+}
+#endif
+
+TEST_CASE("Allocations are sized by sizeof(T), not alignof(T)") {
+  struct alignas(4) wide {
+    char data[64];
+  };
+  monotonic_memory memoryResource{sizeof(wide) * 2};
+  monotonic_allocator<wide> alloc{&memoryResource};
+  auto first = alloc.allocate(1);
+  auto second = alloc.allocate(1);
+  REQUIRE(second == first + 1);
+  REQUIRE_THROWS(alloc.allocate(1));
+}
+
+TEST_CASE("Alignment is applied to the absolute address") {
+  monotonic_memory memoryResource{256, 16};
+  memoryResource.allocate_bytes(1, 1);
+  auto ptr = memoryResource.allocate_bytes(1, 64);
+  REQUIRE(reinterpret_cast<uintptr_t>(ptr) % 64 == 0);
+}
+
+TEST_CASE("Block alignment can be a cache line or a page") {
+  monotonic_memory cacheLine{cache_line_size, cache_line_size};
+  REQUIRE_NOTHROW(cacheLine.allocate_bytes(cache_line_size, cache_line_size));
+  monotonic_memory page{page_size, page_size};
+  REQUIRE_NOTHROW(page.allocate_bytes(page_size, page_size));
+}
+
+TEST_CASE("Over-aligned typed allocation") {
+  monotonic_memory memoryResource{1024};
+  memoryResource.allocate<char>(1);
+  auto ptr = memoryResource.allocate<int32_t>(4, cache_line_size);
+  REQUIRE(reinterpret_cast<uintptr_t>(ptr) % cache_line_size == 0);
+}
+
+TEST_CASE("Alignments that are not a power of two are rejected") {
+  monotonic_memory memoryResource{64};
+  REQUIRE_THROWS_AS(
+      memoryResource.allocate_bytes(4, 3), std::invalid_argument);
+  REQUIRE_THROWS_AS((monotonic_memory{64, 48}), std::invalid_argument);
+}
+
+TEST_CASE("A zero-size allocation at the end of a block is still aligned") {
+  monotonic_memory fixed{100, cache_line_size};
+  fixed.allocate_bytes(99, 1);
+  REQUIRE_THROWS_AS(fixed.allocate_bytes(0, cache_line_size), std::bad_alloc);
+
+  monotonic_memory growable{100, cache_line_size, monotonic_growth{}};
+  growable.allocate_bytes(99, 1);
+  auto ptr = growable.allocate_bytes(0, cache_line_size);
+  REQUIRE(reinterpret_cast<uintptr_t>(ptr) % cache_line_size == 0);
+  REQUIRE(growable.stats().blockCount == 2);
+
+  // an aligned end of the block is still inside it
+  monotonic_memory exact{128, cache_line_size};
+  exact.allocate_bytes(64, 1);
+  auto end = exact.allocate_bytes(64, cache_line_size);
+  REQUIRE(exact.allocate_bytes(0, 1) == static_cast<std::byte*>(end) + 64);
+}
+
+TEST_CASE("Random sizes and alignments stay aligned, in bounds and disjoint") {
+  std::mt19937 rng{GENERATE(1u, 2u, 3u, 4u, 5u)};
+  std::uniform_int_distribution<size_t> sizeDist{0, 300};
+  std::uniform_int_distribution<int> alignShift{0, 12};
+  std::uniform_int_distribution<size_t> capacityDist{64, 8192};
+  bool growable = GENERATE(false, true);
+
+  size_t capacity = capacityDist(rng);
+  auto memoryResource = growable
+                            ? monotonic_memory{capacity, monotonic_growth{}}
+                            : monotonic_memory{capacity};
+  struct range {
+    uintptr_t begin;
+    uintptr_t end;
+  };
+  std::vector<range> ranges;
+  size_t requested{};
+  size_t misaligned{};
+  for (int i{}; i < 500; ++i) {
+    size_t size = sizeDist(rng);
+    size_t alignment = size_t{1} << alignShift(rng);
+    void* ptr{};
+    try {
+      ptr = memoryResource.allocate_bytes(size, alignment);
+    } catch (const std::bad_alloc&) {
+      REQUIRE_FALSE(growable);
+      break;
+    }
+    auto address = reinterpret_cast<uintptr_t>(ptr);
+    if (address % alignment != 0) {
+      ++misaligned;
+    }
+    std::fill_n(static_cast<unsigned char*>(ptr), size, 0xAB);
+    ranges.push_back({address, address + size});
+    requested += size;
+  }
+  REQUIRE(misaligned == 0);
+  REQUIRE(memoryResource.stats().used >= requested);
+  std::sort(ranges.begin(), ranges.end(), [](auto& lhs, auto& rhs) {
+    return lhs.begin < rhs.begin ||
+           (lhs.begin == rhs.begin && lhs.end < rhs.end);
+  });
+  size_t overlaps{};
+  for (size_t i{1}; i < ranges.size(); ++i) {
+    if (ranges[i - 1].end > ranges[i].begin) {
+      ++overlaps;
+    }
+  }
+  REQUIRE(overlaps == 0);
+}
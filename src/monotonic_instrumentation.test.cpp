@@ -0,0 +1,66 @@
+#include "monotonic_allocator.hpp"
+#include <catch2/catch.hpp>
+#include <string>
+
+// Built into catch_tests_instrumented, which defines
+// VKA_MONOTONIC_INSTRUMENTATION for every translation unit.
+
+TEST_CASE("Instrumentation counts allocations and requested bytes") {
+  monotonic_memory memoryResource{1024};
+  memoryResource.allocate<int32_t>(4);
+  memoryResource.allocate<int64_t>(2);
+  auto& counters = memoryResource.counters();
+  REQUIRE(counters.allocationCount == 2);
+  REQUIRE(counters.bytesRequested == 32);
+}
+
+TEST_CASE("Instrumentation separates alignment padding from requests") {
+  // a cache-line aligned base puts the second request 63 bytes on
+  monotonic_memory memoryResource{1024, cache_line_size};
+  memoryResource.allocate_bytes(1, 1);
+  memoryResource.allocate_bytes(8, 64);
+  auto& counters = memoryResource.counters();
+  REQUIRE(counters.bytesRequested == 9);
+  REQUIRE(counters.paddingWaste == 63);
+  REQUIRE(counters.bytesConsumed == counters.bytesRequested + 63);
+}
+
+TEST_CASE("Instrumentation records the peak offset of each reset cycle") {
+  monotonic_memory memoryResource{1024};
+  memoryResource.allocate_bytes(100, 1);
+  memoryResource.reset();
+  memoryResource.allocate_bytes(10, 1);
+  REQUIRE(memoryResource.previous_counters().peakOffset == 100);
+  REQUIRE(memoryResource.counters().peakOffset == 10);
+  REQUIRE(memoryResource.counters().allocationCount == 1);
+}
+
+TEST_CASE("Instrumentation records block tail waste when growing") {
+  monotonic_memory memoryResource{16, monotonic_growth{}};
+  memoryResource.allocate_bytes(10, 1);
+  memoryResource.allocate_bytes(10, 1);
+  REQUIRE(memoryResource.counters().blockTailWaste == 6);
+}
+
+TEST_CASE("Allocations are attributed to the innermost tag") {
+  monotonic_memory memoryResource{1024};
+  {
+    monotonic_tag_scope meshTag{memoryResource, "mesh"};
+    memoryResource.allocate_bytes(16, 1);
+    {
+      monotonic_tag_scope indexTag{memoryResource, "indices"};
+      memoryResource.allocate_bytes(8, 1);
+    }
+    memoryResource.allocate_bytes(4, 1);
+  }
+  memoryResource.allocate_bytes(2, 1);
+
+  auto& tags = memoryResource.counters().tags;
+  REQUIRE(tags.size() == 2);
+  REQUIRE(std::string{tags[0].tag} == "mesh");
+  REQUIRE(tags[0].allocationCount == 2);
+  REQUIRE(tags[0].bytesRequested == 20);
+  REQUIRE(std::string{tags[1].tag} == "indices");
+  REQUIRE(tags[1].bytesRequested == 8);
+  REQUIRE(memoryResource.counters().allocationCount == 4);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "frame_arena.hpp"
+#include "monotonic_allocator.hpp"
+#include <logger.hpp>
+#include <string>
+
+// Logs the counters of the last completed reset cycle. Compiles to nothing
+// unless VKA_MONOTONIC_INSTRUMENTATION is defined.
+inline void log_monotonic_report(
+    const std::string& name,
+    const monotonic_memory& memory) {
+#ifdef VKA_MONOTONIC_INSTRUMENTATION
+  auto& counters = memory.previous_counters();
+  auto stats = memory.stats();
+  vka::multi_logger::get()->debug(
+      "{}: {} allocations, {} B requested, {} B consumed, {} B padding, {} B "
+      "block tail, peak {} B of {} B in {} block(s), high water {} B",
+      name,
+      counters.allocationCount,
+      counters.bytesRequested,
+      counters.bytesConsumed,
+      counters.paddingWaste,
+      counters.blockTailWaste,
+      counters.peakOffset,
+      stats.capacity,
+      stats.blockCount,
+      stats.highWaterMark);
+  for (auto& tag : counters.tags) {
+    vka::multi_logger::get()->debug(
+        "  {}: {} allocations, {} B requested",
+        tag.tag,
+        tag.allocationCount,
+        tag.bytesRequested);
+  }
+#endif
+}
+
+// Reports every worker arena of the current frame; call right after
+// begin_frame to log what the previous use of that frame index consumed.
+inline void log_frame_report(frame_arenas& arenas) {
+#ifdef VKA_MONOTONIC_INSTRUMENTATION
+  for (size_t worker{}; worker < arenas.worker_count(); ++worker) {
+    log_monotonic_report(
+        "frame " + std::to_string(arenas.current_frame()) + " worker " +
+            std::to_string(worker),
+        arenas.arena(worker));
+  }
+#endif
+}
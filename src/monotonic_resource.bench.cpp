@@ -0,0 +1,49 @@
+#include "bench.hpp"
+#include "monotonic_resource.hpp"
+#include <cstdint>
+#include <vector>
+
+constexpr size_t vectorCount = 1000;
+constexpr size_t pushCount = 256;
+constexpr size_t operations = vectorCount * pushCount;
+constexpr size_t arenaSize = 64 * 1024 * 1024;
+
+template <typename Vector, typename MakeVector>
+void push_back_workload(MakeVector&& makeVector) {
+  for (size_t v{}; v < vectorCount; ++v) {
+    Vector values = makeVector();
+    for (size_t i{}; i < pushCount; ++i) {
+      values.push_back(static_cast<uint32_t>(i));
+    }
+    do_not_optimize(values.back());
+  }
+}
+
+int main() {
+  run_benchmark("std::vector<T> (default allocator)", operations, [] {
+    push_back_workload<std::vector<uint32_t>>(
+        [] { return std::vector<uint32_t>{}; });
+  });
+
+  monotonic_memory memory{arenaSize, monotonic_growth{}};
+  run_benchmark("std::vector<T, monotonic_allocator<T>>", operations, [&] {
+    memory.reset();
+    using vector_type = std::vector<uint32_t, monotonic_allocator<uint32_t>>;
+    push_back_workload<vector_type>([&] {
+      return vector_type{monotonic_allocator<uint32_t>{&memory}};
+    });
+  });
+
+  monotonic_resource resource{&memory};
+  run_benchmark("std::pmr::vector<T> (monotonic_resource)", operations, [&] {
+    memory.reset();
+    push_back_workload<std::pmr::vector<uint32_t>>(
+        [&] { return std::pmr::vector<uint32_t>{&resource}; });
+  });
+
+  run_benchmark("std::pmr::vector<T> (new_delete_resource)", operations, [] {
+    push_back_workload<std::pmr::vector<uint32_t>>([] {
+      return std::pmr::vector<uint32_t>{std::pmr::new_delete_resource()};
+    });
+  });
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "monotonic_allocator.hpp"
+#include <cstddef>
+#include <memory_resource>
+#include <type_traits>
+
+template <typename Memory, typename = void>
+struct has_deallocate_bytes : std::false_type {};
+
+template <typename Memory>
+struct has_deallocate_bytes<
+    Memory,
+    std::void_t<decltype(std::declval<Memory&>().deallocate_bytes(
+        std::declval<void*>(),
+        size_t{},
+        size_t{}))>> : std::true_type {};
+
+// Exposes one of our memory types as a std::pmr::memory_resource so that
+// std::pmr containers can draw from it without each container type being
+// templated on a different allocator. Memory must provide
+// allocate_bytes(size, alignment); deallocate_bytes(ptr, size, alignment) is
+// forwarded when present and otherwise deallocation is a no-op.
+template <typename Memory>
+struct memory_resource_adapter : std::pmr::memory_resource {
+  memory_resource_adapter(Memory* memory) : m_memory(memory) {}
+
+  Memory* memory() const { return m_memory; }
+
+private:
+  Memory* m_memory{};
+
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    return m_memory->allocate_bytes(bytes, alignment);
+  }
+
+  void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+    if constexpr (has_deallocate_bytes<Memory>::value) {
+      m_memory->deallocate_bytes(ptr, bytes, alignment);
+    }
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const
+      noexcept override {
+    auto otherAdapter = dynamic_cast<const memory_resource_adapter*>(&other);
+    return otherAdapter && otherAdapter->m_memory == m_memory;
+  }
+};
+
+using monotonic_resource = memory_resource_adapter<monotonic_memory>;
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "monotonic_resource.hpp"
+#include <catch2/catch.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+TEST_CASE("A pmr vector draws its storage from a monotonic resource") {
+  monotonic_memory memory{1024};
+  monotonic_resource resource{&memory};
+  std::pmr::vector<int32_t> ints{&resource};
+  ints.reserve(16);
+  REQUIRE(memory.stats().used >= sizeof(int32_t) * 16);
+}
+
+TEST_CASE("Exhausting a fixed monotonic resource throws bad_alloc") {
+  monotonic_memory memory{sizeof(int32_t) * 4};
+  monotonic_resource resource{&memory};
+  std::pmr::vector<int32_t> ints{&resource};
+  ints.reserve(4);
+  REQUIRE_THROWS_AS(ints.reserve(8), std::bad_alloc);
+}
+
+TEST_CASE("pmr string and unordered_map share one growable arena") {
+  monotonic_memory memory{64, monotonic_growth{}};
+  monotonic_resource resource{&memory};
+  std::pmr::unordered_map<std::pmr::string, int> names{&resource};
+  for (int i{}; i < 100; ++i) {
+    names.emplace(std::pmr::string{"a long enough name to skip sso", &resource}
+                      .append(std::to_string(i)),
+                  i);
+  }
+  REQUIRE(names.size() == 100);
+  REQUIRE(memory.stats().blockCount > 1);
+}
+
+TEST_CASE("Resources compare equal when they adapt the same memory") {
+  monotonic_memory memory0{16};
+  monotonic_memory memory1{16};
+  monotonic_resource resource0{&memory0};
+  monotonic_resource resource0Copy{&memory0};
+  monotonic_resource resource1{&memory1};
+  REQUIRE(resource0.is_equal(resource0Copy));
+  REQUIRE_FALSE(resource0.is_equal(resource1));
+  REQUIRE_FALSE(resource0.is_equal(*std::pmr::new_delete_resource()));
+}
@@ -0,0 +1,223 @@
+#pragma once
+#include "array_view.hpp"
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Cooked mesh blob whose streams already match the 3D pipeline's vertex
+// bindings: binding 0 is a packed vec3 position stream and binding 1 a packed
+// vec3 normal stream, so each stream uploads with a single memcpy.
+//
+// Layout: packed_mesh_header, packed_mesh_record[meshCount], then the
+// streams, each starting on a packed_mesh_stream_alignment boundary. The
+// index stream holds every LOD of a mesh back to back, finest first, and all
+// LODs share the mesh's vertex streams.
+constexpr uint32_t packed_mesh_magic = 0x4D504B56;  // "VKPM"
+constexpr uint32_t packed_mesh_version = 2;
+constexpr size_t packed_mesh_stream_alignment = 16;
+
+struct packed_mesh_header {
+  uint32_t magic{packed_mesh_magic};
+  uint32_t version{packed_mesh_version};
+  uint32_t meshCount{};
+  uint32_t reserved{};
+};
+
+// One level of detail: a range of the mesh's index stream and an upper bound
+// on how far, in object space, its surface strays from the full mesh.
+struct mesh_lod {
+  uint32_t indexOffset{};
+  uint32_t indexCount{};
+  float error{};
+  uint32_t reserved{};
+};
+
+struct packed_mesh_record {
+  uint64_t positionOffset{};
+  uint64_t normalOffset{};
+  uint64_t indexOffset{};
+  uint32_t vertexCount{};
+  uint32_t indexCount{};
+  // 2 or 4, chosen per mesh from the vertex count
+  uint32_t indexSize{};
+  float boundsMin[3]{};
+  float boundsMax[3]{};
+  // explicit padding, so the written blob holds no indeterminate bytes
+  uint32_t reserved0{};
+  uint64_t lodOffset{};
+  uint32_t lodCount{};
+  uint32_t reserved1{};
+};
+static_assert(sizeof(packed_mesh_record) == 80);
+
+// Mesh data on the cooking side, de-interleaved and with 32-bit indices.
+struct source_mesh {
+  std::vector<std::array<float, 3>> positions;
+  std::vector<std::array<float, 3>> normals;
+  std::vector<uint32_t> indices;
+  // empty means a single LOD covering all of indices
+  std::vector<mesh_lod> lods;
+};
+
+// Upload-ready ranges of one cooked mesh, pointing into the mapped blob.
+struct packed_mesh_view {
+  array_view<std::byte> positions;
+  array_view<std::byte> normals;
+  array_view<std::byte> indices;
+  uint32_t vertexCount{};
+  uint32_t indexCount{};
+  uint32_t indexSize{};
+  array_view<mesh_lod> lods;
+  std::array<float, 3> boundsMin{};
+  std::array<float, 3> boundsMax{};
+};
+
+inline std::vector<std::byte> cook_packed_meshes(
+    const std::vector<source_mesh>& meshes) {
+  std::vector<std::byte> blob;
+  auto align = [&] {
+    blob.resize(
+        (blob.size() + packed_mesh_stream_alignment - 1) /
+        packed_mesh_stream_alignment * packed_mesh_stream_alignment);
+  };
+  auto append = [&](const void* data, size_t size) {
+    align();
+    auto offset = blob.size();
+    blob.resize(offset + size);
+    if (size > 0) {
+      std::memcpy(blob.data() + offset, data, size);
+    }
+    return static_cast<uint64_t>(offset);
+  };
+
+  packed_mesh_header header{};
+  header.meshCount = static_cast<uint32_t>(meshes.size());
+  std::vector<packed_mesh_record> records(meshes.size());
+  blob.resize(sizeof(header) + sizeof(packed_mesh_record) * records.size());
+
+  for (size_t i{}; i < meshes.size(); ++i) {
+    auto& mesh = meshes[i];
+    auto& record = records[i];
+    if (mesh.normals.size() != mesh.positions.size()) {
+      throw std::runtime_error{"Mesh positions and normals differ in count"};
+    }
+    record.vertexCount = static_cast<uint32_t>(mesh.positions.size());
+    record.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    record.positionOffset = append(
+        mesh.positions.data(), mesh.positions.size() * sizeof(float) * 3);
+    record.normalOffset = append(
+        mesh.normals.data(), mesh.normals.size() * sizeof(float) * 3);
+
+    if (record.vertexCount <= std::numeric_limits<uint16_t>::max()) {
+      record.indexSize = 2;
+      std::vector<uint16_t> shortIndices(
+          mesh.indices.begin(), mesh.indices.end());
+      record.indexOffset = append(
+          shortIndices.data(), shortIndices.size() * sizeof(uint16_t));
+    } else {
+      record.indexSize = 4;
+      record.indexOffset =
+          append(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+    }
+
+    auto lods = mesh.lods;
+    if (lods.empty()) {
+      lods.push_back({0, record.indexCount, 0.f});
+    }
+    record.lodCount = static_cast<uint32_t>(lods.size());
+    record.lodOffset = append(lods.data(), lods.size() * sizeof(mesh_lod));
+
+    std::fill_n(record.boundsMin, 3, std::numeric_limits<float>::max());
+    std::fill_n(record.boundsMax, 3, std::numeric_limits<float>::lowest());
+    for (auto& position : mesh.positions) {
+      for (int axis{}; axis < 3; ++axis) {
+        auto& low = record.boundsMin[axis];
+        auto& high = record.boundsMax[axis];
+        low = std::min(low, position[axis]);
+        high = std::max(high, position[axis]);
+      }
+    }
+  }
+  align();
+
+  std::memcpy(blob.data(), &header, sizeof(header));
+  if (!records.empty()) {
+    std::memcpy(
+        blob.data() + sizeof(header),
+        records.data(),
+        records.size() * sizeof(packed_mesh_record));
+  }
+  return blob;
+}
+
+inline void write_packed_meshes(
+    const std::string& path,
+    const std::vector<source_mesh>& meshes) {
+  auto blob = cook_packed_meshes(meshes);
+  std::ofstream out{path, std::ios::binary};
+  out.write(reinterpret_cast<const char*>(blob.data()), blob.size());
+  if (!out) {
+    throw std::runtime_error{"Unable to write " + path};
+  }
+}
+
+// Maps a cooked blob; mesh(i) hands out ranges ready to copy into staging
+// memory with no parsing or conversion.
+struct packed_mesh_file {
+  packed_mesh_file(const std::string& path) : m_file(path) {
+    auto bytes = m_file.bytes();
+    if (bytes.size() < sizeof(packed_mesh_header)) {
+      throw std::runtime_error{"Packed mesh file is truncated"};
+    }
+    std::memcpy(&m_header, bytes.data(), sizeof(m_header));
+    if (m_header.magic != packed_mesh_magic) {
+      throw std::runtime_error{"Not a packed mesh file"};
+    }
+    if (m_header.version != packed_mesh_version) {
+      throw std::runtime_error{"Packed mesh version mismatch; re-cook assets"};
+    }
+    auto records = bytes.subview(
+        sizeof(packed_mesh_header),
+        sizeof(packed_mesh_record) * m_header.meshCount);
+    m_records.resize(m_header.meshCount);
+    std::memcpy(m_records.data(), records.data(), records.size());
+  }
+
+  size_t mesh_count() const { return m_records.size(); }
+
+  packed_mesh_view mesh(size_t index) const {
+    auto& record = m_records.at(index);
+    auto bytes = m_file.bytes();
+    packed_mesh_view view{};
+    view.vertexCount = record.vertexCount;
+    view.indexCount = record.indexCount;
+    view.indexSize = record.indexSize;
+    size_t streamSize = size_t{record.vertexCount} * sizeof(float) * 3;
+    view.positions = bytes.subview(record.positionOffset, streamSize);
+    view.normals = bytes.subview(record.normalOffset, streamSize);
+    view.indices = bytes.subview(
+        record.indexOffset, size_t{record.indexCount} * record.indexSize);
+    // streams are 16-byte aligned within a page-aligned mapping, so the LOD
+    // table can be viewed in place
+    auto lods = bytes.subview(
+        record.lodOffset, size_t{record.lodCount} * sizeof(mesh_lod));
+    view.lods = {
+        reinterpret_cast<const mesh_lod*>(lods.data()), record.lodCount};
+    std::copy_n(record.boundsMin, 3, view.boundsMin.begin());
+    std::copy_n(record.boundsMax, 3, view.boundsMax.begin());
+    return view;
+  }
+
+private:
+  mapped_file m_file;
+  packed_mesh_header m_header{};
+  std::vector<packed_mesh_record> m_records{};
+};
\ No newline at end of file
@@ -0,0 +1,300 @@
+#include "bench.hpp"
+#include "headless_vulkan.hpp"
+#include "mapped_file.hpp"
+#include "parallel_recorder.hpp"
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records the triangle pipeline's draws into a headless render pass, e.g.
+// on lavapipe. Run from the directory holding triangle.vert.spv and
+// triangle.frag.spv. Only recording is timed; nothing is submitted.
+
+constexpr uint32_t targetSize = 256;
+
+struct bench_target {
+  headless_vulkan& vk;
+  VkImage image{};
+  VmaAllocation imageAllocation{};
+  VkImageView view{};
+  VkRenderPass renderPass{};
+  VkFramebuffer framebuffer{};
+  VkPipelineLayout layout{};
+  VkPipeline pipeline{};
+  VkBuffer vertices{};
+  VmaAllocation verticesAllocation{};
+
+  bench_target(headless_vulkan& vk, size_t drawCount) : vk(vk) {
+    VkImageCreateInfo imageInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    imageInfo.extent = {targetSize, targetSize, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    VmaAllocationCreateInfo allocationInfo{};
+    allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    vmaCreateImage(
+        vk.allocator,
+        &imageInfo,
+        &allocationInfo,
+        &image,
+        &imageAllocation,
+        nullptr);
+
+    VkImageViewCreateInfo viewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = imageInfo.format;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCreateImageView(vk.device, &viewInfo, nullptr, &view);
+
+    VkAttachmentDescription attachment{};
+    attachment.format = imageInfo.format;
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    VkAttachmentReference colorReference{
+        0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorReference;
+    VkRenderPassCreateInfo renderPassInfo{
+        VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &attachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    vkCreateRenderPass(vk.device, &renderPassInfo, nullptr, &renderPass);
+
+    VkFramebufferCreateInfo framebufferInfo{
+        VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = &view;
+    framebufferInfo.width = targetSize;
+    framebufferInfo.height = targetSize;
+    framebufferInfo.layers = 1;
+    vkCreateFramebuffer(vk.device, &framebufferInfo, nullptr, &framebuffer);
+
+    VkPipelineLayoutCreateInfo layoutInfo{
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    vkCreatePipelineLayout(vk.device, &layoutInfo, nullptr, &layout);
+    create_pipeline();
+
+    // each draw reads its own triangle: positions, then colors
+    VkBufferCreateInfo bufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    bufferInfo.size = drawCount * 3 * (12 + 16);
+    bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    vmaCreateBuffer(
+        vk.allocator,
+        &bufferInfo,
+        &allocationInfo,
+        &vertices,
+        &verticesAllocation,
+        nullptr);
+  }
+
+  ~bench_target() {
+    vmaDestroyBuffer(vk.allocator, vertices, verticesAllocation);
+    vkDestroyPipeline(vk.device, pipeline, nullptr);
+    vkDestroyPipelineLayout(vk.device, layout, nullptr);
+    vkDestroyFramebuffer(vk.device, framebuffer, nullptr);
+    vkDestroyRenderPass(vk.device, renderPass, nullptr);
+    vkDestroyImageView(vk.device, view, nullptr);
+    vmaDestroyImage(vk.allocator, image, imageAllocation);
+  }
+
+private:
+  VkShaderModule load_shader(const char* path) {
+    mapped_file code{path};
+    VkShaderModuleCreateInfo moduleInfo{
+        VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+    moduleInfo.codeSize = code.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.bytes().data());
+    VkShaderModule module{};
+    vkCreateShaderModule(vk.device, &moduleInfo, nullptr, &module);
+    return module;
+  }
+
+  void create_pipeline() {
+    auto vertexShader = load_shader("triangle.vert.spv");
+    auto fragmentShader = load_shader("triangle.frag.spv");
+    VkPipelineShaderStageCreateInfo stages[2]{};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vertexShader;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = fragmentShader;
+    stages[1].pName = "main";
+
+    VkVertexInputBindingDescription bindings[2]{
+        {0, 12, VK_VERTEX_INPUT_RATE_VERTEX},
+        {1, 16, VK_VERTEX_INPUT_RATE_VERTEX}};
+    VkVertexInputAttributeDescription attributes[2]{
+        {0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0},
+        {1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 0}};
+    VkPipelineVertexInputStateCreateInfo vertexInput{
+        VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+    vertexInput.vertexBindingDescriptionCount = 2;
+    vertexInput.pVertexBindingDescriptions = bindings;
+    vertexInput.vertexAttributeDescriptionCount = 2;
+    vertexInput.pVertexAttributeDescriptions = attributes;
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{
+        VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkViewport viewport{0.f, 0.f, targetSize, targetSize, 0.f, 1.f};
+    VkRect2D scissor{{0, 0}, {targetSize, targetSize}};
+    VkPipelineViewportStateCreateInfo viewportState{
+        VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+    viewportState.viewportCount = 1;
+    viewportState.pViewports = &viewport;
+    viewportState.scissorCount = 1;
+    viewportState.pScissors = &scissor;
+    VkPipelineRasterizationStateCreateInfo rasterization{
+        VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
+    rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterization.cullMode = VK_CULL_MODE_NONE;
+    rasterization.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    rasterization.lineWidth = 1.f;
+    VkPipelineMultisampleStateCreateInfo multisample{
+        VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    VkPipelineColorBlendAttachmentState blendAttachment{};
+    blendAttachment.colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    VkPipelineColorBlendStateCreateInfo colorBlend{
+        VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO};
+    colorBlend.attachmentCount = 1;
+    colorBlend.pAttachments = &blendAttachment;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{
+        VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = stages;
+    pipelineInfo.pVertexInputState = &vertexInput;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterization;
+    pipelineInfo.pMultisampleState = &multisample;
+    pipelineInfo.pColorBlendState = &colorBlend;
+    pipelineInfo.layout = layout;
+    pipelineInfo.renderPass = renderPass;
+    vkCreateGraphicsPipelines(
+        vk.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+    vkDestroyShaderModule(vk.device, vertexShader, nullptr);
+    vkDestroyShaderModule(vk.device, fragmentShader, nullptr);
+  }
+};
+
+int main() {
+  auto vk = headless_vulkan::create();
+  if (!vk) {
+    std::printf(
+        "No Vulkan device; set VK_ICD_FILENAMES to lavapipe to run this\n");
+    return 0;
+  }
+  try {
+    mapped_file{"triangle.vert.spv"};
+    mapped_file{"triangle.frag.spv"};
+  } catch (const std::exception& error) {
+    std::printf("%s; run from the compiled shaders' directory\n", error.what());
+    return 0;
+  }
+  size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+  VkCommandPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  poolInfo.queueFamilyIndex = vk->graphicsFamily;
+  VkCommandPool pool{};
+  vkCreateCommandPool(vk->device, &poolInfo, nullptr, &pool);
+  VkCommandBufferAllocateInfo allocateInfo{
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+  allocateInfo.commandPool = pool;
+  allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocateInfo.commandBufferCount = 1;
+  VkCommandBuffer primary{};
+  vkAllocateCommandBuffers(vk->device, &allocateInfo, &primary);
+
+  for (size_t drawCount : {10000, 50000}) {
+    bench_target target{*vk, drawCount};
+    // one vertex buffer binding pair and draw per object, as a scene's
+    // draw list would record them
+    auto recordDraws = [&](VkCommandBuffer cmd, size_t begin, size_t end) {
+      vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, target.pipeline);
+      for (auto draw = begin; draw < end; ++draw) {
+        VkBuffer buffers[2]{target.vertices, target.vertices};
+        VkDeviceSize offsets[2]{draw * 3 * 12,
+                                drawCount * 3 * 12 + draw * 3 * 16};
+        vkCmdBindVertexBuffers(cmd, 0, 2, buffers, offsets);
+        vkCmdDraw(cmd, 3, 1, 0, 0);
+      }
+    };
+    VkClearValue clearValue{};
+    VkRenderPassBeginInfo renderBeginInfo{
+        VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+    renderBeginInfo.renderPass = target.renderPass;
+    renderBeginInfo.framebuffer = target.framebuffer;
+    renderBeginInfo.renderArea.extent = {targetSize, targetSize};
+    renderBeginInfo.clearValueCount = 1;
+    renderBeginInfo.pClearValues = &clearValue;
+    VkCommandBufferBeginInfo beginInfo{
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+
+    run_benchmark(
+        ("inline " + std::to_string(drawCount) + " draws").c_str(),
+        drawCount,
+        [&] {
+          vkResetCommandBuffer(primary, 0);
+          vkBeginCommandBuffer(primary, &beginInfo);
+          vkCmdBeginRenderPass(
+              primary, &renderBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+          recordDraws(primary, 0, drawCount);
+          vkCmdEndRenderPass(primary);
+          vkEndCommandBuffer(primary);
+        });
+    for (size_t threadCount{1}; threadCount <= maxThreads;
+         threadCount = threadCount == maxThreads
+                           ? maxThreads + 1
+                           : std::min(threadCount * 2, maxThreads)) {
+      worker_pool workers{threadCount - 1};
+      parallel_recorder recorder{vk->device, vk->graphicsFamily, 1, workers};
+      run_benchmark(
+          ("secondary " + std::to_string(drawCount) + " draws x" +
+           std::to_string(threadCount))
+              .c_str(),
+          drawCount,
+          [&] {
+            vkResetCommandBuffer(primary, 0);
+            vkBeginCommandBuffer(primary, &beginInfo);
+            vkCmdBeginRenderPass(
+                primary,
+                &renderBeginInfo,
+                VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            recorder.record(
+                primary,
+                0,
+                target.renderPass,
+                0,
+                target.framebuffer,
+                drawCount,
+                recordDraws);
+            vkCmdEndRenderPass(primary);
+            vkEndCommandBuffer(primary);
+          });
+    }
+  }
+  vkDestroyCommandPool(vk->device, pool, nullptr);
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include "worker_pool.hpp"
+#include <memory_allocator.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Records a render pass's draws in parallel. The draw list is cut into one
+// slice per worker_pool thread, each slice is recorded into a secondary
+// command buffer, and the primary executes them in order. Every slice has a
+// command pool of its own for each frame in flight, so threads never share a
+// pool and a frame's pools are reset wholesale instead of per buffer.
+struct parallel_recorder {
+  // slices are not cut smaller than this, since below it the cost of an
+  // extra secondary buffer outweighs the recording it offloads
+  static constexpr size_t min_slice_draws = 256;
+
+  parallel_recorder(
+      VkDevice device,
+      uint32_t queueFamilyIndex,
+      size_t frameCount,
+      worker_pool& workers)
+      : m_device(device), m_workers(workers), m_sliceCount(workers.width()) {
+    m_pools.resize(frameCount * m_sliceCount);
+    m_commandBuffers.resize(m_pools.size());
+    m_results.resize(m_sliceCount);
+    for (size_t i{}; i < m_pools.size(); ++i) {
+      VkCommandPoolCreateInfo poolInfo{
+          VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+      poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+      poolInfo.queueFamilyIndex = queueFamilyIndex;
+      check(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_pools[i]));
+      VkCommandBufferAllocateInfo allocateInfo{
+          VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+      allocateInfo.commandPool = m_pools[i];
+      allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+      allocateInfo.commandBufferCount = 1;
+      check(vkAllocateCommandBuffers(
+          m_device, &allocateInfo, &m_commandBuffers[i]));
+    }
+  }
+
+  parallel_recorder(const parallel_recorder&) = delete;
+  parallel_recorder& operator=(const parallel_recorder&) = delete;
+
+  ~parallel_recorder() {
+    for (auto pool : m_pools) {
+      if (pool) {
+        vkDestroyCommandPool(m_device, pool, nullptr);
+      }
+    }
+  }
+
+  // Records draws [0, drawCount) for frame by calling record(cmd, begin,
+  // end) for each slice on the pool's threads, then executes the slices
+  // from primary. primary must be inside subpass of renderPass, begun with
+  // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS; secondaries inherit no
+  // state, so record binds its own pipeline. record must not throw. The
+  // frame's previous submission must have completed, as its pools are
+  // reset.
+  template <typename Fn>
+  void record(
+      VkCommandBuffer primary,
+      size_t frame,
+      VkRenderPass renderPass,
+      uint32_t subpass,
+      VkFramebuffer framebuffer,
+      size_t drawCount,
+      Fn&& record) {
+    if (drawCount == 0) {
+      return;
+    }
+    auto sliceCount = std::min(
+        m_sliceCount, (drawCount + min_slice_draws - 1) / min_slice_draws);
+    auto first = frame * m_sliceCount;
+    VkCommandBufferInheritanceInfo inheritance{
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+    inheritance.renderPass = renderPass;
+    inheritance.subpass = subpass;
+    inheritance.framebuffer = framebuffer;
+
+    m_workers.parallel_for(sliceCount, 1, [&](size_t begin, size_t end) {
+      for (auto slice = begin; slice < end; ++slice) {
+        m_results[slice] = record_slice(
+            first + slice,
+            inheritance,
+            drawCount * slice / sliceCount,
+            drawCount * (slice + 1) / sliceCount,
+            record);
+      }
+    });
+    for (size_t slice{}; slice < sliceCount; ++slice) {
+      check(m_results[slice]);
+    }
+    vkCmdExecuteCommands(
+        primary,
+        static_cast<uint32_t>(sliceCount),
+        m_commandBuffers.data() + first);
+  }
+
+  // most secondary command buffers one record() executes
+  size_t max_slices() const { return m_sliceCount; }
+
+private:
+  VkDevice m_device{};
+  worker_pool& m_workers;
+  size_t m_sliceCount{};
+  // indexed by frame * m_sliceCount + slice
+  std::vector<VkCommandPool> m_pools{};
+  std::vector<VkCommandBuffer> m_commandBuffers{};
+  std::vector<VkResult> m_results{};
+
+  static void check(VkResult result) {
+    if (result != VK_SUCCESS) {
+      throw std::runtime_error{
+          "Parallel recording Vulkan call failed: " +
+          std::to_string(static_cast<int>(result))};
+    }
+  }
+
+  template <typename Fn>
+  VkResult record_slice(
+      size_t index,
+      const VkCommandBufferInheritanceInfo& inheritance,
+      size_t begin,
+      size_t end,
+      Fn& record) {
+    auto cmd = m_commandBuffers[index];
+    if (auto result = vkResetCommandPool(m_device, m_pools[index], 0);
+        result != VK_SUCCESS) {
+      return result;
+    }
+    VkCommandBufferBeginInfo beginInfo{
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT |
+                      VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+    if (auto result = vkBeginCommandBuffer(cmd, &beginInfo);
+        result != VK_SUCCESS) {
+      return result;
+    }
+    record(cmd, begin, end);
+    return vkEndCommandBuffer(cmd);
+  }
+};
@@ -0,0 +1,266 @@
+#include "headless_vulkan.hpp"
+#include "parallel_recorder.hpp"
+#include <catch2/catch.hpp>
+
+namespace {
+constexpr uint32_t targetSize = 64;
+
+// Color attachment, render pass and host-visible copy of the result.
+struct clear_target {
+  headless_vulkan& vk;
+  VkImage image{};
+  VmaAllocation imageAllocation{};
+  VkImageView view{};
+  VkRenderPass renderPass{};
+  VkFramebuffer framebuffer{};
+  VkBuffer readback{};
+  VmaAllocation readbackAllocation{};
+  const uint32_t* pixels{};
+
+  explicit clear_target(headless_vulkan& vk) : vk(vk) {
+    VkImageCreateInfo imageInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R8G8B8A8_UINT;
+    imageInfo.extent = {targetSize, targetSize, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                      VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    VmaAllocationCreateInfo imageAllocationInfo{};
+    imageAllocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    vmaCreateImage(
+        vk.allocator,
+        &imageInfo,
+        &imageAllocationInfo,
+        &image,
+        &imageAllocation,
+        nullptr);
+
+    VkImageViewCreateInfo viewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = imageInfo.format;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCreateImageView(vk.device, &viewInfo, nullptr, &view);
+
+    VkAttachmentDescription attachment{};
+    attachment.format = imageInfo.format;
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    VkAttachmentReference colorReference{
+        0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorReference;
+    // orders the attachment writes before the copy out
+    VkSubpassDependency dependency{};
+    dependency.srcSubpass = 0;
+    dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    VkRenderPassCreateInfo renderPassInfo{
+        VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &attachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = 1;
+    renderPassInfo.pDependencies = &dependency;
+    vkCreateRenderPass(vk.device, &renderPassInfo, nullptr, &renderPass);
+
+    VkFramebufferCreateInfo framebufferInfo{
+        VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = &view;
+    framebufferInfo.width = targetSize;
+    framebufferInfo.height = targetSize;
+    framebufferInfo.layers = 1;
+    vkCreateFramebuffer(vk.device, &framebufferInfo, nullptr, &framebuffer);
+
+    VkBufferCreateInfo bufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    bufferInfo.size = targetSize * targetSize * 4;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    VmaAllocationCreateInfo bufferAllocationInfo{};
+    bufferAllocationInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+    bufferAllocationInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    VmaAllocationInfo mapping{};
+    vmaCreateBuffer(
+        vk.allocator,
+        &bufferInfo,
+        &bufferAllocationInfo,
+        &readback,
+        &readbackAllocation,
+        &mapping);
+    pixels = static_cast<const uint32_t*>(mapping.pMappedData);
+  }
+
+  ~clear_target() {
+    vmaDestroyBuffer(vk.allocator, readback, readbackAllocation);
+    vkDestroyFramebuffer(vk.device, framebuffer, nullptr);
+    vkDestroyRenderPass(vk.device, renderPass, nullptr);
+    vkDestroyImageView(vk.device, view, nullptr);
+    vmaDestroyImage(vk.allocator, image, imageAllocation);
+  }
+};
+
+// Each "draw" clears one pixel to a value identifying the draw and its
+// slice, which is all the recording path needs without a pipeline.
+uint32_t pixel_value(size_t draw, size_t sliceBegin, uint32_t frameTag) {
+  return static_cast<uint32_t>(draw & 0xfff) |
+         static_cast<uint32_t>((sliceBegin & 0xfff) << 12) | frameTag << 24;
+}
+
+void record_clears(
+    VkCommandBuffer cmd,
+    size_t begin,
+    size_t end,
+    uint32_t frameTag) {
+  for (auto draw = begin; draw < end; ++draw) {
+    VkClearAttachment clear{};
+    clear.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    auto value = pixel_value(draw, begin, frameTag);
+    clear.clearValue.color.uint32[0] = value & 0xff;
+    clear.clearValue.color.uint32[1] = (value >> 8) & 0xff;
+    clear.clearValue.color.uint32[2] = (value >> 16) & 0xff;
+    clear.clearValue.color.uint32[3] = value >> 24;
+    VkClearRect rect{};
+    rect.rect.offset = {static_cast<int32_t>(draw % targetSize),
+                        static_cast<int32_t>(draw / targetSize)};
+    rect.rect.extent = {1, 1};
+    rect.layerCount = 1;
+    vkCmdClearAttachments(cmd, 1, &clear, 1, &rect);
+  }
+}
+}  // namespace
+
+TEST_CASE("Parallel recording executes every slice in order") {
+  auto vk = headless_vulkan::create();
+  if (!vk) {
+    WARN("No Vulkan device; set VK_ICD_FILENAMES to lavapipe to run this");
+    return;
+  }
+  clear_target target{*vk};
+  worker_pool workers{3};
+  parallel_recorder recorder{vk->device, vk->graphicsFamily, 2, workers};
+  REQUIRE(recorder.max_slices() == 4);
+
+  VkCommandPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  poolInfo.queueFamilyIndex = vk->graphicsFamily;
+  VkCommandPool pool{};
+  vkCreateCommandPool(vk->device, &poolInfo, nullptr, &pool);
+  VkCommandBufferAllocateInfo allocateInfo{
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+  allocateInfo.commandPool = pool;
+  allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocateInfo.commandBufferCount = 1;
+  VkCommandBuffer primary{};
+  vkAllocateCommandBuffers(vk->device, &allocateInfo, &primary);
+
+  // records drawCount clears through the recorder, submits them and copies
+  // the target into the readback buffer
+  auto drawFrame = [&](size_t frame, size_t drawCount, uint32_t frameTag) {
+    VkCommandBufferBeginInfo beginInfo{
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    vkBeginCommandBuffer(primary, &beginInfo);
+    VkClearValue clearValue{};
+    VkRenderPassBeginInfo renderBeginInfo{
+        VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+    renderBeginInfo.renderPass = target.renderPass;
+    renderBeginInfo.framebuffer = target.framebuffer;
+    renderBeginInfo.renderArea.extent = {targetSize, targetSize};
+    renderBeginInfo.clearValueCount = 1;
+    renderBeginInfo.pClearValues = &clearValue;
+    vkCmdBeginRenderPass(
+        primary,
+        &renderBeginInfo,
+        VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    recorder.record(
+        primary,
+        frame,
+        target.renderPass,
+        0,
+        target.framebuffer,
+        drawCount,
+        [&](VkCommandBuffer cmd, size_t begin, size_t end) {
+          record_clears(cmd, begin, end, frameTag);
+        });
+    vkCmdEndRenderPass(primary);
+    VkBufferImageCopy region{};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = {targetSize, targetSize, 1};
+    vkCmdCopyImageToBuffer(
+        primary,
+        target.image,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        target.readback,
+        1,
+        &region);
+    VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(
+        primary,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+    vkEndCommandBuffer(primary);
+    VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &primary;
+    vkQueueSubmit(vk->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    vkQueueWaitIdle(vk->graphicsQueue);
+  };
+
+  // every draw's pixel carries its own slice's start, and nothing else
+  // was drawn
+  auto check = [&](size_t drawCount, size_t sliceCount, uint32_t frameTag) {
+    for (size_t slice{}; slice < sliceCount; ++slice) {
+      auto begin = drawCount * slice / sliceCount;
+      auto end = drawCount * (slice + 1) / sliceCount;
+      for (auto draw = begin; draw < end; ++draw) {
+        REQUIRE(target.pixels[draw] == pixel_value(draw, begin, frameTag));
+      }
+    }
+    for (auto pixel = drawCount; pixel < targetSize * targetSize; ++pixel) {
+      REQUIRE(target.pixels[pixel] == 0);
+    }
+  };
+
+  SECTION("A full draw list uses every slice") {
+    drawFrame(0, targetSize * targetSize, 1);
+    check(targetSize * targetSize, 4, 1);
+    // the other frame's pools, then this frame's again after a reset
+    drawFrame(1, 3000, 2);
+    check(3000, 4, 2);
+    drawFrame(0, 1000, 3);
+    check(1000, 4, 3);
+  }
+  SECTION("Short draw lists use fewer slices") {
+    drawFrame(0, parallel_recorder::min_slice_draws * 2 - 1, 4);
+    check(parallel_recorder::min_slice_draws * 2 - 1, 2, 4);
+    drawFrame(1, 10, 5);
+    check(10, 1, 5);
+    drawFrame(0, 0, 6);
+    check(0, 1, 6);
+  }
+
+  vkDestroyCommandPool(vk->device, pool, nullptr);
+}
@@ -0,0 +1,245 @@
+#include "headless_vulkan.hpp"
+#include "mapped_file.hpp"
+#include "pipeline_cache.hpp"
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Pipeline creation time with an empty pipeline cache and with the cache
+// the first run saved to disk, e.g. on lavapipe. Builds the triangle
+// shaders with every combination of cull mode, blending and depth test;
+// run from the compiled shaders' directory.
+
+constexpr const char* cachePath = "pipeline_cache.bench.bin";
+
+struct variant {
+  std::string name;
+  VkCullModeFlags cullMode;
+  bool blend;
+  bool depthTest;
+};
+
+std::vector<variant> variants() {
+  std::vector<variant> result{};
+  std::pair<VkCullModeFlags, const char*> cullModes[]{
+      {VK_CULL_MODE_NONE, "none"},
+      {VK_CULL_MODE_BACK_BIT, "back"},
+      {VK_CULL_MODE_FRONT_BIT, "front"}};
+  for (auto [cullMode, cullName] : cullModes) {
+    for (bool blend : {false, true}) {
+      for (bool depthTest : {false, true}) {
+        result.push_back(
+            {std::string{"cull "} + cullName + (blend ? " blend" : "") +
+                 (depthTest ? " depth" : ""),
+             cullMode,
+             blend,
+             depthTest});
+      }
+    }
+  }
+  return result;
+}
+
+struct pipeline_inputs {
+  VkDevice device{};
+  VkShaderModule vertexShader{};
+  VkShaderModule fragmentShader{};
+  VkPipelineLayout layout{};
+  VkRenderPass renderPass{};
+
+  explicit pipeline_inputs(VkDevice device) : device(device) {
+    vertexShader = load_shader("triangle.vert.spv");
+    fragmentShader = load_shader("triangle.frag.spv");
+    VkPipelineLayoutCreateInfo layoutInfo{
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    vkCreatePipelineLayout(device, &layoutInfo, nullptr, &layout);
+
+    VkAttachmentDescription attachment{};
+    attachment.format = VK_FORMAT_R8G8B8A8_UNORM;
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    VkAttachmentReference colorReference{
+        0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorReference;
+    VkRenderPassCreateInfo renderPassInfo{
+        VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &attachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass);
+  }
+
+  pipeline_inputs(const pipeline_inputs&) = delete;
+  pipeline_inputs& operator=(const pipeline_inputs&) = delete;
+
+  ~pipeline_inputs() {
+    vkDestroyRenderPass(device, renderPass, nullptr);
+    vkDestroyPipelineLayout(device, layout, nullptr);
+    vkDestroyShaderModule(device, fragmentShader, nullptr);
+    vkDestroyShaderModule(device, vertexShader, nullptr);
+  }
+
+  VkPipeline create(VkPipelineCache cache, const variant& v) const {
+    VkPipelineShaderStageCreateInfo stages[2]{};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vertexShader;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = fragmentShader;
+    stages[1].pName = "main";
+
+    VkVertexInputBindingDescription bindings[2]{
+        {0, 12, VK_VERTEX_INPUT_RATE_VERTEX},
+        {1, 16, VK_VERTEX_INPUT_RATE_VERTEX}};
+    VkVertexInputAttributeDescription attributes[2]{
+        {0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0},
+        {1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 0}};
+    VkPipelineVertexInputStateCreateInfo vertexInput{
+        VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+    vertexInput.vertexBindingDescriptionCount = 2;
+    vertexInput.pVertexBindingDescriptions = bindings;
+    vertexInput.vertexAttributeDescriptionCount = 2;
+    vertexInput.pVertexAttributeDescriptions = attributes;
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{
+        VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPipelineViewportStateCreateInfo viewportState{
+        VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+    VkPipelineRasterizationStateCreateInfo rasterization{
+        VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
+    rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterization.cullMode = v.cullMode;
+    rasterization.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    rasterization.lineWidth = 1.f;
+    VkPipelineMultisampleStateCreateInfo multisample{
+        VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    VkPipelineDepthStencilStateCreateInfo depthStencil{
+        VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+    depthStencil.depthTestEnable = v.depthTest;
+    depthStencil.depthWriteEnable = v.depthTest;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    VkPipelineColorBlendAttachmentState blendAttachment{};
+    blendAttachment.blendEnable = v.blend;
+    blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    blendAttachment.colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    VkPipelineColorBlendStateCreateInfo colorBlend{
+        VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO};
+    colorBlend.attachmentCount = 1;
+    colorBlend.pAttachments = &blendAttachment;
+    VkDynamicState dynamicStates[]{
+        VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{
+        VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{
+        VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = stages;
+    pipelineInfo.pVertexInputState = &vertexInput;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterization;
+    pipelineInfo.pMultisampleState = &multisample;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlend;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = layout;
+    pipelineInfo.renderPass = renderPass;
+    VkPipeline pipeline{};
+    vkCreateGraphicsPipelines(
+        device, cache, 1, &pipelineInfo, nullptr, &pipeline);
+    return pipeline;
+  }
+
+private:
+  VkShaderModule load_shader(const char* path) {
+    mapped_file code{path};
+    VkShaderModuleCreateInfo moduleInfo{
+        VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+    moduleInfo.codeSize = code.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.bytes().data());
+    VkShaderModule module{};
+    vkCreateShaderModule(device, &moduleInfo, nullptr, &module);
+    return module;
+  }
+};
+
+// Builds every variant through a cache loaded from cachePath, then saves it.
+std::vector<pipeline_build_time> build_all(
+    headless_vulkan& vk,
+    const pipeline_inputs& inputs,
+    pipeline_cache_state& state) {
+  pipeline_cache cache{vk.physicalDevice, vk.device, cachePath};
+  state = cache.state();
+  for (auto& v : variants()) {
+    auto pipeline = cache.timed(v.name, [&](VkPipelineCache handle) {
+      return inputs.create(handle, v);
+    });
+    vkDestroyPipeline(vk.device, pipeline, nullptr);
+  }
+  cache.save();
+  return cache.build_times();
+}
+
+int main() {
+  auto vk = headless_vulkan::create();
+  if (!vk) {
+    std::printf(
+        "No Vulkan device; set VK_ICD_FILENAMES to lavapipe to run this\n");
+    return 0;
+  }
+  try {
+    mapped_file{"triangle.vert.spv"};
+    mapped_file{"triangle.frag.spv"};
+  } catch (const std::exception& error) {
+    std::printf("%s; run from the compiled shaders' directory\n", error.what());
+    return 0;
+  }
+  pipeline_inputs inputs{vk->device};
+  std::remove(cachePath);
+  pipeline_cache_state coldState{};
+  pipeline_cache_state warmState{};
+  auto cold = build_all(*vk, inputs, coldState);
+  auto warm = build_all(*vk, inputs, warmState);
+  if (coldState != pipeline_cache_state::cold ||
+      warmState != pipeline_cache_state::warm) {
+    std::printf("Saved cache was not reloaded warm\n");
+    return 1;
+  }
+
+  std::printf("%-24s %10s %10s\n", "pipeline", "cold ms", "warm ms");
+  double coldTotal{};
+  double warmTotal{};
+  for (size_t i{}; i < cold.size(); ++i) {
+    std::printf(
+        "%-24s %10.3f %10.3f\n", cold[i].name.c_str(), cold[i].ms, warm[i].ms);
+    coldTotal += cold[i].ms;
+    warmTotal += warm[i].ms;
+  }
+  std::printf("%-24s %10.3f %10.3f\n", "total", coldTotal, warmTotal);
+  std::remove(cachePath);
+}
@@ -0,0 +1,207 @@
+#pragma once
+#include "array_view.hpp"
+#include <memory_allocator.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+// Header the driver writes in front of the data returned by
+// vkGetPipelineCacheData (VK_PIPELINE_CACHE_HEADER_VERSION_ONE).
+struct pipeline_cache_header {
+  uint32_t headerSize;
+  uint32_t headerVersion;
+  uint32_t vendorID;
+  uint32_t deviceID;
+  uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+static_assert(sizeof(pipeline_cache_header) == 16 + VK_UUID_SIZE);
+
+// Whether a cache blob was written by this driver for this device. Drivers
+// must ignore foreign data themselves, but some have crashed on it, so it
+// is checked before it reaches the driver.
+inline bool pipeline_cache_compatible(
+    array_view<std::byte> blob,
+    const VkPhysicalDeviceProperties& properties) {
+  pipeline_cache_header header{};
+  if (blob.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, blob.data(), sizeof(header));
+  return header.headerSize >= sizeof(header) &&
+         header.headerSize <= blob.size() &&
+         header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == properties.vendorID &&
+         header.deviceID == properties.deviceID &&
+         std::memcmp(
+             header.pipelineCacheUUID,
+             properties.pipelineCacheUUID,
+             VK_UUID_SIZE) == 0;
+}
+
+enum class pipeline_cache_state {
+  // no cache file yet, e.g. the first launch
+  cold,
+  // created from the file on disk
+  warm,
+  // the file was for another device or driver version, or truncated
+  rejected
+};
+
+struct pipeline_build_time {
+  std::string name;
+  double ms;
+};
+
+// VkPipelineCache persisted at `path`. The constructor starts from the file
+// when its header matches the device; save() writes the cache back. Pass
+// handle() to every vkCreate*Pipelines call, or build through timed() to
+// also record how long each pipeline took, cold or warm.
+struct pipeline_cache {
+  pipeline_cache(
+      VkPhysicalDevice physicalDevice,
+      VkDevice device,
+      std::string path)
+      : m_device(device), m_path(std::move(path)) {
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    auto initialData = read_file(m_path);
+    VkPipelineCacheCreateInfo cacheInfo{
+        VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    if (!initialData) {
+      m_state = pipeline_cache_state::cold;
+    } else if (!pipeline_cache_compatible(
+                   {initialData->data(), initialData->size()}, properties)) {
+      m_state = pipeline_cache_state::rejected;
+    } else {
+      m_state = pipeline_cache_state::warm;
+      cacheInfo.initialDataSize = initialData->size();
+      cacheInfo.pInitialData = initialData->data();
+    }
+    check(vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &m_cache));
+  }
+
+  pipeline_cache(const pipeline_cache&) = delete;
+  pipeline_cache& operator=(const pipeline_cache&) = delete;
+
+  ~pipeline_cache() { vkDestroyPipelineCache(m_device, m_cache, nullptr); }
+
+  VkPipelineCache handle() const { return m_cache; }
+  operator VkPipelineCache() const { return m_cache; }
+  pipeline_cache_state state() const { return m_state; }
+  bool warm() const { return m_state == pipeline_cache_state::warm; }
+  const std::string& path() const { return m_path; }
+
+  // Calls build(handle()) and records its duration under name; returns
+  // what build returns. Safe to call from several threads at once, as
+  // Vulkan allows for the cache itself.
+  template <typename Fn>
+  auto timed(const std::string& name, Fn&& build) {
+    auto start = std::chrono::steady_clock::now();
+    auto result = build(m_cache);
+    std::lock_guard<std::mutex> lock{m_buildTimesMutex};
+    m_buildTimes.push_back(
+        {name,
+         std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+             .count()});
+    return result;
+  }
+
+  std::vector<pipeline_build_time> build_times() const {
+    std::lock_guard<std::mutex> lock{m_buildTimesMutex};
+    return m_buildTimes;
+  }
+
+  double total_build_ms() const {
+    std::lock_guard<std::mutex> lock{m_buildTimesMutex};
+    double total{};
+    for (auto& buildTime : m_buildTimes) {
+      total += buildTime.ms;
+    }
+    return total;
+  }
+
+  std::vector<std::byte> data() const {
+    size_t size{};
+    check(vkGetPipelineCacheData(m_device, m_cache, &size, nullptr));
+    std::vector<std::byte> result(size);
+    check(vkGetPipelineCacheData(m_device, m_cache, &size, result.data()));
+    result.resize(size);
+    return result;
+  }
+
+  // Writes the cache to a temporary file beside path and renames it into
+  // place, so a crash mid-write never leaves a torn cache for the next
+  // launch; at worst the old file survives.
+  void save() const {
+    auto blob = data();
+    auto temporaryPath = m_path + ".tmp";
+    {
+      std::ofstream out{temporaryPath, std::ios::binary | std::ios::trunc};
+      out.write(reinterpret_cast<const char*>(blob.data()), blob.size());
+      out.close();
+      if (!out) {
+        std::remove(temporaryPath.c_str());
+        throw std::runtime_error{"Unable to write " + temporaryPath};
+      }
+    }
+#ifdef _WIN32
+    auto replaced = MoveFileExA(
+                        temporaryPath.c_str(),
+                        m_path.c_str(),
+                        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) !=
+                    0;
+#else
+    auto replaced = std::rename(temporaryPath.c_str(), m_path.c_str()) == 0;
+#endif
+    if (!replaced) {
+      std::remove(temporaryPath.c_str());
+      throw std::runtime_error{"Unable to replace " + m_path};
+    }
+  }
+
+private:
+  VkDevice m_device{};
+  std::string m_path;
+  VkPipelineCache m_cache{};
+  pipeline_cache_state m_state{};
+  mutable std::mutex m_buildTimesMutex;
+  std::vector<pipeline_build_time> m_buildTimes{};
+
+  static void check(VkResult result) {
+    if (result != VK_SUCCESS) {
+      throw std::runtime_error{
+          "Pipeline cache Vulkan call failed: " +
+          std::to_string(static_cast<int>(result))};
+    }
+  }
+
+  static std::optional<std::vector<std::byte>> read_file(
+      const std::string& path) {
+    std::ifstream in{path, std::ios::binary | std::ios::ate};
+    if (!in) {
+      return {};
+    }
+    std::vector<std::byte> result(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(result.data()), result.size());
+    if (!in) {
+      return {};
+    }
+    return result;
+  }
+};
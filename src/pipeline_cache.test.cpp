@@ -0,0 +1,125 @@
+#include "headless_vulkan.hpp"
+#include "pipeline_cache.hpp"
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fstream>
+
+namespace {
+VkPhysicalDeviceProperties test_properties() {
+  VkPhysicalDeviceProperties properties{};
+  properties.vendorID = 0x10de;
+  properties.deviceID = 0x1234;
+  for (uint8_t i{}; i < VK_UUID_SIZE; ++i) {
+    properties.pipelineCacheUUID[i] = i;
+  }
+  return properties;
+}
+
+std::vector<std::byte> cache_blob(
+    const VkPhysicalDeviceProperties& properties,
+    size_t payload) {
+  pipeline_cache_header header{};
+  header.headerSize = sizeof(header);
+  header.headerVersion = VK_PIPELINE_CACHE_HEADER_VERSION_ONE;
+  header.vendorID = properties.vendorID;
+  header.deviceID = properties.deviceID;
+  std::memcpy(
+      header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+  std::vector<std::byte> blob(sizeof(header) + payload, std::byte{0x5a});
+  std::memcpy(blob.data(), &header, sizeof(header));
+  return blob;
+}
+
+void write_file(const std::string& path, const std::vector<std::byte>& data) {
+  std::ofstream out{path, std::ios::binary | std::ios::trunc};
+  out.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+bool file_exists(const std::string& path) {
+  return std::ifstream{path}.good();
+}
+} // namespace
+
+TEST_CASE("Pipeline cache header must match the device") {
+  auto properties = test_properties();
+  auto blob = cache_blob(properties, 64);
+  auto view = [&] { return array_view<std::byte>{blob.data(), blob.size()}; };
+  REQUIRE(pipeline_cache_compatible(view(), properties));
+
+  SECTION("Another vendor") {
+    properties.vendorID += 1;
+    REQUIRE_FALSE(pipeline_cache_compatible(view(), properties));
+  }
+  SECTION("Another device") {
+    properties.deviceID += 1;
+    REQUIRE_FALSE(pipeline_cache_compatible(view(), properties));
+  }
+  SECTION("Another driver build") {
+    properties.pipelineCacheUUID[VK_UUID_SIZE - 1] ^= 0xff;
+    REQUIRE_FALSE(pipeline_cache_compatible(view(), properties));
+  }
+  SECTION("Unknown header version") {
+    blob[4] = std::byte{2};
+    REQUIRE_FALSE(pipeline_cache_compatible(view(), properties));
+  }
+  SECTION("Header size past the end of the blob") {
+    uint32_t headerSize = static_cast<uint32_t>(blob.size() + 1);
+    std::memcpy(blob.data(), &headerSize, sizeof(headerSize));
+    REQUIRE_FALSE(pipeline_cache_compatible(view(), properties));
+  }
+  SECTION("Truncated") {
+    REQUIRE_FALSE(pipeline_cache_compatible(
+        {blob.data(), sizeof(pipeline_cache_header) - 1}, properties));
+    REQUIRE_FALSE(pipeline_cache_compatible({}, properties));
+  }
+}
+
+TEST_CASE("Pipeline cache round-trips through disk") {
+  auto vk = headless_vulkan::create();
+  if (!vk) {
+    WARN("No Vulkan device; set VK_ICD_FILENAMES to lavapipe to run this");
+    return;
+  }
+  const std::string path = "pipeline_cache.test.bin";
+  std::remove(path.c_str());
+  VkPhysicalDeviceProperties properties{};
+  vkGetPhysicalDeviceProperties(vk->physicalDevice, &properties);
+
+  {
+    pipeline_cache cache{vk->physicalDevice, vk->device, path};
+    REQUIRE(cache.state() == pipeline_cache_state::cold);
+    REQUIRE(cache.timed("first", [](VkPipelineCache) { return 7; }) == 7);
+    REQUIRE(cache.build_times().size() == 1);
+    REQUIRE(cache.build_times()[0].name == "first");
+    REQUIRE(cache.total_build_ms() >= 0);
+    cache.save();
+  }
+  REQUIRE(file_exists(path));
+  REQUIRE_FALSE(file_exists(path + ".tmp"));
+
+  SECTION("A saved cache starts warm") {
+    pipeline_cache cache{vk->physicalDevice, vk->device, path};
+    REQUIRE(cache.state() == pipeline_cache_state::warm);
+    auto data = cache.data();
+    REQUIRE(pipeline_cache_compatible({data.data(), data.size()}, properties));
+    // saving again replaces the file in place
+    cache.save();
+    REQUIRE(file_exists(path));
+    REQUIRE_FALSE(file_exists(path + ".tmp"));
+  }
+
+  SECTION("A cache from another device is not handed to the driver") {
+    properties.deviceID += 1;
+    write_file(path, cache_blob(properties, 256));
+    pipeline_cache cache{vk->physicalDevice, vk->device, path};
+    REQUIRE(cache.state() == pipeline_cache_state::rejected);
+    REQUIRE_FALSE(cache.warm());
+  }
+
+  SECTION("A truncated cache is rejected") {
+    write_file(path, std::vector<std::byte>(10, std::byte{1}));
+    pipeline_cache cache{vk->physicalDevice, vk->device, path};
+    REQUIRE(cache.state() == pipeline_cache_state::rejected);
+  }
+  std::remove(path.c_str());
+}
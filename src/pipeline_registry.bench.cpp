@@ -0,0 +1,163 @@
+#include "headless_vulkan.hpp"
+#include "mapped_file.hpp"
+#include "pipeline_registry.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Startup pipeline compilation on 1..N registry threads, e.g. on lavapipe.
+// Requests 48 variants of the triangle pipeline, each twice, into an empty
+// pipeline cache; reports how long the requests take to return, which is
+// what startup pays up front, and how long until every pipeline is built.
+// Run from the compiled shaders' directory.
+
+constexpr const char* cachePath = "pipeline_registry.bench.bin";
+
+std::vector<pipeline_description> variants(const pipeline_description& base) {
+  std::vector<pipeline_description> result{};
+  for (auto cullMode :
+       {VK_CULL_MODE_NONE, VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_FRONT_BIT}) {
+    for (auto frontFace :
+         {VK_FRONT_FACE_COUNTER_CLOCKWISE, VK_FRONT_FACE_CLOCKWISE}) {
+      for (bool blend : {false, true}) {
+        for (bool depth : {false, true}) {
+          for (uint32_t stride : {16u, 32u}) {
+            auto variant = base;
+            variant.cullMode = cullMode;
+            variant.frontFace = frontFace;
+            if (blend) {
+              variant.blendAttachments[0] =
+                  pipeline_description::alpha_blend_attachment();
+            }
+            variant.depthTest = depth;
+            variant.depthWrite = depth;
+            variant.bindings[1].stride = stride;
+            result.push_back(variant);
+          }
+        }
+      }
+    }
+  }
+  return result;
+}
+
+double ms_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+int main() {
+  auto vk = headless_vulkan::create();
+  if (!vk) {
+    std::printf(
+        "No Vulkan device; set VK_ICD_FILENAMES to lavapipe to run this\n");
+    return 0;
+  }
+  auto loadShader = [&](const char* path) {
+    mapped_file code{path};
+    VkShaderModuleCreateInfo moduleInfo{
+        VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+    moduleInfo.codeSize = code.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.bytes().data());
+    VkShaderModule module{};
+    vkCreateShaderModule(vk->device, &moduleInfo, nullptr, &module);
+    return module;
+  };
+  VkShaderModule vertexShader{};
+  VkShaderModule fragmentShader{};
+  try {
+    vertexShader = loadShader("triangle.vert.spv");
+    fragmentShader = loadShader("triangle.frag.spv");
+  } catch (const std::exception& error) {
+    std::printf("%s; run from the compiled shaders' directory\n", error.what());
+    return 0;
+  }
+  VkPipelineLayoutCreateInfo layoutInfo{
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+  VkPipelineLayout layout{};
+  vkCreatePipelineLayout(vk->device, &layoutInfo, nullptr, &layout);
+  VkAttachmentDescription attachments[2]{};
+  attachments[0].format = VK_FORMAT_R8G8B8A8_UNORM;
+  attachments[1].format = VK_FORMAT_D32_SFLOAT;
+  for (auto& attachment : attachments) {
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  }
+  attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  VkAttachmentReference colorReference{
+      0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+  VkAttachmentReference depthReference{
+      1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorReference;
+  subpass.pDepthStencilAttachment = &depthReference;
+  VkRenderPassCreateInfo renderPassInfo{
+      VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
+  renderPassInfo.attachmentCount = 2;
+  renderPassInfo.pAttachments = attachments;
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  VkRenderPass renderPass{};
+  vkCreateRenderPass(vk->device, &renderPassInfo, nullptr, &renderPass);
+
+  pipeline_description base{};
+  base.stages = {{VK_SHADER_STAGE_VERTEX_BIT, vertexShader},
+                 {VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader}};
+  base.bindings = {{0, 12, VK_VERTEX_INPUT_RATE_VERTEX},
+                   {1, 16, VK_VERTEX_INPUT_RATE_VERTEX}};
+  base.attributes = {{0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0},
+                     {1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 0}};
+  base.layout = layout;
+  base.renderPass = renderPass;
+  auto descriptions = variants(base);
+
+  std::printf(
+      "%zu pipelines, each requested twice\n%-8s %12s %12s %10s\n",
+      descriptions.size(),
+      "threads",
+      "request ms",
+      "built ms",
+      "speedup");
+  size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  double singleThreaded{};
+  for (size_t threads{1}; threads <= maxThreads;
+       threads = threads == maxThreads ? maxThreads + 1
+                                       : std::min(threads * 2, maxThreads)) {
+    std::remove(cachePath);
+    pipeline_cache cache{vk->physicalDevice, vk->device, cachePath};
+    pipeline_registry registry{vk->device, cache, threads};
+    auto start = std::chrono::steady_clock::now();
+    for (int round{}; round < 2; ++round) {
+      for (auto& description : descriptions) {
+        registry.request(description);
+      }
+    }
+    auto requested = ms_since(start);
+    registry.wait_idle();
+    auto built = ms_since(start);
+    if (threads == 1) {
+      singleThreaded = built;
+    }
+    std::printf(
+        "%-8zu %12.3f %12.3f %9.2fx\n",
+        threads,
+        requested,
+        built,
+        singleThreaded / built);
+  }
+
+  vkDestroyRenderPass(vk->device, renderPass, nullptr);
+  vkDestroyPipelineLayout(vk->device, layout, nullptr);
+  vkDestroyShaderModule(vk->device, fragmentShader, nullptr);
+  vkDestroyShaderModule(vk->device, vertexShader, nullptr);
+}
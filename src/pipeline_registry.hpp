@@ -0,0 +1,367 @@
+#pragma once
+#include "pipeline_cache.hpp"
+#include <memory_allocator.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct pipeline_shader_stage {
+  VkShaderStageFlagBits stage;
+  VkShaderModule module;
+  std::string entryPoint{"main"};
+};
+
+// Everything that goes into a graphics pipeline, as plain values. Two
+// descriptions that compare equal build interchangeable pipelines; `name`
+// only labels timings and errors and takes no part in either.
+struct pipeline_description {
+  std::string name{};
+  std::vector<pipeline_shader_stage> stages{};
+  std::vector<VkVertexInputBindingDescription> bindings{};
+  std::vector<VkVertexInputAttributeDescription> attributes{};
+  VkPrimitiveTopology topology{VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+  VkPolygonMode polygonMode{VK_POLYGON_MODE_FILL};
+  VkCullModeFlags cullMode{VK_CULL_MODE_BACK_BIT};
+  VkFrontFace frontFace{VK_FRONT_FACE_COUNTER_CLOCKWISE};
+  bool depthTest{};
+  bool depthWrite{};
+  VkCompareOp depthCompareOp{VK_COMPARE_OP_LESS};
+  // one per color attachment of the subpass
+  std::vector<VkPipelineColorBlendAttachmentState> blendAttachments{
+      opaque_attachment()};
+  std::vector<VkDynamicState> dynamicStates{VK_DYNAMIC_STATE_VIEWPORT,
+                                            VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineLayout layout{};
+  VkRenderPass renderPass{};
+  uint32_t subpass{};
+
+  static VkPipelineColorBlendAttachmentState opaque_attachment() {
+    VkPipelineColorBlendAttachmentState attachment{};
+    attachment.colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    return attachment;
+  }
+
+  // Straight alpha blending over what is already in the attachment.
+  static VkPipelineColorBlendAttachmentState alpha_blend_attachment() {
+    auto attachment = opaque_attachment();
+    attachment.blendEnable = true;
+    attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    attachment.colorBlendOp = VK_BLEND_OP_ADD;
+    attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    return attachment;
+  }
+
+  bool operator==(const pipeline_description& other) const {
+    if (stages.size() != other.stages.size()) {
+      return false;
+    }
+    for (size_t i{}; i < stages.size(); ++i) {
+      if (stages[i].stage != other.stages[i].stage ||
+          stages[i].module != other.stages[i].module ||
+          stages[i].entryPoint != other.stages[i].entryPoint) {
+        return false;
+      }
+    }
+    return same_bytes(bindings, other.bindings) &&
+           same_bytes(attributes, other.attributes) &&
+           topology == other.topology && polygonMode == other.polygonMode &&
+           cullMode == other.cullMode && frontFace == other.frontFace &&
+           depthTest == other.depthTest && depthWrite == other.depthWrite &&
+           depthCompareOp == other.depthCompareOp &&
+           same_bytes(blendAttachments, other.blendAttachments) &&
+           dynamicStates == other.dynamicStates && layout == other.layout &&
+           renderPass == other.renderPass && subpass == other.subpass;
+  }
+  bool operator!=(const pipeline_description& other) const {
+    return !(*this == other);
+  }
+
+  // FNV-1a over every field that operator== compares.
+  size_t hash() const {
+    size_t hash = 14695981039346656037ull;
+    auto add = [&](const void* data, size_t size) {
+      auto bytes = static_cast<const unsigned char*>(data);
+      for (size_t i{}; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+      }
+    };
+    auto addValue = [&](const auto& value) { add(&value, sizeof(value)); };
+    auto addArray = [&](const auto& values) {
+      addValue(values.size());
+      add(values.data(), values.size() * sizeof(values[0]));
+    };
+    for (auto& stage : stages) {
+      addValue(stage.stage);
+      addValue(stage.module);
+      add(stage.entryPoint.data(), stage.entryPoint.size() + 1);
+    }
+    addArray(bindings);
+    addArray(attributes);
+    addValue(topology);
+    addValue(polygonMode);
+    addValue(cullMode);
+    addValue(frontFace);
+    addValue(depthTest);
+    addValue(depthWrite);
+    addValue(depthCompareOp);
+    addArray(blendAttachments);
+    addArray(dynamicStates);
+    addValue(layout);
+    addValue(renderPass);
+    addValue(subpass);
+    return hash;
+  }
+
+  VkPipeline create(VkDevice device, VkPipelineCache cache) const {
+    std::vector<VkPipelineShaderStageCreateInfo> stageInfos{};
+    for (auto& stage : stages) {
+      VkPipelineShaderStageCreateInfo stageInfo{
+          VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO};
+      stageInfo.stage = stage.stage;
+      stageInfo.module = stage.module;
+      stageInfo.pName = stage.entryPoint.c_str();
+      stageInfos.push_back(stageInfo);
+    }
+    VkPipelineVertexInputStateCreateInfo vertexInput{
+        VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+    vertexInput.vertexBindingDescriptionCount =
+        static_cast<uint32_t>(bindings.size());
+    vertexInput.pVertexBindingDescriptions = bindings.data();
+    vertexInput.vertexAttributeDescriptionCount =
+        static_cast<uint32_t>(attributes.size());
+    vertexInput.pVertexAttributeDescriptions = attributes.data();
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{
+        VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+    inputAssembly.topology = topology;
+    // viewport and scissor are expected to be dynamic
+    VkPipelineViewportStateCreateInfo viewportState{
+        VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+    VkPipelineRasterizationStateCreateInfo rasterization{
+        VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
+    rasterization.polygonMode = polygonMode;
+    rasterization.cullMode = cullMode;
+    rasterization.frontFace = frontFace;
+    rasterization.lineWidth = 1.f;
+    VkPipelineMultisampleStateCreateInfo multisample{
+        VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    VkPipelineDepthStencilStateCreateInfo depthStencil{
+        VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+    depthStencil.depthTestEnable = depthTest;
+    depthStencil.depthWriteEnable = depthWrite;
+    depthStencil.depthCompareOp = depthCompareOp;
+    depthStencil.maxDepthBounds = 1.f;
+    VkPipelineColorBlendStateCreateInfo colorBlend{
+        VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO};
+    colorBlend.attachmentCount =
+        static_cast<uint32_t>(blendAttachments.size());
+    colorBlend.pAttachments = blendAttachments.data();
+    VkPipelineDynamicStateCreateInfo dynamicState{
+        VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
+    dynamicState.dynamicStateCount =
+        static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{
+        VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
+    pipelineInfo.stageCount = static_cast<uint32_t>(stageInfos.size());
+    pipelineInfo.pStages = stageInfos.data();
+    pipelineInfo.pVertexInputState = &vertexInput;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterization;
+    pipelineInfo.pMultisampleState = &multisample;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlend;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = layout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = subpass;
+    VkPipeline pipeline{};
+    auto result = vkCreateGraphicsPipelines(
+        device, cache, 1, &pipelineInfo, nullptr, &pipeline);
+    if (result != VK_SUCCESS) {
+      throw std::runtime_error{
+          "Unable to create pipeline " + name + ": " +
+          std::to_string(static_cast<int>(result))};
+    }
+    return pipeline;
+  }
+
+private:
+  template <typename T>
+  static bool same_bytes(const std::vector<T>& a, const std::vector<T>& b) {
+    return a.size() == b.size() &&
+           (a.empty() ||
+            std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+  }
+};
+
+struct pipeline_description_hash {
+  size_t operator()(const pipeline_description& description) const {
+    return description.hash();
+  }
+};
+
+// Owns every graphics pipeline, one per distinct description. request()
+// returns at once with a future; the pipeline compiles on the registry's
+// threads through the shared pipeline cache, so startup can go on loading
+// assets meanwhile. Requesting a description that is already known, built
+// or still compiling, returns the same future.
+struct pipeline_registry {
+  // With zero threads, request() compiles inline before returning.
+  pipeline_registry(
+      VkDevice device,
+      pipeline_cache& cache,
+      size_t threadCount = std::max(1u, std::thread::hardware_concurrency()))
+      : m_device(device), m_cache(cache) {
+    for (size_t i{}; i < threadCount; ++i) {
+      m_threads.emplace_back([this] { run(); });
+    }
+  }
+
+  pipeline_registry(const pipeline_registry&) = delete;
+  pipeline_registry& operator=(const pipeline_registry&) = delete;
+
+  // Finishes the queued compiles, then destroys every pipeline.
+  ~pipeline_registry() {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads) {
+      thread.join();
+    }
+    for (auto& [description, entry] : m_entries) {
+      if (entry->pipeline) {
+        vkDestroyPipeline(m_device, entry->pipeline, nullptr);
+      }
+    }
+  }
+
+  std::shared_future<VkPipeline> request(
+      const pipeline_description& description) {
+    std::shared_ptr<entry> compileNow{};
+    std::shared_future<VkPipeline> result{};
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      auto found = m_entries.find(description);
+      if (found != m_entries.end()) {
+        ++m_reused;
+        return found->second->future;
+      }
+      auto added = std::make_shared<entry>();
+      added->description = description;
+      added->future = added->promise.get_future().share();
+      m_entries.emplace(description, added);
+      result = added->future;
+      if (m_threads.empty()) {
+        compileNow = added;
+      } else {
+        m_queue.push_back(added);
+      }
+    }
+    if (compileNow) {
+      compile(*compileNow);
+    } else {
+      m_wake.notify_one();
+    }
+    return result;
+  }
+
+  // Blocks until the pipeline is built; rethrows a failed build.
+  VkPipeline get(const pipeline_description& description) {
+    return request(description).get();
+  }
+
+  // Blocks until every requested pipeline finished compiling.
+  void wait_idle() {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_idle.wait(lock, [this] { return m_queue.empty() && m_compiling == 0; });
+  }
+
+  // distinct descriptions requested so far
+  size_t size() const {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_entries.size();
+  }
+  // requests answered with an existing pipeline
+  size_t reused() const {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_reused;
+  }
+  size_t thread_count() const { return m_threads.size(); }
+
+private:
+  struct entry {
+    pipeline_description description;
+    std::promise<VkPipeline> promise;
+    std::shared_future<VkPipeline> future;
+    VkPipeline pipeline{};
+  };
+
+  VkDevice m_device{};
+  pipeline_cache& m_cache;
+  std::vector<std::thread> m_threads;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_idle;
+  std::unordered_map<
+      pipeline_description,
+      std::shared_ptr<entry>,
+      pipeline_description_hash>
+      m_entries;
+  std::deque<std::shared_ptr<entry>> m_queue;
+  size_t m_compiling{};
+  size_t m_reused{};
+  bool m_stop{};
+
+  void compile(entry& compiled) {
+    try {
+      auto& description = compiled.description;
+      compiled.pipeline =
+          m_cache.timed(description.name, [&](VkPipelineCache cache) {
+            return description.create(m_device, cache);
+          });
+      compiled.promise.set_value(compiled.pipeline);
+    } catch (...) {
+      compiled.promise.set_exception(std::current_exception());
+    }
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    while (true) {
+      m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+      if (m_queue.empty()) {
+        return;
+      }
+      auto next = std::move(m_queue.front());
+      m_queue.pop_front();
+      ++m_compiling;
+      lock.unlock();
+      compile(*next);
+      lock.lock();
+      if (--m_compiling == 0 && m_queue.empty()) {
+        m_idle.notify_all();
+      }
+    }
+  }
+};
@@ -0,0 +1,170 @@
+#include "headless_vulkan.hpp"
+#include "mapped_file.hpp"
+#include "pipeline_registry.hpp"
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <set>
+
+namespace {
+pipeline_description triangle_description(
+    VkShaderModule vertexShader,
+    VkShaderModule fragmentShader,
+    VkPipelineLayout layout,
+    VkRenderPass renderPass) {
+  pipeline_description description{};
+  description.name = "triangle";
+  description.stages = {{VK_SHADER_STAGE_VERTEX_BIT, vertexShader},
+                        {VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader}};
+  description.bindings = {{0, 12, VK_VERTEX_INPUT_RATE_VERTEX},
+                          {1, 16, VK_VERTEX_INPUT_RATE_VERTEX}};
+  description.attributes = {{0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0},
+                            {1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 0}};
+  description.layout = layout;
+  description.renderPass = renderPass;
+  return description;
+}
+
+// Handles only compared and hashed, never passed to Vulkan.
+template <typename Handle>
+Handle fake_handle(uintptr_t value) {
+  Handle handle{};
+  std::memcpy(&handle, &value, std::min(sizeof(handle), sizeof(value)));
+  return handle;
+}
+} // namespace
+
+TEST_CASE("Pipeline descriptions compare and hash by content") {
+  auto base = triangle_description(
+      fake_handle<VkShaderModule>(1),
+      fake_handle<VkShaderModule>(2),
+      fake_handle<VkPipelineLayout>(3),
+      fake_handle<VkRenderPass>(4));
+  auto copy = base;
+  copy.name = "another name";
+  REQUIRE(copy == base);
+  REQUIRE(copy.hash() == base.hash());
+
+  std::vector<pipeline_description> changed(9, base);
+  changed[0].stages[1].module = fake_handle<VkShaderModule>(5);
+  changed[1].stages[0].entryPoint = "vertex_main";
+  changed[2].bindings[1].stride = 32;
+  changed[3].attributes[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+  changed[4].cullMode = VK_CULL_MODE_NONE;
+  changed[5].depthTest = true;
+  changed[6].blendAttachments[0] =
+      pipeline_description::alpha_blend_attachment();
+  changed[7].renderPass = fake_handle<VkRenderPass>(6);
+  changed[8].dynamicStates.pop_back();
+  std::set<size_t> hashes{base.hash()};
+  for (auto& description : changed) {
+    REQUIRE(description != base);
+    hashes.insert(description.hash());
+  }
+  REQUIRE(hashes.size() == changed.size() + 1);
+}
+
+TEST_CASE("Pipeline registry compiles each description once") {
+  auto vk = headless_vulkan::create();
+  if (!vk) {
+    WARN("No Vulkan device; set VK_ICD_FILENAMES to lavapipe to run this");
+    return;
+  }
+  auto loadShader = [&](const char* path) {
+    mapped_file code{path};
+    VkShaderModuleCreateInfo moduleInfo{
+        VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+    moduleInfo.codeSize = code.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.bytes().data());
+    VkShaderModule module{};
+    vkCreateShaderModule(vk->device, &moduleInfo, nullptr, &module);
+    return module;
+  };
+  VkShaderModule vertexShader{};
+  VkShaderModule fragmentShader{};
+  try {
+    vertexShader = loadShader("triangle.vert.spv");
+    fragmentShader = loadShader("triangle.frag.spv");
+  } catch (const std::runtime_error&) {
+    vkDestroyShaderModule(vk->device, vertexShader, nullptr);
+    WARN("Run from the compiled shaders' directory to build pipelines");
+    return;
+  }
+  VkPipelineLayoutCreateInfo layoutInfo{
+      VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+  VkPipelineLayout layout{};
+  vkCreatePipelineLayout(vk->device, &layoutInfo, nullptr, &layout);
+  VkAttachmentDescription attachment{};
+  attachment.format = VK_FORMAT_R8G8B8A8_UNORM;
+  attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  VkAttachmentReference colorReference{
+      0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorReference;
+  VkRenderPassCreateInfo renderPassInfo{
+      VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
+  renderPassInfo.attachmentCount = 1;
+  renderPassInfo.pAttachments = &attachment;
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  VkRenderPass renderPass{};
+  vkCreateRenderPass(vk->device, &renderPassInfo, nullptr, &renderPass);
+
+  const std::string cachePath = "pipeline_registry.test.bin";
+  std::remove(cachePath.c_str());
+  auto base =
+      triangle_description(vertexShader, fragmentShader, layout, renderPass);
+  std::vector<pipeline_description> variants{};
+  for (auto cullMode : {VK_CULL_MODE_NONE, VK_CULL_MODE_BACK_BIT}) {
+    for (bool blend : {false, true}) {
+      auto variant = base;
+      variant.cullMode = cullMode;
+      if (blend) {
+        variant.blendAttachments[0] =
+            pipeline_description::alpha_blend_attachment();
+      }
+      variants.push_back(variant);
+    }
+  }
+
+  auto threadCount = GENERATE(size_t{0}, size_t{1}, size_t{3});
+  {
+    pipeline_cache cache{vk->physicalDevice, vk->device, cachePath};
+    pipeline_registry registry{vk->device, cache, threadCount};
+    REQUIRE(registry.thread_count() == threadCount);
+    std::vector<std::shared_future<VkPipeline>> futures{};
+    // every variant twice, the second time under another name
+    for (int round{}; round < 2; ++round) {
+      for (auto variant : variants) {
+        variant.name = round == 0 ? "first" : "second";
+        futures.push_back(registry.request(variant));
+      }
+    }
+    registry.wait_idle();
+    REQUIRE(registry.size() == variants.size());
+    REQUIRE(registry.reused() == variants.size());
+    REQUIRE(cache.build_times().size() == variants.size());
+
+    std::set<VkPipeline> distinct{};
+    for (size_t i{}; i < variants.size(); ++i) {
+      auto pipeline = futures[i].get();
+      REQUIRE(pipeline != VK_NULL_HANDLE);
+      REQUIRE(futures[i + variants.size()].get() == pipeline);
+      REQUIRE(registry.get(variants[i]) == pipeline);
+      distinct.insert(pipeline);
+    }
+    REQUIRE(distinct.size() == variants.size());
+  }
+
+  vkDestroyRenderPass(vk->device, renderPass, nullptr);
+  vkDestroyPipelineLayout(vk->device, layout, nullptr);
+  vkDestroyShaderModule(vk->device, fragmentShader, nullptr);
+  vkDestroyShaderModule(vk->device, vertexShader, nullptr);
+}
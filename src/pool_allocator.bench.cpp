@@ -0,0 +1,56 @@
+#include "bench.hpp"
+#include "pool_allocator.hpp"
+#include <random>
+#include <vector>
+
+struct render_record {
+  float model[16];
+  uint32_t materialIndex;
+  uint32_t meshIndex;
+};
+
+constexpr size_t liveObjects = 10000;
+constexpr size_t churnRounds = 100;
+constexpr size_t operations = liveObjects * churnRounds;
+
+// Frees a random object and allocates a replacement, keeping liveObjects
+// alive, the way per-entity records churn as entities come and go.
+template <typename Allocate, typename Free>
+void churn(Allocate&& allocate, Free&& free) {
+  std::mt19937 rng{1234};
+  std::uniform_int_distribution<size_t> pick{0, liveObjects - 1};
+  std::vector<render_record*> live(liveObjects);
+  for (auto& record : live) {
+    record = allocate();
+  }
+  for (size_t i{}; i < operations; ++i) {
+    auto& record = live[pick(rng)];
+    free(record);
+    record = allocate();
+    record->materialIndex = static_cast<uint32_t>(i);
+  }
+  for (auto record : live) {
+    free(record);
+  }
+}
+
+int main() {
+  run_benchmark("new/delete churn", operations, [] {
+    churn([] { return new render_record; },
+          [](render_record* record) { delete record; });
+  });
+
+  pool_memory pool{sizeof(render_record)};
+  pool_allocator<render_record> alloc{&pool};
+  run_benchmark("pool_allocator churn", operations, [&] {
+    churn([&] { return alloc.allocate(1); },
+          [&](render_record* record) { alloc.deallocate(record, 1); });
+  });
+
+  pool_memory alignedPool{sizeof(render_record), cache_line_size};
+  pool_allocator<render_record> alignedAlloc{&alignedPool};
+  run_benchmark("pool_allocator churn (cache line slots)", operations, [&] {
+    churn([&] { return alignedAlloc.allocate(1); },
+          [&](render_record* record) { alignedAlloc.deallocate(record, 1); });
+  });
+}
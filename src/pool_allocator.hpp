@@ -0,0 +1,179 @@
+#pragma once
+#include "aligned_alloc.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Fixed-size slot allocator for long-lived objects that churn (per-entity
+// render records, dynamic light entries). Free slots are kept on an
+// intrusive singly linked list, so allocate and deallocate are O(1). Memory
+// is obtained in chunks of at least chunkSize bytes and only returned when
+// the pool is destroyed.
+struct pool_memory {
+  // slotAlignment must be a power of two.
+  pool_memory(
+      size_t slotSize,
+      size_t slotAlignment = alignof(std::max_align_t),
+      size_t chunkSize = page_size)
+      : m_slotAlignment(std::max(slotAlignment, alignof(free_slot))) {
+    if (slotAlignment == 0 || (slotAlignment & (slotAlignment - 1)) != 0) {
+      throw std::invalid_argument{"slot alignment must be a power of two"};
+    }
+    m_slotSize = round_up(
+        std::max(slotSize, sizeof(free_slot)), m_slotAlignment);
+    m_slotsPerChunk = std::max<size_t>(1, chunkSize / m_slotSize);
+  }
+
+  pool_memory(const pool_memory&) = delete;
+  pool_memory(pool_memory&& other) noexcept { *this = std::move(other); }
+  pool_memory& operator=(const pool_memory&) = delete;
+
+  // The source keeps its slot layout but owns no chunks, so it is an empty
+  // pool rather than one whose free list points into moved memory.
+  pool_memory& operator=(pool_memory&& other) noexcept {
+    if (this != &other) {
+      m_slotSize = other.m_slotSize;
+      m_slotAlignment = other.m_slotAlignment;
+      m_slotsPerChunk = other.m_slotsPerChunk;
+      m_slotsInUse = std::exchange(other.m_slotsInUse, 0);
+      m_freeList = std::exchange(other.m_freeList, nullptr);
+      m_chunks = std::move(other.m_chunks);
+      other.m_chunks.clear();
+    }
+    return *this;
+  }
+
+  void* allocate_slot() {
+    if (!m_freeList) {
+      push_chunk();
+    }
+    auto slot = m_freeList;
+    m_freeList = slot->next;
+    ++m_slotsInUse;
+    return slot;
+  }
+
+  void deallocate_slot(void* slot) {
+    auto freed = static_cast<free_slot*>(slot);
+    freed->next = m_freeList;
+    m_freeList = freed;
+    --m_slotsInUse;
+  }
+
+  template <typename T>
+  T* allocate(size_t n) {
+    return reinterpret_cast<T*>(allocate_bytes(sizeof(T) * n, alignof(T)));
+  }
+
+  template <typename T>
+  void deallocate(T* ptr, size_t) {
+    deallocate_slot(ptr);
+  }
+
+  void* allocate_bytes(size_t size, size_t alignment) {
+    if (size > m_slotSize || alignment > m_slotAlignment) {
+      throw std::bad_alloc{};
+    }
+    return allocate_slot();
+  }
+
+  void deallocate_bytes(void* ptr, size_t, size_t) { deallocate_slot(ptr); }
+
+  size_t slot_size() const { return m_slotSize; }
+  size_t slot_alignment() const { return m_slotAlignment; }
+  size_t slots_in_use() const { return m_slotsInUse; }
+  size_t capacity() const { return m_chunks.size() * m_slotsPerChunk; }
+
+private:
+  struct free_slot {
+    free_slot* next;
+  };
+
+  size_t m_slotSize{};
+  size_t m_slotAlignment{};
+  size_t m_slotsPerChunk{};
+  size_t m_slotsInUse{};
+  free_slot* m_freeList{};
+  std::vector<std::unique_ptr<void, aligned_free_deleter>> m_chunks{};
+
+  static size_t round_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+
+  void push_chunk() {
+    std::unique_ptr<void, aligned_free_deleter> chunk{
+        aligned_malloc(m_slotSize * m_slotsPerChunk, m_slotAlignment)};
+    if (!chunk) {
+      throw std::bad_alloc{};
+    }
+    auto base = static_cast<std::byte*>(chunk.get());
+    for (size_t i = m_slotsPerChunk; i > 0; --i) {
+      auto slot = reinterpret_cast<free_slot*>(base + (i - 1) * m_slotSize);
+      slot->next = m_freeList;
+      m_freeList = slot;
+    }
+    m_chunks.push_back(std::move(chunk));
+  }
+};
+
+template <typename T>
+struct pool_allocator;
+
+template <typename T>
+void swap(pool_allocator<T>, pool_allocator<T>) noexcept;
+
+template <typename T>
+bool operator!=(pool_allocator<T>, pool_allocator<T>) noexcept;
+
+template <typename T>
+bool operator==(pool_allocator<T>, pool_allocator<T>) noexcept;
+
+// Node-based containers rebind to their node type, so the pool's slot size
+// must be large enough for the node rather than for T itself.
+template <typename T>
+struct pool_allocator {
+  using value_type = T;
+
+  pool_allocator(pool_memory* memoryResource)
+      : m_memoryResource(memoryResource) {}
+
+  template <typename U>
+  pool_allocator(const pool_allocator<U>& other)
+      : m_memoryResource(other.memory_resource()) {}
+
+  T* allocate(size_t n) { return m_memoryResource->allocate<T>(n); }
+
+  void deallocate(T* ptr, size_t n) { m_memoryResource->deallocate(ptr, n); }
+
+  pool_memory* memory_resource() const { return m_memoryResource; }
+
+  template <typename U>
+  friend void swap(pool_allocator<U>, pool_allocator<U>) noexcept;
+  template <typename U>
+  friend bool operator!=(pool_allocator<U>, pool_allocator<U>) noexcept;
+  template <typename U>
+  friend bool operator==(pool_allocator<U>, pool_allocator<U>) noexcept;
+
+private:
+  pool_memory* m_memoryResource{};
+};
+
+template <typename T>
+void swap(pool_allocator<T> lhs, pool_allocator<T> rhs) noexcept {
+  std::swap(lhs.m_memoryResource, rhs.m_memoryResource);
+}
+
+template <typename T>
+bool operator!=(pool_allocator<T> lhs, pool_allocator<T> rhs) noexcept {
+  return lhs.m_memoryResource != rhs.m_memoryResource;
+}
+
+template <typename T>
+bool operator==(pool_allocator<T> lhs, pool_allocator<T> rhs) noexcept {
+  return !(lhs != rhs);
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "pool_allocator.hpp"
+#include "monotonic_resource.hpp"
+#include <catch2/catch.hpp>
+#include <list>
+#include <set>
+
+struct light_entry {
+  float color[4];
+  float positionViewSpace[4];
+};
+
+TEST_CASE("Pool slots are at least pointer sized and aligned") {
+  pool_memory pool{1, 1};
+  REQUIRE(pool.slot_size() >= sizeof(void*));
+  REQUIRE(pool.slot_alignment() >= alignof(void*));
+}
+
+TEST_CASE("Allocate and free a slot from a pool") {
+  pool_memory pool{sizeof(light_entry)};
+  pool_allocator<light_entry> alloc{&pool};
+  auto light = alloc.allocate(1);
+  REQUIRE(light != nullptr);
+  REQUIRE(pool.slots_in_use() == 1);
+  alloc.deallocate(light, 1);
+  REQUIRE(pool.slots_in_use() == 0);
+}
+
+TEST_CASE("A freed slot is reused by the next allocation") {
+  pool_memory pool{sizeof(light_entry)};
+  pool_allocator<light_entry> alloc{&pool};
+  auto first = alloc.allocate(1);
+  alloc.allocate(1);
+  alloc.deallocate(first, 1);
+  REQUIRE(alloc.allocate(1) == first);
+}
+
+TEST_CASE("Slots handed out by a pool are distinct") {
+  pool_memory pool{sizeof(light_entry)};
+  pool_allocator<light_entry> alloc{&pool};
+  std::set<light_entry*> slots;
+  for (int i{}; i < 1000; ++i) {
+    slots.insert(alloc.allocate(1));
+  }
+  REQUIRE(slots.size() == 1000);
+  REQUIRE(pool.capacity() >= 1000);
+}
+
+TEST_CASE("A pool grows by page-sized chunks") {
+  pool_memory pool{64, alignof(std::max_align_t), 4096};
+  pool.allocate_slot();
+  REQUIRE(pool.capacity() == 4096 / 64);
+  for (size_t i{1}; i < 4096 / 64; ++i) {
+    pool.allocate_slot();
+  }
+  REQUIRE(pool.capacity() == 4096 / 64);
+  pool.allocate_slot();
+  REQUIRE(pool.capacity() == 2 * 4096 / 64);
+}
+
+TEST_CASE("Cache line aligned slots start on a cache line") {
+  pool_memory pool{sizeof(light_entry), cache_line_size};
+  pool_allocator<light_entry> alloc{&pool};
+  for (int i{}; i < 100; ++i) {
+    auto light = alloc.allocate(1);
+    REQUIRE(reinterpret_cast<uintptr_t>(light) % cache_line_size == 0);
+  }
+}
+
+TEST_CASE("Slot alignments must be powers of two") {
+  REQUIRE_THROWS_AS((pool_memory{16, 0}), std::invalid_argument);
+  REQUIRE_THROWS_AS((pool_memory{16, 24}), std::invalid_argument);
+}
+
+TEST_CASE("A moved-from pool is empty and still usable") {
+  pool_memory pool{sizeof(light_entry)};
+  pool_allocator<light_entry> alloc{&pool};
+  auto light = alloc.allocate(1);
+  pool_memory moved{std::move(pool)};
+  REQUIRE(moved.slots_in_use() == 1);
+  REQUIRE(pool.slots_in_use() == 0);
+  REQUIRE(pool.capacity() == 0);
+  moved.deallocate_slot(light);
+
+  // the source must not hand out slots from the memory it gave away
+  auto fresh = pool.allocate_slot();
+  REQUIRE(pool.capacity() > 0);
+  moved = std::move(pool);
+  REQUIRE(moved.slots_in_use() == 1);
+  REQUIRE(pool.capacity() == 0);
+  moved.deallocate_slot(fresh);
+}
+
+TEST_CASE("Requests larger than a slot throw bad_alloc") {
+  pool_memory pool{sizeof(light_entry)};
+  pool_allocator<light_entry> alloc{&pool};
+  REQUIRE_THROWS_AS(alloc.allocate(64), std::bad_alloc);
+}
+
+TEST_CASE("Two pool allocators over the same pool compare equal") {
+  pool_memory pool0{16};
+  pool_memory pool1{16};
+  pool_allocator<int32_t> alloc0{&pool0};
+  pool_allocator<int64_t> alloc0Rebound{alloc0};
+  REQUIRE(alloc0 == pool_allocator<int32_t>{alloc0Rebound});
+  REQUIRE(alloc0 != pool_allocator<int32_t>{&pool1});
+}
+
+TEST_CASE("A std::list allocates its nodes from a pool") {
+  pool_memory pool{64};
+  std::list<int, pool_allocator<int>> values{pool_allocator<int>{&pool}};
+  for (int i{}; i < 10; ++i) {
+    values.push_back(i);
+  }
+  REQUIRE(pool.slots_in_use() == 10);
+  values.pop_front();
+  REQUIRE(pool.slots_in_use() == 9);
+}
+
+TEST_CASE("A pool can back a pmr memory resource") {
+  pool_memory pool{64};
+  memory_resource_adapter<pool_memory> resource{&pool};
+  {
+    std::pmr::list<int> values{&resource};
+    values.push_back(1);
+    values.push_back(2);
+    REQUIRE(pool.slots_in_use() == 2);
+  }
+  REQUIRE(pool.slots_in_use() == 0);
+}
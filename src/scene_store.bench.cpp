@@ -0,0 +1,88 @@
+#include "bench.hpp"
+#include "scene_store.hpp"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr size_t nodeCount = 1 << 20;
+
+// Roots with long chains below them: few nodes per depth level.
+scene_store make_deep(size_t chainLength) {
+  scene_store scene{};
+  for (size_t chain{}; chain < nodeCount / chainLength; ++chain) {
+    auto parent = scene.add_node();
+    for (size_t i{1}; i < chainLength; ++i) {
+      parent = scene.add_node(parent);
+    }
+  }
+  return scene;
+}
+
+// A few roots with many children each, and children of those.
+scene_store make_wide() {
+  scene_store scene{};
+  std::mt19937 rng{1};
+  for (size_t i{}; i < nodeCount; ++i) {
+    auto parent = i < 16 ? scene_store::no_parent
+                         : static_cast<scene_store::node_handle>(
+                               rng() % std::min<size_t>(i, 4096));
+    scene.add_node(parent);
+  }
+  return scene;
+}
+
+void move_nodes(scene_store& scene, size_t step, float offset) {
+  for (scene_store::node_handle node{}; node < scene.size(); node += step) {
+    scene.set_local(
+        node,
+        {offset, 1.f, 2.f},
+        {0.f, 0.38268343f, 0.f, 0.92387953f},
+        {1.f, 1.f, 1.f});
+  }
+}
+
+int main() {
+  size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  auto stride = scene_store::uniform_stride(256);
+  std::vector<std::byte> uniforms(stride * nodeCount);
+  dynamic_uniform_target target{uniforms.data(), stride};
+
+  struct shape {
+    const char* name;
+    scene_store scene;
+  };
+  std::vector<shape> shapes{};
+  shapes.push_back({"wide", make_wide()});
+  shapes.push_back({"deep 64", make_deep(64)});
+  shapes.push_back({"deep 4096", make_deep(4096)});
+
+  for (auto& [name, scene] : shapes) {
+    scene.update(target);
+    for (size_t threadCount{1}; threadCount <= maxThreads;
+         threadCount = threadCount == maxThreads
+                           ? maxThreads + 1
+                           : std::min(threadCount * 2, maxThreads)) {
+      worker_pool pool{threadCount - 1};
+      auto label = [&](const char* what) {
+        return std::string{name} + " " + what + " x" +
+               std::to_string(threadCount);
+      };
+      float offset{};
+      run_benchmark(label("all moving").c_str(), nodeCount, [&] {
+        move_nodes(scene, 1, offset += 1.f);
+        scene.update(target, &pool);
+      });
+      // every 64th node moves and drags its descendants along
+      run_benchmark(label("1/64 moving").c_str(), nodeCount, [&] {
+        move_nodes(scene, 64, offset += 1.f);
+        scene.update(target, &pool);
+      });
+    }
+    run_benchmark((std::string{name} + " static").c_str(), nodeCount, [&] {
+      scene.update(target);
+    });
+  }
+  do_not_optimize(uniforms);
+}
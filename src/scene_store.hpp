@@ -0,0 +1,301 @@
+#pragma once
+#include "worker_pool.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// Column-major 4x4 matrix, laid out like a GLSL mat4 in a uniform block.
+using scene_matrix = std::array<float, 16>;
+
+// Destination for world matrices in a dynamic uniform buffer: the matrix of
+// node n goes to data + n * stride, the dynamic offset of its draw.
+struct dynamic_uniform_target {
+  std::byte* data{};
+  size_t stride{};
+};
+
+// Transform hierarchy for scene instances. Local transforms (translation,
+// rotation quaternion, scale), parent links and world matrices live in
+// structure-of-arrays streams sorted by hierarchy depth, so every parent is
+// computed before its children and each depth level is one flat loop that
+// can be split across threads. Only nodes whose local transform changed, or
+// whose ancestor's did, are recomputed; static objects cost one flag test.
+struct scene_store {
+  using node_handle = uint32_t;
+  static constexpr node_handle no_parent =
+      std::numeric_limits<node_handle>::max();
+
+  // levels smaller than this are not worth waking the pool for
+  static constexpr size_t parallel_grain = 1024;
+
+  // Rounds the size of a matrix up to the device's
+  // minUniformBufferOffsetAlignment, giving the dynamic uniform stride.
+  static size_t uniform_stride(size_t minUniformBufferOffsetAlignment) {
+    auto alignment = std::max<size_t>(minUniformBufferOffsetAlignment, 1);
+    return (sizeof(scene_matrix) + alignment - 1) / alignment * alignment;
+  }
+
+  // Adds a node with an identity local transform. Parents must be added
+  // before their children, which makes cycles impossible.
+  node_handle add_node(node_handle parent = no_parent) {
+    auto handle = static_cast<node_handle>(m_slotOf.size());
+    if (parent != no_parent && parent >= handle) {
+      throw std::invalid_argument{"Scene node parent does not exist"};
+    }
+    m_parentOf.push_back(parent);
+    m_depthOf.push_back(parent == no_parent ? 0 : m_depthOf[parent] + 1);
+    m_slotOf.push_back(static_cast<uint32_t>(m_handleOf.size()));
+    m_handleOf.push_back(handle);
+    m_parentSlot.push_back(0);
+    for (auto stream : local_streams()) {
+      stream->push_back(0.f);
+    }
+    m_rotationW.back() = 1.f;
+    m_scaleX.back() = m_scaleY.back() = m_scaleZ.back() = 1.f;
+    m_world.push_back(identity());
+    m_dirty.push_back(1);
+    m_changed.push_back(0);
+    m_sorted = false;
+    return handle;
+  }
+
+  size_t size() const { return m_slotOf.size(); }
+  node_handle parent(node_handle node) const { return m_parentOf[node]; }
+
+  // rotation is a unit quaternion (x, y, z, w)
+  void set_local(
+      node_handle node,
+      const std::array<float, 3>& translation,
+      const std::array<float, 4>& rotation,
+      const std::array<float, 3>& scale) {
+    auto slot = m_slotOf[node];
+    m_translationX[slot] = translation[0];
+    m_translationY[slot] = translation[1];
+    m_translationZ[slot] = translation[2];
+    m_rotationX[slot] = rotation[0];
+    m_rotationY[slot] = rotation[1];
+    m_rotationZ[slot] = rotation[2];
+    m_rotationW[slot] = rotation[3];
+    m_scaleX[slot] = scale[0];
+    m_scaleY[slot] = scale[1];
+    m_scaleZ[slot] = scale[2];
+    m_dirty[slot] = 1;
+  }
+
+  void set_translation(node_handle node, const std::array<float, 3>& value) {
+    auto slot = m_slotOf[node];
+    m_translationX[slot] = value[0];
+    m_translationY[slot] = value[1];
+    m_translationZ[slot] = value[2];
+    m_dirty[slot] = 1;
+  }
+
+  // World matrix as of the last update().
+  const scene_matrix& world(node_handle node) const {
+    return m_world[m_slotOf[node]];
+  }
+
+  // Recomputes the world matrices of changed nodes and their descendants and
+  // writes each recomputed matrix to target, if it has data. Matrices that did
+  // not change are not written, so the target must keep its contents between
+  // updates; fill a fresh buffer with write_all first. With a pool, wide
+  // depth levels are split across its threads.
+  void update(
+      dynamic_uniform_target target = {},
+      worker_pool* pool = nullptr) {
+    if (target.data && target.stride < sizeof(scene_matrix)) {
+      throw std::invalid_argument{"Uniform stride is smaller than a matrix"};
+    }
+    if (!m_sorted) {
+      sort_by_depth();
+    }
+    for (size_t level{}; level + 1 < m_levels.size(); ++level) {
+      auto first = m_levels[level];
+      auto count = m_levels[level + 1] - first;
+      auto run = [&](size_t begin, size_t end) {
+        update_range(first + begin, first + end, target);
+      };
+      if (pool && count >= parallel_grain * 2) {
+        auto grain = std::max(
+            parallel_grain, (count + pool->width() * 4 - 1) /
+                                (pool->width() * 4));
+        pool->parallel_for(count, grain, run);
+      } else {
+        run(0, count);
+      }
+    }
+  }
+
+  // Writes every world matrix to target.
+  void write_all(dynamic_uniform_target target) const {
+    for (size_t slot{}; slot < m_world.size(); ++slot) {
+      std::memcpy(
+          target.data + size_t{m_handleOf[slot]} * target.stride,
+          m_world[slot].data(),
+          sizeof(scene_matrix));
+    }
+  }
+
+private:
+  // per handle, in creation order
+  std::vector<node_handle> m_parentOf;
+  std::vector<uint32_t> m_depthOf;
+  std::vector<uint32_t> m_slotOf;
+
+  // per slot, sorted by depth
+  std::vector<node_handle> m_handleOf;
+  std::vector<uint32_t> m_parentSlot;
+  std::vector<float> m_translationX;
+  std::vector<float> m_translationY;
+  std::vector<float> m_translationZ;
+  std::vector<float> m_rotationX;
+  std::vector<float> m_rotationY;
+  std::vector<float> m_rotationZ;
+  std::vector<float> m_rotationW;
+  std::vector<float> m_scaleX;
+  std::vector<float> m_scaleY;
+  std::vector<float> m_scaleZ;
+  std::vector<scene_matrix> m_world;
+  // bytes rather than vector<bool> so threads can write neighbours
+  std::vector<uint8_t> m_dirty;
+  std::vector<uint8_t> m_changed;
+
+  // first slot of each depth level, plus the end
+  std::vector<size_t> m_levels;
+  bool m_sorted{true};
+
+  static scene_matrix identity() {
+    return {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+  }
+
+  std::array<std::vector<float>*, 10> local_streams() {
+    return {&m_translationX,
+            &m_translationY,
+            &m_translationZ,
+            &m_rotationX,
+            &m_rotationY,
+            &m_rotationZ,
+            &m_rotationW,
+            &m_scaleX,
+            &m_scaleY,
+            &m_scaleZ};
+  }
+
+  template <typename T>
+  static void permute(std::vector<T>& stream, const std::vector<uint32_t>& from) {
+    std::vector<T> sorted(stream.size());
+    for (size_t slot{}; slot < from.size(); ++slot) {
+      sorted[slot] = stream[from[slot]];
+    }
+    stream.swap(sorted);
+  }
+
+  // Counting sort of the slots by depth; stable, so siblings stay in
+  // creation order.
+  void sort_by_depth() {
+    uint32_t maxDepth{};
+    for (auto depth : m_depthOf) {
+      maxDepth = std::max(maxDepth, depth);
+    }
+    m_levels.assign(size_t{maxDepth} + 2, 0);
+    for (auto depth : m_depthOf) {
+      ++m_levels[depth + 1];
+    }
+    for (size_t level{1}; level < m_levels.size(); ++level) {
+      m_levels[level] += m_levels[level - 1];
+    }
+    auto next = m_levels;
+    // from[newSlot] = oldSlot
+    std::vector<uint32_t> from(size());
+    for (node_handle handle{}; handle < size(); ++handle) {
+      auto slot = static_cast<uint32_t>(next[m_depthOf[handle]]++);
+      from[slot] = m_slotOf[handle];
+      m_slotOf[handle] = slot;
+    }
+    permute(m_handleOf, from);
+    for (auto stream : local_streams()) {
+      permute(*stream, from);
+    }
+    permute(m_world, from);
+    permute(m_dirty, from);
+    for (size_t slot{}; slot < size(); ++slot) {
+      auto parent = m_parentOf[m_handleOf[slot]];
+      m_parentSlot[slot] = parent == no_parent ? 0 : m_slotOf[parent];
+    }
+    m_sorted = true;
+  }
+
+  void update_range(size_t begin, size_t end, dynamic_uniform_target target) {
+    for (size_t slot = begin; slot < end; ++slot) {
+      bool root = m_parentOf[m_handleOf[slot]] == no_parent;
+      bool changed = m_dirty[slot] || (!root && m_changed[m_parentSlot[slot]]);
+      m_changed[slot] = changed;
+      if (!changed) {
+        continue;
+      }
+      m_dirty[slot] = 0;
+      auto local = local_matrix(slot);
+      if (root) {
+        m_world[slot] = local;
+      } else {
+        multiply(m_world[m_parentSlot[slot]], local, m_world[slot]);
+      }
+      if (target.data) {
+        std::memcpy(
+            target.data + size_t{m_handleOf[slot]} * target.stride,
+            m_world[slot].data(),
+            sizeof(scene_matrix));
+      }
+    }
+  }
+
+  // translation * rotation * scale
+  scene_matrix local_matrix(size_t slot) const {
+    float x = m_rotationX[slot];
+    float y = m_rotationY[slot];
+    float z = m_rotationZ[slot];
+    float w = m_rotationW[slot];
+    float sx = m_scaleX[slot];
+    float sy = m_scaleY[slot];
+    float sz = m_scaleZ[slot];
+    return {(1 - 2 * (y * y + z * z)) * sx,
+            2 * (x * y + z * w) * sx,
+            2 * (x * z - y * w) * sx,
+            0.f,
+            2 * (x * y - z * w) * sy,
+            (1 - 2 * (x * x + z * z)) * sy,
+            2 * (y * z + x * w) * sy,
+            0.f,
+            2 * (x * z + y * w) * sz,
+            2 * (y * z - x * w) * sz,
+            (1 - 2 * (x * x + y * y)) * sz,
+            0.f,
+            m_translationX[slot],
+            m_translationY[slot],
+            m_translationZ[slot],
+            1.f};
+  }
+
+  // result = parent * local. Each output column is a sum of four-wide parent
+  // columns, which compilers turn into vector ops.
+  static void multiply(
+      const scene_matrix& parent,
+      const scene_matrix& local,
+      scene_matrix& result) {
+    for (size_t column{}; column < 4; ++column) {
+      float out[4];
+      for (size_t row{}; row < 4; ++row) {
+        out[row] = parent[row] * local[column * 4] +
+                   parent[4 + row] * local[column * 4 + 1] +
+                   parent[8 + row] * local[column * 4 + 2] +
+                   parent[12 + row] * local[column * 4 + 3];
+      }
+      std::memcpy(&result[column * 4], out, sizeof(out));
+    }
+  }
+};
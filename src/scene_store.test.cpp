@@ -0,0 +1,217 @@
+#include "scene_store.hpp"
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <random>
+
+namespace {
+struct transform {
+  std::array<float, 3> translation;
+  std::array<float, 4> rotation;
+  std::array<float, 3> scale;
+};
+
+transform random_transform(std::mt19937& rng) {
+  std::uniform_real_distribution<float> unit{-1.f, 1.f};
+  std::array<float, 4> rotation{unit(rng), unit(rng), unit(rng), unit(rng)};
+  float length = std::sqrt(
+      rotation[0] * rotation[0] + rotation[1] * rotation[1] +
+      rotation[2] * rotation[2] + rotation[3] * rotation[3]);
+  for (auto& value : rotation) {
+    value /= length;
+  }
+  return {{unit(rng) * 10.f, unit(rng) * 10.f, unit(rng) * 10.f},
+          rotation,
+          {1.f + unit(rng) * 0.2f, 1.f + unit(rng) * 0.2f, 1.f}};
+}
+
+// Reference: applies each transform to a point directly, walking up to the
+// root, without building any matrices.
+std::array<float, 3> transform_point(
+    const std::vector<transform>& transforms,
+    const scene_store& scene,
+    scene_store::node_handle node,
+    std::array<float, 3> point) {
+  while (node != scene_store::no_parent) {
+    auto& t = transforms[node];
+    float x = point[0] * t.scale[0];
+    float y = point[1] * t.scale[1];
+    float z = point[2] * t.scale[2];
+    // v + 2 q x (q x v + w v)
+    float qx = t.rotation[0], qy = t.rotation[1], qz = t.rotation[2],
+          qw = t.rotation[3];
+    float cx = qy * z - qz * y + qw * x;
+    float cy = qz * x - qx * z + qw * y;
+    float cz = qx * y - qy * x + qw * z;
+    point = {x + 2.f * (qy * cz - qz * cy) + t.translation[0],
+             y + 2.f * (qz * cx - qx * cz) + t.translation[1],
+             z + 2.f * (qx * cy - qy * cx) + t.translation[2]};
+    node = scene.parent(node);
+  }
+  return point;
+}
+
+std::array<float, 3> apply(
+    const scene_matrix& m,
+    const std::array<float, 3>& p) {
+  return {m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12],
+          m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13],
+          m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14]};
+}
+
+// Random forest; parents are always earlier nodes, so depths vary.
+scene_store make_scene(
+    size_t count,
+    std::vector<transform>& transforms,
+    std::mt19937& rng) {
+  scene_store scene{};
+  for (size_t i{}; i < count; ++i) {
+    auto parent = i == 0 || rng() % 8 == 0
+                      ? scene_store::no_parent
+                      : static_cast<scene_store::node_handle>(rng() % i);
+    auto node = scene.add_node(parent);
+    transforms.push_back(random_transform(rng));
+    scene.set_local(
+        node,
+        transforms[node].translation,
+        transforms[node].rotation,
+        transforms[node].scale);
+  }
+  return scene;
+}
+
+void check_world(
+    const scene_store& scene,
+    const std::vector<transform>& transforms) {
+  const std::array<float, 3> point{0.5f, -1.f, 2.f};
+  for (scene_store::node_handle node{}; node < scene.size(); ++node) {
+    auto expected = transform_point(transforms, scene, node, point);
+    auto actual = apply(scene.world(node), point);
+    for (int axis{}; axis < 3; ++axis) {
+      REQUIRE(actual[axis] == Approx(expected[axis]).margin(1e-2));
+    }
+  }
+}
+}  // namespace
+
+TEST_CASE("World matrices compose local transforms up the hierarchy") {
+  std::mt19937 rng{3};
+  std::vector<transform> transforms{};
+  auto scene = make_scene(500, transforms, rng);
+  scene.update();
+  check_world(scene, transforms);
+
+  SECTION("Nodes added after an update are sorted in") {
+    for (int i{}; i < 50; ++i) {
+      auto parent = static_cast<scene_store::node_handle>(rng() % scene.size());
+      auto node = scene.add_node(parent);
+      transforms.push_back(random_transform(rng));
+      scene.set_local(
+          node,
+          transforms[node].translation,
+          transforms[node].rotation,
+          transforms[node].scale);
+    }
+    scene.update();
+    check_world(scene, transforms);
+  }
+
+  SECTION("A parent must exist before its child") {
+    REQUIRE_THROWS_AS(
+        scene.add_node(static_cast<scene_store::node_handle>(scene.size())),
+        std::invalid_argument);
+  }
+}
+
+TEST_CASE("Only changed nodes and their descendants are rewritten") {
+  scene_store scene{};
+  auto root = scene.add_node();
+  auto child = scene.add_node(root);
+  auto grandchild = scene.add_node(child);
+  auto other = scene.add_node();
+
+  auto stride = scene_store::uniform_stride(256);
+  std::vector<std::byte> uniforms(stride * scene.size());
+  dynamic_uniform_target target{uniforms.data(), stride};
+  scene.update(target);
+
+  auto marker = std::byte{0xcd};
+  std::fill(uniforms.begin(), uniforms.end(), marker);
+  scene.set_translation(child, {1.f, 2.f, 3.f});
+  scene.update(target);
+
+  auto written = [&](scene_store::node_handle node) {
+    return uniforms[node * stride] != marker;
+  };
+  REQUIRE_FALSE(written(root));
+  REQUIRE(written(child));
+  REQUIRE(written(grandchild));
+  REQUIRE_FALSE(written(other));
+
+  scene_matrix matrix{};
+  std::memcpy(matrix.data(), &uniforms[grandchild * stride], sizeof(matrix));
+  REQUIRE(matrix == scene.world(grandchild));
+  REQUIRE(matrix[12] == 1.f);
+  REQUIRE(matrix[13] == 2.f);
+  REQUIRE(matrix[14] == 3.f);
+
+  SECTION("A static scene writes nothing") {
+    std::fill(uniforms.begin(), uniforms.end(), marker);
+    scene.update(target);
+    for (auto byte : uniforms) {
+      REQUIRE(byte == marker);
+    }
+  }
+
+  SECTION("write_all fills a fresh buffer") {
+    scene.write_all(target);
+    for (scene_store::node_handle node{}; node < scene.size(); ++node) {
+      std::memcpy(matrix.data(), &uniforms[node * stride], sizeof(matrix));
+      REQUIRE(matrix == scene.world(node));
+    }
+  }
+}
+
+TEST_CASE("Parallel update matches serial update") {
+  std::mt19937 rng{11};
+  std::vector<transform> transforms{};
+  scene_store serial{};
+  scene_store parallel{};
+  // wide levels so the pool is actually used
+  for (auto* scene : {&serial, &parallel}) {
+    for (int root{}; root < 8; ++root) {
+      auto parent = scene->add_node();
+      for (int depth{}; depth < 3; ++depth) {
+        auto first = static_cast<scene_store::node_handle>(scene->size());
+        for (int i{}; i < 1500; ++i) {
+          scene->add_node(parent);
+        }
+        parent = first;
+      }
+    }
+  }
+  for (scene_store::node_handle node{}; node < serial.size(); ++node) {
+    transforms.push_back(random_transform(rng));
+    for (auto* scene : {&serial, &parallel}) {
+      scene->set_local(
+          node,
+          transforms[node].translation,
+          transforms[node].rotation,
+          transforms[node].scale);
+    }
+  }
+  worker_pool pool{3};
+  auto stride = scene_store::uniform_stride(64);
+  std::vector<std::byte> serialUniforms(stride * serial.size());
+  std::vector<std::byte> parallelUniforms(stride * parallel.size());
+  serial.update({serialUniforms.data(), stride});
+  parallel.update({parallelUniforms.data(), stride}, &pool);
+  REQUIRE(serialUniforms == parallelUniforms);
+  check_world(parallel, transforms);
+}
+
+TEST_CASE("Uniform stride respects the offset alignment") {
+  REQUIRE(scene_store::uniform_stride(0) == 64);
+  REQUIRE(scene_store::uniform_stride(16) == 64);
+  REQUIRE(scene_store::uniform_stride(64) == 64);
+  REQUIRE(scene_store::uniform_stride(256) == 256);
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include "array_view.hpp"
+#include <memory_allocator.hpp>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// What a generated <name>.layout.hpp exposes as constexpr data: the bindings
+// of each descriptor set in set order, the push constant ranges, and one
+// vertex stream per vertex shader input.
+struct shader_layout {
+  array_view<array_view<VkDescriptorSetLayoutBinding>> sets;
+  array_view<VkPushConstantRange> pushConstants;
+  array_view<VkVertexInputBindingDescription> vertexBindings;
+  array_view<VkVertexInputAttributeDescription> vertexAttributes;
+};
+
+// The set layouts and pipeline layout of a shader_layout plus `copies` of
+// every descriptor set, e.g. one per frame in flight. The sets come from
+// one pool sized from the bindings and one vkAllocateDescriptorSets call,
+// and each copy's sets sit side by side so one vkCmdBindDescriptorSets
+// binds them all.
+struct descriptor_layouts {
+  descriptor_layouts(
+      VkDevice device,
+      const shader_layout& layout,
+      uint32_t copies)
+      : m_device(device), m_copies(copies) {
+    try {
+      create(layout);
+    } catch (...) {
+      destroy();
+      throw;
+    }
+  }
+
+  descriptor_layouts(const descriptor_layouts&) = delete;
+  descriptor_layouts& operator=(const descriptor_layouts&) = delete;
+
+  ~descriptor_layouts() { destroy(); }
+
+  VkPipelineLayout pipeline_layout() const { return m_pipelineLayout; }
+  VkDescriptorSetLayout set_layout(size_t set) const {
+    return m_setLayouts.at(set);
+  }
+  size_t set_count() const { return m_setLayouts.size(); }
+  uint32_t copies() const { return m_copies; }
+
+  array_view<VkDescriptorSet> sets(uint32_t copy) const {
+    if (copy >= m_copies) {
+      throw std::out_of_range{"descriptor_layouts copy out of range"};
+    }
+    if (m_sets.empty()) {
+      return {};
+    }
+    return {m_sets.data() + copy * m_setLayouts.size(), m_setLayouts.size()};
+  }
+  VkDescriptorSet set(uint32_t copy, size_t set) const {
+    return sets(copy)[set];
+  }
+
+private:
+  VkDevice m_device{};
+  uint32_t m_copies{};
+  std::vector<VkDescriptorSetLayout> m_setLayouts{};
+  VkPipelineLayout m_pipelineLayout{};
+  VkDescriptorPool m_pool{};
+  std::vector<VkDescriptorSet> m_sets{};
+
+  void create(const shader_layout& layout) {
+    std::map<VkDescriptorType, uint32_t> descriptorCounts{};
+    for (auto& bindings : layout.sets) {
+      VkDescriptorSetLayoutCreateInfo setLayoutInfo{
+          VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+      setLayoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+      setLayoutInfo.pBindings = bindings.data();
+      VkDescriptorSetLayout setLayout{};
+      check(vkCreateDescriptorSetLayout(
+          m_device, &setLayoutInfo, nullptr, &setLayout));
+      m_setLayouts.push_back(setLayout);
+      for (auto& binding : bindings) {
+        descriptorCounts[binding.descriptorType] +=
+            binding.descriptorCount * m_copies;
+      }
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    pipelineLayoutInfo.setLayoutCount =
+        static_cast<uint32_t>(m_setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = m_setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount =
+        static_cast<uint32_t>(layout.pushConstants.size());
+    pipelineLayoutInfo.pPushConstantRanges = layout.pushConstants.data();
+    check(vkCreatePipelineLayout(
+        m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout));
+
+    if (m_setLayouts.empty() || m_copies == 0 || descriptorCounts.empty()) {
+      return;
+    }
+    std::vector<VkDescriptorPoolSize> poolSizes{};
+    for (auto [type, count] : descriptorCounts) {
+      poolSizes.push_back({type, count});
+    }
+    VkDescriptorPoolCreateInfo poolInfo{
+        VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    poolInfo.maxSets = static_cast<uint32_t>(m_setLayouts.size() * m_copies);
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    check(vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_pool));
+
+    std::vector<VkDescriptorSetLayout> allocateLayouts{};
+    for (uint32_t copy{}; copy < m_copies; ++copy) {
+      allocateLayouts.insert(
+          allocateLayouts.end(), m_setLayouts.begin(), m_setLayouts.end());
+    }
+    VkDescriptorSetAllocateInfo allocateInfo{
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    allocateInfo.descriptorPool = m_pool;
+    allocateInfo.descriptorSetCount =
+        static_cast<uint32_t>(allocateLayouts.size());
+    allocateInfo.pSetLayouts = allocateLayouts.data();
+    m_sets.resize(allocateLayouts.size());
+    check(vkAllocateDescriptorSets(m_device, &allocateInfo, m_sets.data()));
+  }
+
+  void destroy() {
+    // sets go back with their pool
+    if (m_pool != VK_NULL_HANDLE) {
+      vkDestroyDescriptorPool(m_device, m_pool, nullptr);
+    }
+    if (m_pipelineLayout != VK_NULL_HANDLE) {
+      vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+    }
+    for (auto setLayout : m_setLayouts) {
+      vkDestroyDescriptorSetLayout(m_device, setLayout, nullptr);
+    }
+  }
+
+  static void check(VkResult result) {
+    if (result != VK_SUCCESS) {
+      throw std::runtime_error{
+          "Descriptor layout Vulkan call failed: " + std::to_string(result)};
+    }
+  }
+};
@@ -0,0 +1,56 @@
+#include "headless_vulkan.hpp"
+#include "shader_layout.hpp"
+#include <catch2/catch.hpp>
+#include <set>
+
+namespace {
+// What vkaShaderLayout writes for 3d.vert and 3d.frag.
+constexpr VkDescriptorSetLayoutBinding frameSet[]{
+    {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT,
+     nullptr},
+    {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT,
+     nullptr},
+    {2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT,
+     nullptr},
+    {3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT,
+     nullptr}};
+constexpr VkDescriptorSetLayoutBinding drawSet[]{
+    {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1,
+     VK_SHADER_STAGE_VERTEX_BIT, nullptr}};
+constexpr array_view<VkDescriptorSetLayoutBinding> sets[]{
+    {frameSet, 4}, {drawSet, 1}};
+constexpr VkPushConstantRange pushConstants[]{
+    {VK_SHADER_STAGE_FRAGMENT_BIT, 0, 4}};
+constexpr shader_layout layout{{sets, 2}, {pushConstants, 1}, {}, {}};
+static_assert(layout.sets[1][0].binding == 0);
+} // namespace
+
+TEST_CASE("Descriptor layouts come from a shader layout in one batch") {
+  auto vk = headless_vulkan::create();
+  if (!vk) {
+    WARN("No Vulkan device; set VK_ICD_FILENAMES to lavapipe to run this");
+    return;
+  }
+  descriptor_layouts layouts{vk->device, layout, 3};
+  REQUIRE(layouts.pipeline_layout() != VK_NULL_HANDLE);
+  REQUIRE(layouts.set_count() == 2);
+  REQUIRE(layouts.copies() == 3);
+  REQUIRE(layouts.set_layout(0) != layouts.set_layout(1));
+
+  std::set<VkDescriptorSet> distinct{};
+  for (uint32_t copy{}; copy < layouts.copies(); ++copy) {
+    auto copySets = layouts.sets(copy);
+    REQUIRE(copySets.size() == 2);
+    REQUIRE(layouts.set(copy, 1) == copySets[1]);
+    distinct.insert(copySets.begin(), copySets.end());
+  }
+  REQUIRE(distinct.size() == 6);
+  REQUIRE_THROWS_AS(layouts.sets(3), std::out_of_range);
+
+  SECTION("A layout without descriptors still gets a pipeline layout") {
+    descriptor_layouts empty{vk->device, shader_layout{}, 2};
+    REQUIRE(empty.pipeline_layout() != VK_NULL_HANDLE);
+    REQUIRE(empty.set_count() == 0);
+    REQUIRE(empty.sets(1).empty());
+  }
+}
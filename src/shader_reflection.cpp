@@ -0,0 +1,77 @@
+#include "mapped_file.hpp"
+#include "shader_reflection.hpp"
+#include <logger.hpp>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace vka;
+
+// Usage: vkaShaderLayout <name> <output.hpp> [--dynamic-set N]... <spv>...
+// Reflects the descriptor sets, push constants and vertex inputs of every
+// stage and writes them merged into output.hpp as constexpr data in
+// namespace layout_<name>. Buffers in a --dynamic-set get dynamic offsets.
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    multi_logger::get()->critical(
+        "Usage: vkaShaderLayout <name> <output.hpp> [--dynamic-set N]... "
+        "<input.spv>...");
+    return 1;
+  }
+  std::string name{argv[1]};
+  std::string outputPath{argv[2]};
+  std::vector<uint32_t> dynamicSets{};
+  std::vector<std::string> inputPaths{};
+  try {
+    for (int arg{3}; arg < argc; ++arg) {
+      std::string value{argv[arg]};
+      if (value == "--dynamic-set" && arg + 1 < argc) {
+        dynamicSets.push_back(static_cast<uint32_t>(std::stoul(argv[++arg])));
+      } else {
+        inputPaths.push_back(value);
+      }
+    }
+
+    std::vector<shader_interface> stages{};
+    std::vector<std::string> sources{};
+    for (auto& inputPath : inputPaths) {
+      mapped_file code{inputPath};
+      auto bytes = code.bytes();
+      if (bytes.size() % sizeof(uint32_t) != 0) {
+        throw std::runtime_error{inputPath + " is not whole SPIR-V words"};
+      }
+      // mappings are page aligned, so the words can be read in place
+      stages.push_back(reflect_spirv(
+          {reinterpret_cast<const uint32_t*>(bytes.data()),
+           bytes.size() / sizeof(uint32_t)}));
+      sources.push_back(inputPath.substr(inputPath.find_last_of("/\\") + 1));
+    }
+    auto layout = merge_shader_interfaces(stages, dynamicSets);
+
+    std::ostringstream header{};
+    write_shader_layout_header(header, name, layout, sources);
+    // unchanged layouts keep their timestamp, so includers don't rebuild
+    std::ifstream existing{outputPath, std::ios::binary};
+    std::ostringstream existingText{};
+    existingText << existing.rdbuf();
+    if (existingText.str() != header.str()) {
+      std::ofstream out{outputPath, std::ios::binary | std::ios::trunc};
+      out << header.str();
+      if (!out) {
+        throw std::runtime_error{"Unable to write " + outputPath};
+      }
+    }
+    multi_logger::get()->info(
+        "Layout {}: {} set(s), {} push constant range(s), {} vertex input(s)",
+        name,
+        layout.sets.size(),
+        layout.pushConstants.size(),
+        layout.vertexAttributes.size());
+  } catch (const std::exception& error) {
+    multi_logger::get()->critical(
+        "Error generating layout {}: {}", name, error.what());
+    return 1;
+  }
+  return 0;
+}
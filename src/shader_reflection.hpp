@@ -0,0 +1,687 @@
+#pragma once
+#include "array_view.hpp"
+#include <memory_allocator.hpp>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct reflected_descriptor {
+  uint32_t set;
+  uint32_t binding;
+  VkDescriptorType type;
+  uint32_t count;
+};
+
+struct reflected_vertex_input {
+  uint32_t location;
+  VkFormat format;
+};
+
+// Resource interface of one SPIR-V module, read from its types and
+// decorations: the descriptors it declares, the size of its push constant
+// block (0 without one) and, for a vertex shader, its located inputs.
+struct shader_interface {
+  VkShaderStageFlagBits stage;
+  std::vector<reflected_descriptor> descriptors;
+  uint32_t pushConstantSize;
+  std::vector<reflected_vertex_input> vertexInputs;
+};
+
+namespace spirv_detail {
+constexpr uint32_t magic = 0x07230203;
+
+enum op : uint16_t {
+  OpEntryPoint = 15,
+  OpTypeInt = 21,
+  OpTypeFloat = 22,
+  OpTypeVector = 23,
+  OpTypeMatrix = 24,
+  OpTypeImage = 25,
+  OpTypeSampler = 26,
+  OpTypeSampledImage = 27,
+  OpTypeArray = 28,
+  OpTypeRuntimeArray = 29,
+  OpTypeStruct = 30,
+  OpTypePointer = 32,
+  OpConstant = 43,
+  OpVariable = 59,
+  OpDecorate = 71,
+  OpMemberDecorate = 72
+};
+
+enum decoration : uint32_t {
+  BufferBlock = 3,
+  ArrayStride = 6,
+  MatrixStride = 7,
+  BuiltIn = 11,
+  Location = 30,
+  Binding = 33,
+  DescriptorSet = 34,
+  Offset = 35
+};
+
+enum storage_class : uint32_t {
+  UniformConstant = 0,
+  Input = 1,
+  Uniform = 2,
+  PushConstant = 9,
+  StorageBuffer = 12
+};
+
+struct decorations {
+  std::map<uint32_t, uint32_t> values;
+  bool has(uint32_t decoration) const { return values.count(decoration) > 0; }
+  uint32_t get(uint32_t decoration) const {
+    auto found = values.find(decoration);
+    return found == values.end() ? 0 : found->second;
+  }
+};
+
+struct module {
+  // operands after the result id, keyed by result id
+  std::unordered_map<uint32_t, std::pair<uint16_t, std::vector<uint32_t>>>
+      types;
+  std::unordered_map<uint32_t, uint32_t> constants;
+  std::unordered_map<uint32_t, decorations> decorated;
+  std::unordered_map<uint32_t, std::vector<decorations>> memberDecorated;
+  // result id, pointer type, storage class
+  std::vector<std::array<uint32_t, 3>> variables;
+  std::optional<uint32_t> executionModel;
+
+  const std::pair<uint16_t, std::vector<uint32_t>>& type(uint32_t id) const {
+    auto found = types.find(id);
+    if (found == types.end()) {
+      throw std::runtime_error{"SPIR-V references undeclared type"};
+    }
+    return found->second;
+  }
+
+  uint32_t array_length(const std::vector<uint32_t>& arrayOperands) const {
+    auto found = constants.find(arrayOperands.at(1));
+    if (found == constants.end()) {
+      throw std::runtime_error{"SPIR-V array length is not a constant"};
+    }
+    return found->second;
+  }
+
+  // Bytes the type occupies under its explicit layout decorations.
+  uint32_t size_of(uint32_t id, uint32_t matrixStride = 0) const {
+    auto& [opcode, operands] = type(id);
+    switch (opcode) {
+    case OpTypeInt:
+    case OpTypeFloat:
+      return operands.at(0) / 8;
+    case OpTypeVector:
+      return operands.at(1) * size_of(operands.at(0));
+    case OpTypeMatrix:
+      return operands.at(1) *
+             (matrixStride != 0 ? matrixStride : size_of(operands.at(0)));
+    case OpTypeArray: {
+      auto stride = decorated.count(id) ? decorated.at(id).get(ArrayStride)
+                                        : 0;
+      return array_length(operands) *
+             (stride != 0 ? stride : size_of(operands.at(0)));
+    }
+    case OpTypeStruct: {
+      uint32_t size{};
+      auto members = memberDecorated.find(id);
+      for (size_t member{}; member < operands.size(); ++member) {
+        decorations memberDecorations{};
+        if (members != memberDecorated.end() &&
+            member < members->second.size()) {
+          memberDecorations = members->second[member];
+        }
+        if (!memberDecorations.has(Offset)) {
+          throw std::runtime_error{"SPIR-V block member has no Offset"};
+        }
+        size = std::max(
+            size,
+            memberDecorations.get(Offset) +
+                size_of(
+                    operands[member], memberDecorations.get(MatrixStride)));
+      }
+      return size;
+    }
+    default:
+      throw std::runtime_error{
+          "SPIR-V type " + std::to_string(opcode) + " has no size"};
+    }
+  }
+};
+
+inline module parse(array_view<uint32_t> words) {
+  if (words.size() < 5 || words[0] != magic) {
+    throw std::runtime_error{"Not a SPIR-V module"};
+  }
+  module parsed{};
+  for (size_t at{5}; at < words.size();) {
+    auto opcode = static_cast<uint16_t>(words[at] & 0xffff);
+    auto wordCount = words[at] >> 16;
+    if (wordCount == 0 || at + wordCount > words.size()) {
+      throw std::runtime_error{"Truncated SPIR-V instruction"};
+    }
+    std::vector<uint32_t> operands(
+        words.begin() + at + 1, words.begin() + at + wordCount);
+    auto tail = [&](size_t from) {
+      return std::vector<uint32_t>(operands.begin() + from, operands.end());
+    };
+    switch (opcode) {
+    case OpEntryPoint:
+      if (!parsed.executionModel) {
+        parsed.executionModel = operands.at(0);
+      }
+      break;
+    case OpTypeInt:
+    case OpTypeFloat:
+    case OpTypeVector:
+    case OpTypeMatrix:
+    case OpTypeImage:
+    case OpTypeSampler:
+    case OpTypeSampledImage:
+    case OpTypeArray:
+    case OpTypeRuntimeArray:
+    case OpTypeStruct:
+    case OpTypePointer:
+      parsed.types[operands.at(0)] = {opcode, tail(1)};
+      break;
+    case OpConstant:
+      // 32-bit constants only; array lengths never need more
+      parsed.constants[operands.at(1)] = operands.at(2);
+      break;
+    case OpVariable:
+      parsed.variables.push_back(
+          {operands.at(1), operands.at(0), operands.at(2)});
+      break;
+    case OpDecorate:
+      parsed.decorated[operands.at(0)].values[operands.at(1)] =
+          operands.size() > 2 ? operands[2] : 1;
+      break;
+    case OpMemberDecorate: {
+      auto& members = parsed.memberDecorated[operands.at(0)];
+      auto member = operands.at(1);
+      if (members.size() <= member) {
+        members.resize(member + 1);
+      }
+      members[member].values[operands.at(2)] =
+          operands.size() > 3 ? operands[3] : 1;
+      break;
+    }
+    default:
+      break;
+    }
+    at += wordCount;
+  }
+  if (!parsed.executionModel) {
+    throw std::runtime_error{"SPIR-V module has no entry point"};
+  }
+  return parsed;
+}
+
+inline VkShaderStageFlagBits stage_of(uint32_t executionModel) {
+  switch (executionModel) {
+  case 0:
+    return VK_SHADER_STAGE_VERTEX_BIT;
+  case 1:
+    return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+  case 2:
+    return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+  case 3:
+    return VK_SHADER_STAGE_GEOMETRY_BIT;
+  case 4:
+    return VK_SHADER_STAGE_FRAGMENT_BIT;
+  case 5:
+    return VK_SHADER_STAGE_COMPUTE_BIT;
+  default:
+    throw std::runtime_error{
+        "Unsupported SPIR-V execution model " +
+        std::to_string(executionModel)};
+  }
+}
+
+inline VkDescriptorType descriptor_type(
+    const module& parsed,
+    uint32_t typeId,
+    uint32_t storageClass) {
+  auto& [opcode, operands] = parsed.type(typeId);
+  if (storageClass == StorageBuffer) {
+    return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  }
+  if (storageClass == Uniform) {
+    auto found = parsed.decorated.find(typeId);
+    return found != parsed.decorated.end() && found->second.has(BufferBlock)
+               ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+               : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  }
+  switch (opcode) {
+  case OpTypeSampler:
+    return VK_DESCRIPTOR_TYPE_SAMPLER;
+  case OpTypeSampledImage: {
+    auto& image = parsed.type(operands.at(0)).second;
+    // a sampled buffer image is a texel buffer even when combined
+    return image.at(1) == 5 ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER
+                            : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  }
+  case OpTypeImage: {
+    auto dim = operands.at(1);
+    auto sampled = operands.at(5);
+    if (dim == 6) {
+      return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    }
+    if (dim == 5) {
+      return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER
+                          : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+    }
+    return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
+                        : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  }
+  default:
+    throw std::runtime_error{
+        "Unsupported SPIR-V descriptor type " + std::to_string(opcode)};
+  }
+}
+
+inline VkFormat vertex_format(const module& parsed, uint32_t typeId) {
+  auto& [opcode, operands] = parsed.type(typeId);
+  uint32_t components{1};
+  auto scalarId = typeId;
+  if (opcode == OpTypeVector) {
+    components = operands.at(1);
+    scalarId = operands.at(0);
+  }
+  auto& [scalarOpcode, scalar] = parsed.type(scalarId);
+  if ((scalarOpcode != OpTypeFloat && scalarOpcode != OpTypeInt) ||
+      scalar.at(0) != 32 || components < 1 || components > 4) {
+    throw std::runtime_error{
+        "Vertex inputs must be 32-bit scalars or vectors"};
+  }
+  static constexpr VkFormat floats[]{
+      VK_FORMAT_R32_SFLOAT,
+      VK_FORMAT_R32G32_SFLOAT,
+      VK_FORMAT_R32G32B32_SFLOAT,
+      VK_FORMAT_R32G32B32A32_SFLOAT};
+  static constexpr VkFormat signedInts[]{
+      VK_FORMAT_R32_SINT,
+      VK_FORMAT_R32G32_SINT,
+      VK_FORMAT_R32G32B32_SINT,
+      VK_FORMAT_R32G32B32A32_SINT};
+  static constexpr VkFormat unsignedInts[]{
+      VK_FORMAT_R32_UINT,
+      VK_FORMAT_R32G32_UINT,
+      VK_FORMAT_R32G32B32_UINT,
+      VK_FORMAT_R32G32B32A32_UINT};
+  if (scalarOpcode == OpTypeFloat) {
+    return floats[components - 1];
+  }
+  return scalar.at(1) != 0 ? signedInts[components - 1]
+                           : unsignedInts[components - 1];
+}
+} // namespace spirv_detail
+
+inline shader_interface reflect_spirv(array_view<uint32_t> words) {
+  using namespace spirv_detail;
+  auto parsed = parse(words);
+  shader_interface result{};
+  result.stage = stage_of(*parsed.executionModel);
+  for (auto [id, pointerId, storageClass] : parsed.variables) {
+    auto& pointer = parsed.type(pointerId);
+    if (pointer.first != OpTypePointer) {
+      throw std::runtime_error{"SPIR-V variable is not a pointer"};
+    }
+    auto typeId = pointer.second.at(1);
+    decorations variable{};
+    if (parsed.decorated.count(id)) {
+      variable = parsed.decorated.at(id);
+    }
+    switch (storageClass) {
+    case Input:
+      if (result.stage == VK_SHADER_STAGE_VERTEX_BIT &&
+          variable.has(Location) && !variable.has(BuiltIn)) {
+        result.vertexInputs.push_back(
+            {variable.get(Location), vertex_format(parsed, typeId)});
+      }
+      break;
+    case PushConstant:
+      result.pushConstantSize =
+          std::max(result.pushConstantSize, parsed.size_of(typeId));
+      break;
+    case UniformConstant:
+    case Uniform:
+    case StorageBuffer: {
+      if (!variable.has(DescriptorSet) || !variable.has(Binding)) {
+        throw std::runtime_error{"SPIR-V descriptor has no set or binding"};
+      }
+      uint32_t count{1};
+      for (;;) {
+        auto& [opcode, operands] = parsed.type(typeId);
+        if (opcode == OpTypeRuntimeArray) {
+          throw std::runtime_error{"Unsized descriptor arrays are unsupported"};
+        }
+        if (opcode != OpTypeArray) {
+          break;
+        }
+        count *= parsed.array_length(operands);
+        typeId = operands.at(0);
+      }
+      result.descriptors.push_back(
+          {variable.get(DescriptorSet),
+           variable.get(Binding),
+           descriptor_type(parsed, typeId, storageClass),
+           count});
+      break;
+    }
+    default:
+      break;
+    }
+  }
+  std::sort(
+      result.vertexInputs.begin(),
+      result.vertexInputs.end(),
+      [](auto& a, auto& b) { return a.location < b.location; });
+  return result;
+}
+
+// Layout of a whole pipeline merged from its stages' interfaces. Stages
+// sharing a set and binding must declare the same descriptor; that mismatch
+// is an error here rather than a validation message at draw time.
+struct shader_layout_description {
+  // indexed by set; a set no stage uses stays empty so indices line up
+  std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets;
+  std::vector<VkPushConstantRange> pushConstants;
+  std::vector<VkVertexInputBindingDescription> vertexBindings;
+  std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+};
+
+inline uint32_t vertex_format_size(VkFormat format) {
+  switch (format) {
+  case VK_FORMAT_R32_SFLOAT:
+  case VK_FORMAT_R32_SINT:
+  case VK_FORMAT_R32_UINT:
+    return 4;
+  case VK_FORMAT_R32G32_SFLOAT:
+  case VK_FORMAT_R32G32_SINT:
+  case VK_FORMAT_R32G32_UINT:
+    return 8;
+  case VK_FORMAT_R32G32B32_SFLOAT:
+  case VK_FORMAT_R32G32B32_SINT:
+  case VK_FORMAT_R32G32B32_UINT:
+    return 12;
+  case VK_FORMAT_R32G32B32A32_SFLOAT:
+  case VK_FORMAT_R32G32B32A32_SINT:
+  case VK_FORMAT_R32G32B32A32_UINT:
+    return 16;
+  default:
+    throw std::invalid_argument{"Unsupported vertex format"};
+  }
+}
+
+// Buffers in `dynamicSets` become dynamic descriptors, for sets rebound per
+// draw at a new offset rather than rewritten. Each vertex input gets its own
+// tightly packed stream, binding number equal to its location, as
+// packed_mesh stores positions and normals.
+inline shader_layout_description merge_shader_interfaces(
+    const std::vector<shader_interface>& stages,
+    const std::vector<uint32_t>& dynamicSets = {}) {
+  shader_layout_description result{};
+  VkShaderStageFlags seenStages{};
+  VkPushConstantRange pushConstants{};
+  for (auto& stage : stages) {
+    if (seenStages & stage.stage) {
+      throw std::invalid_argument{"Two shaders for the same stage"};
+    }
+    seenStages |= stage.stage;
+
+    for (auto descriptor : stage.descriptors) {
+      bool dynamic =
+          std::find(dynamicSets.begin(), dynamicSets.end(), descriptor.set) !=
+          dynamicSets.end();
+      if (dynamic &&
+          descriptor.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
+        descriptor.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+      } else if (
+          dynamic && descriptor.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) {
+        descriptor.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+      }
+      if (result.sets.size() <= descriptor.set) {
+        result.sets.resize(descriptor.set + 1);
+      }
+      auto& bindings = result.sets[descriptor.set];
+      auto existing = std::find_if(
+          bindings.begin(), bindings.end(), [&](auto& binding) {
+            return binding.binding == descriptor.binding;
+          });
+      if (existing == bindings.end()) {
+        bindings.push_back(
+            {descriptor.binding,
+             descriptor.type,
+             descriptor.count,
+             static_cast<VkShaderStageFlags>(stage.stage),
+             nullptr});
+      } else if (
+          existing->descriptorType != descriptor.type ||
+          existing->descriptorCount != descriptor.count) {
+        throw std::runtime_error{
+            "Set " + std::to_string(descriptor.set) + " binding " +
+            std::to_string(descriptor.binding) +
+            " is declared differently by two stages"};
+      } else {
+        existing->stageFlags |= stage.stage;
+      }
+    }
+
+    // one range covering every stage's block keeps vkCmdPushConstants calls
+    // free of per-stage offsets
+    if (stage.pushConstantSize != 0) {
+      pushConstants.stageFlags |= stage.stage;
+      pushConstants.size = std::max(pushConstants.size, stage.pushConstantSize);
+    }
+
+    for (auto& input : stage.vertexInputs) {
+      result.vertexBindings.push_back(
+          {input.location,
+           vertex_format_size(input.format),
+           VK_VERTEX_INPUT_RATE_VERTEX});
+      result.vertexAttributes.push_back(
+          {input.location, input.location, input.format, 0});
+    }
+  }
+  for (auto& bindings : result.sets) {
+    std::sort(bindings.begin(), bindings.end(), [](auto& a, auto& b) {
+      return a.binding < b.binding;
+    });
+  }
+  if (pushConstants.size != 0) {
+    result.pushConstants.push_back(pushConstants);
+  }
+  return result;
+}
+
+namespace shader_layout_detail {
+inline std::string stage_flags_name(VkShaderStageFlags flags) {
+  static const std::pair<VkShaderStageFlagBits, const char*> names[]{
+      {VK_SHADER_STAGE_VERTEX_BIT, "VK_SHADER_STAGE_VERTEX_BIT"},
+      {VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT,
+       "VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT"},
+      {VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT,
+       "VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT"},
+      {VK_SHADER_STAGE_GEOMETRY_BIT, "VK_SHADER_STAGE_GEOMETRY_BIT"},
+      {VK_SHADER_STAGE_FRAGMENT_BIT, "VK_SHADER_STAGE_FRAGMENT_BIT"},
+      {VK_SHADER_STAGE_COMPUTE_BIT, "VK_SHADER_STAGE_COMPUTE_BIT"}};
+  std::string result{};
+  for (auto [bit, name] : names) {
+    if (flags & bit) {
+      result += result.empty() ? name : std::string{" | "} + name;
+    }
+  }
+  return result;
+}
+
+inline const char* descriptor_type_name(VkDescriptorType type) {
+  switch (type) {
+  case VK_DESCRIPTOR_TYPE_SAMPLER:
+    return "VK_DESCRIPTOR_TYPE_SAMPLER";
+  case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+    return "VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER";
+  case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+    return "VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE";
+  case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+    return "VK_DESCRIPTOR_TYPE_STORAGE_IMAGE";
+  case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+    return "VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER";
+  case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+    return "VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER";
+  case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+    return "VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER";
+  case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+    return "VK_DESCRIPTOR_TYPE_STORAGE_BUFFER";
+  case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+    return "VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC";
+  case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+    return "VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC";
+  case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+    return "VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT";
+  default:
+    throw std::invalid_argument{"Unknown descriptor type"};
+  }
+}
+
+inline const char* format_name(VkFormat format) {
+  switch (format) {
+  case VK_FORMAT_R32_SFLOAT:
+    return "VK_FORMAT_R32_SFLOAT";
+  case VK_FORMAT_R32G32_SFLOAT:
+    return "VK_FORMAT_R32G32_SFLOAT";
+  case VK_FORMAT_R32G32B32_SFLOAT:
+    return "VK_FORMAT_R32G32B32_SFLOAT";
+  case VK_FORMAT_R32G32B32A32_SFLOAT:
+    return "VK_FORMAT_R32G32B32A32_SFLOAT";
+  case VK_FORMAT_R32_SINT:
+    return "VK_FORMAT_R32_SINT";
+  case VK_FORMAT_R32G32_SINT:
+    return "VK_FORMAT_R32G32_SINT";
+  case VK_FORMAT_R32G32B32_SINT:
+    return "VK_FORMAT_R32G32B32_SINT";
+  case VK_FORMAT_R32G32B32A32_SINT:
+    return "VK_FORMAT_R32G32B32A32_SINT";
+  case VK_FORMAT_R32_UINT:
+    return "VK_FORMAT_R32_UINT";
+  case VK_FORMAT_R32G32_UINT:
+    return "VK_FORMAT_R32G32_UINT";
+  case VK_FORMAT_R32G32B32_UINT:
+    return "VK_FORMAT_R32G32B32_UINT";
+  case VK_FORMAT_R32G32B32A32_UINT:
+    return "VK_FORMAT_R32G32B32A32_UINT";
+  default:
+    throw std::invalid_argument{"Unsupported vertex format"};
+  }
+}
+
+// `name[]{...};` for a non-empty list, and the matching array_view
+// initializer, which is `{}` when there is nothing to point at.
+template <typename T, typename Write>
+std::string write_array(
+    std::ostream& out,
+    const char* type,
+    const std::string& name,
+    const std::vector<T>& items,
+    Write write) {
+  if (items.empty()) {
+    return "{}";
+  }
+  out << "constexpr " << type << " " << name << "[]{\n";
+  for (auto& item : items) {
+    out << "    {";
+    write(item);
+    out << "},\n";
+  }
+  out << "};\n";
+  return "{" + name + ", " + std::to_string(items.size()) + "}";
+}
+} // namespace shader_layout_detail
+
+// Writes `layout` as a header of constexpr data in namespace layout_<name>,
+// whose `layout` member is the shader_layout to hand to descriptor_layouts.
+inline void write_shader_layout_header(
+    std::ostream& out,
+    const std::string& name,
+    const shader_layout_description& layout,
+    const std::vector<std::string>& sources) {
+  using namespace shader_layout_detail;
+  if (name.empty() || !std::all_of(name.begin(), name.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+      })) {
+    throw std::invalid_argument{"Layout name must be an identifier: " + name};
+  }
+  out << "// Generated by vkaShaderLayout";
+  for (size_t source{}; source < sources.size(); ++source) {
+    out << (source == 0 ? " from " : " ") << sources[source];
+  }
+  out << "; do not edit.\n"
+         "#pragma once\n"
+         "#include \"shader_layout.hpp\"\n\n"
+         "namespace layout_"
+      << name << " {\n";
+
+  std::vector<std::string> sets{};
+  for (size_t set{}; set < layout.sets.size(); ++set) {
+    sets.push_back(write_array(
+        out,
+        "VkDescriptorSetLayoutBinding",
+        "set" + std::to_string(set),
+        layout.sets[set],
+        [&](const VkDescriptorSetLayoutBinding& binding) {
+          out << binding.binding << ", "
+              << descriptor_type_name(binding.descriptorType) << ", "
+              << binding.descriptorCount << ", "
+              << stage_flags_name(binding.stageFlags) << ", nullptr";
+        }));
+  }
+  auto setsView = write_array(
+      out,
+      "array_view<VkDescriptorSetLayoutBinding>",
+      "sets",
+      sets,
+      [&](const std::string& set) {
+        // strip the braces the set initializer already carries
+        out << set.substr(1, set.size() - 2);
+      });
+  auto pushConstantsView = write_array(
+      out,
+      "VkPushConstantRange",
+      "pushConstants",
+      layout.pushConstants,
+      [&](const VkPushConstantRange& range) {
+        out << stage_flags_name(range.stageFlags) << ", " << range.offset
+            << ", " << range.size;
+      });
+  auto vertexBindingsView = write_array(
+      out,
+      "VkVertexInputBindingDescription",
+      "vertexBindings",
+      layout.vertexBindings,
+      [&](const VkVertexInputBindingDescription& binding) {
+        out << binding.binding << ", " << binding.stride
+            << ", VK_VERTEX_INPUT_RATE_VERTEX";
+      });
+  auto vertexAttributesView = write_array(
+      out,
+      "VkVertexInputAttributeDescription",
+      "vertexAttributes",
+      layout.vertexAttributes,
+      [&](const VkVertexInputAttributeDescription& attribute) {
+        out << attribute.location << ", " << attribute.binding << ", "
+            << format_name(attribute.format) << ", " << attribute.offset;
+      });
+  out << "constexpr shader_layout layout{\n"
+      << "    " << setsView << ",\n"
+      << "    " << pushConstantsView << ",\n"
+      << "    " << vertexBindingsView << ",\n"
+      << "    " << vertexAttributesView << "};\n"
+      << "} // namespace layout_" << name << "\n";
+}
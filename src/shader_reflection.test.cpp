@@ -0,0 +1,287 @@
+#include "shader_reflection.hpp"
+#include <catch2/catch.hpp>
+#include <initializer_list>
+#include <sstream>
+
+namespace {
+// Assembles just enough SPIR-V to stand in for glslangValidator output.
+struct spirv_builder {
+  std::vector<uint32_t> words{spirv_detail::magic, 0x10000, 0, 64, 0};
+
+  spirv_builder& op(uint16_t opcode, std::initializer_list<uint32_t> operands) {
+    words.push_back(static_cast<uint32_t>(operands.size() + 1) << 16 | opcode);
+    words.insert(words.end(), operands);
+    return *this;
+  }
+  spirv_builder& entry_point(uint32_t executionModel) {
+    // OpEntryPoint model %100 "main"
+    return op(15, {executionModel, 100, 0x6e69616d, 0});
+  }
+  spirv_builder& decorate(uint32_t id, std::initializer_list<uint32_t> rest) {
+    std::vector<uint32_t> operands{id};
+    operands.insert(operands.end(), rest);
+    words.push_back(static_cast<uint32_t>(operands.size() + 1) << 16 | 71);
+    words.insert(words.end(), operands.begin(), operands.end());
+    return *this;
+  }
+  array_view<uint32_t> view() const { return {words.data(), words.size()}; }
+};
+
+enum : uint32_t {
+  Vertex = 0,
+  Fragment = 4,
+  UniformConstant = 0,
+  Input = 1,
+  Uniform = 2,
+  PushConstant = 9,
+  Block = 2,
+  BufferBlock = 3,
+  ArrayStride = 6,
+  MatrixStride = 7,
+  BuiltIn = 11,
+  Location = 30,
+  Binding = 33,
+  DescriptorSet = 34,
+  Offset = 35
+};
+
+// 3d.vert: Camera at set 0 binding 3, Instance at set 1 binding 0, vec3
+// position and normal inputs, plus gl_VertexIndex.
+spirv_builder vertex_module() {
+  spirv_builder module{};
+  module.entry_point(Vertex)
+      .decorate(5, {Block})
+      .op(72, {5, 0, Offset, 0})
+      .op(72, {5, 0, MatrixStride, 16})
+      .op(72, {5, 1, Offset, 64})
+      .op(72, {5, 1, MatrixStride, 16})
+      .decorate(6, {Block})
+      .op(72, {6, 0, Offset, 0})
+      .op(72, {6, 0, MatrixStride, 16})
+      .decorate(10, {DescriptorSet, 0})
+      .decorate(10, {Binding, 3})
+      .decorate(11, {DescriptorSet, 1})
+      .decorate(11, {Binding, 0})
+      .decorate(12, {Location, 0})
+      .decorate(13, {Location, 1})
+      .decorate(16, {BuiltIn, 42})
+      .op(22, {1, 32})     // float
+      .op(23, {2, 1, 3})   // vec3
+      .op(23, {3, 1, 4})   // vec4
+      .op(24, {4, 3, 4})   // mat4
+      .op(30, {5, 4, 4})   // Camera
+      .op(30, {6, 4})      // Instance
+      .op(32, {7, Uniform, 5})
+      .op(32, {8, Uniform, 6})
+      .op(32, {9, Input, 2})
+      .op(21, {14, 32, 1}) // int
+      .op(32, {15, Input, 14})
+      .op(59, {7, 10, Uniform})
+      .op(59, {8, 11, Uniform})
+      .op(59, {9, 13, Input})
+      .op(59, {9, 12, Input})
+      .op(59, {15, 16, Input});
+  return module;
+}
+
+// 3d.frag: uint material index push constant, Materials storage buffer at
+// set 0 binding 0 and LightUniform at binding 2, plus four textures at set 2.
+spirv_builder fragment_module() {
+  spirv_builder module{};
+  module.entry_point(Fragment)
+      .decorate(2, {Block})
+      .op(72, {2, 0, Offset, 0})
+      .op(72, {7, 0, Offset, 0})
+      .decorate(8, {ArrayStride, 16})
+      .decorate(9, {BufferBlock})
+      .op(72, {9, 0, Offset, 0})
+      .decorate(11, {DescriptorSet, 0})
+      .decorate(11, {Binding, 0})
+      .decorate(12, {Block})
+      .op(72, {12, 0, Offset, 0})
+      .op(72, {12, 1, Offset, 16})
+      .decorate(14, {DescriptorSet, 0})
+      .decorate(14, {Binding, 2})
+      .decorate(16, {Location, 0})
+      .decorate(22, {DescriptorSet, 2})
+      .decorate(22, {Binding, 0})
+      .op(21, {1, 32, 0})              // uint
+      .op(30, {2, 1})                  // PushConstants
+      .op(32, {3, PushConstant, 2})
+      .op(22, {5, 32})                 // float
+      .op(23, {6, 5, 4})               // vec4
+      .op(30, {7, 6})                  // Material
+      .op(29, {8, 7})                  // Material[]
+      .op(30, {9, 8})                  // Materials
+      .op(32, {10, Uniform, 9})
+      .op(30, {12, 6, 1})              // LightUniform
+      .op(32, {13, Uniform, 12})
+      .op(32, {15, Input, 6})
+      .op(25, {17, 5, 1, 0, 0, 0, 1, 0}) // texture2D
+      .op(27, {18, 17})                // sampler2D
+      .op(43, {1, 19, 4})
+      .op(28, {20, 18, 19})            // sampler2D[4]
+      .op(32, {21, UniformConstant, 20})
+      .op(59, {3, 4, PushConstant})
+      .op(59, {10, 11, Uniform})
+      .op(59, {13, 14, Uniform})
+      .op(59, {15, 16, Input})
+      .op(59, {21, 22, UniformConstant});
+  return module;
+}
+
+bool same(
+    const VkDescriptorSetLayoutBinding& binding,
+    uint32_t number,
+    VkDescriptorType type,
+    uint32_t count,
+    VkShaderStageFlags stages) {
+  return binding.binding == number && binding.descriptorType == type &&
+         binding.descriptorCount == count && binding.stageFlags == stages;
+}
+} // namespace
+
+TEST_CASE("SPIR-V reflection reads descriptors, push constants and inputs") {
+  auto vertex = reflect_spirv(vertex_module().view());
+  REQUIRE(vertex.stage == VK_SHADER_STAGE_VERTEX_BIT);
+  REQUIRE(vertex.pushConstantSize == 0);
+  REQUIRE(vertex.descriptors.size() == 2);
+  // the built-in gl_VertexIndex is not a vertex attribute
+  REQUIRE(vertex.vertexInputs.size() == 2);
+  REQUIRE(vertex.vertexInputs[0].location == 0);
+  REQUIRE(vertex.vertexInputs[1].location == 1);
+  REQUIRE(vertex.vertexInputs[1].format == VK_FORMAT_R32G32B32_SFLOAT);
+
+  auto fragment = reflect_spirv(fragment_module().view());
+  REQUIRE(fragment.stage == VK_SHADER_STAGE_FRAGMENT_BIT);
+  REQUIRE(fragment.pushConstantSize == sizeof(uint32_t));
+  // fragment inputs come from the previous stage, not vertex buffers
+  REQUIRE(fragment.vertexInputs.empty());
+  REQUIRE(fragment.descriptors.size() == 3);
+  auto& textures = fragment.descriptors[2];
+  REQUIRE(textures.set == 2);
+  REQUIRE(textures.type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+  REQUIRE(textures.count == 4);
+
+  SECTION("Not SPIR-V") {
+    std::vector<uint32_t> words{1, 2, 3, 4, 5};
+    REQUIRE_THROWS(reflect_spirv({words.data(), words.size()}));
+  }
+  SECTION("Truncated instruction") {
+    auto module = vertex_module();
+    module.words.pop_back();
+    REQUIRE_THROWS(reflect_spirv(module.view()));
+  }
+}
+
+TEST_CASE("Stage interfaces merge into one pipeline layout") {
+  auto vertex = reflect_spirv(vertex_module().view());
+  auto fragment = reflect_spirv(fragment_module().view());
+  auto layout = merge_shader_interfaces({vertex, fragment}, {1});
+
+  REQUIRE(layout.sets.size() == 3);
+  REQUIRE(layout.sets[0].size() == 3);
+  REQUIRE(same(
+      layout.sets[0][0],
+      0,
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+      1,
+      VK_SHADER_STAGE_FRAGMENT_BIT));
+  REQUIRE(same(
+      layout.sets[0][1],
+      2,
+      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+      1,
+      VK_SHADER_STAGE_FRAGMENT_BIT));
+  REQUIRE(same(
+      layout.sets[0][2],
+      3,
+      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+      1,
+      VK_SHADER_STAGE_VERTEX_BIT));
+  REQUIRE(layout.sets[1].size() == 1);
+  REQUIRE(same(
+      layout.sets[1][0],
+      0,
+      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+      1,
+      VK_SHADER_STAGE_VERTEX_BIT));
+  REQUIRE(layout.sets[2].size() == 1);
+
+  REQUIRE(layout.pushConstants.size() == 1);
+  REQUIRE(layout.pushConstants[0].stageFlags == VK_SHADER_STAGE_FRAGMENT_BIT);
+  REQUIRE(layout.pushConstants[0].size == sizeof(uint32_t));
+
+  // one tightly packed stream per input, as packed_mesh stores them
+  REQUIRE(layout.vertexBindings.size() == 2);
+  REQUIRE(layout.vertexAttributes.size() == 2);
+  for (uint32_t location{}; location < 2; ++location) {
+    REQUIRE(layout.vertexBindings[location].binding == location);
+    REQUIRE(layout.vertexBindings[location].stride == 12);
+    REQUIRE(layout.vertexAttributes[location].location == location);
+    REQUIRE(layout.vertexAttributes[location].binding == location);
+    REQUIRE(layout.vertexAttributes[location].offset == 0);
+  }
+
+  SECTION("A binding both stages use carries both stage bits") {
+    auto shared = vertex;
+    shared.descriptors[0].binding = 2;
+    shared.descriptors[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    auto merged = merge_shader_interfaces({shared, fragment});
+    REQUIRE(merged.sets[0].size() == 2);
+    REQUIRE(
+        merged.sets[0][1].stageFlags ==
+        (VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT));
+  }
+  SECTION("Stages disagreeing on a binding are an error") {
+    auto mismatched = vertex;
+    mismatched.descriptors[0].binding = 0;
+    REQUIRE_THROWS_AS(
+        merge_shader_interfaces({mismatched, fragment}), std::runtime_error);
+  }
+  SECTION("Two shaders for one stage are an error") {
+    REQUIRE_THROWS_AS(
+        merge_shader_interfaces({vertex, vertex}), std::invalid_argument);
+  }
+}
+
+TEST_CASE("Layout headers hold the merged layout as constexpr data") {
+  auto layout = merge_shader_interfaces(
+      {reflect_spirv(vertex_module().view()),
+       reflect_spirv(fragment_module().view())},
+      {1});
+  std::ostringstream out{};
+  write_shader_layout_header(out, "3d", layout, {"3d.vert.spv", "3d.frag.spv"});
+  auto header = out.str();
+  auto contains = [&](const std::string& text) {
+    return header.find(text) != std::string::npos;
+  };
+  REQUIRE(contains("from 3d.vert.spv 3d.frag.spv"));
+  REQUIRE(contains("namespace layout_3d {"));
+  REQUIRE(contains(
+      "{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, "
+      "VK_SHADER_STAGE_VERTEX_BIT, nullptr}"));
+  REQUIRE(contains(
+      "{0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4, "
+      "VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}"));
+  REQUIRE(contains("{set0, 3},\n    {set1, 1},\n    {set2, 1},"));
+  REQUIRE(contains("{VK_SHADER_STAGE_FRAGMENT_BIT, 0, 4}"));
+  REQUIRE(contains("{1, 1, VK_FORMAT_R32G32B32_SFLOAT, 0}"));
+  REQUIRE(contains(
+      "constexpr shader_layout layout{\n    {sets, 3},\n    "
+      "{pushConstants, 1},\n    {vertexBindings, 2},\n    "
+      "{vertexAttributes, 2}};"));
+
+  SECTION("Empty lists become empty views") {
+    std::ostringstream empty{};
+    write_shader_layout_header(empty, "empty", {}, {});
+    REQUIRE(
+        empty.str().find("layout{\n    {},\n    {},\n    {},\n    {}};") !=
+        std::string::npos);
+  }
+  SECTION("Names must be identifiers") {
+    REQUIRE_THROWS_AS(
+        write_shader_layout_header(out, "3d.vert", layout, {}),
+        std::invalid_argument);
+  }
+}
@@ -3,12 +3,12 @@
 layout (location = 0) in vec3 inPos;
 layout (location = 1) in vec3 inNormal;
 
-layout (set = 3, binding = 3) uniform Camera {
+layout (set = 0, binding = 3) uniform Camera {
   mat4 view;
   mat4 projection;
 } camera;
 
-layout (set = 4, binding = 4) uniform Instance {
+layout (set = 1, binding = 0) uniform Instance {
   mat4 model;
 } instance;
 
@@ -0,0 +1,80 @@
+#include "headless_vulkan.hpp"
+#include "swapchain_resources.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+// Swapchain recreation latency on a headless surface, e.g. lavapipe's
+// VK_EXT_headless_surface, while a window is dragged through a range of
+// sizes. Only the swapchain, its views and framebuffers are rebuilt;
+// pipelines use dynamic viewport and scissor and are untouched.
+
+constexpr size_t resizeCount = 200;
+
+int main() {
+  auto vk = headless_vulkan::create(true);
+  if (!vk) {
+    std::printf(
+        "No presentable Vulkan device; set VK_ICD_FILENAMES to lavapipe to "
+        "run this\n");
+    return 0;
+  }
+  VkAttachmentDescription attachment{};
+  attachment.format = VK_FORMAT_B8G8R8A8_UNORM;
+  attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  VkAttachmentReference colorReference{
+      0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorReference;
+  VkRenderPassCreateInfo renderPassInfo{
+      VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
+  renderPassInfo.attachmentCount = 1;
+  renderPassInfo.pAttachments = &attachment;
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  VkRenderPass renderPass{};
+  vkCreateRenderPass(vk->device, &renderPassInfo, nullptr, &renderPass);
+
+  std::printf(
+      "%-12s %8s %10s %10s %10s\n",
+      "min images",
+      "resizes",
+      "avg ms",
+      "max ms",
+      "images");
+  for (uint32_t minImageCount : {2u, 3u, 4u}) {
+    swapchain_resources swapchain{vk->physicalDevice,
+                                  vk->device,
+                                  vk->surface,
+                                  renderPass,
+                                  attachment.format,
+                                  VK_PRESENT_MODE_FIFO_KHR,
+                                  {900, 900},
+                                  minImageCount};
+    double total{};
+    double worst{};
+    for (size_t i{}; i < resizeCount; ++i) {
+      // sweeps 900x900 down to 300x600 and back
+      auto step = static_cast<uint32_t>(i % 100 < 50 ? i % 50 : 50 - i % 50);
+      swapchain.recreate({900 - 12 * step, 900 - 6 * step});
+      total += swapchain.last_recreate_ms();
+      worst = std::max(worst, swapchain.last_recreate_ms());
+    }
+    std::printf(
+        "%-12u %8zu %10.3f %10.3f %10u\n",
+        minImageCount,
+        resizeCount,
+        total / resizeCount,
+        worst,
+        swapchain.image_count());
+  }
+  vkDestroyRenderPass(vk->device, renderPass, nullptr);
+}
@@ -0,0 +1,199 @@
+#pragma once
+#include <memory_allocator.hpp>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// The swapchain and what depends on its images: one view and one
+// framebuffer per image. Rendering uses dynamic viewport and scissor state,
+// so recreate() replaces only these, never the pipelines or render pass.
+struct swapchain_resources {
+  // minImageCount is raised to what the surface requires and clamped to
+  // what it allows, so the real count can be anything; see image_count().
+  swapchain_resources(
+      VkPhysicalDevice physicalDevice,
+      VkDevice device,
+      VkSurfaceKHR surface,
+      VkRenderPass renderPass,
+      VkFormat format,
+      VkPresentModeKHR presentMode,
+      VkExtent2D windowExtent,
+      uint32_t minImageCount = 3)
+      : m_physicalDevice(physicalDevice),
+        m_device(device),
+        m_surface(surface),
+        m_renderPass(renderPass),
+        m_format(format),
+        m_presentMode(presentMode),
+        m_minImageCount(minImageCount) {
+    if (!recreate(windowExtent)) {
+      throw std::runtime_error{"Surface has no area to present to"};
+    }
+  }
+
+  swapchain_resources(const swapchain_resources&) = delete;
+  swapchain_resources& operator=(const swapchain_resources&) = delete;
+
+  ~swapchain_resources() {
+    destroy_framebuffers();
+    if (m_swapchain) {
+      vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
+    }
+  }
+
+  // Whether an acquire or present result means the swapchain no longer
+  // matches the surface.
+  static bool out_of_date(VkResult result) {
+    return result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR;
+  }
+
+  // Rebuilds the swapchain for the surface's current size, or windowExtent
+  // where the surface leaves the size to the swapchain. The old swapchain
+  // is handed over as oldSwapchain so images in flight can finish. Waits
+  // for the device to go idle. Returns false and keeps the old swapchain
+  // while the surface has zero area, e.g. a minimized window.
+  bool recreate(VkExtent2D windowExtent) {
+    auto start = std::chrono::steady_clock::now();
+    VkSurfaceCapabilitiesKHR capabilities{};
+    check(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(
+        m_physicalDevice, m_surface, &capabilities));
+    auto extent = capabilities.currentExtent;
+    if (extent.width == UINT32_MAX) {
+      if (windowExtent.width == 0 || windowExtent.height == 0) {
+        return false;
+      }
+      extent.width = std::clamp(
+          windowExtent.width,
+          capabilities.minImageExtent.width,
+          capabilities.maxImageExtent.width);
+      extent.height = std::clamp(
+          windowExtent.height,
+          capabilities.minImageExtent.height,
+          capabilities.maxImageExtent.height);
+    }
+    if (extent.width == 0 || extent.height == 0) {
+      return false;
+    }
+    auto imageCount = std::max(m_minImageCount, capabilities.minImageCount);
+    if (capabilities.maxImageCount > 0) {
+      imageCount = std::min(imageCount, capabilities.maxImageCount);
+    }
+
+    if (m_swapchain) {
+      vkDeviceWaitIdle(m_device);
+    }
+    VkSwapchainCreateInfoKHR swapchainInfo{
+        VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR};
+    swapchainInfo.surface = m_surface;
+    swapchainInfo.minImageCount = imageCount;
+    swapchainInfo.imageFormat = m_format;
+    swapchainInfo.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    swapchainInfo.imageExtent = extent;
+    swapchainInfo.imageArrayLayers = 1;
+    swapchainInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    swapchainInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    swapchainInfo.preTransform = capabilities.currentTransform;
+    swapchainInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    swapchainInfo.presentMode = m_presentMode;
+    swapchainInfo.clipped = true;
+    swapchainInfo.oldSwapchain = m_swapchain;
+    VkSwapchainKHR swapchain{};
+    check(vkCreateSwapchainKHR(m_device, &swapchainInfo, nullptr, &swapchain));
+
+    destroy_framebuffers();
+    if (m_swapchain) {
+      vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
+    }
+    m_swapchain = swapchain;
+    m_extent = extent;
+    create_framebuffers();
+    ++m_generation;
+    m_lastRecreateMs = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+    return true;
+  }
+
+  VkSwapchainKHR swapchain() const { return m_swapchain; }
+  VkExtent2D extent() const { return m_extent; }
+  uint32_t image_count() const {
+    return static_cast<uint32_t>(m_images.size());
+  }
+  VkImage image(uint32_t index) const { return m_images[index]; }
+  VkFramebuffer framebuffer(uint32_t index) const {
+    return m_framebuffers[index];
+  }
+  // incremented by every successful recreate(), including the first
+  size_t generation() const { return m_generation; }
+  double last_recreate_ms() const { return m_lastRecreateMs; }
+
+private:
+  VkPhysicalDevice m_physicalDevice{};
+  VkDevice m_device{};
+  VkSurfaceKHR m_surface{};
+  VkRenderPass m_renderPass{};
+  VkFormat m_format{};
+  VkPresentModeKHR m_presentMode{};
+  uint32_t m_minImageCount{};
+  VkSwapchainKHR m_swapchain{};
+  VkExtent2D m_extent{};
+  std::vector<VkImage> m_images{};
+  std::vector<VkImageView> m_views{};
+  std::vector<VkFramebuffer> m_framebuffers{};
+  size_t m_generation{};
+  double m_lastRecreateMs{};
+
+  static void check(VkResult result) {
+    if (result != VK_SUCCESS) {
+      throw std::runtime_error{
+          "Swapchain Vulkan call failed: " +
+          std::to_string(static_cast<int>(result))};
+    }
+  }
+
+  void create_framebuffers() {
+    uint32_t imageCount{};
+    check(
+        vkGetSwapchainImagesKHR(m_device, m_swapchain, &imageCount, nullptr));
+    m_images.resize(imageCount);
+    check(vkGetSwapchainImagesKHR(
+        m_device, m_swapchain, &imageCount, m_images.data()));
+    for (auto image : m_images) {
+      VkImageViewCreateInfo viewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+      viewInfo.image = image;
+      viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+      viewInfo.format = m_format;
+      viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+      VkImageView view{};
+      check(vkCreateImageView(m_device, &viewInfo, nullptr, &view));
+      m_views.push_back(view);
+
+      VkFramebufferCreateInfo framebufferInfo{
+          VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
+      framebufferInfo.renderPass = m_renderPass;
+      framebufferInfo.attachmentCount = 1;
+      framebufferInfo.pAttachments = &view;
+      framebufferInfo.width = m_extent.width;
+      framebufferInfo.height = m_extent.height;
+      framebufferInfo.layers = 1;
+      VkFramebuffer framebuffer{};
+      check(vkCreateFramebuffer(
+          m_device, &framebufferInfo, nullptr, &framebuffer));
+      m_framebuffers.push_back(framebuffer);
+    }
+  }
+
+  void destroy_framebuffers() {
+    for (auto framebuffer : m_framebuffers) {
+      vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+    }
+    for (auto view : m_views) {
+      vkDestroyImageView(m_device, view, nullptr);
+    }
+    m_framebuffers.clear();
+    m_views.clear();
+    m_images.clear();
+  }
+};
@@ -0,0 +1,184 @@
+#include "frame_scheduler.hpp"
+#include "headless_vulkan.hpp"
+#include "swapchain_resources.hpp"
+#include <catch2/catch.hpp>
+
+namespace {
+constexpr VkFormat swapFormat = VK_FORMAT_B8G8R8A8_UNORM;
+
+VkRenderPass create_present_pass(VkDevice device) {
+  VkAttachmentDescription attachment{};
+  attachment.format = swapFormat;
+  attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  VkAttachmentReference colorReference{
+      0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorReference;
+  // the layout transition waits for the acquire semaphore's stage
+  VkSubpassDependency dependency{};
+  dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependency.dstSubpass = 0;
+  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  VkRenderPassCreateInfo renderPassInfo{
+      VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
+  renderPassInfo.attachmentCount = 1;
+  renderPassInfo.pAttachments = &attachment;
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = 1;
+  renderPassInfo.pDependencies = &dependency;
+  VkRenderPass renderPass{};
+  vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass);
+  return renderPass;
+}
+
+// Renders and presents one frame, recreating the swapchain when acquire or
+// present report it out of date. Returns the present result.
+VkResult present_frame(
+    headless_vulkan& vk,
+    swapchain_resources& swapchain,
+    frame_scheduler& scheduler,
+    VkRenderPass renderPass,
+    const std::vector<VkCommandPool>& pools,
+    const std::vector<VkCommandBuffer>& commandBuffers,
+    VkExtent2D windowExtent) {
+  auto frame = scheduler.begin_frame();
+  auto imageIndex = scheduler.acquire(swapchain.swapchain());
+  if (!imageIndex) {
+    if (swapchain_resources::out_of_date(scheduler.last_result()) &&
+        swapchain.recreate(windowExtent)) {
+      scheduler.set_swap_image_count(swapchain.image_count());
+    }
+    return scheduler.last_result();
+  }
+  auto cmd = commandBuffers[frame];
+  vkResetCommandPool(vk.device, pools[frame], 0);
+  VkCommandBufferBeginInfo beginInfo{
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(cmd, &beginInfo);
+  VkClearValue clear{};
+  VkRenderPassBeginInfo passInfo{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+  passInfo.renderPass = renderPass;
+  passInfo.framebuffer = swapchain.framebuffer(*imageIndex);
+  passInfo.renderArea = {{0, 0}, swapchain.extent()};
+  passInfo.clearValueCount = 1;
+  passInfo.pClearValues = &clear;
+  vkCmdBeginRenderPass(cmd, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
+  vkCmdEndRenderPass(cmd);
+  vkEndCommandBuffer(cmd);
+  scheduler.submit(vk.graphicsQueue, {cmd});
+  auto result = scheduler.present(vk.graphicsQueue, swapchain.swapchain());
+  if (swapchain_resources::out_of_date(result) &&
+      swapchain.recreate(windowExtent)) {
+    scheduler.set_swap_image_count(swapchain.image_count());
+  }
+  return result;
+}
+} // namespace
+
+TEST_CASE("Swapchain resources follow window resizes") {
+  auto vk = headless_vulkan::create(true);
+  if (!vk) {
+    WARN(
+        "No presentable Vulkan device; set VK_ICD_FILENAMES to lavapipe to "
+        "run this");
+    return;
+  }
+  auto renderPass = create_present_pass(vk->device);
+  constexpr size_t framesInFlight = 2;
+  std::vector<VkCommandPool> pools(framesInFlight);
+  std::vector<VkCommandBuffer> commandBuffers(framesInFlight);
+  for (size_t frame{}; frame < framesInFlight; ++frame) {
+    VkCommandPoolCreateInfo poolInfo{
+        VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = vk->graphicsFamily;
+    vkCreateCommandPool(vk->device, &poolInfo, nullptr, &pools[frame]);
+    VkCommandBufferAllocateInfo allocateInfo{
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    allocateInfo.commandPool = pools[frame];
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = 1;
+    vkAllocateCommandBuffers(
+        vk->device, &allocateInfo, &commandBuffers[frame]);
+  }
+
+  {
+    auto presentMode = choose_present_mode(vk->physicalDevice, vk->surface);
+    swapchain_resources swapchain{vk->physicalDevice,
+                                  vk->device,
+                                  vk->surface,
+                                  renderPass,
+                                  swapFormat,
+                                  presentMode,
+                                  {900, 900}};
+    REQUIRE(swapchain.generation() == 1);
+    REQUIRE(swapchain.image_count() >= 3);
+    frame_scheduler scheduler{
+        vk->device, framesInFlight, swapchain.image_count()};
+
+    SECTION("Resizes rebuild the framebuffers at the new size") {
+      std::vector<VkExtent2D> sizes{
+          {640, 480}, {1, 1}, {1920, 1080}, {900, 900}};
+      for (auto size : sizes) {
+        auto generation = swapchain.generation();
+        REQUIRE(swapchain.recreate(size));
+        REQUIRE(swapchain.generation() == generation + 1);
+        REQUIRE(swapchain.extent().width == size.width);
+        REQUIRE(swapchain.extent().height == size.height);
+        REQUIRE(swapchain.image_count() >= 3);
+        REQUIRE(swapchain.last_recreate_ms() > 0);
+        for (uint32_t i{}; i < swapchain.image_count(); ++i) {
+          REQUIRE(swapchain.framebuffer(i) != VK_NULL_HANDLE);
+        }
+        scheduler.set_swap_image_count(swapchain.image_count());
+        for (int frame{}; frame < 5; ++frame) {
+          REQUIRE(
+              present_frame(
+                  *vk,
+                  swapchain,
+                  scheduler,
+                  renderPass,
+                  pools,
+                  commandBuffers,
+                  size) == VK_SUCCESS);
+        }
+      }
+    }
+
+    SECTION("A zero-area window keeps the old swapchain") {
+      auto handle = swapchain.swapchain();
+      REQUIRE_FALSE(swapchain.recreate({0, 0}));
+      REQUIRE_FALSE(swapchain.recreate({640, 0}));
+      REQUIRE(swapchain.swapchain() == handle);
+      REQUIRE(swapchain.generation() == 1);
+      REQUIRE(
+          present_frame(
+              *vk,
+              swapchain,
+              scheduler,
+              renderPass,
+              pools,
+              commandBuffers,
+              {900, 900}) == VK_SUCCESS);
+    }
+
+    scheduler.wait_idle();
+  }
+
+  for (auto pool : pools) {
+    vkDestroyCommandPool(vk->device, pool, nullptr);
+  }
+  vkDestroyRenderPass(vk->device, renderPass, nullptr);
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "terrain_streamer.hpp"
+#include "upload_manager.hpp"
+#include <logger.hpp>
+#include <algorithm>
+#include <exception>
+#include <unordered_map>
+#include <vector>
+
+// GPU buffers of one resident terrain chunk, laid out for the 3D pipeline's
+// two vertex bindings. Drawable once the upload_manager reports ticket
+// complete.
+struct terrain_chunk_buffers {
+  device_local_buffer positions{};
+  device_local_buffer normals{};
+  device_local_buffer indices{};
+  upload_manager::ticket ticket{};
+  uint32_t indexCount{};
+  VkIndexType indexType{};
+  std::vector<mesh_lod> lods{};
+};
+
+// Upload sink that creates each resident chunk's streams in device-local
+// memory and fills them through the upload_manager's staging ring, so no
+// host-visible memory needs flushing. The caller submits the manager's
+// batch once per update; a chunk is drawable when ready() says so.
+struct vma_terrain_sink : terrain_upload_sink {
+  vma_terrain_sink(upload_manager& uploads) : m_uploads(uploads) {}
+
+  vma_terrain_sink(const vma_terrain_sink&) = delete;
+  vma_terrain_sink& operator=(const vma_terrain_sink&) = delete;
+
+  // Chunks still being copied into keep their buffers until the copy lands.
+  ~vma_terrain_sink() {
+    for (auto& [chunk, buffers] : m_chunks) {
+      m_uploads.wait(buffers.ticket);
+    }
+    for (auto& buffers : m_retired) {
+      m_uploads.wait(buffers.ticket);
+    }
+  }
+
+  void upload(size_t chunk, const packed_mesh_view& mesh) override {
+    release_retired();
+    terrain_chunk_buffers buffers{};
+    try {
+      buffers.positions = m_uploads.create_buffer(
+          mesh.positions.data(),
+          mesh.positions.size(),
+          VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+      buffers.normals = m_uploads.create_buffer(
+          mesh.normals.data(),
+          mesh.normals.size(),
+          VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+      buffers.indices = m_uploads.create_buffer(
+          mesh.indices.data(),
+          mesh.indices.size(),
+          VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    } catch (const std::exception& error) {
+      vka::multi_logger::get()->error(
+          "Unable to upload terrain chunk {}: {}", chunk, error.what());
+      // buffers already created may have copies queued
+      buffers.ticket = m_uploads.pending_ticket();
+      m_retired.push_back(std::move(buffers));
+      return;
+    }
+    buffers.ticket = buffers.indices.ticket();
+    buffers.indexCount = mesh.indexCount;
+    buffers.indexType =
+        mesh.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    buffers.lods.assign(mesh.lods.begin(), mesh.lods.end());
+    m_chunks[chunk] = std::move(buffers);
+  }
+
+  void evict(size_t chunk) override {
+    auto found = m_chunks.find(chunk);
+    if (found == m_chunks.end()) {
+      return;
+    }
+    if (!m_uploads.complete(found->second.ticket)) {
+      m_retired.push_back(std::move(found->second));
+    }
+    m_chunks.erase(found);
+    release_retired();
+  }
+
+  // Whether the chunk is resident and its copies have finished.
+  bool ready(size_t chunk) {
+    auto found = m_chunks.find(chunk);
+    return found != m_chunks.end() && m_uploads.complete(found->second.ticket);
+  }
+
+  // Chunks currently resident on the GPU, keyed by chunk index.
+  const std::unordered_map<size_t, terrain_chunk_buffers>& chunks() const {
+    return m_chunks;
+  }
+
+private:
+  upload_manager& m_uploads;
+  std::unordered_map<size_t, terrain_chunk_buffers> m_chunks{};
+  // evicted before their copies finished
+  std::vector<terrain_chunk_buffers> m_retired{};
+
+  void release_retired() {
+    m_retired.erase(
+        std::remove_if(
+            m_retired.begin(),
+            m_retired.end(),
+            [&](auto& buffers) { return m_uploads.complete(buffers.ticket); }),
+        m_retired.end());
+  }
+};
@@ -0,0 +1,301 @@
+#pragma once
+#include "aligned_alloc.hpp"
+#include "packed_mesh.hpp"
+#include <logger.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Receives chunks as they become resident and are evicted. Both calls are
+// made from the thread calling terrain_streamer::update, so an
+// implementation can create GPU resources directly.
+struct terrain_upload_sink {
+  virtual ~terrain_upload_sink() = default;
+  virtual void upload(size_t chunk, const packed_mesh_view& mesh) = 0;
+  virtual void evict(size_t chunk) = 0;
+};
+
+struct terrain_chunk_info {
+  std::array<float, 3> boundsMin{};
+  std::array<float, 3> boundsMax{};
+  // memory charged against the budget while the chunk is resident
+  size_t bytes{};
+};
+
+struct terrain_streaming_config {
+  // chunks whose bounds come within loadRadius of the camera are loaded
+  float loadRadius{256.f};
+  // resident chunks are only evicted beyond evictRadius, so a camera moving
+  // back and forth across the load radius does not thrash
+  float evictRadius{320.f};
+  size_t memoryBudget{64 * 1024 * 1024};
+  // caps the upload work done by one update to bound frame hitches
+  size_t maxUploadsPerUpdate{4};
+};
+
+// Keeps the terrain chunks near the camera resident within a memory budget.
+// Loads run on a background I/O thread; update() hands finished loads to the
+// upload sink, evicts distant chunks and queues new loads nearest first.
+// Memory for queued loads counts against the budget, so the sink never holds
+// more than memoryBudget bytes. A chunk whose load throws is logged by
+// update() and not retried.
+struct terrain_streamer {
+  // Runs on the I/O thread and must return a view that stays valid until
+  // the streamer is destroyed. Exceptions mark the chunk failed.
+  using load_function = std::function<packed_mesh_view(size_t chunk)>;
+
+  terrain_streamer(
+      std::vector<terrain_chunk_info> chunks,
+      load_function load,
+      terrain_upload_sink& sink,
+      terrain_streaming_config config = {})
+      : m_chunks(std::move(chunks)),
+        m_load(std::move(load)),
+        m_sink(sink),
+        m_config(config),
+        m_state(m_chunks.size(), chunk_state::unloaded) {
+    m_thread = std::thread{[this] { run_io(); }};
+  }
+
+  // Streams the meshes of a cooked tile file. The I/O thread faults in each
+  // chunk's pages so the upload on the update thread never waits on disk.
+  terrain_streamer(
+      const packed_mesh_file& file,
+      terrain_upload_sink& sink,
+      terrain_streaming_config config = {})
+      : terrain_streamer(
+            chunk_infos(file),
+            [&file](size_t chunk) {
+              auto mesh = file.mesh(chunk);
+              prefault(mesh.positions);
+              prefault(mesh.normals);
+              prefault(mesh.indices);
+              return mesh;
+            },
+            sink,
+            config) {}
+
+  terrain_streamer(const terrain_streamer&) = delete;
+  terrain_streamer& operator=(const terrain_streamer&) = delete;
+
+  ~terrain_streamer() {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+  }
+
+  void update(const std::array<float, 3>& cameraPosition) {
+    std::vector<completed_load> completed;
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      auto count = std::min(m_completed.size(), m_config.maxUploadsPerUpdate);
+      completed.assign(m_completed.begin(), m_completed.begin() + count);
+      m_completed.erase(m_completed.begin(), m_completed.begin() + count);
+    }
+    for (auto& [chunk, mesh, error] : completed) {
+      m_pendingBytes -= m_chunks[chunk].bytes;
+      if (error) {
+        vka::multi_logger::get()->error(
+            "Unable to load terrain chunk {}: {}", chunk, *error);
+        m_state[chunk] = chunk_state::failed;
+        continue;
+      }
+      if (distance(chunk, cameraPosition) > m_config.evictRadius) {
+        m_state[chunk] = chunk_state::unloaded;
+        continue;
+      }
+      m_sink.upload(chunk, mesh);
+      m_state[chunk] = chunk_state::resident;
+      m_residentBytes += m_chunks[chunk].bytes;
+    }
+
+    for (size_t chunk{}; chunk < m_chunks.size(); ++chunk) {
+      if (m_state[chunk] == chunk_state::resident &&
+          distance(chunk, cameraPosition) > m_config.evictRadius) {
+        evict(chunk);
+      }
+    }
+
+    m_candidates.clear();
+    for (size_t chunk{}; chunk < m_chunks.size(); ++chunk) {
+      auto chunkDistance = distance(chunk, cameraPosition);
+      if (m_state[chunk] == chunk_state::unloaded &&
+          chunkDistance <= m_config.loadRadius) {
+        m_candidates.push_back({chunkDistance, chunk});
+      }
+    }
+    std::sort(m_candidates.begin(), m_candidates.end());
+    for (auto& [chunkDistance, chunk] : m_candidates) {
+      auto bytes = m_chunks[chunk].bytes;
+      auto over_budget = [&] {
+        return m_residentBytes + m_pendingBytes + bytes >
+               m_config.memoryBudget;
+      };
+      // make room by evicting resident chunks farther away than this one
+      while (over_budget()) {
+        auto farthest = farthest_resident(cameraPosition);
+        if (farthest == m_chunks.size() ||
+            distance(farthest, cameraPosition) <= chunkDistance) {
+          break;
+        }
+        evict(farthest);
+      }
+      if (over_budget()) {
+        break;
+      }
+      m_state[chunk] = chunk_state::loading;
+      m_pendingBytes += bytes;
+      {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_requests.push_back(chunk);
+      }
+      m_wake.notify_one();
+    }
+  }
+
+  // Blocks until the I/O thread has finished every queued load. Completed
+  // loads are handed to the sink by the next update().
+  void wait_idle() {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_idle.wait(lock, [this] { return m_requests.empty() && !m_loading; });
+  }
+
+  size_t chunk_count() const { return m_chunks.size(); }
+  bool is_resident(size_t chunk) const {
+    return m_state[chunk] == chunk_state::resident;
+  }
+  bool has_failed(size_t chunk) const {
+    return m_state[chunk] == chunk_state::failed;
+  }
+  size_t resident_bytes() const { return m_residentBytes; }
+  size_t pending_bytes() const { return m_pendingBytes; }
+
+  static std::vector<terrain_chunk_info> chunk_infos(
+      const packed_mesh_file& file) {
+    std::vector<terrain_chunk_info> infos;
+    for (size_t i{}; i < file.mesh_count(); ++i) {
+      auto mesh = file.mesh(i);
+      infos.push_back(
+          {mesh.boundsMin,
+           mesh.boundsMax,
+           mesh.positions.size() + mesh.normals.size() +
+               mesh.indices.size()});
+    }
+    return infos;
+  }
+
+private:
+  enum class chunk_state { unloaded, loading, resident, failed };
+
+  struct completed_load {
+    size_t chunk;
+    packed_mesh_view mesh;
+    // set when the load threw
+    std::optional<std::string> error;
+  };
+
+  std::vector<terrain_chunk_info> m_chunks;
+  load_function m_load;
+  terrain_upload_sink& m_sink;
+  terrain_streaming_config m_config;
+  std::vector<chunk_state> m_state;
+  std::vector<std::pair<float, size_t>> m_candidates;
+  size_t m_residentBytes{};
+  size_t m_pendingBytes{};
+
+  // shared with the I/O thread
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_idle;
+  std::deque<size_t> m_requests;
+  std::vector<completed_load> m_completed;
+  bool m_loading{};
+  bool m_stop{};
+  std::thread m_thread;
+
+  static void prefault(array_view<std::byte> bytes) {
+    volatile std::byte touched{};
+    for (size_t offset{}; offset < bytes.size(); offset += page_size) {
+      touched = bytes[offset];
+    }
+    (void)touched;
+  }
+
+  // distance from the camera to the chunk's bounding box
+  float distance(size_t chunk, const std::array<float, 3>& camera) const {
+    auto& info = m_chunks[chunk];
+    float squared{};
+    for (int axis{}; axis < 3; ++axis) {
+      float outside = std::max(
+          {info.boundsMin[axis] - camera[axis],
+           0.f,
+           camera[axis] - info.boundsMax[axis]});
+      squared += outside * outside;
+    }
+    return std::sqrt(squared);
+  }
+
+  size_t farthest_resident(const std::array<float, 3>& camera) const {
+    size_t farthest = m_chunks.size();
+    float farthestDistance = -1.f;
+    for (size_t chunk{}; chunk < m_chunks.size(); ++chunk) {
+      if (m_state[chunk] != chunk_state::resident) {
+        continue;
+      }
+      auto chunkDistance = distance(chunk, camera);
+      if (chunkDistance > farthestDistance) {
+        farthestDistance = chunkDistance;
+        farthest = chunk;
+      }
+    }
+    return farthest;
+  }
+
+  void evict(size_t chunk) {
+    m_sink.evict(chunk);
+    m_state[chunk] = chunk_state::unloaded;
+    m_residentBytes -= m_chunks[chunk].bytes;
+  }
+
+  void run_io() {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    while (true) {
+      m_wake.wait(lock, [this] { return m_stop || !m_requests.empty(); });
+      if (m_stop) {
+        return;
+      }
+      auto chunk = m_requests.front();
+      m_requests.pop_front();
+      m_loading = true;
+      lock.unlock();
+      completed_load load{chunk, {}, {}};
+      try {
+        load.mesh = m_load(chunk);
+      } catch (const std::exception& error) {
+        load.error = error.what();
+      } catch (...) {
+        load.error = "unknown exception";
+      }
+      lock.lock();
+      m_completed.push_back(std::move(load));
+      m_loading = false;
+      if (m_requests.empty()) {
+        m_idle.notify_all();
+      }
+    }
+  }
+};
@@ -0,0 +1,232 @@
+#include "terrain_streamer.hpp"
+#include "terrain_tiles.hpp"
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <cstdio>
+#include <set>
+
+namespace {
+source_mesh make_heightfield(uint32_t n) {
+  source_mesh mesh{};
+  for (uint32_t z{}; z < n; ++z) {
+    for (uint32_t x{}; x < n; ++x) {
+      mesh.positions.push_back({float(x), float((x * z) % 5), float(z)});
+      mesh.normals.push_back({0.f, 1.f, 0.f});
+    }
+  }
+  for (uint32_t z{}; z + 1 < n; ++z) {
+    for (uint32_t x{}; x + 1 < n; ++x) {
+      uint32_t i = z * n + x;
+      mesh.indices.insert(
+          mesh.indices.end(), {i, i + n, i + 1, i + 1, i + n, i + n + 1});
+    }
+  }
+  return mesh;
+}
+
+// Records what the streamer asks for and checks it never double-uploads,
+// evicts something it does not hold or goes over budget.
+struct fake_upload_sink : terrain_upload_sink {
+  std::vector<terrain_chunk_info>* chunks{};
+  size_t budget{};
+  std::set<size_t> resident;
+  size_t residentBytes{};
+  size_t peakBytes{};
+  size_t uploads{};
+  bool misuse{};
+
+  void upload(size_t chunk, const packed_mesh_view& mesh) override {
+    misuse |= !resident.insert(chunk).second;
+    misuse |= mesh.vertexCount != chunk;
+    residentBytes += (*chunks)[chunk].bytes;
+    peakBytes = std::max(peakBytes, residentBytes);
+    ++uploads;
+  }
+
+  void evict(size_t chunk) override {
+    misuse |= resident.erase(chunk) != 1;
+    residentBytes -= (*chunks)[chunk].bytes;
+  }
+};
+
+// A 16 x 16 grid of 10-unit chunks on the xz plane.
+std::vector<terrain_chunk_info> make_chunk_grid() {
+  std::vector<terrain_chunk_info> chunks;
+  for (int z{}; z < 16; ++z) {
+    for (int x{}; x < 16; ++x) {
+      terrain_chunk_info info{};
+      info.boundsMin = {x * 10.f, 0.f, z * 10.f};
+      info.boundsMax = {x * 10.f + 10.f, 5.f, z * 10.f + 10.f};
+      info.bytes = 1000;
+      chunks.push_back(info);
+    }
+  }
+  return chunks;
+}
+
+float box_distance(
+    const terrain_chunk_info& info,
+    const std::array<float, 3>& p) {
+  float squared{};
+  for (int axis{}; axis < 3; ++axis) {
+    float outside = std::max(
+        {info.boundsMin[axis] - p[axis], 0.f, p[axis] - info.boundsMax[axis]});
+    squared += outside * outside;
+  }
+  return std::sqrt(squared);
+}
+
+packed_mesh_view fake_load(size_t chunk) {
+  packed_mesh_view mesh{};
+  mesh.vertexCount = static_cast<uint32_t>(chunk);
+  return mesh;
+}
+}  // namespace
+
+TEST_CASE("Splitting terrain keeps every triangle in exactly one chunk") {
+  auto terrain = make_heightfield(33);
+  auto chunks = split_terrain(terrain, 8.f);
+  REQUIRE(chunks.size() == 16);
+  size_t triangles{};
+  for (auto& chunk : chunks) {
+    triangles += chunk.indices.size() / 3;
+    REQUIRE(chunk.positions.size() == chunk.normals.size());
+    REQUIRE(chunk.positions.size() == 9 * 9);
+    float minX = chunk.positions[0][0];
+    float maxX = minX;
+    for (auto& position : chunk.positions) {
+      minX = std::min(minX, position[0]);
+      maxX = std::max(maxX, position[0]);
+    }
+    REQUIRE(maxX - minX == 8.f);
+  }
+  REQUIRE(triangles == terrain.indices.size() / 3);
+  REQUIRE_THROWS(split_terrain(terrain, 0.f));
+}
+
+TEST_CASE("Chunks near a moving camera become resident within budget") {
+  auto chunks = make_chunk_grid();
+  fake_upload_sink sink{};
+  sink.chunks = &chunks;
+  terrain_streaming_config config{};
+  config.loadRadius = 25.f;
+  config.evictRadius = 35.f;
+  config.memoryBudget = 40 * 1000;
+  config.maxUploadsPerUpdate = 64;
+  {
+    terrain_streamer streamer{chunks, fake_load, sink, config};
+    for (float t{}; t <= 150.f; t += 5.f) {
+      std::array<float, 3> camera{t, 2.f, t * 0.5f + 20.f};
+      streamer.update(camera);
+      streamer.wait_idle();
+      streamer.update(camera);
+
+      REQUIRE(streamer.resident_bytes() + streamer.pending_bytes() <=
+              config.memoryBudget);
+      REQUIRE(streamer.resident_bytes() == sink.residentBytes);
+      for (size_t chunk{}; chunk < chunks.size(); ++chunk) {
+        auto distance = box_distance(chunks[chunk], camera);
+        if (streamer.is_resident(chunk)) {
+          REQUIRE(distance <= config.evictRadius);
+        }
+        // the ~25 nearest chunks fit the budget, so close ones must be in
+        if (distance <= 10.f) {
+          REQUIRE(streamer.is_resident(chunk));
+        }
+      }
+    }
+  }
+  REQUIRE_FALSE(sink.misuse);
+  REQUIRE(sink.peakBytes <= config.memoryBudget);
+  REQUIRE(sink.uploads > 40);
+}
+
+TEST_CASE("A tight budget keeps the nearest chunks") {
+  auto chunks = make_chunk_grid();
+  fake_upload_sink sink{};
+  sink.chunks = &chunks;
+  terrain_streaming_config config{};
+  config.loadRadius = 1000.f;
+  config.evictRadius = 1000.f;
+  config.memoryBudget = 4 * 1000;
+  config.maxUploadsPerUpdate = 64;
+  terrain_streamer streamer{chunks, fake_load, sink, config};
+
+  std::array<float, 3> corner{0.f, 0.f, 0.f};
+  streamer.update(corner);
+  streamer.wait_idle();
+  streamer.update(corner);
+  REQUIRE(sink.resident == std::set<size_t>{0, 1, 16, 17});
+
+  // moving to the far corner evicts the old chunks for the new nearest
+  std::array<float, 3> farCorner{160.f, 0.f, 160.f};
+  for (int i{}; i < 3; ++i) {
+    streamer.update(farCorner);
+    streamer.wait_idle();
+  }
+  streamer.update(farCorner);
+  REQUIRE(sink.resident == std::set<size_t>{238, 239, 254, 255});
+  REQUIRE_FALSE(sink.misuse);
+}
+
+TEST_CASE("Chunks stream from a cooked tile file") {
+  auto chunks = split_terrain(make_heightfield(33), 16.f);
+  std::string path = "terrain_streamer_test.vkmesh";
+  write_packed_meshes(path, chunks);
+  {
+    packed_mesh_file file{path};
+    REQUIRE(file.mesh_count() == 4);
+    struct counting_sink : terrain_upload_sink {
+      std::set<size_t> resident;
+      void upload(size_t chunk, const packed_mesh_view& mesh) override {
+        REQUIRE(mesh.vertexCount == 17 * 17);
+        resident.insert(chunk);
+      }
+      void evict(size_t chunk) override { resident.erase(chunk); }
+    } sink;
+    terrain_streaming_config config{};
+    config.loadRadius = 1.f;
+    terrain_streamer streamer{file, sink, config};
+    std::array<float, 3> camera{2.f, 2.f, 2.f};
+    streamer.update(camera);
+    streamer.wait_idle();
+    streamer.update(camera);
+    REQUIRE(sink.resident == std::set<size_t>{0});
+  }
+  std::remove(path.c_str());
+}
+
+TEST_CASE("A chunk whose load throws is marked failed, not retried") {
+  auto chunks = make_chunk_grid();
+  fake_upload_sink sink{};
+  sink.chunks = &chunks;
+  terrain_streaming_config config{};
+  config.loadRadius = 15.f;
+  config.maxUploadsPerUpdate = 64;
+  std::atomic<int> attempts{};
+  terrain_streamer streamer{
+      chunks,
+      [&](size_t chunk) {
+        if (chunk == 0) {
+          ++attempts;
+          throw std::out_of_range{"chunk 0 is missing"};
+        }
+        return fake_load(chunk);
+      },
+      sink,
+      config};
+
+  std::array<float, 3> corner{0.f, 0.f, 0.f};
+  for (int i{}; i < 3; ++i) {
+    streamer.update(corner);
+    // returns even though a load threw on the I/O thread
+    streamer.wait_idle();
+  }
+  streamer.update(corner);
+  REQUIRE(streamer.has_failed(0));
+  REQUIRE_FALSE(streamer.is_resident(0));
+  REQUIRE(streamer.is_resident(1));
+  REQUIRE(attempts == 1);
+  REQUIRE(streamer.pending_bytes() == 0);
+  REQUIRE_FALSE(sink.misuse);
+}
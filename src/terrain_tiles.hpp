@@ -0,0 +1,76 @@
+#pragma once
+#include "packed_mesh.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+// Splits a terrain mesh into square chunks of chunkSize world units on the xz
+// plane. Each triangle goes to the chunk containing its centroid, and vertices
+// on chunk borders are duplicated so every chunk is a self-contained mesh.
+// Empty cells are skipped; chunks come out in row-major order. Run this
+// before generate_lod_chain, whose border locking then keeps chunk seams
+// matching at every LOD.
+inline std::vector<source_mesh> split_terrain(
+    const source_mesh& mesh,
+    float chunkSize) {
+  if (!(chunkSize > 0.f)) {
+    throw std::invalid_argument{"Terrain chunk size must be positive"};
+  }
+  if (!mesh.lods.empty()) {
+    throw std::invalid_argument{"Split terrain before generating LODs"};
+  }
+  if (mesh.positions.empty()) {
+    return {};
+  }
+
+  float minX = mesh.positions[0][0];
+  float minZ = mesh.positions[0][2];
+  float maxX = minX;
+  float maxZ = minZ;
+  for (auto& position : mesh.positions) {
+    minX = std::min(minX, position[0]);
+    maxX = std::max(maxX, position[0]);
+    minZ = std::min(minZ, position[2]);
+    maxZ = std::max(maxZ, position[2]);
+  }
+  auto countX =
+      std::max<uint32_t>(1, uint32_t(std::ceil((maxX - minX) / chunkSize)));
+  auto countZ =
+      std::max<uint32_t>(1, uint32_t(std::ceil((maxZ - minZ) / chunkSize)));
+
+  std::vector<source_mesh> cells(size_t{countX} * countZ);
+  std::vector<std::unordered_map<uint32_t, uint32_t>> remaps(cells.size());
+  for (size_t t{}; t + 2 < mesh.indices.size(); t += 3) {
+    float centroidX{};
+    float centroidZ{};
+    for (size_t corner{}; corner < 3; ++corner) {
+      centroidX += mesh.positions[mesh.indices[t + corner]][0] / 3.f;
+      centroidZ += mesh.positions[mesh.indices[t + corner]][2] / 3.f;
+    }
+    auto x = std::min(countX - 1, uint32_t((centroidX - minX) / chunkSize));
+    auto z = std::min(countZ - 1, uint32_t((centroidZ - minZ) / chunkSize));
+    auto cell = size_t{z} * countX + x;
+    auto& chunk = cells[cell];
+    for (size_t corner{}; corner < 3; ++corner) {
+      auto index = mesh.indices[t + corner];
+      auto inserted = remaps[cell].emplace(
+          index, static_cast<uint32_t>(chunk.positions.size()));
+      if (inserted.second) {
+        chunk.positions.push_back(mesh.positions[index]);
+        chunk.normals.push_back(mesh.normals[index]);
+      }
+      chunk.indices.push_back(inserted.first->second);
+    }
+  }
+
+  std::vector<source_mesh> chunks;
+  for (auto& cell : cells) {
+    if (!cell.indices.empty()) {
+      chunks.push_back(std::move(cell));
+    }
+  }
+  return chunks;
+}
@@ -22,8 +22,6 @@
 #include <command_pool.hpp>
 #include <command_buffer.hpp>
 #include <render_pass.hpp>
-#include <pipeline_layout.hpp>
-#include <pipeline.hpp>
 #include <memory>
 #include <array>
 #include <vector>
@@ -35,6 +33,15 @@
 #include <tiny_gltf.h>
 #include <memory_allocator.hpp>
 #include <cstring>
+#include "frame_arena.hpp"
+#include "upload_manager.hpp"
+#include "parallel_recorder.hpp"
+#include "frame_scheduler.hpp"
+#include "swapchain_resources.hpp"
+#include "monotonic_report.hpp"
+#include "pipeline_registry.hpp"
+#include "shader_layout.hpp"
+#include "triangle.layout.hpp"
 
 using namespace vka;
 int main() {
@@ -98,35 +105,6 @@ int main() {
   VkQueue queue{};
   vkGetDeviceQueue(*devicePtr, queueFamily.familyIndex, 0, &queue);
 
-  std::unique_ptr<swapchain> swapchainPtr{};
-  swapchain_builder{}
-      .image_count(3)
-      .present_mode(VK_PRESENT_MODE_FIFO_KHR)
-      .queue_family_index(queueFamily.familyIndex)
-      .build(physicalDevice, *surfacePtr, *devicePtr)
-      .map(move_into{swapchainPtr})
-      .map_error([](auto error) {
-        multi_logger::get()->critical("Error creating swapchain!");
-        exit(error);
-      });
-
-  std::array<VkImage, 3> swapImages{};
-  std::array<std::unique_ptr<image_view>, 3> swapViews{};
-  std::array<std::unique_ptr<framebuffer>, 3> framebuffers{};
-
-  auto getSwapImages = [&]() {
-    uint32_t imageCount{};
-    vkGetSwapchainImagesKHR(*devicePtr, *swapchainPtr, &imageCount, nullptr);
-    if (imageCount != 3) {
-      multi_logger::get()->critical(
-          "Swap image count doesn't match. Expected: 3, Actual {}", imageCount);
-      exit(1);
-    }
-    vkGetSwapchainImagesKHR(
-        *devicePtr, *swapchainPtr, &imageCount, swapImages.data());
-  };
-  getSwapImages();
-
   std::unique_ptr<shader_module> shaderVertex3D{};
   shader_module_builder{}
       .build(*devicePtr, "triangle.vert.spv")
@@ -145,14 +123,8 @@ int main() {
         exit(1);
       });
 
-  std::unique_ptr<pipeline_layout> pipelineLayoutPtr{};
-  pipeline_layout_builder{}
-      .build(*devicePtr)
-      .map(move_into{pipelineLayoutPtr})
-      .map_error([](auto error) {
-        multi_logger::get()->critical("Error creating pipeline layout!");
-        exit(error);
-      });
+  // triangle.layout.hpp is reflected from the shaders json-shader generates
+  descriptor_layouts triangleLayouts{*devicePtr, layout_triangle::layout, 1};
 
   auto subpass3D =
       subpass_builder{}
@@ -177,62 +149,47 @@ int main() {
         exit(error);
       });
 
-  VkViewport viewport{};
-  viewport.width = 900;
-  viewport.height = 900;
-  viewport.minDepth = 0.f;
-  viewport.maxDepth = 1.f;
-
-  VkRect2D scissor{};
-  scissor.extent.width = 900;
-  scissor.extent.height = 900;
-
-  for (int i{}; i < 3; ++i) {
-    image_view_builder{}
-        .image_source(swapImages[i])
-        .image_format(VK_FORMAT_B8G8R8A8_UNORM)
-        .array_layers(1)
-        .image_aspect(VK_IMAGE_ASPECT_COLOR_BIT)
-        .image_type(VK_IMAGE_TYPE_2D)
-        .build(*devicePtr)
-        .map(move_into{swapViews[i]});
-
-    framebuffer_builder{}
-        .render_pass(*renderPassPtr)
-        .dimensions(900, 900)
-        .attachments({*swapViews[i]})
-        .build(*devicePtr)
-        .map(move_into{framebuffers[i]});
-  }
-
-  std::unique_ptr<pipeline> pipeline3DPtr{};
-  graphics_pipeline_builder{}
-      .pipeline_layout(*pipelineLayoutPtr)
-      .render_pass(*renderPassPtr, 0)
-      .color_attachment(no_blend_attachment{})
-      .shader_stage(shader_stage_builder{}
-                        .vertex()
-                        .shader_module(*shaderVertex3D, "main")
-                        .build())
-      .shader_stage(shader_stage_builder{}
-                        .fragment()
-                        .shader_module(*shaderFragment3D, "main")
-                        .build())
-      .vertex_binding<glm::vec3>(0, VK_VERTEX_INPUT_RATE_VERTEX)
-      .vertex_binding<glm::vec4>(1, VK_VERTEX_INPUT_RATE_VERTEX)
-      .vertex_attribute(0, 0, 3, 0)
-      .vertex_attribute(1, 1, 4, 0)
-      .viewport_scissor(viewport, scissor)
-      .polygon_mode(VK_POLYGON_MODE_FILL)
-      .cull_mode(VK_CULL_MODE_NONE)
-      .primitive_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
-      .winding_cw()
-      .build(*devicePtr)
-      .map(move_into{pipeline3DPtr})
-      .map_error([](auto error) {
-        multi_logger::get()->critical("Error creating 3D pipeline!");
-        exit(error);
-      });
+  // Views and framebuffers follow the swapchain through resizes; the
+  // pipeline below uses dynamic viewport and scissor, so it never does.
+  // Surfaces that report their size ignore the extent passed in; the rest
+  // take the window's current framebuffer size, which is zero while it is
+  // minimized.
+  auto windowExtent = [&]() {
+    int width{};
+    int height{};
+    glfwGetFramebufferSize(*surfacePtr, &width, &height);
+    return VkExtent2D{
+        static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+  };
+  swapchain_resources swapResources{
+      physicalDevice,
+      *devicePtr,
+      *surfacePtr,
+      *renderPassPtr,
+      VK_FORMAT_B8G8R8A8_UNORM,
+      choose_present_mode(physicalDevice, *surfacePtr),
+      windowExtent()};
+
+  // Compiles on the registry's threads while the buffers below upload; the
+  // cache file makes every run after the first a warm start.
+  pipeline_cache pipelineCache{
+      physicalDevice, *devicePtr, "triangle.pipeline_cache"};
+  pipeline_registry pipelines{*devicePtr, pipelineCache};
+  pipeline_description pipeline3D{};
+  pipeline3D.name = "triangle";
+  pipeline3D.stages = {{VK_SHADER_STAGE_VERTEX_BIT, *shaderVertex3D},
+                       {VK_SHADER_STAGE_FRAGMENT_BIT, *shaderFragment3D}};
+  pipeline3D.bindings.assign(
+      layout_triangle::layout.vertexBindings.begin(),
+      layout_triangle::layout.vertexBindings.end());
+  pipeline3D.attributes.assign(
+      layout_triangle::layout.vertexAttributes.begin(),
+      layout_triangle::layout.vertexAttributes.end());
+  pipeline3D.cullMode = VK_CULL_MODE_NONE;
+  pipeline3D.frontFace = VK_FRONT_FACE_CLOCKWISE;
+  pipeline3D.layout = triangleLayouts.pipeline_layout();
+  pipeline3D.renderPass = *renderPassPtr;
+  auto pipeline3DFuture = pipelines.request(pipeline3D);
 
   std::unique_ptr<allocator> allocatorPtr{};
   allocator_builder{}
@@ -246,160 +203,116 @@ int main() {
         exit(error);
       });
 
-  std::unique_ptr<buffer> vertexBuffer{};
-  buffer_builder{}
-      .cpu_to_gpu()
-      .vertex_buffer()
-      .queue_family_index(queueFamily.familyIndex)
-      .size(sizeof(glm::vec3) * 3)
-      .build(*allocatorPtr)
-      .map(move_into{vertexBuffer})
-      .map_error([](auto error) {
-        multi_logger::get()->critical("Error creating vertex buffer!");
-        exit(error);
-      });
-
-  void* vertPtr{};
-  vertexBuffer->map().map(move_into{vertPtr});
+  // Vertex data goes to device-local buffers through the staging ring.
+  upload_manager uploads{
+      *devicePtr, *allocatorPtr, queue, queueFamily.familyIndex};
   std::array<glm::vec3, 3> vertices{glm::vec3{-0.5f, 0.5f, 0.f},
                                     glm::vec3{0.5f, 0.5f, 0.f},
                                     glm::vec3{0.f, -0.5f, 0.f}};
-  std::memcpy(
-      vertPtr, reinterpret_cast<void*>(vertices.data()), sizeof(glm::vec3) * 3);
-
-  std::unique_ptr<buffer> vertexColorBuffer{};
-  buffer_builder{}
-      .cpu_to_gpu()
-      .vertex_buffer()
-      .queue_family_index(queueFamily.familyIndex)
-      .size(sizeof(glm::vec4) * 3)
-      .build(*allocatorPtr)
-      .map(move_into{vertexColorBuffer})
-      .map_error([](auto error) {
-        multi_logger::get()->critical("Error creating vertex color buffer!");
-        exit(error);
-      });
-  void* colorArrayPtr{};
-  vertexColorBuffer->map().map(move_into{colorArrayPtr});
+  auto vertexBuffer = uploads.create_buffer(
+      vertices.data(),
+      sizeof(glm::vec3) * 3,
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
   std::array<glm::vec4, 3> vertexColors{glm::vec4{1.f, 0.f, 0.f, 1.f},
                                         glm::vec4{0.f, 1.f, 0.f, 1.f},
                                         glm::vec4{0.f, 0.f, 1.f, 1.f}};
-  std::memcpy(
-      colorArrayPtr,
-      reinterpret_cast<void*>(vertexColors.data()),
-      sizeof(glm::vec4) * 3);
-  // /** round n down to nearest multiple of m */
-  // auto round_down = [](VkDeviceSize n, VkDeviceSize m) {
-  //     return (m == 0) ? n : (n / m) * m;
-  // };
-
-  // /** round n up to nearest multiple of m */
-  // auto round_up = [](VkDeviceSize n, VkDeviceSize m) {
-  //     return (m == 0) ? n : ((n + m - 1) / m) * m;
-  // };
-
-  // auto getAtomSize = [physicalDevice]() {
-  //   VkPhysicalDeviceProperties props{};
-  //   vkGetPhysicalDeviceProperties(physicalDevice, &props);
-  //   return props.limits.nonCoherentAtomSize;
-  // };
-
-  vmaFlushAllocation(*allocatorPtr, *vertexBuffer, 0, VK_WHOLE_SIZE);
-  vmaFlushAllocation(*allocatorPtr, *vertexColorBuffer, 0, VK_WHOLE_SIZE);
-
-  std::unique_ptr<command_pool> cmdPoolPtr{};
-  command_pool_builder{}
-      .queue_family_index(queueFamily.familyIndex)
-      .build(*devicePtr)
-      .map(move_into{cmdPoolPtr})
-      .map_error([](auto error) {
-        multi_logger::get()->critical("Error creating command pool!");
-        exit(error);
-      });
-
-  std::array<std::unique_ptr<command_buffer>, 3> cmdPtr{};
-  for (auto& cmd : cmdPtr) {
-    command_buffer_allocator{}
-        .set_command_pool(cmdPoolPtr.get())
-        .allocate(*devicePtr)
-        .map(move_into{cmd})
+  auto vertexColorBuffer = uploads.create_buffer(
+      vertexColors.data(),
+      sizeof(glm::vec4) * 3,
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+  uploads.submit();
+
+  VkPipeline pipeline3DHandle{};
+  try {
+    pipeline3DHandle = pipeline3DFuture.get();
+  } catch (const std::exception& error) {
+    multi_logger::get()->critical("{}", error.what());
+    exit(1);
+  }
+  multi_logger::get()->info(
+      "Pipelines built in {:.2f} ms from a {} cache",
+      pipelineCache.total_build_ms(),
+      pipelineCache.warm() ? "warm" : "cold");
+
+  // Frame slots, not swap images, own the per-frame resources: each slot's
+  // command buffer is re-recorded once its fence says the GPU is done.
+  constexpr size_t framesInFlight = 2;
+  frame_scheduler scheduler{
+      *devicePtr, framesInFlight, swapResources.image_count()};
+
+  std::array<std::unique_ptr<command_pool>, framesInFlight> cmdPools{};
+  std::array<std::unique_ptr<command_buffer>, framesInFlight> cmdPtr{};
+  for (size_t frame{}; frame < framesInFlight; ++frame) {
+    command_pool_builder{}
+        .queue_family_index(queueFamily.familyIndex)
+        .build(*devicePtr)
+        .map(move_into{cmdPools[frame]})
         .map_error([](auto error) {
-          multi_logger::get()->critical("Error allocating command buffer!");
+          multi_logger::get()->critical("Error creating command pool!");
           exit(error);
         });
-  }
-
-  {
-    std::unique_ptr<command_buffer> utilityCmd{};
     command_buffer_allocator{}
-        .set_command_pool(cmdPoolPtr.get())
+        .set_command_pool(cmdPools[frame].get())
         .allocate(*devicePtr)
-        .map(move_into{utilityCmd})
+        .map(move_into{cmdPtr[frame]})
         .map_error([](auto error) {
           multi_logger::get()->critical("Error allocating command buffer!");
           exit(error);
         });
-
-    VkCommandBufferBeginInfo beginInfo{
-        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
-    vkBeginCommandBuffer(*utilityCmd, &beginInfo);
-    VkMemoryBarrier vertexFlushBarrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
-    vertexFlushBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
-    vertexFlushBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
-    vkCmdPipelineBarrier(
-        *utilityCmd,
-        VK_PIPELINE_STAGE_HOST_BIT,
-        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-        0,
-        1,
-        &vertexFlushBarrier,
-        0,
-        nullptr,
-        0,
-        nullptr);
-    vkEndCommandBuffer(*utilityCmd);
-
-    std::unique_ptr<fence> flushFence{};
-    fence_builder{}.build(*devicePtr).map(move_into{flushFence});
-
-    VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
-    VkCommandBuffer cmd = *utilityCmd;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &cmd;
-    vkQueueSubmit(queue, 1, &submitInfo, *flushFence);
-
-    VkFence vkFlushFence = *flushFence;
-    vkWaitForFences(*devicePtr, 1, &vkFlushFence, true, ~uint64_t{});
   }
 
-  std::unique_ptr<fence> imageReady{};
-  fence_builder{}.build(*devicePtr).map(move_into{imageReady});
-
-  std::unique_ptr<semaphore> drawFinished{};
-  semaphore_builder{}.build(*devicePtr).map(move_into{drawFinished});
-
-  std::array<std::unique_ptr<fence>, 3> commandBufferExecuted{};
-  for (auto& cmdFence : commandBufferExecuted) {
-    fence_builder{}.signaled().build(*devicePtr).map(move_into{cmdFence});
-  }
+  // the first frame draws from the vertex buffers
+  uploads.wait(vertexColorBuffer.ticket());
+
+  frame_arenas frameArenas{framesInFlight, 1, 64 * 1024, monotonic_growth{}};
+
+  // Draws are recorded into per-thread secondary command buffers and
+  // executed from each frame's primary.
+  worker_pool recordWorkers{};
+  parallel_recorder recorder{
+      *devicePtr, queueFamily.familyIndex, framesInFlight, recordWorkers};
+  std::array<VkBuffer, 2> vertexBuffers{vertexBuffer, vertexColorBuffer};
+  std::array<VkDeviceSize, 2> vertexOffsets{};
+  // dynamic state isn't inherited, so every secondary sets it
+  auto recordDraws = [&](VkCommandBuffer cmd, size_t begin, size_t end) {
+    auto extent = swapResources.extent();
+    VkViewport viewport{};
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.f;
+    viewport.maxDepth = 1.f;
+    VkRect2D scissor{{0, 0}, extent};
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline3DHandle);
+    vkCmdBindVertexBuffers(
+        cmd, 0, 2, vertexBuffers.data(), vertexOffsets.data());
+    for (auto draw = begin; draw < end; ++draw) {
+      vkCmdDraw(cmd, 3, 1, 0, 0);
+    }
+  };
 
-  auto buildCmdBuffer = [&](uint32_t imageIndex) {
-    VkCommandBuffer cmd = *cmdPtr[imageIndex];
+  auto buildCmdBuffer = [&](size_t frame, uint32_t imageIndex) {
+    vkResetCommandPool(*devicePtr, *cmdPools[frame], 0);
+    VkCommandBuffer cmd = *cmdPtr[frame];
     VkCommandBufferBeginInfo beginInfo{
         VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     vkBeginCommandBuffer(cmd, &beginInfo);
 
     VkImageMemoryBarrier swapBarrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
     swapBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
     swapBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     swapBarrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    swapBarrier.image = swapImages[imageIndex];
+    swapBarrier.image = swapResources.image(imageIndex);
     swapBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     swapBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
     swapBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+    // starts at the stage the acquire semaphore is waited on, so the
+    // transition can't run before the image is released by presentation
     vkCmdPipelineBarrier(
         cmd,
-        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
         0,
         0,
@@ -416,79 +329,73 @@ int main() {
     renderBeginInfo.clearValueCount = 1;
     renderBeginInfo.pClearValues = &clearValue;
     renderBeginInfo.renderPass = *renderPassPtr;
-    renderBeginInfo.renderArea = scissor;
-    renderBeginInfo.framebuffer = *framebuffers[imageIndex];
-    vkCmdBeginRenderPass(cmd, &renderBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    renderBeginInfo.renderArea = {{0, 0}, swapResources.extent()};
+    renderBeginInfo.framebuffer = swapResources.framebuffer(imageIndex);
+    vkCmdBeginRenderPass(
+        cmd, &renderBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, *pipeline3DPtr);
-    vkCmdBindVertexBuffers(
+    recorder.record(
         cmd,
+        frame,
+        *renderPassPtr,
         0,
-        2,
-        std::vector<VkBuffer>{*vertexBuffer, *vertexColorBuffer}.data(),
-        std::vector<VkDeviceSize>{0, 0}.data());
-
-    vkCmdDraw(cmd, 3, 1, 0, 0);
+        swapResources.framebuffer(imageIndex),
+        1,
+        recordDraws);
 
     vkCmdEndRenderPass(cmd);
     vkEndCommandBuffer(cmd);
   };
-  for (uint32_t i{}; i < 3; ++i) {
-    buildCmdBuffer(i);
-  }
 
-  auto acquireImage = [&]() -> std::optional<uint32_t> {
-    uint32_t imageIndex{};
-    auto result = vkAcquireNextImageKHR(
-        *devicePtr,
-        *swapchainPtr,
-        ~uint64_t{},
-        VK_NULL_HANDLE,
-        *imageReady,
-        &imageIndex);
-    if (result == VK_SUCCESS) {
-      return imageIndex;
+  // An out-of-date or suboptimal swapchain is rebuilt in place; a frame
+  // whose acquire failed just renders nothing. While the window has no
+  // area recreate() keeps the old swapchain and is retried next frame.
+  auto recreateSwapchain = [&]() {
+    if (swapResources.recreate(windowExtent())) {
+      scheduler.set_swap_image_count(swapResources.image_count());
+      multi_logger::get()->debug(
+          "Swapchain recreated at {}x{} with {} images in {:.2f} ms",
+          swapResources.extent().width,
+          swapResources.extent().height,
+          swapResources.image_count(),
+          swapResources.last_recreate_ms());
     }
-    return {};
-  };
-
-  auto submitDraw = [&](uint32_t imageIndex) {
-    VkFence imageReadyFence = *imageReady;
-    std::vector<VkFence> fences = {*imageReady,
-                                   *commandBufferExecuted[imageIndex]};
-    vkWaitForFences(*devicePtr, 2, fences.data(), true, ~uint64_t{});
-    vkResetFences(*devicePtr, 2, fences.data());
-
-    VkSubmitInfo drawSubmit{VK_STRUCTURE_TYPE_SUBMIT_INFO};
-    drawSubmit.commandBufferCount = 1;
-    VkCommandBuffer cmd = *cmdPtr[imageIndex];
-    drawSubmit.pCommandBuffers = &cmd;
-    drawSubmit.signalSemaphoreCount = 1;
-    VkSemaphore sem4 = *drawFinished;
-    drawSubmit.pSignalSemaphores = &sem4;
-
-    vkQueueSubmit(queue, 1, &drawSubmit, *commandBufferExecuted[imageIndex]);
-  };
-
-  auto presentImage = [&](uint32_t imageIndex) {
-    VkPresentInfoKHR presentInfo{VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
-    presentInfo.swapchainCount = 1;
-    VkSwapchainKHR swapchain = *swapchainPtr;
-    presentInfo.pSwapchains = &swapchain;
-    presentInfo.waitSemaphoreCount = 1;
-    VkSemaphore sem4 = *drawFinished;
-    presentInfo.pWaitSemaphores = &sem4;
-    presentInfo.pImageIndices = &imageIndex;
-    vkQueuePresentKHR(queue, &presentInfo);
   };
 
+  // CPU work for a frame overlaps the GPU executing the frames before it;
+  // begin_frame only blocks once framesInFlight frames are queued.
+  size_t frameNumber{};
   platform::window_should_close shouldClose{};
   while (!(shouldClose = platform::glfw::poll_os(*surfacePtr))) {
-    if (auto has_index = acquireImage()) {
-      auto index = *has_index;
-      submitDraw(index);
-      presentImage(index);
+    auto frame = scheduler.begin_frame();
+    frameArenas.begin_frame(frame);
+    log_frame_report(frameArenas);
+
+    if (auto imageIndex = scheduler.acquire(swapResources.swapchain())) {
+      buildCmdBuffer(frame, *imageIndex);
+      scheduler.submit(queue, {*cmdPtr[frame]});
+      scheduler.present(queue, swapResources.swapchain());
+    }
+    if (swapchain_resources::out_of_date(scheduler.last_result())) {
+      recreateSwapchain();
+    }
+
+    if (++frameNumber % 600 == 0) {
+      auto& stats = scheduler.stats();
+      multi_logger::get()->info(
+          "{:.1f} fps, cpu frame {:.2f} ms, gpu wait {:.2f} ms, latency "
+          "{:.2f} ms",
+          stats.frames_per_second(),
+          stats.cpu_frame_ms(),
+          stats.gpu_wait_ms(),
+          stats.latency_ms());
     }
   }
+  scheduler.wait_idle();
   vkDeviceWaitIdle(*devicePtr);
+  try {
+    pipelineCache.save();
+  } catch (const std::exception& error) {
+    multi_logger::get()->warn("{}", error.what());
+  }
 }
\ No newline at end of file
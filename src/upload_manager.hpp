@@ -0,0 +1,497 @@
+#pragma once
+#include "frame_ring_buffer.hpp"
+#include <memory_allocator.hpp>
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Index of a queue family that does transfers and nothing else, which on
+// discrete GPUs maps to the copy engines. The graphics family works too, it
+// just competes with rendering.
+inline std::optional<uint32_t> find_transfer_queue_family(
+    VkPhysicalDevice physicalDevice) {
+  uint32_t familyCount{};
+  vkGetPhysicalDeviceQueueFamilyProperties(
+      physicalDevice, &familyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> families(familyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(
+      physicalDevice, &familyCount, families.data());
+  for (uint32_t i{}; i < familyCount; ++i) {
+    auto flags = families[i].queueFlags;
+    if ((flags & VK_QUEUE_TRANSFER_BIT) &&
+        !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+      return i;
+    }
+  }
+  return {};
+}
+
+// Device-local buffer filled through the upload_manager. Usable once the
+// manager reports its ticket complete.
+struct device_local_buffer {
+  device_local_buffer() = default;
+  device_local_buffer(
+      VmaAllocator allocator,
+      VkBuffer buffer,
+      VmaAllocation allocation,
+      uint64_t ticket)
+      : m_allocator(allocator),
+        m_buffer(buffer),
+        m_allocation(allocation),
+        m_ticket(ticket) {}
+
+  device_local_buffer(device_local_buffer&& other) noexcept {
+    *this = std::move(other);
+  }
+
+  device_local_buffer& operator=(device_local_buffer&& other) noexcept {
+    std::swap(m_allocator, other.m_allocator);
+    std::swap(m_buffer, other.m_buffer);
+    std::swap(m_allocation, other.m_allocation);
+    std::swap(m_ticket, other.m_ticket);
+    return *this;
+  }
+
+  ~device_local_buffer() {
+    if (m_buffer) {
+      vmaDestroyBuffer(m_allocator, m_buffer, m_allocation);
+    }
+  }
+
+  operator VkBuffer() const { return m_buffer; }
+  uint64_t ticket() const { return m_ticket; }
+
+private:
+  VmaAllocator m_allocator{};
+  VkBuffer m_buffer{};
+  VmaAllocation m_allocation{};
+  uint64_t m_ticket{};
+};
+
+// Copies data to device-local buffers and images through a staging ring.
+// Copies are recorded into one command buffer per batch, with consecutive
+// copies to disjoint ranges of the same buffer merged into one
+// vkCmdCopyBuffer. A copy overlapping a range already written in the batch
+// is recorded after a transfer barrier, so the later write wins. submit()
+// sends the batch to the upload queue with a fence. Nothing waits on the
+// GPU unless every batch is still in flight or the staging ring is full;
+// callers poll complete(ticket) and start using a resource when it is.
+//
+// With a dedicated transfer family, resources are created with concurrent
+// sharing between it and the families in sharingFamilies, so no ownership
+// transfer is needed.
+struct upload_manager {
+  using ticket = uint64_t;
+
+  upload_manager(
+      VkDevice device,
+      VmaAllocator allocator,
+      VkQueue queue,
+      uint32_t queueFamilyIndex,
+      std::vector<uint32_t> sharingFamilies = {},
+      VkDeviceSize stagingSize = 32 * 1024 * 1024,
+      size_t batchCount = 3)
+      : m_device(device),
+        m_allocator(allocator),
+        m_queue(queue),
+        m_sharingFamilies(std::move(sharingFamilies)) {
+    m_sharingFamilies.push_back(queueFamilyIndex);
+    std::sort(m_sharingFamilies.begin(), m_sharingFamilies.end());
+    m_sharingFamilies.erase(
+        std::unique(m_sharingFamilies.begin(), m_sharingFamilies.end()),
+        m_sharingFamilies.end());
+
+    VkCommandPoolCreateInfo poolInfo{
+        VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+                     VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+    check(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_pool));
+    m_commandBuffers.resize(batchCount);
+    VkCommandBufferAllocateInfo allocateInfo{
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    allocateInfo.commandPool = m_pool;
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = static_cast<uint32_t>(batchCount);
+    check(vkAllocateCommandBuffers(
+        m_device, &allocateInfo, m_commandBuffers.data()));
+    m_fences.resize(batchCount);
+    for (auto& fence : m_fences) {
+      VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+      fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+      check(vkCreateFence(m_device, &fenceInfo, nullptr, &fence));
+    }
+    m_slotFences = std::make_unique<vulkan_frame_fences>(m_device, m_fences);
+
+    VkBufferCreateInfo stagingInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    stagingInfo.size = stagingSize;
+    stagingInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    VmaAllocationCreateInfo stagingAllocation{};
+    stagingAllocation.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+    stagingAllocation.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    VmaAllocationInfo stagingMapping{};
+    check(vmaCreateBuffer(
+        m_allocator,
+        &stagingInfo,
+        &stagingAllocation,
+        &m_staging,
+        &m_stagingAllocation,
+        &stagingMapping));
+    m_ring = std::make_unique<frame_ring>(
+        static_cast<std::byte*>(stagingMapping.pMappedData),
+        stagingSize,
+        staging_alignment,
+        *m_slotFences);
+    m_ring->begin_frame(0);
+  }
+
+  upload_manager(const upload_manager&) = delete;
+  upload_manager& operator=(const upload_manager&) = delete;
+
+  // Waits for submitted batches; copies queued but not submitted are
+  // dropped.
+  ~upload_manager() {
+    for (auto value = m_completed + 1; value <= m_submitted; ++value) {
+      m_slotFences->wait(slot_of(value));
+    }
+    m_ring.reset();
+    vmaDestroyBuffer(m_allocator, m_staging, m_stagingAllocation);
+    for (auto fence : m_fences) {
+      vkDestroyFence(m_device, fence, nullptr);
+    }
+    vkDestroyCommandPool(m_device, m_pool, nullptr);
+  }
+
+  // Creates a device-local buffer holding a copy of data. usage gets
+  // TRANSFER_DST added.
+  device_local_buffer create_buffer(
+      const void* data,
+      VkDeviceSize size,
+      VkBufferUsageFlags usage) {
+    VkBufferCreateInfo bufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    bufferInfo.size = size;
+    bufferInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    if (m_sharingFamilies.size() > 1) {
+      bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+      bufferInfo.queueFamilyIndexCount =
+          static_cast<uint32_t>(m_sharingFamilies.size());
+      bufferInfo.pQueueFamilyIndices = m_sharingFamilies.data();
+    }
+    VmaAllocationCreateInfo allocationInfo{};
+    allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    VkBuffer buffer{};
+    VmaAllocation allocation{};
+    check(vmaCreateBuffer(
+        m_allocator,
+        &bufferInfo,
+        &allocationInfo,
+        &buffer,
+        &allocation,
+        nullptr));
+    ticket ready{};
+    try {
+      ready = copy_to_buffer(buffer, 0, data, size);
+    } catch (...) {
+      vmaDestroyBuffer(m_allocator, buffer, allocation);
+      throw;
+    }
+    return {m_allocator, buffer, allocation, ready};
+  }
+
+  // Queues a copy of data into dst at dstOffset; returns the ticket of the
+  // batch that will carry it. Copies larger than the staging ring are split.
+  ticket copy_to_buffer(
+      VkBuffer dst,
+      VkDeviceSize dstOffset,
+      const void* data,
+      VkDeviceSize size) {
+    auto bytes = static_cast<const std::byte*>(data);
+    auto maxChunk = m_ring->capacity() / 2;
+    while (size > 0) {
+      auto chunk = std::min<VkDeviceSize>(size, maxChunk);
+      auto staged = stage(bytes, chunk);
+      recording();
+      // regions of one vkCmdCopyBuffer must not overlap
+      if (dst != m_pendingDst || overlaps(m_pendingRegions, dstOffset, chunk)) {
+        flush_buffer_copies();
+        m_pendingDst = dst;
+      }
+      m_pendingRegions.push_back({staged.offset, dstOffset, chunk});
+      bytes += chunk;
+      dstOffset += chunk;
+      size -= chunk;
+    }
+    return pending_ticket();
+  }
+
+  // Queues a copy of tightly packed texels into mip level 0, layer 0 of
+  // image, leaving it in finalLayout. The image's previous contents are
+  // discarded.
+  ticket copy_to_image(
+      VkImage image,
+      VkImageAspectFlags aspect,
+      VkExtent3D extent,
+      const void* data,
+      VkDeviceSize size,
+      VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+    if (size > m_ring->capacity()) {
+      throw std::invalid_argument{"Image upload exceeds the staging ring"};
+    }
+    auto staged = stage(static_cast<const std::byte*>(data), size);
+    auto cmd = recording();
+    flush_buffer_copies();
+
+    VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = {aspect, 0, 1, 0, 1};
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        cmd,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = staged.offset;
+    region.imageSubresource = {aspect, 0, 0, 1};
+    region.imageExtent = extent;
+    vkCmdCopyBufferToImage(
+        cmd,
+        m_staging,
+        image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1,
+        &region);
+
+    // later stages are synchronized by the batch fence; a transfer queue
+    // could not name them here anyway
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = finalLayout;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(
+        cmd,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &barrier);
+    return pending_ticket();
+  }
+
+  // Submits the copies queued since the last submit and returns their
+  // ticket. Without queued copies, returns the last submitted ticket.
+  ticket submit() {
+    if (!m_recording) {
+      return m_submitted;
+    }
+    flush_buffer_copies();
+    auto cmd = m_commandBuffers[m_slot];
+    // makes the copies visible to whatever the queue runs next, including
+    // the next batch's copies to the same buffers
+    VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask =
+        VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        cmd,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+    check(vkEndCommandBuffer(cmd));
+    VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cmd;
+    check(vkQueueSubmit(m_queue, 1, &submitInfo, m_fences[m_slot]));
+    m_recording = false;
+    m_batchWrites.clear();
+    ++m_submitted;
+
+    // the next slot is free once its previous batch finished, which only
+    // blocks when every batch is in flight
+    m_slot = (m_slot + 1) % m_fences.size();
+    if (m_submitted >= m_fences.size()) {
+      m_slotFences->wait(m_slot);
+      m_completed = std::max(m_completed, m_submitted + 1 - m_fences.size());
+    }
+    m_ring->begin_frame(m_slot);
+    return m_submitted;
+  }
+
+  // Whether the batch carrying ticket has finished on the GPU. Batches
+  // complete in submission order.
+  bool complete(ticket value) {
+    if (value <= m_completed) {
+      return true;
+    }
+    if (value > m_submitted) {
+      return false;
+    }
+    if (m_slotFences->signaled(slot_of(value))) {
+      m_completed = value;
+      return true;
+    }
+    return false;
+  }
+
+  // Blocks until ticket completes, submitting the current batch if it is
+  // the one carrying it. A ticket no submitted batch carries, such as
+  // pending_ticket() with nothing queued, has nothing to wait for.
+  void wait(ticket value) {
+    if (value > m_submitted) {
+      submit();
+    }
+    if (value > m_submitted) {
+      return;
+    }
+    if (!complete(value)) {
+      m_slotFences->wait(slot_of(value));
+      m_completed = value;
+    }
+  }
+
+  // ticket the copies queued now will complete with
+  ticket pending_ticket() const { return m_submitted + 1; }
+
+private:
+  // covers optimalBufferCopyOffsetAlignment and every texel size on the
+  // devices we target
+  static constexpr size_t staging_alignment = 16;
+
+  VkDevice m_device{};
+  VmaAllocator m_allocator{};
+  VkQueue m_queue{};
+  std::vector<uint32_t> m_sharingFamilies{};
+  VkCommandPool m_pool{};
+  std::vector<VkCommandBuffer> m_commandBuffers{};
+  std::vector<VkFence> m_fences{};
+  std::unique_ptr<vulkan_frame_fences> m_slotFences{};
+  VkBuffer m_staging{};
+  VmaAllocation m_stagingAllocation{};
+  std::unique_ptr<frame_ring> m_ring{};
+  size_t m_slot{};
+  bool m_recording{};
+  ticket m_submitted{};
+  ticket m_completed{};
+  VkBuffer m_pendingDst{};
+  std::vector<VkBufferCopy> m_pendingRegions{};
+  // buffer copies recorded in this batch since its last transfer barrier
+  std::vector<std::pair<VkBuffer, VkBufferCopy>> m_batchWrites{};
+
+  static void check(VkResult result) {
+    if (result != VK_SUCCESS) {
+      throw std::runtime_error{
+          "Upload manager Vulkan call failed: " +
+          std::to_string(static_cast<int>(result))};
+    }
+  }
+
+  size_t slot_of(ticket value) const { return (value - 1) % m_fences.size(); }
+
+  static bool overlaps(
+      const std::vector<VkBufferCopy>& regions,
+      VkDeviceSize dstOffset,
+      VkDeviceSize size) {
+    return std::any_of(regions.begin(), regions.end(), [&](auto& region) {
+      return dstOffset < region.dstOffset + region.size &&
+             region.dstOffset < dstOffset + size;
+    });
+  }
+
+  // Copies bytes into the staging ring, submitting the current batch to
+  // make room when it alone fills the ring.
+  ring_allocation stage(const std::byte* bytes, VkDeviceSize size) {
+    auto staged = m_ring->try_allocate(size, staging_alignment);
+    if (!staged) {
+      submit();
+      staged = m_ring->try_allocate(size, staging_alignment);
+    }
+    if (!staged) {
+      throw std::bad_alloc{};
+    }
+    std::memcpy(staged->data, bytes, size);
+    return *staged;
+  }
+
+  VkCommandBuffer recording() {
+    auto cmd = m_commandBuffers[m_slot];
+    if (!m_recording) {
+      check(vkResetFences(m_device, 1, &m_fences[m_slot]));
+      check(vkResetCommandBuffer(cmd, 0));
+      VkCommandBufferBeginInfo beginInfo{
+          VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+      beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+      check(vkBeginCommandBuffer(cmd, &beginInfo));
+      m_recording = true;
+    }
+    return cmd;
+  }
+
+  void flush_buffer_copies() {
+    if (m_pendingRegions.empty()) {
+      return;
+    }
+    auto cmd = m_commandBuffers[m_slot];
+    bool rewrites = std::any_of(
+        m_batchWrites.begin(), m_batchWrites.end(), [&](auto& write) {
+          return write.first == m_pendingDst &&
+                 overlaps(
+                     m_pendingRegions,
+                     write.second.dstOffset,
+                     write.second.size);
+        });
+    if (rewrites) {
+      // orders the earlier write before this one
+      VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      vkCmdPipelineBarrier(
+          cmd,
+          VK_PIPELINE_STAGE_TRANSFER_BIT,
+          VK_PIPELINE_STAGE_TRANSFER_BIT,
+          0,
+          1,
+          &barrier,
+          0,
+          nullptr,
+          0,
+          nullptr);
+      m_batchWrites.clear();
+    }
+    for (auto& region : m_pendingRegions) {
+      m_batchWrites.emplace_back(m_pendingDst, region);
+    }
+    vkCmdCopyBuffer(
+        cmd,
+        m_staging,
+        m_pendingDst,
+        static_cast<uint32_t>(m_pendingRegions.size()),
+        m_pendingRegions.data());
+    m_pendingRegions.clear();
+    m_pendingDst = VK_NULL_HANDLE;
+  }
+};
@@ -0,0 +1,224 @@
+#include "headless_vulkan.hpp"
+#include "upload_manager.hpp"
+#include <catch2/catch.hpp>
+#include <functional>
+
+namespace {
+// Runs record(cmd, readbackBuffer) on the graphics queue, waits, and
+// returns the readback buffer's contents.
+std::vector<std::byte> read_back(
+    headless_vulkan& vk,
+    VkDeviceSize size,
+    const std::function<void(VkCommandBuffer, VkBuffer)>& record) {
+  VkBufferCreateInfo bufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+  bufferInfo.size = size;
+  bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  VmaAllocationCreateInfo allocationInfo{};
+  allocationInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+  allocationInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  VkBuffer buffer{};
+  VmaAllocation allocation{};
+  VmaAllocationInfo mapping{};
+  REQUIRE(
+      vmaCreateBuffer(
+          vk.allocator,
+          &bufferInfo,
+          &allocationInfo,
+          &buffer,
+          &allocation,
+          &mapping) == VK_SUCCESS);
+
+  VkCommandPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+  poolInfo.queueFamilyIndex = vk.graphicsFamily;
+  VkCommandPool pool{};
+  vkCreateCommandPool(vk.device, &poolInfo, nullptr, &pool);
+  VkCommandBufferAllocateInfo allocateInfo{
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+  allocateInfo.commandPool = pool;
+  allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocateInfo.commandBufferCount = 1;
+  VkCommandBuffer cmd{};
+  vkAllocateCommandBuffers(vk.device, &allocateInfo, &cmd);
+  VkCommandBufferBeginInfo beginInfo{
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+  vkBeginCommandBuffer(cmd, &beginInfo);
+  record(cmd, buffer);
+  VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(
+      cmd,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_HOST_BIT,
+      0,
+      1,
+      &barrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
+  vkEndCommandBuffer(cmd);
+  VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &cmd;
+  vkQueueSubmit(vk.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+  vkQueueWaitIdle(vk.graphicsQueue);
+
+  auto data = static_cast<const std::byte*>(mapping.pMappedData);
+  std::vector<std::byte> result(data, data + size);
+  vkDestroyCommandPool(vk.device, pool, nullptr);
+  vmaDestroyBuffer(vk.allocator, buffer, allocation);
+  return result;
+}
+
+std::vector<std::byte> pattern(size_t size, unsigned seed) {
+  std::vector<std::byte> bytes(size);
+  for (size_t i{}; i < size; ++i) {
+    bytes[i] = std::byte((i * 131 + seed) >> 3);
+  }
+  return bytes;
+}
+
+std::vector<std::byte> read_buffer(
+    headless_vulkan& vk,
+    VkBuffer source,
+    VkDeviceSize size) {
+  return read_back(vk, size, [&](VkCommandBuffer cmd, VkBuffer dst) {
+    VkBufferCopy region{0, 0, size};
+    vkCmdCopyBuffer(cmd, source, dst, 1, &region);
+  });
+}
+}  // namespace
+
+TEST_CASE("Uploads reach device-local buffers") {
+  auto vk = headless_vulkan::create();
+  if (!vk) {
+    WARN("No Vulkan device; set VK_ICD_FILENAMES to lavapipe to run this");
+    return;
+  }
+  bool useTransferQueue = GENERATE(false, true);
+  if (useTransferQueue && !vk->transferFamily) {
+    return;
+  }
+  auto queue = useTransferQueue ? vk->transferQueue : vk->graphicsQueue;
+  auto family = useTransferQueue ? *vk->transferFamily : vk->graphicsFamily;
+
+  constexpr VkDeviceSize stagingSize = 1024 * 1024;
+  std::vector<device_local_buffer> buffers{};
+  std::vector<std::vector<std::byte>> contents{};
+  {
+    upload_manager uploads{
+        vk->device,
+        vk->allocator,
+        queue,
+        family,
+        {vk->graphicsFamily},
+        stagingSize};
+    // many small uploads share a batch; the large one spans several
+    for (size_t size : {16, 1000, 4096, 100, 3 * 1024 * 1024, 64}) {
+      contents.push_back(pattern(size, static_cast<unsigned>(size)));
+      buffers.push_back(uploads.create_buffer(
+          contents.back().data(), size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT));
+    }
+    auto last = uploads.submit();
+    REQUIRE(last == buffers.back().ticket());
+    REQUIRE(buffers.front().ticket() < buffers.back().ticket());
+    uploads.wait(last);
+    for (auto& buffer : buffers) {
+      REQUIRE(uploads.complete(buffer.ticket()));
+    }
+    REQUIRE_FALSE(uploads.complete(uploads.pending_ticket()));
+
+    SECTION("Partial updates land at their offset") {
+      auto update = pattern(256, 7);
+      uploads.copy_to_buffer(buffers[2], 512, update.data(), update.size());
+      uploads.wait(uploads.pending_ticket());
+      std::copy(update.begin(), update.end(), contents[2].begin() + 512);
+    }
+
+    SECTION("Waiting with nothing queued doesn't complete the next batch") {
+      auto empty = uploads.pending_ticket();
+      uploads.wait(empty);
+      auto update = pattern(64, 19);
+      auto queued =
+          uploads.copy_to_buffer(buffers[5], 0, update.data(), update.size());
+      REQUIRE(queued == empty);
+      REQUIRE_FALSE(uploads.complete(queued));
+      uploads.wait(queued);
+      REQUIRE(uploads.complete(queued));
+      contents[5] = update;
+    }
+
+    SECTION("Overlapping updates in one batch land in order") {
+      auto first = pattern(512, 11);
+      auto second = pattern(512, 13);
+      auto third = pattern(64, 17);
+      uploads.copy_to_buffer(buffers[2], 0, first.data(), first.size());
+      uploads.copy_to_buffer(buffers[2], 256, second.data(), second.size());
+      uploads.copy_to_buffer(buffers[3], 0, third.data(), third.size());
+      uploads.copy_to_buffer(buffers[2], 480, third.data(), third.size());
+      uploads.wait(uploads.pending_ticket());
+      std::copy(first.begin(), first.end(), contents[2].begin());
+      std::copy(second.begin(), second.end(), contents[2].begin() + 256);
+      std::copy(third.begin(), third.end(), contents[3].begin());
+      std::copy(third.begin(), third.end(), contents[2].begin() + 480);
+    }
+  }
+  for (size_t i{}; i < buffers.size(); ++i) {
+    REQUIRE(read_buffer(*vk, buffers[i], contents[i].size()) == contents[i]);
+  }
+}
+
+TEST_CASE("Uploads reach images") {
+  auto vk = headless_vulkan::create();
+  if (!vk) {
+    WARN("No Vulkan device; set VK_ICD_FILENAMES to lavapipe to run this");
+    return;
+  }
+  VkImageCreateInfo imageInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+  imageInfo.extent = {64, 32, 1};
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.usage =
+      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  VmaAllocationCreateInfo allocationInfo{};
+  allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+  VkImage image{};
+  VmaAllocation allocation{};
+  REQUIRE(
+      vmaCreateImage(
+          vk->allocator,
+          &imageInfo,
+          &allocationInfo,
+          &image,
+          &allocation,
+          nullptr) == VK_SUCCESS);
+
+  auto texels = pattern(64 * 32 * 4, 3);
+  {
+    upload_manager uploads{
+        vk->device, vk->allocator, vk->graphicsQueue, vk->graphicsFamily};
+    auto ready = uploads.copy_to_image(
+        image,
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        imageInfo.extent,
+        texels.data(),
+        texels.size(),
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    uploads.wait(ready);
+  }
+  auto result =
+      read_back(*vk, texels.size(), [&](VkCommandBuffer cmd, VkBuffer dst) {
+        VkBufferImageCopy region{};
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageExtent = imageInfo.extent;
+        vkCmdCopyImageToBuffer(
+            cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst, 1, &region);
+      });
+  REQUIRE(result == texels);
+  vmaDestroyImage(vk->allocator, image, allocation);
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads for data-parallel loops. The calling thread works
+// alongside the pool, so a pool of n threads runs loops n + 1 wide and a pool
+// of zero threads runs them inline.
+struct worker_pool {
+  explicit worker_pool(
+      size_t threadCount = std::max(1u, std::thread::hardware_concurrency()) -
+                           1) {
+    for (size_t i{}; i < threadCount; ++i) {
+      m_threads.emplace_back([this] { run(); });
+    }
+  }
+
+  worker_pool(const worker_pool&) = delete;
+  worker_pool& operator=(const worker_pool&) = delete;
+
+  ~worker_pool() {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads) {
+      thread.join();
+    }
+  }
+
+  // threads taking part in a loop, including the caller
+  size_t width() const { return m_threads.size() + 1; }
+
+  // Calls fn(begin, end) over [0, count) in chunks of at most grain and
+  // returns once every chunk has run. fn must not throw. Loops must not be
+  // started concurrently or from inside fn.
+  template <typename Fn>
+  void parallel_for(size_t count, size_t grain, Fn&& fn) {
+    grain = std::max<size_t>(grain, 1);
+    if (m_threads.empty() || count <= grain) {
+      if (count > 0) {
+        fn(size_t{}, count);
+      }
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_job = [&fn](size_t begin, size_t end) { fn(begin, end); };
+      m_count = count;
+      m_grain = grain;
+      m_next.store(0, std::memory_order_relaxed);
+      m_busy = m_threads.size();
+      ++m_generation;
+    }
+    m_wake.notify_all();
+    run_chunks();
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_done.wait(lock, [this] { return m_busy == 0; });
+    m_job = nullptr;
+  }
+
+private:
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  std::function<void(size_t, size_t)> m_job;
+  size_t m_count{};
+  size_t m_grain{};
+  std::atomic<size_t> m_next{};
+  size_t m_busy{};
+  size_t m_generation{};
+  bool m_stop{};
+
+  void run_chunks() {
+    while (true) {
+      auto begin = m_next.fetch_add(m_grain, std::memory_order_relaxed);
+      if (begin >= m_count) {
+        return;
+      }
+      m_job(begin, std::min(begin + m_grain, m_count));
+    }
+  }
+
+  void run() {
+    size_t seen{};
+    std::unique_lock<std::mutex> lock{m_mutex};
+    while (true) {
+      m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+      if (m_stop) {
+        return;
+      }
+      seen = m_generation;
+      lock.unlock();
+      run_chunks();
+      lock.lock();
+      if (--m_busy == 0) {
+        m_done.notify_one();
+      }
+    }
+  }
+};